@@ -20,6 +20,7 @@
 //      GNU g++ compiler v3.4.5                                                //
 //      Nexus Class Library (NCL) by Paul Lewis v2.0                           //
 //      available from http://hydrodictyon.eeb.uconn.edu/ncl/                  //
+//      POSIX threads (pthreads)                                               //
 //                                                                             //
 //  REVISION HISTORY:                                                          //
 //      Version 1.0, 9th Apr 2006 - Initial version                            //
@@ -28,9 +29,23 @@
 //=============================================================================//
 
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <ctime>
 #include <ncl.h>
+#include "aloecluster.h"
+#include "aloeconsensus.h"
+#include "aloecooccurrence.h"
+#include "aloeendemicareas.h"
+#include "aloenj.h"
+#include "aloenodf.h"
+#include "aloenullmodel.h"
+#include "aloepae.h"
+#include "aloerf.h"
+#include "aloesimilarity.h"
+#include "aloesplits.h"
+#include "aloestreamstats.h"
+#include "aloethreadpool.h"
 
 using namespace std;
 
@@ -38,60 +53,70 @@ using namespace std;
 class Token : public NxsToken
 	{
 	public:
-		Token(istream &is, ostream &os) : out(os), NxsToken(is) {}
+		Token(NxsInputSource &src, ostream &os, bool echo = true) : out(os), echoing(echo), NxsToken(src) {}
 		void OutputComment(const NxsString &msg) {
-			cout << msg << endl;
+			if (echoing)
+				cout << msg << endl;
 			out << msg << endl;
 			}
 	private:
 		ostream &out;
+		bool echoing;
 	};
 
 class Reader : public NxsReader
 	{
 	public:
-		ifstream inf;
+		NxsInputSource inf;
 		ofstream outf;
+		bool verbose;
+		bool failed;
+		NxsString lastError;
 
-		Reader(char *infname, char *outfname) : NxsReader()
+		Reader(const char *infname, const char *outfname, bool talk = true) : NxsReader(), inf(infname), verbose(talk), failed(false)
 			{
-			inf.open(infname, ios::binary);
-            cout << "Opening input data file " << infname << endl;
-			outf.open(outfname);
+            if (verbose)
+                cout << "Opening input data file " << infname << endl;
+			if (inf.IsOpen())
+				outf.open(outfname);
 			}
 
 		~Reader()
 			{
-			inf.close();
 			outf.close();
 			}
 
 	void ExecuteStarting()
         {
-        cout << "Reading data file..." << endl;
+        if (verbose)
+            cout << "Reading data file..." << endl;
         }
             
 	void ExecuteStopping() {}
 
 	bool EnteringBlock(NxsString blockName)
 		{
-		cout << "Reading \"" << blockName << "\" block..." << endl;
+		if (verbose)
+			cout << "Reading \"" << blockName << "\" block..." << endl;
 		return true;
 		}
 
     void ExitingBlock( NxsString blockName ) 
         {
-        cout << "Finished with " << blockName << " block." << endl;
+        if (verbose)
+            cout << "Finished with " << blockName << " block." << endl;
 		}
 
 	void SkippingBlock(NxsString blockName)
 		{
-		cout << "Skipping unknown block (" << blockName << ")..." << endl;
+		if (verbose)
+			cout << "Skipping unknown block (" << blockName << ")..." << endl;
 		}
 
 	void SkippingDisabledBlock(NxsString blockName)
         {
-        cout << "Skipping disabled block (" << blockName << ")..." << endl;
+        if (verbose)
+            cout << "Skipping disabled block (" << blockName << ")..." << endl;
         }
 
 	void OutputComment(const NxsString &msg)
@@ -99,20 +124,27 @@ class Reader : public NxsReader
 		outf << msg << endl;
 		}
 
-	void NexusError(NxsString msg, file_pos pos, unsigned line, unsigned col)
+	void NexusError(NxsString msg, file_pos pos, long line, long col)
 		{
-		cerr << endl;
-		cerr << "Error found at line " << line;
-		cerr << ", column " << col;
-		cerr << " (file position " << pos << "):" << endl;
-		cerr << msg << endl;
+		if (verbose) {
+			cerr << endl;
+			cerr << "Error found at line " << line;
+			cerr << ", column " << col;
+			cerr << " (file position " << pos << "):" << endl;
+			cerr << msg << endl;
+			}
 
 		outf << endl;
 		outf << "Error found at line " << line;
 		outf << ", column " << col;
 		outf << " (file position " << pos << "):" << endl;
 		outf << msg << endl;
-		exit(0);
+
+		failed = true;
+		lastError = "line ";
+		lastError += line;
+		lastError += ": ";
+		lastError += msg;
 		}
 };
 // --- End NCL stuff
@@ -127,155 +159,299 @@ float percent(int val1, int val2)
 	return(ret_val);
 }
 
-int main(int argc, char* argv[])
+// --- Input, output and results of the analysis of one data file
+struct AloeResult
 {
-        NxsTaxaBlock* taxa = new NxsTaxaBlock();
-        NxsAssumptionsBlock* assumptions = new NxsAssumptionsBlock (taxa);
-        NxsCharactersBlock* characters = new NxsCharactersBlock (taxa, assumptions);
-        NxsDataBlock* data = new NxsDataBlock (taxa, assumptions);
-        NxsTreesBlock* trees = new NxsTreesBlock(taxa);
-        
-        cout << "****************************************" << endl;
-        cout << " * AnaLysis Of Endemicity program v1.1 *" << endl;
-        cout << "****************************************" << endl;
-        cout << "(c) 2006-2024 Mauro J. Cavalcanti" << endl;
-        cout << "Ecoinformatics Studio, Rio de Janeiro, Brazil" << endl;
-        cout << "E-mail: maurobio@gmail.com" << endl;
-
-        // Get input file name
-        char infile[80];
-        cout << "\nEnter file name: ";
-        cin.getline(infile, 80); 
-		int ext = '.';
-		const char* extension = NULL;
-		extension = strrchr(infile, ext);
-		if((extension == NULL) || (strcmp(extension, ".nex")) !=0) {
-			cout << "Invalid extension encountered!\n";
-			return 1;
-		}
+        AloeResult() : outno(0), weighted(false), similarity(false), index(AloeSimilarity::jaccard), cluster(false), clusterMethod(AloeCluster::upgma), nj(false), consensus(false), consensusMethod(AloeConsensus::majority), rf(false), replicates(0), bootstrap(0), jackknife(0), randomisations(0), nullModel(AloeNullModel::curveball), nestedness(false), cooccurrence(false), units(0), starts(0), width(0), seed(1), nthreads(1), ok(false), ntax(0), nchar(0), endemics(0) {}
+        string infile;
+        string outfile;
         int outno;
-        cout << "\nEnter outgroup number (0 for none): ";
-        cin >> outno;
-        cout << endl;
-        
-        // Open input and output (results) files
-        Reader nexus (infile, "Aloe.txt");
-        nexus.Add (taxa);
-        nexus.Add (assumptions);
-        nexus.Add (characters);
-        nexus.Add (data);
-        nexus.Add (trees);
-        Token token (nexus.inf, nexus.outf);
-        nexus.Execute (token);
+        bool weighted;
+        bool similarity;
+        AloeSimilarity::IndexEnum index;
+        bool cluster;
+        AloeCluster::MethodEnum clusterMethod;
+        bool nj;
+        bool consensus;
+        AloeConsensus::MethodEnum consensusMethod;
+        bool rf;
+        unsigned replicates;
+        unsigned bootstrap, jackknife;
+        unsigned randomisations;
+        AloeNullModel::AlgorithmEnum nullModel;
+        bool nestedness;
+        bool cooccurrence;
+        unsigned units;
+        unsigned starts, width;
+        unsigned long seed;
+        unsigned nthreads;
+        bool ok;
+        string message;
+        int ntax, nchar, endemics;
+};
 
-        // Get number of characters (species) and taxa (areas) from the input file
-        int ntax, nchar;
-        if (!characters->IsEmpty()) {
-           if (outno > 0) {
-             characters->DeleteTaxon(outno);
-             ntax = characters->GetNumActiveTaxa();
-           } 
-           else 
-             ntax = characters->GetNTax();
-           nchar = characters->GetNChar();
-           }
-        else if (!data->IsEmpty()) {
-           if (outno > 0) {
-             data->DeleteTaxon(outno);
-             ntax = data->GetNumActiveTaxa();
-           } 
-           else
-             ntax = data->GetNTax();
-           nchar = data->GetNChar();
-        }
-
-        // Store data matrix
-        NxsDiscreteMatrix* matrix = new NxsDiscreteMatrix (ntax, nchar);
-        if (!matrix) {
-           cout << "Error storing data matrix! Execution terminated." << endl;
-           return(1);
-        }   
-
-        unsigned char dataMatrix [ntax][nchar];
-        for (int i = 0; i < ntax; i++) {
-            for (int j = 0; j < nchar; j++) {
-               if (!characters->IsEmpty()) {
-                  if (!characters->IsMissingState(i, j))
-                    dataMatrix[i][j] = characters->GetState(i, j, 0);
-                  else
-                    dataMatrix[i][j] = characters->GetMissingSymbol();
-               }
-               else if (!data->IsEmpty()) {
-                  if (!data->IsMissingState(i, j))
-                    dataMatrix[i][j] = data->GetState(i, j, 0);
-                  else
-                    dataMatrix[i][j] = data->GetMissingSymbol();
-               }
-            }
+// Return file name `fn' without its extension
+string Stem(const string &fn)
+{
+        string stem = fn;
+        size_t dot = fn.rfind('.');
+        size_t slash = fn.find_last_of("/\\");
+        if (dot != string::npos && (slash == string::npos || dot > slash))
+          stem.erase(dot);
+        return stem;
+}
+
+// Return the stem of the names of the files written besides the results file
+// of `result': the results file name without its ".aloe.txt" (or any other)
+// extension, so that jobs with separate results files never share side files
+string OutputStem(const AloeResult &result)
+{
+        const string suffix = ".aloe.txt";
+        const string &fn = result.outfile;
+        if (fn.size() > suffix.size() && fn.compare(fn.size() - suffix.size(), suffix.size(), suffix) == 0)
+          return fn.substr(0, fn.size() - suffix.size());
+        return Stem(fn);
+}
+
+// Return the labels of the areas (taxa) listed in `areas'
+NxsStringVector AreaLabels(NxsTaxaBlock &taxa, const NxsUnsignedVector &areas)
+{
+        NxsStringVector labels;
+        for (unsigned i = 0; i < areas.size(); i++)
+          labels.push_back(taxa.GetTaxonLabel(areas[i]));
+        return labels;
+}
+
+// Return the labels of the species (characters) of `chars' listed in `species',
+// numbering those the data file leaves unlabelled
+NxsStringVector SpeciesLabels(NxsCharactersBlock &chars, const NxsUnsignedVector &species)
+{
+        NxsStringVector labels;
+        for (unsigned k = 0; k < species.size(); k++) {
+          unsigned j = species[k];
+          NxsString label = chars.GetCharLabel(j);
+          if (label == " ") {
+            label = "Species ";
+            label += j + 1;
+          }
+          labels.push_back(label);
         }
-        cout << "Data matrix stored in memory." << endl;
-        
-        // --- Write data matrix to csv file
-        //ofstream csvf;
-        //csvf.open("aloe.csv");
-        //csvf << taxa->GetTaxonLabel(0).c_str();
-        //for (int k = 1; k < ntax; k++) {
-        //  csvf << ";" << taxa->GetTaxonLabel(k).c_str();
-        //}
-        //csvf << endl;
-        //for (int j = 0; j < nchar; j++) {
-        //  csvf << characters->GetCharLabel(j).c_str();
-        //  for (int i = 0; i < ntax; i++) {
-        //    csvf << ";" << dataMatrix[i][j];
-        //  }
-        //  csvf << endl;
-        //}    
-        //csvf.close();
+        return labels;
+}
 
-        cout.setf(ios::left);
-        nexus.outf.setf(ios::left);
-        nexus.outf << "AnaLysis Of Endemicity program v1.2" << endl;
-        
-        time_t now = time(0);
-        char* dt = ctime(&now);
-        nexus.outf << "Date and time of analysis - " << dt;
-        nexus.outf << "Data file - " << infile << endl << endl;
-
-        // Compute area statistics
-        cout << "Area statistics" << endl << endl;
-        nexus.outf << "Area statistics" << endl << endl;
-        for (int i = 0; i < ntax; i++) {
-          int n = 0;
-          for (int j = 0; j < nchar; j++) {
-            if (dataMatrix[i][j] == '1') n++;
+// Record the reason why an analysis could not be done
+bool Fail(AloeResult &result, const string &msg, bool verbose)
+{
+        result.ok = false;
+        result.message = msg;
+        if (verbose)
+          cout << msg << "! Execution terminated." << endl;
+        return false;
+}
+
+// Write the heading of the results file
+void WriteHeader(ostream &out, const char *dt, const string &infile)
+{
+        out.setf(ios::left);
+        out << "AnaLysis Of Endemicity program v1.2" << endl;
+        out << "Date and time of analysis - " << dt;
+        out << "Data file - " << infile << endl << endl;
+}
+
+// Take the distances between the areas from the DISTANCES block `distances',
+// packed as a lower triangle, and their labels from `taxa'. The areas deleted
+// from the matrix summarised by `stats' (e.g., the outgroup) are left out, as
+// they are from the dissimilarities; `stats' is NULL if there is no matrix
+bool ReadAreaDistances(AloeResult &result, NxsDistancesBlock &distances, NxsTaxaBlock &taxa, AloeStreamStats *stats, vector<float> &packed, NxsStringVector &labels, bool verbose)
+{
+        NxsUnsignedVector areas;
+        for (unsigned i = 0; i < distances.GetNtax(); i++) {
+          if (stats == NULL || i >= stats->GetNAreas() || stats->IsActiveArea(i))
+            areas.push_back(i);
+        }
+        try {
+          AloeCluster::PackDistances(distances, packed, &areas);
+        }
+        catch (NxsException &x) {
+          return Fail(result, x.msg, verbose);
+        }
+        labels = AreaLabels(taxa, areas);
+        return true;
+}
+
+// Cluster the areas into a dendrogram (-c) and join them into a neighbour-
+// joining tree (-t), from the distances `packed' between the areas labelled
+// `labels', taken from `source', each written to a NEXUS file named after
+// the results file
+bool ClusterAreas(AloeResult &result, vector<float> &packed, const NxsStringVector &labels, const string &source, ostream &out, bool verbose)
+{
+        unsigned n = (unsigned)labels.size();
+        if (result.cluster) {
+          string method = AloeCluster::GetMethodName(result.clusterMethod);
+          string fn = OutputStem(result) + "." + method + ".nex";
+          ofstream tf(fn.c_str());
+          if (!tf.is_open())
+            return Fail(result, "Cannot create tree file " + fn, verbose);
+          AloeCluster cluster;
+          vector<float> copy;
+          if (result.nj)
+            copy = packed;
+          else
+            copy.swap(packed);
+          cluster.SetDistances(n, copy);
+          cluster.Run(result.clusterMethod);
+          cluster.Write(tf, labels);
+          for (unsigned i = 0; i < method.size(); i++)
+            method[i] = toupper(method[i]);
+          out << endl << "Cluster analysis of areas (" << method << ", " << source << ")" << endl << endl;
+          out << setw(40) << "Areas clustered " << n << endl;
+          out << setw(40) << "Height of root " << setprecision(4) << cluster.GetHeight() << endl;
+          out << "Dendrogram written to " << fn << endl;
+          if (verbose)
+            cout << method << " dendrogram of " << n << " areas written to " << fn << endl;
+        }
+
+        if (result.nj) {
+          string fn = OutputStem(result) + ".nj.nex";
+          ofstream tf(fn.c_str());
+          if (!tf.is_open())
+            return Fail(result, "Cannot create tree file " + fn, verbose);
+          AloeNj nj;
+          nj.SetDistances(n, packed);
+          nj.Run(result.nthreads);
+          nj.Write(tf, labels);
+          out << endl << "Neighbour-joining tree of areas (" << source << ")" << endl << endl;
+          out << setw(40) << "Areas joined " << n << endl;
+          out << setw(40) << "Tree length " << setprecision(4) << nj.GetLength() << endl;
+          out << "Tree written to " << fn << endl;
+          if (verbose)
+            cout << "Neighbour-joining tree of " << n << " areas written to " << fn << endl;
+        }
+        return true;
+}
+
+// Return true if the trees of data file `fn' can be kept while it is read, so
+// that their splits can be counted on several threads: the file must take no
+// more than a quarter of the physical memory (or 1 GB, if that is not known)
+bool TreesFitInMemory(const string &fn)
+{
+        ifstream f(fn.c_str(), ios::in | ios::binary);
+        if (!f.is_open())
+          return true;
+        f.seekg(0, ios::end);
+        double size = (double)f.tellg();
+        double memory = AloeThreadPool::GetPhysicalMemory();
+        return size <= (memory > 0.0 ? memory / 4.0 : 1024.0 * 1024.0 * 1024.0);
+}
+
+// Summarise the trees of `trees' by their consensus (-q) and the Robinson-
+// Foulds distances between them (-f), each written to a NEXUS file named after
+// the results file. If the trees were dropped as they were read, `streamed'
+// has counted their splits; otherwise the splits are counted from the block
+bool SummariseTrees(AloeResult &result, NxsTreesBlock &trees, AloeSplitReader &streamed, NxsTaxaBlock &taxa, ostream &out, bool verbose)
+{
+        AloeSplitReader kept(trees, taxa);
+        AloeSplitReader &reader = (trees.AreTreesDiscarded() ? streamed : kept);
+        AloeSplitTable table;
+        try {
+          reader.Count(table, result.nthreads);
+        }
+        catch (NxsException &x) {
+          return Fail(result, x.msg, verbose);
+        }
+
+        if (result.consensus) {
+          string method = AloeConsensus::GetMethodName(result.consensusMethod);
+          string fn = OutputStem(result) + "." + method + ".nex";
+          ofstream tf(fn.c_str());
+          if (!tf.is_open())
+            return Fail(result, "Cannot create tree file " + fn, verbose);
+          AloeConsensus consensus;
+          try {
+            consensus.Build(reader, table, result.consensusMethod);
           }
-          cout << setw(40) << taxa->GetTaxonLabel(i).c_str() << " " << setw(10) << n << " taxa" << endl;
-          nexus.outf << setw(40) << taxa->GetTaxonLabel(i).c_str() << " " << setw(10) << n << " taxa" << endl;
-        }
-        cout << string(56, '-') << endl;
-        nexus.outf << string(56, '-') << endl;
-        cout << "Total areas = " << ntax << endl;
-        nexus.outf << "Total areas = " << ntax << endl;
-        cout << string(56, '-') << endl;
-        nexus.outf << string(56, '-') << endl << endl;
+          catch (NxsException &x) {
+            return Fail(result, x.msg, verbose);
+          }
+          NxsStringVector labels;
+          for (unsigned i = 0; i < reader.GetNTaxa(); i++)
+            labels.push_back(taxa.GetTaxonLabel(i));
+          consensus.Write(tf, labels);
+          method[0] = toupper(method[0]);
+          out << endl << method << " consensus of trees" << endl << endl;
+          out << setw(40) << "Trees " << reader.GetNTrees() << (reader.IsRooted() ? " (rooted)" : " (unrooted)") << endl;
+          out << setw(40) << "Distinct splits " << table.GetNSplits() << endl;
+          out << setw(40) << "Groups in consensus " << consensus.GetNGroups() << endl;
+          out << "Consensus written to " << fn << endl;
+          if (verbose)
+            cout << method << " consensus of " << reader.GetNTrees() << " trees written to " << fn << endl;
+        }
+
+        if (result.rf) {
+          string fn = OutputStem(result) + ".rf.nex";
+          ofstream df(fn.c_str());
+          if (!df.is_open())
+            return Fail(result, "Cannot create distance file " + fn, verbose);
+          AloeRf rf;
+          try {
+            rf.Read(reader, table, result.nthreads);
+          }
+          catch (NxsException &x) {
+            return Fail(result, x.msg, verbose);
+          }
+          NxsStringVector names;
+          for (unsigned i = 0; i < rf.GetNTrees(); i++)
+            names.push_back(trees.GetTreeName(i));
+          rf.Write(df, names, result.nthreads);
+          out << endl << "Robinson-Foulds distances between trees" << endl << endl;
+          out << setw(40) << "Trees " << rf.GetNTrees() << (reader.IsRooted() ? " (rooted)" : " (unrooted)") << endl;
+          out << setw(40) << "Largest possible distance " << rf.GetMaxDistance() << endl;
+          out << setw(40) << "Mean distance " << setprecision(4) << rf.GetMeanDistance() << endl;
+          out << "Distances written to " << fn << endl;
+          if (verbose)
+            cout << "Robinson-Foulds distances between " << rf.GetNTrees() << " trees written to " << fn << endl;
+        }
+        return true;
+}
+
+// Write the area, species and occurrence statistics, and the weighted endemism
+// of the areas if `weighted' is true (the console version differs from the
+// results file only in the spacing and one heading)
+void WriteStatistics(ostream &out, bool console, NxsTaxaBlock &taxa, NxsCharactersBlock &chars, AloeStreamStats &stats, bool weighted)
+{
+        int ntax = stats.GetNumActiveAreas();
+        int nchar = stats.GetNumActiveSpecies();
+        out.setf(ios::left);
+
+        // Compute area statistics (deleted areas and excluded species are left out)
+        out << "Area statistics" << endl << endl;
+        for (unsigned i = 0; i < stats.GetNAreas(); i++) {
+          if (!stats.IsActiveArea(i))
+            continue;
+          int n = stats.GetRichness(i);
+          out << setw(40) << taxa.GetTaxonLabel(i).c_str() << " " << setw(10) << n << " taxa" << endl;
+        }
+        out << string(56, '-') << endl;
+        out << "Total areas = " << ntax << endl;
+        out << string(56, '-') << endl;
+        if (!console)
+          out << endl;
      
         // Compute species statistics
-        cout << "Species statistics" << endl << endl;
-        nexus.outf << "Species statistics" << endl << endl;
+        out << "Species statistics" << endl << endl;
         string status;
-        int total = 0;
-        for (int j = 0; j < nchar; j++) {
-          int freq = 0;
-          for (int i = 0; i < ntax; i++) {
-            if (dataMatrix[i][j] == '1') freq++;
-          }     
+        const NxsUnsignedVector &speciesFreq = stats.GetFrequencies();
+        int total = stats.GetNumEndemics();
+        for (unsigned j = 0; j < stats.GetNSpecies(); j++) {
+          if (!stats.IsActiveSpecies(j))
+            continue;
+          int freq = speciesFreq[j];
           
           switch (freq) {
             case 0:
               status = "Absent";
               break;
             case 1:
-              total++;
               status = "Endemic";
               break;
             default:
@@ -283,38 +459,22 @@ int main(int argc, char* argv[])
               break;  
           }     
           
-          if (!characters->IsEmpty()) {
-            cout << setw(40) << characters->GetCharLabel(j).c_str() << setw(10) << freq << setw(10) << status << endl;
-            nexus.outf << setw(40) << characters->GetCharLabel(j).c_str() << setw(10) << freq << setw(10) << status << endl;
-          }  
-          else if (!data->IsEmpty()) {
-            cout << setw(40) << data->GetCharLabel(j).c_str() << setw(10) << freq << setw(10) << status << endl;
-            nexus.outf << setw(40) << data->GetCharLabel(j).c_str() << setw(10) << freq << setw(10) << status << endl;
-          }  
+          out << setw(40) << chars.GetCharLabel(j).c_str() << setw(10) << freq << setw(10) << status << endl;
         }    
         
-        cout << string(60, '-') << endl;
-        nexus.outf << string(60, '-') << endl;
-        cout << "Total taxa = " << nchar << endl;
-        cout << "Total widespread taxa = " << (nchar - total) << endl;
-        cout << "Total endemics = " << total << endl;
-        nexus.outf << "Total taxa = " << nchar << endl;
-        nexus.outf << "Total widespread taxa = " << (nchar - total) << endl;
-        nexus.outf << "Total endemics = " << total << endl;
-        cout << string(60, '-') << endl << endl;
-        nexus.outf << string(60, '-') << endl << endl;
+        out << string(60, '-') << endl;
+        out << "Total taxa = " << nchar << endl;
+        out << "Total widespread taxa = " << (nchar - total) << endl;
+        out << "Total endemics = " << total << endl;
+        out << string(60, '-') << endl << endl;
         
         // Compute occurrence statistics
-        cout << "Ocurrence statistics" << endl;
-        nexus.outf << "Ocurrence statistics" << endl;
+        out << "Ocurrence statistics" << endl;
         int one = 0, two = 0, three = 0, four = 0, five = 0;
-        for (int j = 0; j < nchar; j++) {
-          int freq = 0;
-          for (int i = 0; i < ntax; i++) {
-            if (dataMatrix[i][j] == '1') freq++;
-          }     
-          
-          switch (freq) {
+        for (unsigned j = 0; j < stats.GetNSpecies(); j++) {
+          if (!stats.IsActiveSpecies(j))
+            continue;
+          switch (speciesFreq[j]) {
               case 1:
                 one++;
                 break;
@@ -336,21 +496,680 @@ int main(int argc, char* argv[])
           }
         }
           
+        out << endl;
+        out << (console ? "Species occurring in:" : "Species occurring in...") << endl;
+        out << setw(40) << "   One area " << setw(10) << one << "(" << setprecision(3) << percent(one, nchar) << "%)" << endl;
+        out << setw(40) << "   Two areas " << setw(10) << two << "(" << setprecision(3) << percent(two, nchar) << "%)" << endl;
+        out << setw(40) << "   Three areas " << setw(10) << three << "(" << setprecision(3) << percent(three, nchar) << "%)" << endl;
+        out << setw(40) << "   Four areas " << setw(10) << four << "(" << setprecision(3) << percent(four, nchar) << "%)" << endl;
+        out << setw(40) << "   Five or more areas " << setw(10) << five << "(" << setprecision(3) << percent(five, nchar) << "%)" << endl;
+
+        // Compute weighted endemism (WE) and corrected weighted endemism (CWE)
+        AloeDoubleVector we, cwe;
+        if (!weighted || !stats.GetWeightedEndemism(we, cwe))
+          return;
+        out << endl << "Weighted endemism" << endl << endl;
+        out << setw(40) << "Area" << setw(10) << "WE" << setw(10) << "CWE" << endl;
+        for (unsigned i = 0; i < stats.GetNAreas(); i++) {
+          if (!stats.IsActiveArea(i))
+            continue;
+          out << setw(40) << taxa.GetTaxonLabel(i).c_str() << setw(10) << setprecision(4) << we[i] << setw(10) << setprecision(4) << cwe[i] << endl;
+        }
+        out << string(60, '-') << endl;
+}
+
+// Return true if an analysis asked for in `result' needs the presences in every
+// area, not just the counts gathered while reading
+bool NeedsRows(const AloeResult &result)
+{
+        return result.weighted || result.similarity || result.cluster || result.nj ||
+               result.replicates > 0 || result.bootstrap > 0 || result.jackknife > 0 ||
+               result.randomisations > 0 || result.nestedness || result.cooccurrence || result.starts > 0;
+}
+
+// Read and analyse the data file `result.infile', keeping the presences in
+// every area if `keepRows' is true. Returns false with `reread' set if the
+// file itself deletes taxa or excludes characters and the presences, needed
+// to leave them out, were not kept.
+bool AnalyseFile(AloeResult &result, const char *dt, bool verbose, bool keepRows, bool &reread)
+{
+        NxsTaxaBlock taxa;
+        NxsAssumptionsBlock assumptions (&taxa);
+        NxsCharactersBlock characters (&taxa, &assumptions);
+        NxsDataBlock data (&taxa, &assumptions);
+        NxsTreesBlock trees (&taxa);
+        NxsDistancesBlock distances (&taxa);
+        characters.SetMatrixStorage(NxsDiscreteMatrix::packedStorage);
+        data.SetMatrixStorage(NxsDiscreteMatrix::packedStorage);
+        distances.SetMatrixStorage(NxsDistancesBlock::packedStorage);
+        int outno = result.outno;
+
+        // Gather statistics while the matrix is being read, without storing it
+        AloeStreamStats charStats, dataStats;
+        characters.SetRowListener(&charStats);
+        data.SetRowListener(&dataStats);
+
+        // Weighted endemism, area similarity, PAE, the null model and the search
+        // for areas of endemism need the presences themselves, one bit per cell,
+        // as does leaving out the taxa deleted and characters excluded by the
+        // file; the outgroup is left out as it is read, so it needs nothing kept
+        AloeBitMatrix charRows, dataRows;
+        if (keepRows) {
+          charStats.KeepRows(&charRows);
+          dataStats.KeepRows(&dataRows);
+        }
+        if (outno > 0) {
+          charStats.LeaveOut(outno - 1);
+          dataStats.LeaveOut(outno - 1);
+        }
+
+        // Count the splits of the trees to be summarised while they are read,
+        // keeping only their names, if the trees are too many to be kept
+        AloeSplitReader splitReader(taxa, result.rf);
+        if ((result.consensus || result.rf) && !TreesFitInMemory(result.infile))
+          trees.SetTreeListener(&splitReader);
+        
+        // Open input and output (results) files
+        Reader nexus (result.infile.c_str(), result.outfile.c_str(), verbose);
+        if (!nexus.inf.IsOpen())
+          return Fail(result, "Cannot open input data file " + result.infile, verbose);
+        if (!nexus.outf.is_open())
+          return Fail(result, "Cannot create results file " + result.outfile, verbose);
+        nexus.Add (&taxa);
+        nexus.Add (&assumptions);
+        nexus.Add (&characters);
+        nexus.Add (&data);
+        nexus.Add (&trees);
+        nexus.Add (&distances);
+        Token token (nexus.inf, nexus.outf, verbose);
+        nexus.Execute (token);
+        if (nexus.failed) {
+          result.ok = false;
+          result.message = nexus.lastError;
+          return false;
+        }
+
+        // Get number of characters (species) and taxa (areas) from the input file
+        NxsCharactersBlock* chars = NULL;
+        AloeStreamStats* stats = NULL;
+        if (!characters.IsEmpty()) {
+           chars = &characters;
+           stats = &charStats;
+        }
+        else if (!data.IsEmpty()) {
+           chars = &data;
+           stats = &dataStats;
+        }
+        if (chars == NULL) {
+          // A file of trees alone can still be summarised by their consensus
+          // and the distances between them, and a file of distances alone
+          // (e.g., one written by -d) can still be clustered and joined
+          bool summarise = (result.consensus || result.rf) && !trees.IsEmpty();
+          bool cluster = (result.cluster || result.nj) && !distances.IsEmpty();
+          if (!summarise && !cluster)
+            return Fail(result, "No CHARACTERS or DATA block found", verbose);
+          WriteHeader(nexus.outf, dt, result.infile);
+          if (cluster) {
+            vector<float> packed;
+            NxsStringVector labels;
+            if (!ReadAreaDistances(result, distances, taxa, NULL, packed, labels, verbose))
+              return false;
+            if (!ClusterAreas(result, packed, labels, "DISTANCES block", nexus.outf, verbose))
+              return false;
+          }
+          if (summarise && !SummariseTrees(result, trees, splitReader, taxa, nexus.outf, verbose))
+            return false;
+          result.ok = true;
+          result.ntax = taxa.GetNumTaxonLabels();
+          return true;
+        }
+        // The outgroup (numbered from 1) is deleted like any other taxon, and
+        // the statistics follow the taxa deleted and the characters excluded
+        // (e.g., by EXSET *), visiting only the rows and columns that change
+        if (outno > 0) {
+          if (outno > (int)chars->GetNTax())
+            return Fail(result, "Invalid outgroup number", verbose);
+          chars->DeleteTaxon(outno - 1);
+        }
+        if (!stats->ApplyMasks(*chars)) {
+          reread = !keepRows;
+          return Fail(result, "Cannot apply the deleted taxa and excluded characters to the statistics", verbose && keepRows);
+        }
+        int ntax = stats->GetNumActiveAreas();
+        int nchar = stats->GetNumActiveSpecies();
+        if (verbose)
+          cout << "Data matrix summarised while reading." << endl;
+
+        // The analyses of areas see only the active areas and species; the
+        // presences are copied only if something was deleted or excluded
+        NxsUnsignedVector areas, species;
+        AloeBitMatrix activeRows;
+        stats->GetActiveAreas(areas);
+        const AloeBitMatrix &active = (keepRows ? stats->Select(activeRows, areas, species) : activeRows);
+
+        // --- Write data matrix to csv file
+        //ofstream csvf;
+        //csvf.open("aloe.csv");
+        //csvf << taxa->GetTaxonLabel(0).c_str();
+        //for (int k = 1; k < ntax; k++) {
+        //  csvf << ";" << taxa->GetTaxonLabel(k).c_str();
+        //}
+        //csvf << endl;
+        //for (int j = 0; j < nchar; j++) {
+        //  csvf << characters->GetCharLabel(j).c_str();
+        //  for (int i = 0; i < ntax; i++) {
+        //    csvf << ";" << (dataMatrix.Test(i, j) ? '1' : '0');
+        //  }
+        //  csvf << endl;
+        //}    
+        //csvf.close();
+
+        WriteHeader(nexus.outf, dt, result.infile);
+
+        if (verbose)
+          WriteStatistics(cout, true, taxa, *chars, *stats, result.weighted);
+        WriteStatistics(nexus.outf, false, taxa, *chars, *stats, result.weighted);
+
+        // Compute area similarity, written as a DISTANCES block and as CSV
+        if (result.similarity) {
+          string stem = OutputStem(result) + "." + AloeSimilarity::GetIndexName(result.index);
+          ofstream nf((stem + ".nex").c_str());
+          ofstream cf((stem + ".csv").c_str());
+          if (!nf.is_open() || !cf.is_open())
+            return Fail(result, "Cannot create similarity files " + stem + ".nex and .csv", verbose);
+          AloeSimilarity sim(active, result.index, ntax);
+          sim.Write(nf, cf, AreaLabels(taxa, areas), result.nthreads);
+          string index = AloeSimilarity::GetIndexName(result.index);
+          index[0] = toupper(index[0]);
+          nexus.outf << endl << "Area similarity (" << index << ")" << endl << endl;
+          nexus.outf << setw(40) << "Areas compared " << ntax << endl;
+          nexus.outf << "Similarities written to " << stem << ".csv and dissimilarities to " << stem << ".nex" << endl;
+          if (verbose)
+            cout << "Area similarity written to " << stem << ".nex and " << stem << ".csv" << endl;
+        }
+
+        // Cluster the areas into a dendrogram, and join them into a neighbour-
+        // joining tree, from the distances given in the data file if there
+        // are any, otherwise from the dissimilarity (one minus the similarity)
+        // of their species
+        if (result.cluster || result.nj) {
+          vector<float> packed;
+          string source;
+          NxsStringVector labels;
+          if (!distances.IsEmpty()) {
+            if (!ReadAreaDistances(result, distances, taxa, stats, packed, labels, verbose))
+              return false;
+            source = "DISTANCES block";
+          }
+          else {
+            AloeSimilarity(active, result.index, ntax).GetDissimilarities(packed, result.nthreads);
+            source = AloeSimilarity::GetIndexName(result.index);
+            labels = AreaLabels(taxa, areas);
+          }
+
+          if (!ClusterAreas(result, packed, labels, source, nexus.outf, verbose))
+            return false;
+        }
+
+        // Consensus of and distances between the trees given in the data file
+        if ((result.consensus || result.rf) && !trees.IsEmpty()) {
+          if (!SummariseTrees(result, trees, splitReader, taxa, nexus.outf, verbose))
+            return false;
+        }
+
+        // Parsimony analysis of endemicity, rooted on the outgroup area (or on
+        // a hypothetical area with every species absent): the most parsimonious
+        // trees and the consensus of bootstrap and jackknife replicates are
+        // written to NEXUS TREES blocks
+        unsigned resamples[2] = {result.bootstrap, result.jackknife};
+        if (result.replicates > 0 || resamples[0] > 0 || resamples[1] > 0) {
+          // The outgroup is a terminal here, although it is left out elsewhere
+          NxsUnsignedVector paeAreas, paeSpecies;
+          AloeBitMatrix paeRows;
+          int outgroupRow = (int)AloePae::noOutgroup;
+          for (unsigned i = 0; i < stats->GetNAreas(); i++) {
+            bool outgroup = (i + 1 == (unsigned)outno);
+            if (outgroup)
+              outgroupRow = (int)paeAreas.size();
+            if (outgroup || stats->IsActiveArea(i))
+              paeAreas.push_back(i);
+          }
+          NxsStringVector labels = AreaLabels(taxa, paeAreas);
+          AloePae pae(stats->Select(paeRows, paeAreas, paeSpecies), outgroupRow);
+          nexus.outf << endl << "Parsimony analysis of endemicity" << endl << endl;
+          nexus.outf << setw(40) << "Informative species " << pae.GetNInformative() << endl;
+          nexus.outf << setw(40) << "Random seed " << result.seed << endl;
+
+          if (result.replicates > 0) {
+            string fn = OutputStem(result) + ".pae.nex";
+            ofstream tf(fn.c_str());
+            if (!tf.is_open())
+              return Fail(result, "Cannot create tree file " + fn, verbose);
+            pae.Search(result.replicates, result.seed, result.nthreads);
+            pae.Write(tf, labels);
+            nexus.outf << setw(40) << "Replicates (TBR) " << result.replicates << endl;
+            nexus.outf << setw(40) << "Tree length " << pae.GetLength() << endl;
+            nexus.outf << setw(40) << "Most parsimonious trees " << pae.GetNTrees() << endl;
+            nexus.outf << setw(40) << "Consistency index " << setprecision(3) << pae.GetConsistencyIndex() << endl;
+            nexus.outf << setw(40) << "Retention index " << setprecision(3) << pae.GetRetentionIndex() << endl;
+            nexus.outf << "Trees written to " << fn << endl;
+            if (verbose)
+              cout << pae.GetNTrees() << " most parsimonious area cladogram(s) of length " << pae.GetLength() << " written to " << fn << endl;
+          }
+
+          for (int m = AloePae::bootstrap; m <= AloePae::jackknife; m++) {
+            if (resamples[m] == 0)
+              continue;
+            string method = AloePae::GetResampleName((AloePae::ResampleEnum)m);
+            string fn = OutputStem(result) + "." + method + ".nex";
+            ofstream cf(fn.c_str());
+            if (!cf.is_open())
+              return Fail(result, "Cannot create tree file " + fn, verbose);
+            pae.Resample((AloePae::ResampleEnum)m, resamples[m], result.seed, result.nthreads);
+            pae.WriteConsensus(cf, labels);
+            method[0] = toupper(method[0]);
+            nexus.outf << setw(40) << (method + " replicates ") << resamples[m] << endl;
+            nexus.outf << "Majority-rule consensus written to " << fn << endl;
+            if (verbose)
+              cout << method << " consensus of " << resamples[m] << " replicates written to " << fn << endl;
+          }
+        }
+
+        // Test the number of endemic species in each area, and the nestedness
+        // (NODF) and co-occurrence of species (C-score) if asked for, against
+        // random matrices with the same area and species totals. Pairs of
+        // species with many checkerboard units are written as they are found.
+        // Statistics are given to the null model only when it will be run,
+        // since it evaluates them again on the observed data
+        if (result.randomisations > 0 || result.nestedness || result.cooccurrence) {
+          string pairsFile = OutputStem(result) + ".cooccurrence.csv";
+          ofstream pf;
+          if (result.units > 0) {
+            pf.open(pairsFile.c_str());
+            if (!pf.is_open())
+              return Fail(result, "Cannot create co-occurrence file " + pairsFile, verbose);
+          }
+          NxsStringVector labels = AreaLabels(taxa, areas);
+          AloeNullModel null(active, ntax);
+          unsigned knodf = 0, kcooccurrence = 0;
+          // A statistic not asked for is given an empty matrix, which costs nothing
+          const AloeBitMatrix none;
+          AloeNodf nodf(result.nestedness ? active : none, ntax, result.nthreads);
+          if (result.nestedness && result.randomisations > 0)
+            knodf = null.AddStatistic(&nodf);
+          AloeCooccurrence cooccurrence(result.cooccurrence ? active : none, ntax);
+          if (result.cooccurrence) {
+            if (result.units > 0)
+              cooccurrence.Run(pf, SpeciesLabels(*chars, species), result.units, result.nthreads);
+            else
+              cooccurrence.Run(result.nthreads);
+            if (result.randomisations > 0)
+              kcooccurrence = null.AddStatistic(&cooccurrence);
+          }
+          if (result.randomisations > 0) {
+            null.Run(result.randomisations, result.nullModel, result.seed, result.nthreads);
+            nexus.outf << endl;
+            null.Write(nexus.outf, labels);
+            if (verbose)
+              cout << "Endemic species tested against " << result.randomisations << " random matrices ("
+                   << AloeNullModel::GetAlgorithmName(result.nullModel) << ")" << endl;
+          }
+          if (result.nestedness) {
+            nexus.outf << endl;
+            nodf.Write(nexus.outf, &null, knodf);
+            if (verbose)
+              cout << "NODF = " << setprecision(4) << nodf.GetNodf() << endl;
+          }
+          if (result.cooccurrence) {
+            nexus.outf << endl;
+            cooccurrence.Write(nexus.outf, &null, kcooccurrence);
+            if (result.units > 0)
+              nexus.outf << "Pairs with at least " << result.units << " checkerboard units written to " << pairsFile << endl;
+            if (verbose)
+              cout << "C-score = " << setprecision(4) << cooccurrence.GetCScore() << endl;
+          }
+        }
+
+        // Search for sets of areas (contiguous grid cells if the width of the
+        // grid is given) holding species found mostly in them. A grid keeps
+        // every cell so that the cells stay in place, but a deleted cell
+        // (e.g., the outgroup) is left empty
+        if (result.starts > 0) {
+          NxsUnsignedVector cells(areas), cellSpecies;
+          AloeBitMatrix cellRows;
+          if (result.width > 0) {
+            cells.clear();
+            for (unsigned i = 0; i < stats->GetNAreas(); i++)
+              cells.push_back(i);
+          }
+          NxsStringVector cellLabels = AreaLabels(taxa, cells), speciesLabels = SpeciesLabels(*chars, species);
+          AloeEndemicAreas aoe(result.width > 0 ? stats->SelectCells(cellRows, cellSpecies) : stats->Select(cellRows, cells, cellSpecies),
+                               result.width, (unsigned)cells.size());
+          aoe.Search(result.starts, result.seed, result.nthreads);
+          nexus.outf << endl;
+          aoe.Write(nexus.outf, cellLabels, speciesLabels);
+          if (verbose)
+            cout << aoe.GetNAreas() << " area(s) of endemism found from " << result.starts << " starts" << endl;
+        }
+
+        result.ok = true;
+        result.ntax = ntax;
+        result.nchar = nchar;
+        result.endemics = stats->GetNumEndemics();
+        return true;
+}
+
+// Analyse the data file `result.infile', writing the results to `result.outfile'.
+// Progress messages and statistics are also shown on the console if `verbose' is
+// true. Everything used is local to the call, so separate files can be analysed
+// on separate threads at the same time. The presences in every area are kept
+// only for the analyses that need them, or if the file deletes taxa or excludes
+// characters itself, which is found out only by reading it a first time.
+bool Analyse(AloeResult &result, const char *dt, bool verbose)
+{
+        bool reread = false;
+        if (AnalyseFile(result, dt, verbose, NeedsRows(result), reread) || !reread)
+          return result.ok;
+        if (verbose)
+          cout << "Reading the data file again, keeping the presences in every area." << endl;
+        result.message.clear();
+        return AnalyseFile(result, dt, verbose, true, reread);
+}
+
+// --- Batch mode
+class AloeJob : public AloeTask
+	{
+	public:
+		AloeJob(AloeResult &r, const char *when) : result(r), dt(when) {}
+		void Run()
+			{
+			try {
+				Analyse(result, dt, false);
+				}
+			catch (NxsException &x) {
+				Fail(result, x.msg, false);
+				}
+			catch (exception &x) {
+				Fail(result, x.what(), false);
+				}
+			}
+	private:
+		AloeResult &result;
+		const char *dt;
+	};
+
+// Add a job for data file `infile'; the results go to `outfile' or, if that is
+// empty, to the data file name with its extension replaced by ".aloe.txt"
+void AddJob(vector<AloeResult> &jobs, const string &infile, int outno, const string &outfile)
+{
+        AloeResult job;
+        job.infile = infile;
+        job.outno = outno;
+        job.outfile = outfile;
+        if (job.outfile.empty())
+          job.outfile = Stem(infile) + ".aloe.txt";
+        jobs.push_back(job);
+}
+
+// Read a batch manifest with one job per line: the data file name, optionally
+// followed by the outgroup number (default `outno') and the results file name.
+// Blank lines and lines starting with '#' are ignored.
+bool ReadManifest(const char *fn, int outno, vector<AloeResult> &jobs)
+{
+        ifstream mf(fn);
+        if (!mf.is_open())
+          return false;
+        string line;
+        while (getline(mf, line)) {
+          istringstream fields(line);
+          string infile, outfile;
+          int n = outno;
+          if (!(fields >> infile) || infile[0] == '#')
+            continue;
+          if (fields >> n)
+            fields >> outfile;
+          AddJob(jobs, infile, n, outfile);
+        }
+        return true;
+}
+
+void Usage()
+{
+        cout << "Usage: aloe                      (interactive)" << endl;
+        cout << "       aloe [options] file.nex ... [-m manifest] ..." << endl << endl;
+        cout << "Options:" << endl;
+        cout << "   -a n        also search for areas of endemism from n random starts" << endl;
+        cout << "   -b n        also estimate clade support from n bootstrap replicates (PAE)" << endl;
+        cout << "   -c method   also cluster areas (upgma or wpgma), from a DISTANCES block or from -d" << endl;
+        cout << "   -d index    also compute area similarity (jaccard, sorensen or simpson)" << endl;
+        cout << "   -e model    null model algorithm for -n (curveball or swap, default curveball)" << endl;
+        cout << "   -f          also compute Robinson-Foulds distances between the trees in a TREES block" << endl;
+        cout << "   -g n        outgroup number for the files that follow (0 for none)" << endl;
+        cout << "   -i          also compute the weighted endemism (WE and CWE) of the areas" << endl;
+        cout << "   -j n        number of threads (default: one per core)" << endl;
+        cout << "   -k n        also estimate clade support from n jackknife replicates (PAE)" << endl;
+        cout << "   -m file     manifest listing one job per line: data file [outgroup [results file]]" << endl;
+        cout << "   -n n        also test endemic species per area (and NODF, C-score) against n random matrices" << endl;
+        cout << "   -o          also compute the nestedness (NODF) of areas and species" << endl;
+        cout << "   -p n        also search for most parsimonious area cladograms (PAE) with n replicates" << endl;
+        cout << "   -q method   also compute the consensus (strict, majority or greedy) of the trees in a TREES block" << endl;
+        cout << "   -r n        seed for the random numbers used by PAE, -n and -a (default 1)" << endl;
+        cout << "   -s file     summary table (default AloeSummary.txt)" << endl;
+        cout << "   -t          also build a neighbour-joining tree of areas, from a DISTANCES block or from -d" << endl;
+        cout << "   -u n        also write the pairs of species with at least n checkerboard units (implies -x)" << endl;
+        cout << "   -w n        areas are the cells of a grid n cells wide, listed row by row (for -a)" << endl;
+        cout << "   -x          also compute the co-occurrence of species (C-score)" << endl;
+}
+
+// Analyse every data file named on the command line or in a manifest, each as
+// an independent job on a thread pool, then write a summary table of all jobs
+int RunBatch(int argc, char* argv[])
+{
+        unsigned nthreads = 0;
+        int outno = 0;
+        bool weighted = false, similarity = false, cluster = false, nj = false, consensus = false, rf = false;
+        AloeSimilarity::IndexEnum index = AloeSimilarity::jaccard;
+        AloeCluster::MethodEnum clusterMethod = AloeCluster::upgma;
+        AloeConsensus::MethodEnum consensusMethod = AloeConsensus::majority;
+        unsigned replicates = 0, bootstrap = 0, jackknife = 0, randomisations = 0, starts = 0, width = 0, units = 0;
+        AloeNullModel::AlgorithmEnum nullModel = AloeNullModel::curveball;
+        bool nestedness = false, cooccurrence = false;
+        unsigned long seed = 1;
+        string summary = "AloeSummary.txt";
+        vector<AloeResult> jobs;
+        for (int k = 1; k < argc; k++) {
+          string arg = argv[k];
+          bool option = (arg == "-a" || arg == "-b" || arg == "-c" || arg == "-d" || arg == "-e" || arg == "-g" || arg == "-j" ||
+                        arg == "-k" || arg == "-m" || arg == "-n" || arg == "-p" || arg == "-q" || arg == "-r" || arg == "-s" ||
+                        arg == "-u" || arg == "-w");
+          if (option && k + 1 == argc) {
+            Usage();
+            return 1;
+          }
+          if (arg == "-a")
+            starts = atoi(argv[++k]);
+          else if (arg == "-b")
+            bootstrap = atoi(argv[++k]);
+          else if (arg == "-c") {
+            cluster = AloeCluster::ParseMethod(argv[++k], clusterMethod);
+            if (!cluster) {
+              Usage();
+              return 1;
+            }
+          }
+          else if (arg == "-d") {
+            similarity = AloeSimilarity::ParseIndex(argv[++k], index);
+            if (!similarity) {
+              Usage();
+              return 1;
+            }
+          }
+          else if (arg == "-e") {
+            if (!AloeNullModel::ParseAlgorithm(argv[++k], nullModel)) {
+              Usage();
+              return 1;
+            }
+          }
+          else if (arg == "-f")
+            rf = true;
+          else if (arg == "-g")
+            outno = atoi(argv[++k]);
+          else if (arg == "-i")
+            weighted = true;
+          else if (arg == "-j")
+            nthreads = atoi(argv[++k]);
+          else if (arg == "-k")
+            jackknife = atoi(argv[++k]);
+          else if (arg == "-n")
+            randomisations = atoi(argv[++k]);
+          else if (arg == "-o")
+            nestedness = true;
+          else if (arg == "-p")
+            replicates = atoi(argv[++k]);
+          else if (arg == "-q") {
+            consensus = AloeConsensus::ParseMethod(argv[++k], consensusMethod);
+            if (!consensus) {
+              Usage();
+              return 1;
+            }
+          }
+          else if (arg == "-r")
+            seed = strtoul(argv[++k], NULL, 10);
+          else if (arg == "-s")
+            summary = argv[++k];
+          else if (arg == "-t")
+            nj = true;
+          else if (arg == "-u") {
+            units = atoi(argv[++k]);
+            cooccurrence = true;
+          }
+          else if (arg == "-w")
+            width = atoi(argv[++k]);
+          else if (arg == "-x")
+            cooccurrence = true;
+          else if (arg == "-m") {
+            if (!ReadManifest(argv[++k], outno, jobs)) {
+              cout << "Cannot open manifest " << argv[k] << endl;
+              return 1;
+            }
+          }
+          else if (arg[0] == '-') {
+            Usage();
+            return 1;
+          }
+          else
+            AddJob(jobs, arg, outno, "");
+        }
+
+        // Two jobs must not write the same results file, nor the same files
+        // besides it (similarity, trees, pairs of species)
+        set<string> outfiles, stems;
+        for (unsigned k = 0; k < jobs.size(); k++) {
+          if (!outfiles.insert(jobs[k].outfile).second)
+            Fail(jobs[k], "Results file " + jobs[k].outfile + " is also used by another job", false);
+          else if (!stems.insert(OutputStem(jobs[k])).second)
+            Fail(jobs[k], "Files " + OutputStem(jobs[k]) + ".* are also written by another job", false);
+        }
+
+        time_t now = time(0);
+        char* dt = ctime(&now);
+        AloeThreadPool pool(nthreads);
+        vector<AloeJob*> tasks;
+        for (unsigned k = 0; k < jobs.size(); k++) {
+          if (!jobs[k].message.empty())
+            continue;
+          tasks.push_back(new AloeJob(jobs[k], dt));
+          pool.Add(tasks.back());
+        }
+
+        // Threads left over when there are fewer jobs than threads are given
+        // to the similarity computations, tree searches, randomisations and area searches of the jobs
+        unsigned spare = (tasks.empty() ? 1 : pool.GetNThreads() / tasks.size());
+        for (unsigned k = 0; k < jobs.size(); k++) {
+          jobs[k].weighted = weighted;
+          jobs[k].similarity = similarity;
+          jobs[k].index = index;
+          jobs[k].cluster = cluster;
+          jobs[k].clusterMethod = clusterMethod;
+          jobs[k].nj = nj;
+          jobs[k].consensus = consensus;
+          jobs[k].consensusMethod = consensusMethod;
+          jobs[k].rf = rf;
+          jobs[k].replicates = replicates;
+          jobs[k].bootstrap = bootstrap;
+          jobs[k].jackknife = jackknife;
+          jobs[k].randomisations = randomisations;
+          jobs[k].nullModel = nullModel;
+          jobs[k].nestedness = nestedness;
+          jobs[k].cooccurrence = cooccurrence;
+          jobs[k].units = units;
+          jobs[k].starts = starts;
+          jobs[k].width = width;
+          jobs[k].seed = seed;
+          jobs[k].nthreads = (spare > 0 ? spare : 1);
+        }
+        cout << "Analysing " << tasks.size() << " data file(s) on " << pool.GetNThreads() << " thread(s)..." << endl;
+        pool.Run();
+        for (unsigned k = 0; k < tasks.size(); k++)
+          delete tasks[k];
+
+        // Write summary table
+        ofstream sf(summary.c_str());
+        sf << "File\tOutgroup\tAreas\tSpecies\tWidespread\tEndemics\tResults\tStatus" << endl;
+        int failed = 0;
+        for (unsigned k = 0; k < jobs.size(); k++) {
+          AloeResult &r = jobs[k];
+          sf << r.infile << "\t" << r.outno << "\t";
+          if (r.ok)
+            sf << r.ntax << "\t" << r.nchar << "\t" << (r.nchar - r.endemics) << "\t" << r.endemics << "\t" << r.outfile << "\tOK" << endl;
+          else {
+            sf << "\t\t\t\t" << r.outfile << "\tError: " << r.message << endl;
+            failed++;
+          }
+        }
+        sf.close();
+        cout << (jobs.size() - failed) << " file(s) analysed, " << failed << " failed. Summary written to " << summary << endl;
+        return (failed > 0 ? 1 : 0);
+}
+
+int main(int argc, char* argv[])
+{
+        if (argc > 1)
+          return RunBatch(argc, argv);
+
+        cout << "****************************************" << endl;
+        cout << " * AnaLysis Of Endemicity program v1.1 *" << endl;
+        cout << "****************************************" << endl;
+        cout << "(c) 2006-2024 Mauro J. Cavalcanti" << endl;
+        cout << "Ecoinformatics Studio, Rio de Janeiro, Brazil" << endl;
+        cout << "E-mail: maurobio@gmail.com" << endl;
+
+        // Get input file name
+        string infile;
+        cout << "\nEnter file name: ";
+        getline(cin, infile);
+		size_t extension = infile.rfind('.');
+		if((extension == string::npos) || (infile.compare(extension, string::npos, ".nex")) !=0) {
+			cout << "Invalid extension encountered!\n";
+			return 1;
+		}
+        int outno;
+        cout << "\nEnter outgroup number (0 for none): ";
+        cin >> outno;
         cout << endl;
-        nexus.outf << endl;  
-        cout << "Species occurring in:" << endl;
-        nexus.outf << "Species occurring in..." << endl;
-        cout << setw(40) << "   One area " << setw(10) << one << "(" << setprecision(3) << percent(one, nchar) << "%)" << endl;
-        cout << setw(40) << "   Two areas " << setw(10) << two << "(" << setprecision(3) << percent(two, nchar) << "%)" << endl;
-        cout << setw(40) << "   Three areas " << setw(10) << three << "(" << setprecision(3) << percent(three, nchar) << "%)" << endl;
-        cout << setw(40) << "   Four areas " << setw(10) << four << "(" << setprecision(3) << percent(four, nchar) << "%)" << endl;
-        cout << setw(40) << "   Five or more areas " << setw(10) << five << "(" << setprecision(3) << percent(five, nchar) << "%)" << endl;
-        nexus.outf << setw(40) << "   One area " << setw(10) << one << "(" << setprecision(3) << percent(one, nchar) << "%)" << endl;
-        nexus.outf << setw(40) << "   Two areas " << setw(10) << two << "(" << setprecision(3) << percent(two, nchar) << "%)" << endl;
-        nexus.outf << setw(40) << "   Three areas " << setw(10) << three << "(" << setprecision(3) << percent(three, nchar) << "%)" << endl;
-        nexus.outf << setw(40) << "   Four areas " << setw(10) << four << "(" << setprecision(3) << percent(four, nchar) << "%)" << endl;
-        nexus.outf << setw(40) << "   Five or more areas " << setw(10) << five << "(" << setprecision(3) << percent(five, nchar) << "%)" <<endl;
         
+        AloeResult result;
+        result.infile = infile;
+        result.outno = outno;
+        result.outfile = "Aloe.txt";
+        result.weighted = true;
+
+        time_t now = time(0);
+        char* dt = ctime(&now);
+        cout.setf(ios::left);
+        if (!Analyse(result, dt, true))
+          return(1);
+
         //cout << "\nPress the <ENTER> key to finish...";
         //cin.get();
         return 0;
@@ -0,0 +1,257 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloebitmatrix.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Creates an empty matrix with no rows and no columns.
+*/
+AloeBitMatrix::AloeBitMatrix()
+	{
+	nrows	= 0;
+	ncols	= 0;
+	nwords	= 0;
+	bits	= NULL;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Creates a matrix with `rows' rows and `cols' columns, with every bit cleared.
+*/
+AloeBitMatrix::AloeBitMatrix(
+  unsigned rows,	/* number of rows (areas) */
+  unsigned cols)	/* number of columns (species) */
+	{
+	nrows	= 0;
+	ncols	= 0;
+	nwords	= 0;
+	bits	= NULL;
+	Reset(rows, cols);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Creates a copy of `other'.
+*/
+AloeBitMatrix::AloeBitMatrix(
+  const AloeBitMatrix &other)	/* the matrix to copy */
+	{
+	nrows	= 0;
+	ncols	= 0;
+	nwords	= 0;
+	bits	= NULL;
+	*this = other;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Deletes memory allocated for `bits'.
+*/
+AloeBitMatrix::~AloeBitMatrix()
+	{
+	delete [] bits;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes this matrix an exact copy of `other'.
+*/
+AloeBitMatrix &AloeBitMatrix::operator=(
+  const AloeBitMatrix &other)	/* the matrix to copy */
+	{
+	if (this != &other)
+		{
+		Reset(other.nrows, other.ncols);
+		size_t n = (size_t)nrows * nwords;
+		for (size_t k = 0; k < n; k++)
+			bits[k] = other.bits[k];
+		}
+	return *this;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of bits set in both `a' and `b', each of which is `n' words long.
+*/
+unsigned AloeBitMatrix::AndCount(
+  const AloeWord *a,	/* the first bit vector */
+  const AloeWord *b,	/* the second bit vector */
+  unsigned n)			/* the number of words in each vector */
+	{
+	unsigned count = 0;
+	for (unsigned k = 0; k < n; k++)
+		count += PopCount(a[k] & b[k]);
+	return count;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Clears every bit in the matrix without changing its dimensions.
+*/
+void AloeBitMatrix::Clear()
+	{
+	size_t n = (size_t)nrows * nwords;
+	for (size_t k = 0; k < n; k++)
+		bits[k] = 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `counts' with the number of bits set in each column (i.e., the number of areas in which each species occurs).
+|	The matrix is walked in 64 x 64 bit blocks; each block is transposed in registers so that the column totals can be
+|	obtained by popcount rather than by testing one bit at a time. Only one block is held at a time, so no transposed
+|	copy of the matrix is made.
+*/
+void AloeBitMatrix::ColumnCounts(
+  NxsUnsignedVector &counts) const	/* the vector to fill, resized to `ncols' */
+	{
+	counts.assign(ncols, 0);
+
+	AloeWord block[wordBits];
+	for (unsigned w = 0; w < nwords; w++)
+		{
+		unsigned firstCol = w * wordBits;
+		unsigned lastCol = firstCol + wordBits;
+		if (lastCol > ncols)
+			lastCol = ncols;
+
+		for (unsigned i = 0; i < nrows; i += wordBits)
+			{
+			unsigned k;
+			unsigned nr = nrows - i;
+			if (nr > wordBits)
+				nr = wordBits;
+			for (k = 0; k < nr; k++)
+				block[k] = bits[(size_t)(i + k) * nwords + w];
+			for (; k < wordBits; k++)
+				block[k] = 0;
+
+			Transpose64(block);
+
+			for (unsigned j = firstCol; j < lastCol; j++)
+				counts[j] += PopCount(block[j - firstCol]);
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes, for every column, whether the column has at least one bit set (`once') and whether it has at least two
+|	bits set (`twice'). Columns set in `once' but not in `twice' are the species present in exactly one area, so the
+|	endemic count is PopCount(once & ~twice). Both vectors are resized to `nwords'.
+*/
+void AloeBitMatrix::GetSingletonMask(
+  AloeWordVector &once,			/* on return, bit j set if column j has one or more bits set */
+  AloeWordVector &twice) const	/* on return, bit j set if column j has two or more bits set */
+	{
+	once.assign(nwords, 0);
+	twice.assign(nwords, 0);
+
+	for (unsigned i = 0; i < nrows; i++)
+		{
+		const AloeWord *r = GetRow(i);
+		for (unsigned w = 0; w < nwords; w++)
+			{
+			twice[w] |= once[w] & r[w];
+			once[w] |= r[w];
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of bits set in the `n' words starting at `w'.
+*/
+unsigned AloeBitMatrix::PopCount(
+  const AloeWord *w,	/* the bit vector */
+  unsigned n)			/* the number of words in `w' */
+	{
+	unsigned count = 0;
+	for (unsigned k = 0; k < n; k++)
+		count += PopCount(w[k]);
+	return count;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Discards the current contents and reallocates the matrix as `rows' x `cols', with every bit cleared.
+*/
+void AloeBitMatrix::Reset(
+  unsigned rows,	/* the new number of rows */
+  unsigned cols)	/* the new number of columns */
+	{
+	delete [] bits;
+	bits	= NULL;
+	nrows	= rows;
+	ncols	= cols;
+	nwords	= WordsFor(cols);
+
+	size_t n = (size_t)nrows * nwords;
+	if (n > 0)
+		{
+		bits = new AloeWord[n];
+		Clear();
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes `t' the transpose of this matrix, so that row j of `t' holds the areas in which species j occurs. Works on
+|	64 x 64 bit blocks using Transpose64.
+*/
+void AloeBitMatrix::Transpose(
+  AloeBitMatrix &t) const	/* the matrix to receive the transpose */
+	{
+	t.Reset(ncols, nrows);
+
+	AloeWord block[wordBits];
+	for (unsigned w = 0; w < nwords; w++)
+		{
+		unsigned firstCol = w * wordBits;
+		unsigned nc = ncols - firstCol;
+		if (nc > wordBits)
+			nc = wordBits;
+
+		for (unsigned i = 0; i < nrows; i += wordBits)
+			{
+			unsigned k;
+			unsigned nr = nrows - i;
+			if (nr > wordBits)
+				nr = wordBits;
+			for (k = 0; k < nr; k++)
+				block[k] = bits[(size_t)(i + k) * nwords + w];
+			for (; k < wordBits; k++)
+				block[k] = 0;
+
+			Transpose64(block);
+
+			for (k = 0; k < nc; k++)
+				t.bits[(size_t)(firstCol + k) * t.nwords + i / wordBits] = block[k];
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Transposes the 64 x 64 bit block in place, so that bit c of `block'[r] becomes bit r of `block'[c]. This is the
+|	recursive block-swap method: quadrants of 32 x 32 bits are swapped first, then 16 x 16 blocks within each quadrant,
+|	and so on down to single bits, for a total of 6 x 32 word operations.
+*/
+void AloeBitMatrix::Transpose64(
+  AloeWord *block)	/* array of 64 words to be transposed */
+	{
+	unsigned j = 32;
+	AloeWord m = ~(AloeWord)0 >> 32;
+	for (; j != 0; j >>= 1, m ^= (m << j))
+		{
+		for (unsigned k = 0; k < wordBits; k = ((k | j) + 1) & ~j)
+			{
+			AloeWord t = ((block[k] >> j) ^ block[k | j]) & m;
+			block[k] ^= t << j;
+			block[k | j] ^= t;
+			}
+		}
+	}
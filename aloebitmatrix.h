@@ -0,0 +1,227 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOEBITMATRIX_H
+#define ALOE_ALOEBITMATRIX_H
+
+#include <ncl.h>
+
+#if defined(_MSC_VER)
+	typedef unsigned __int64	AloeWord;
+#else
+	typedef unsigned long long	AloeWord;
+#endif
+
+typedef vector<AloeWord>	AloeWordVector;
+typedef vector<double>		AloeDoubleVector;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Presence/absence matrix stored as one bit per cell. Each row (area) is packed into `nwords' 64-bit words that are
+|	kept contiguously on the heap, so a 20000 x 80000 matrix needs about 200 MB rather than the 1.6 GB needed by one
+|	char per cell. Bits beyond `ncols' in the last word of every row are always zero, which allows whole-word
+|	operations (popcount, AND, OR) to be applied to a row without masking the tail. Species frequencies are obtained by
+|	transposing the matrix (one bit-row per species) and counting bits in each row of the transpose.
+*/
+class AloeBitMatrix
+	{
+	public:
+
+		enum {wordBits = 64};
+
+							AloeBitMatrix();
+							AloeBitMatrix(unsigned rows, unsigned cols);
+							AloeBitMatrix(const AloeBitMatrix &other);
+							~AloeBitMatrix();
+
+		AloeBitMatrix		&operator=(const AloeBitMatrix &other);
+
+		void				Clear();
+		void				ColumnCounts(NxsUnsignedVector &counts) const;
+		unsigned			GetNCols() const;
+		unsigned			GetNRows() const;
+		unsigned			GetNWords() const;
+		AloeWord			*GetRow(unsigned i);
+		const AloeWord		*GetRow(unsigned i) const;
+		void				GetSingletonMask(AloeWordVector &once, AloeWordVector &twice) const;
+		bool				IsEmpty() const;
+		void				Reset(unsigned rows, unsigned cols);
+		unsigned			RowCount(unsigned i) const;
+		void				Set(unsigned i, unsigned j, bool on = true);
+		bool				Test(unsigned i, unsigned j) const;
+		void				Transpose(AloeBitMatrix &t) const;
+
+		static unsigned		AndCount(const AloeWord *a, const AloeWord *b, unsigned n);
+		static unsigned		LowestBit(AloeWord w);
+		static unsigned		PopCount(AloeWord w);
+		static unsigned		PopCount(const AloeWord *w, unsigned n);
+		static unsigned		WordsFor(unsigned nbits);
+
+	private:
+
+		unsigned			nrows;	/* number of rows (areas) */
+		unsigned			ncols;	/* number of columns (species) */
+		unsigned			nwords;	/* number of words used to store a single row */
+		AloeWord			*bits;	/* storage for the matrix, `nrows' x `nwords' words */
+
+		static void			Transpose64(AloeWord *block);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of columns (species) in the matrix.
+*/
+inline unsigned AloeBitMatrix::GetNCols() const
+	{
+	return ncols;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of rows (areas) in the matrix.
+*/
+inline unsigned AloeBitMatrix::GetNRows() const
+	{
+	return nrows;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of 64-bit words used to store one row of the matrix.
+*/
+inline unsigned AloeBitMatrix::GetNWords() const
+	{
+	return nwords;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns pointer to the first word of row `i'. Assumes `i' is in the range [0..`nrows').
+*/
+inline AloeWord *AloeBitMatrix::GetRow(
+  unsigned i)	/* the (0-offset) index of the row */
+	{
+	assert(i < nrows);
+	return bits + (size_t)i * nwords;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns pointer to the first word of row `i'. Assumes `i' is in the range [0..`nrows').
+*/
+inline const AloeWord *AloeBitMatrix::GetRow(
+  unsigned i) const	/* the (0-offset) index of the row */
+	{
+	assert(i < nrows);
+	return bits + (size_t)i * nwords;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the matrix has no rows or no columns.
+*/
+inline bool AloeBitMatrix::IsEmpty() const
+	{
+	return (nrows == 0 || ncols == 0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the position of the lowest bit set in word `w', which must not be zero. Uses the compiler intrinsic where
+|	one is available.
+*/
+inline unsigned AloeBitMatrix::LowestBit(
+  AloeWord w)	/* the word to search */
+	{
+	assert(w != 0);
+#	if defined(__GNUC__)
+		return (unsigned)__builtin_ctzll(w);
+#	else
+		unsigned k = 0;
+		while ((w & 1) == 0)
+			{
+			w >>= 1;
+			k++;
+			}
+		return k;
+#	endif
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of bits set in word `w'. Uses the compiler intrinsic where it becomes a single instruction,
+|	otherwise falls back on the usual SWAR reduction (on x86 without POPCNT enabled, the intrinsic is a library call
+|	that is slower than the SWAR code).
+*/
+inline unsigned AloeBitMatrix::PopCount(
+  AloeWord w)	/* the word whose bits are to be counted */
+	{
+#	if defined(__GNUC__) && (defined(__POPCNT__) || !(defined(__x86_64__) || defined(__i386__)))
+		return (unsigned)__builtin_popcountll(w);
+#	else
+		const AloeWord m1  = ~(AloeWord)0 / 3;
+		const AloeWord m2  = ~(AloeWord)0 / 5;
+		const AloeWord m4  = ~(AloeWord)0 / 17;
+		const AloeWord h01 = ~(AloeWord)0 / 255;
+		w -= (w >> 1) & m1;
+		w = (w & m2) + ((w >> 2) & m2);
+		w = (w + (w >> 4)) & m4;
+		return (unsigned)((w * h01) >> 56);
+#	endif
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of bits set in row `i'. Assumes `i' is in the range [0..`nrows').
+*/
+inline unsigned AloeBitMatrix::RowCount(
+  unsigned i) const	/* the (0-offset) index of the row */
+	{
+	return PopCount(GetRow(i), nwords);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets (if `on' is true) or clears (if `on' is false) the bit at row `i', column `j'. Assumes `i' is in the range
+|	[0..`nrows') and `j' is in the range [0..`ncols').
+*/
+inline void AloeBitMatrix::Set(
+  unsigned i,	/* the (0-offset) index of the row */
+  unsigned j,	/* the (0-offset) index of the column */
+  bool on)		/* true to set the bit, false to clear it */
+	{
+	assert(j < ncols);
+	AloeWord mask = (AloeWord)1 << (j % wordBits);
+	AloeWord &w = GetRow(i)[j / wordBits];
+	if (on)
+		w |= mask;
+	else
+		w &= ~mask;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the bit at row `i', column `j' is set. Assumes `i' is in the range [0..`nrows') and `j' is in the
+|	range [0..`ncols').
+*/
+inline bool AloeBitMatrix::Test(
+  unsigned i,	/* the (0-offset) index of the row */
+  unsigned j) const	/* the (0-offset) index of the column */
+	{
+	assert(j < ncols);
+	return ((GetRow(i)[j / wordBits] >> (j % wordBits)) & 1) != 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of 64-bit words needed to hold `nbits' bits.
+*/
+inline unsigned AloeBitMatrix::WordsFor(
+  unsigned nbits)	/* the number of bits to be stored */
+	{
+	return (nbits + wordBits - 1) / wordBits;
+	}
+
+#endif
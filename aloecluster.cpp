@@ -0,0 +1,293 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#include "aloecluster.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Creates an object with nothing to cluster.
+*/
+AloeCluster::AloeCluster()
+	{
+	nitems	= 0;
+	method	= upgma;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the name of linkage `which', as accepted by ParseMethod.
+*/
+const char *AloeCluster::GetMethodName(
+  MethodEnum which)	/* the linkage in question */
+	{
+	return (which == wpgma ? "wpgma" : "upgma");
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets `which' to the linkage named `name' ("upgma" or "wpgma", in any case) and returns true, or returns false if
+|	the name is not recognized.
+*/
+bool AloeCluster::ParseMethod(
+  const string &name,	/* the name of the linkage */
+  MethodEnum &which)	/* on return, the linkage named */
+	{
+	NxsString s = name.c_str();
+	s.ToUpper();
+	for (int k = upgma; k <= wpgma; k++)
+		{
+		NxsString t = GetMethodName((MethodEnum)k);
+		if (s == t.ToUpper())
+			{
+			which = (MethodEnum)k;
+			return true;
+			}
+		}
+	return false;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `packed' with the distances between the taxa of `block' listed in `taxa' (in that order), or between all of
+|	its taxa if `taxa' is NULL, in the form taken by SetDistances. Either triangle (or both) may have been given in the
+|	block; where both were, the lower is used. Throws NxsException if a distance is missing. Returns the number of taxa
+|	whose distances were packed.
+*/
+unsigned AloeCluster::PackDistances(
+  NxsDistancesBlock &block,			/* the DISTANCES block */
+  vector<float> &packed,			/* on return, the distances */
+  const NxsUnsignedVector *taxa)	/* the (0-offset) indices of the taxa wanted, or NULL for all of them */
+	{
+	unsigned n = (taxa == NULL ? block.GetNtax() : (unsigned)taxa->size());
+	packed.resize((size_t)n * (n > 0 ? n - 1 : 0) / 2);
+	for (unsigned i = 1; i < n; i++)
+		{
+		unsigned ti = (taxa == NULL ? i : (*taxa)[i]);
+		float *row = &packed[0] + (size_t)i * (i - 1) / 2;
+		for (unsigned j = 0; j < i; j++)
+			{
+			unsigned tj = (taxa == NULL ? j : (*taxa)[j]);
+			if (!block.IsMissing(ti, tj))
+				row[j] = (float)block.GetDistance(ti, tj);
+			else if (!block.IsMissing(tj, ti))
+				row[j] = (float)block.GetDistance(tj, ti);
+			else
+				{
+				NxsString errormsg = "Cannot use a DISTANCES block with missing distances (taxa ";
+				errormsg += ti + 1;
+				errormsg += " and ";
+				errormsg += tj + 1;
+				errormsg += ")";
+				throw NxsException(errormsg);
+				}
+			}
+		}
+	return n;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Takes the distances between the taxa of `block' as those between the items to cluster (see PackDistances). Throws
+|	NxsException if a distance is missing.
+*/
+void AloeCluster::ReadDistances(
+  NxsDistancesBlock &block)	/* the DISTANCES block */
+	{
+	vector<float> packed;
+	unsigned n = PackDistances(block, packed);
+	SetDistances(n, packed);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Merges the items into a single cluster using linkage `which'. The distances given are used up: on return they hold
+|	the distances between clusters at the end of the clustering.
+*/
+void AloeCluster::Run(
+  MethodEnum which)	/* the linkage */
+	{
+	method = which;
+	left.clear();
+	right.clear();
+	heights.clear();
+	if (nitems < 2)
+		return;
+
+	NxsUnsignedVector node(nitems);	// the cluster (item or merge) held by each slot
+	NxsUnsignedVector size(nitems, 1);	// number of items in the cluster held by each slot
+	NxsBoolVector active(nitems, true);
+	for (unsigned i = 0; i < nitems; i++)
+		node[i] = i;
+
+	NxsUnsignedVector chain;
+	unsigned firstActive = 0;
+	for (unsigned remaining = nitems; remaining > 1; )
+		{
+		if (chain.empty())
+			{
+			while (!active[firstActive])
+				firstActive++;
+			chain.push_back(firstActive);
+			}
+
+		// Nearest neighbour of the cluster at the end of the chain; ties are resolved in favour of the cluster before
+		// it in the chain, so that the chain cannot cycle
+		//
+		unsigned a = (unsigned)chain.back();
+		unsigned prev = (chain.size() > 1 ? chain[chain.size() - 2] : nitems);
+		unsigned b = prev;
+		float best = (prev < nitems ? distances[Index(a, prev)] : 0.0f);
+		const float *row = &distances[0] + (size_t)a * (a - 1) / 2;
+		for (unsigned k = 0; k < a; k++)
+			{
+			if (active[k] && (b == nitems || row[k] < best))
+				{
+				best = row[k];
+				b = k;
+				}
+			}
+		for (unsigned k = a + 1; k < nitems; k++)
+			{
+			float d = distances[(size_t)k * (k - 1) / 2 + a];
+			if (active[k] && (b == nitems || d < best))
+				{
+				best = d;
+				b = k;
+				}
+			}
+
+		if (b != prev)
+			{
+			chain.push_back(b);
+			continue;
+			}
+
+		// `a' and `b' are each other's nearest neighbours: merge them into the lower numbered slot
+		//
+		chain.pop_back();
+		chain.pop_back();
+		unsigned keep = (a < b ? a : b);
+		unsigned drop = (a < b ? b : a);
+		double na = size[keep];
+		double nb = size[drop];
+		for (unsigned k = 0; k < nitems; k++)
+			{
+			if (!active[k] || k == keep || k == drop)
+				continue;
+			double dk = distances[Index(k, keep)];
+			double dd = distances[Index(k, drop)];
+			if (method == wpgma)
+				distances[Index(k, keep)] = (float)(0.5 * (dk + dd));
+			else
+				distances[Index(k, keep)] = (float)((na * dk + nb * dd) / (na + nb));
+			}
+
+		left.push_back(node[keep]);
+		right.push_back(node[drop]);
+		heights.push_back(best);
+		node[keep] = nitems + (unsigned)heights.size() - 1;
+		size[keep] += size[drop];
+		active[drop] = false;
+		remaining--;
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Takes `packed' as the distances between `n' items: the lower triangle of the distance matrix stored row after row
+|	without the diagonal (the pair i, j with j < i being at i x (i - 1) / 2 + j). The contents of `packed' are taken
+|	over rather than copied, leaving it empty.
+*/
+void AloeCluster::SetDistances(
+  unsigned n,				/* the number of items */
+  vector<float> &packed)	/* the distances */
+	{
+	assert(packed.size() == (size_t)n * (n > 0 ? n - 1 : 0) / 2);
+	nitems = n;
+	distances.swap(packed);
+	packed.clear();
+	left.clear();
+	right.clear();
+	heights.clear();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the dendrogram found by Run to `out' as a NEXUS file holding a TAXA block and a TREES block, which can be
+|	read by NxsTreesBlock. The branch lengths are the differences in height between the clusters they join, the
+|	height of a cluster being half the distance at which it was formed. `labels' must hold a label for every item.
+|	The tree is written without recursion, since the dendrogram of many items may be very deep.
+*/
+void AloeCluster::Write(
+  ostream &out,						/* the stream to write to */
+  const NxsStringVector &labels) const	/* the item (area) labels */
+	{
+	assert(labels.size() >= nitems);
+
+	out << "#NEXUS" << endl << endl;
+	out << "[" << GetMethodName(method) << " dendrogram of " << nitems << " areas]" << endl << endl;
+
+	NxsStringVector quoted(labels.begin(), labels.begin() + nitems);
+	for (unsigned i = 0; i < nitems; i++)
+		{
+		if (quoted[i].QuotesNeeded())
+			quoted[i].AddQuotes();
+		}
+
+	out << "BEGIN TAXA;" << endl;
+	out << "\tDIMENSIONS NTAX=" << nitems << ";" << endl;
+	out << "\tTAXLABELS" << endl;
+	for (unsigned i = 0; i < nitems; i++)
+		out << "\t\t" << quoted[i] << endl;
+	out << "\t;" << endl;
+	out << "END;" << endl << endl;
+
+	out << "BEGIN TREES;" << endl;
+	out << "\tTRANSLATE" << endl;
+	for (unsigned i = 0; i < nitems; i++)
+		out << "\t\t" << (i + 1) << " " << quoted[i] << (i + 1 < nitems ? "," : "") << endl;
+	out << "\t;" << endl;
+	NxsString name = GetMethodName(method);
+	name.ToUpper();
+	out << "\tTREE " << name << " = [&R] ";
+	if (nitems == 1)
+		out << "1";
+	else if (nitems > 1)
+		{
+		// Each entry of the stack is a cluster and the number of its children written so far
+		//
+		unsigned root = nitems + (unsigned)heights.size() - 1;
+		vector< pair<unsigned, unsigned> > stack(1, make_pair(root, 0u));
+		while (!stack.empty())
+			{
+			unsigned v = stack.back().first;
+			unsigned done = stack.back().second;
+			double h = (v < nitems ? 0.0 : 0.5 * heights[v - nitems]);
+			if (v < nitems || done == 2)
+				{
+				if (v < nitems)
+					out << (v + 1);
+				else
+					out << ')';
+				stack.pop_back();
+				if (!stack.empty())
+					{
+					unsigned parent = stack.back().first;
+					out << ':' << setprecision(6) << (0.5 * heights[parent - nitems] - h);
+					}
+				continue;
+				}
+			out << (done == 0 ? "(" : ",");
+			stack.back().second++;
+			stack.push_back(make_pair(done == 0 ? left[v - nitems] : right[v - nitems], 0u));
+			}
+		}
+	out << ";" << endl;
+	out << "END;" << endl;
+	}
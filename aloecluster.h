@@ -0,0 +1,120 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef ALOE_ALOECLUSTER_H
+#define ALOE_ALOECLUSTER_H
+
+#include <ncl.h>
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Agglomerative hierarchical clustering of areas by UPGMA (group average) or WPGMA (weighted average), found with
+|	the nearest-neighbour chain algorithm in O(n^2) time rather than the O(n^3) of the textbook method:
+|~
+|	o A chain of clusters is grown, each the nearest neighbour of the one before, until two clusters are each
+|	  other's nearest neighbours; they are merged and the chain continues from the cluster before them. Both linkages
+|	  are reducible (merging two clusters never brings the result closer to a third than either was), so the
+|	  clusters merged are those the textbook method would merge, and the chain never has to be started again.
+|	o The distances are held as a packed lower triangle of floats (n(n - 1)/2 values, half the space of a square
+|	  matrix of doubles), and a merged cluster takes the place of the lower numbered of the two.
+|~
+|	The distances are taken from a NEXUS DISTANCES block (ReadDistances) or from dissimilarities computed by Aloe
+|	(SetDistances, e.g. with AloeSimilarity::GetDissimilarities). Write saves the dendrogram, with branch lengths (the
+|	height of a cluster being half the distance at which it was formed), as a NEXUS TREES block:
+|>
+|	AloeCluster cluster;
+|	cluster.ReadDistances(distancesBlock);
+|	cluster.Run(AloeCluster::upgma);
+|	cluster.Write(out, labels);
+|>
+*/
+class AloeCluster
+	{
+	public:
+
+		enum MethodEnum	/* the linkage methods available */
+			{
+			upgma = 0,
+			wpgma
+			};
+
+							AloeCluster();
+
+		double				GetHeight() const;
+		MethodEnum			GetMethod() const;
+		unsigned			GetNItems() const;
+		void				ReadDistances(NxsDistancesBlock &block);
+		void				Run(MethodEnum which = upgma);
+		void				SetDistances(unsigned n, vector<float> &packed);
+		void				Write(ostream &out, const NxsStringVector &labels) const;
+
+		static const char	*GetMethodName(MethodEnum which);
+		static unsigned		PackDistances(NxsDistancesBlock &block, vector<float> &packed, const NxsUnsignedVector *taxa = NULL);
+		static bool			ParseMethod(const string &name, MethodEnum &which);
+
+	private:
+
+		unsigned			nitems;		/* number of items (areas) clustered */
+		MethodEnum			method;		/* the linkage used by Run */
+		vector<float>		distances;	/* lower triangle of the distances between clusters (see Index) */
+		NxsUnsignedVector	left;		/* first cluster merged by each merge (items are 0 to n - 1, merge k is n + k) */
+		NxsUnsignedVector	right;		/* second cluster merged by each merge */
+		vector<double>		heights;	/* distance between the clusters merged by each merge */
+
+		size_t				Index(unsigned i, unsigned j) const;
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the distance between the last two clusters merged by Run (0 if there was nothing to merge).
+*/
+inline double AloeCluster::GetHeight() const
+	{
+	return (heights.empty() ? 0.0 : heights.back());
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the linkage used by the last call to Run.
+*/
+inline AloeCluster::MethodEnum AloeCluster::GetMethod() const
+	{
+	return method;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of items (areas) to be clustered.
+*/
+inline unsigned AloeCluster::GetNItems() const
+	{
+	return nitems;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the position in `distances' of the distance between clusters `i' and `j', which must differ.
+*/
+inline size_t AloeCluster::Index(
+  unsigned i,			/* the first cluster */
+  unsigned j) const		/* the second cluster */
+	{
+	if (i < j)
+		{
+		unsigned t = i;
+		i = j;
+		j = t;
+		}
+	return (size_t)i * (i - 1) / 2 + j;
+	}
+
+#endif
@@ -0,0 +1,273 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloeconsensus.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes an empty consensus.
+*/
+AloeConsensus::AloeConsensus()
+	{
+	method	= majority;
+	ntax	= 0;
+	ntrees	= 0;
+	rooted	= false;
+	inserts	= 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the name of consensus `which', as accepted by ParseMethod.
+*/
+const char *AloeConsensus::GetMethodName(
+  MethodEnum which)	/* the consensus in question */
+	{
+	return (which == strict ? "strict" : (which == greedy ? "greedy" : "majority"));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets `which' to the consensus named `name' ("strict", "majority" or "greedy", in any case) and returns true, or
+|	returns false if the name is not recognized.
+*/
+bool AloeConsensus::ParseMethod(
+  const string &name,	/* the name of the consensus */
+  MethodEnum &which)	/* on return, the consensus named */
+	{
+	NxsString s = name.c_str();
+	s.ToUpper();
+	for (int k = strict; k <= greedy; k++)
+		{
+		NxsString t = GetMethodName((MethodEnum)k);
+		if (s == t.ToUpper())
+			{
+			which = (MethodEnum)k;
+			return true;
+			}
+		}
+	return false;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Builds the consensus `which' of the trees read by `reader', whose splits have been counted into `table'. The
+|	consensus starts as a bush of every taxon, to which the splits that qualify are added as groups, most frequent
+|	first.
+*/
+void AloeConsensus::Build(
+  AloeSplitReader &reader,		/* the reader of the trees */
+  const AloeSplitTable &table,	/* the splits of the trees, counted by `reader' */
+  MethodEnum which)				/* the kind of consensus */
+	{
+	method	= which;
+	ntax	= reader.GetNTaxa();
+	ntrees	= reader.GetNTrees();
+	rooted	= reader.IsRooted();
+	inserts	= 0;
+	parent.clear();
+	children.clear();
+	support.clear();
+	if (ntax == 0)
+		return;
+
+	// Taxa are nodes 0 to ntax - 1 and the root is node ntax
+	//
+	parent.assign(ntax + 1, ntax);
+	parent[ntax] = UINT_MAX;
+	children.assign(ntax + 1, NxsUnsignedVector());
+	for (unsigned t = 0; t < ntax; t++)
+		children[ntax].push_back(t);
+	support.assign(1, ntrees);
+	stamp.assign(ntax + 1, 0);
+	nfull.assign(ntax + 1, 0);
+
+	// The splits that qualify, most frequent first (and otherwise in the order in which they occur)
+	//
+	vector< pair<unsigned, unsigned> > order;
+	for (unsigned k = 0; k < table.GetNSplits(); k++)
+		{
+		unsigned count = table.GetSplit(k).count;
+		if ((which == strict && count < ntrees) || (which == majority && 2 * count <= ntrees))
+			continue;
+		order.push_back(pair<unsigned, unsigned>(ntrees - count, k));
+		}
+	sort(order.begin(), order.end());
+
+	unsigned most = (ntax > (rooted ? 2U : 3U) ? ntax - (rooted ? 2 : 3) : 0);
+	AloeBitMatrix bits;
+	NxsUnsignedVector batch, taxa;
+	for (unsigned first = 0; first < order.size() && GetNGroups() < most; first += batchSize)
+		{
+		batch.clear();
+		for (unsigned k = first; k < order.size() && k < first + batchSize; k++)
+			batch.push_back(order[k].second);
+		reader.GetTaxa(table, batch, bits);
+
+		for (unsigned r = 0; r < batch.size() && GetNGroups() < most; r++)
+			{
+			taxa.clear();
+			const AloeWord *row = bits.GetRow(r);
+			for (unsigned w = 0; w < bits.GetNWords(); w++)
+				{
+				for (AloeWord b = row[w]; b != 0; b &= b - 1)
+					taxa.push_back(w * AloeBitMatrix::wordBits + AloeBitMatrix::LowestBit(b));
+				}
+			Insert(taxa, table.GetSplit(batch[r]).count);
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds the group of `taxa', found in `count' trees, to the consensus and returns true if it is compatible with every
+|	group already there; otherwise leaves the consensus alone and returns false. The group must not hold every taxon.
+|	Each taxon marks its parent, and a node is full once all its children are; the group is compatible if the highest
+|	full nodes have the same parent, in which case they become the children of the new group.
+*/
+bool AloeConsensus::Insert(
+  const NxsUnsignedVector &taxa,	/* the taxa of the group */
+  unsigned count)					/* the number of trees having the group */
+	{
+	inserts++;
+	NxsUnsignedVector full;
+	for (unsigned k = 0; k < taxa.size(); k++)
+		{
+		for (unsigned v = taxa[k]; ; )
+			{
+			full.push_back(v);
+			unsigned p = parent[v];
+			assert(p != UINT_MAX);
+			if (stamp[p] != inserts)
+				{
+				stamp[p] = inserts;
+				nfull[p] = 0;
+				}
+			if (++nfull[p] < children[p].size())
+				break;
+			v = p;
+			}
+		}
+
+	unsigned top = UINT_MAX;
+	NxsUnsignedVector moved;
+	for (unsigned k = 0; k < full.size(); k++)
+		{
+		unsigned p = parent[full[k]];
+		if (nfull[p] == children[p].size())
+			continue;
+		if (top != UINT_MAX && p != top)
+			return false;
+		top = p;
+		moved.push_back(full[k]);
+		}
+	if (moved.size() < 2)
+		return false;
+
+	unsigned g = (unsigned)parent.size();
+	parent.push_back(top);
+	children.push_back(moved);
+	support.push_back(count);
+	stamp.push_back(0);
+	nfull.push_back(0);
+	for (unsigned k = 0; k < moved.size(); k++)
+		parent[moved[k]] = g;
+
+	// The new group takes the place of the first of its children
+	//
+	NxsUnsignedVector &c = children[top];
+	unsigned nkept = 0;
+	bool placed = false;
+	for (unsigned k = 0; k < c.size(); k++)
+		{
+		if (parent[c[k]] == top)
+			c[nkept++] = c[k];
+		else if (!placed)
+			{
+			c[nkept++] = g;
+			placed = true;
+			}
+		}
+	c.resize(nkept);
+	return true;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the consensus as a NEXUS TREES block (with the TAXA block it needs), labelling each group with the
+|	percentage of trees in which it was found. `labels' must hold a label for every taxon.
+*/
+void AloeConsensus::Write(
+  ostream &out,							/* the stream to write to */
+  const NxsStringVector &labels) const	/* the taxon (area) labels */
+	{
+	assert(labels.size() >= ntax);
+
+	NxsString title = (method == strict ? "Strict" : (method == greedy ? "Greedy" : "Majority-rule"));
+	out << "#NEXUS" << endl << endl;
+	out << "[" << title << " consensus of " << ntrees << " trees; each group is labelled with the percentage of trees in which it was found]" << endl << endl;
+
+	NxsStringVector quoted(labels.begin(), labels.begin() + ntax);
+	for (unsigned i = 0; i < ntax; i++)
+		{
+		if (quoted[i].QuotesNeeded())
+			quoted[i].AddQuotes();
+		}
+
+	out << "BEGIN TAXA;" << endl;
+	out << "\tDIMENSIONS NTAX=" << ntax << ";" << endl;
+	out << "\tTAXLABELS" << endl;
+	for (unsigned i = 0; i < ntax; i++)
+		out << "\t\t" << quoted[i] << endl;
+	out << "\t;" << endl;
+	out << "END;" << endl << endl;
+
+	out << "BEGIN TREES;" << endl;
+	out << "\tTRANSLATE" << endl;
+	for (unsigned i = 0; i < ntax; i++)
+		out << "\t\t" << (i + 1) << " " << quoted[i] << (i + 1 < ntax ? "," : "") << endl;
+	out << "\t;" << endl;
+	NxsString name = GetMethodName(method);
+	name.ToUpper();
+	out << "\tTREE " << name << " = " << (rooted ? "[&R] " : "[&U] ");
+	if (ntax == 1)
+		out << "1";
+	else if (ntax > 1)
+		{
+		// Each entry of the stack is a node and the number of its children written so far
+		//
+		vector< pair<unsigned, unsigned> > stack(1, make_pair(ntax, 0u));
+		while (!stack.empty())
+			{
+			unsigned v = stack.back().first;
+			unsigned done = stack.back().second;
+			if (v < ntax || done == children[v].size())
+				{
+				if (v < ntax)
+					out << (v + 1);
+				else
+					{
+					out << ')';
+					if (v > ntax)
+						out << (support[v - ntax] * 100 + ntrees / 2) / ntrees;
+					}
+				stack.pop_back();
+				continue;
+				}
+			out << (done == 0 ? "(" : ",");
+			stack.back().second++;
+			stack.push_back(make_pair(children[v][done], 0u));
+			}
+		}
+	out << ";" << endl;
+	out << "END;" << endl;
+	}
@@ -0,0 +1,122 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOECONSENSUS_H
+#define ALOE_ALOECONSENSUS_H
+
+#include <ncl.h>
+#include "aloesplits.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Consensus of the trees of a TREES block, built from the splits counted by an AloeSplitReader:
+|~
+|	o strict: the groups found in every tree;
+|	o majority: the groups found in more than half of the trees (majority rule);
+|	o greedy: the groups taken in order of decreasing frequency, each kept if it is compatible with those kept
+|	  before (extended majority rule); splits found equally often are taken in the order in which they first occur.
+|~
+|	The consensus is held as a tree that grows as groups are added, so that a group is tested and inserted at a cost
+|	proportional to its number of taxa: the taxa of the group mark their ancestors, and the group is compatible if the
+|	highest nodes all of whose taxa are in it share a parent. Only the taxa of the splits tested are recovered from
+|	the trees, `batchSize' splits at a time, and the greedy consensus stops once the tree is fully resolved. The
+|	consensus of unrooted trees is written unrooted, and that of rooted trees rooted:
+|>
+|	AloeSplitReader reader(trees, taxa);
+|	AloeSplitTable table;
+|	reader.Count(table, nthreads);
+|	AloeConsensus consensus;
+|	consensus.Build(reader, table, AloeConsensus::majority);
+|	consensus.Write(out, labels);
+|>
+*/
+class AloeConsensus
+	{
+	public:
+
+		enum MethodEnum	/* the kinds of consensus available */
+			{
+			strict = 0,
+			majority,
+			greedy
+			};
+
+		enum {batchSize = 1024};	/* number of splits whose taxa are recovered from the trees at a time */
+
+							AloeConsensus();
+
+		void				Build(AloeSplitReader &reader, const AloeSplitTable &table, MethodEnum which);
+		MethodEnum			GetMethod() const;
+		unsigned			GetNGroups() const;
+		unsigned			GetNTrees() const;
+		bool				IsRooted() const;
+		void				Write(ostream &out, const NxsStringVector &labels) const;
+
+		static const char	*GetMethodName(MethodEnum which);
+		static bool			ParseMethod(const string &name, MethodEnum &which);
+
+	private:
+
+		typedef vector<NxsUnsignedVector>	AloeChildVector;
+
+		MethodEnum			method;		/* the kind of consensus built */
+		unsigned			ntax;		/* number of taxa */
+		unsigned			ntrees;		/* number of trees */
+		bool				rooted;		/* true if the trees, and so the consensus, are rooted */
+		NxsUnsignedVector	parent;		/* parent of each node (the taxa, then the root, then the groups), or UINT_MAX */
+		AloeChildVector		children;	/* children of each node */
+		NxsUnsignedVector	support;	/* number of trees having each group (from the root on) */
+		NxsUnsignedVector	stamp;		/* number of the last call to Insert that reached each node */
+		NxsUnsignedVector	nfull;		/* number of children of each node whose taxa are all in the group being inserted */
+		unsigned			inserts;	/* number of calls to Insert */
+
+		bool				Insert(const NxsUnsignedVector &taxa, unsigned count);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the kind of consensus built.
+*/
+inline AloeConsensus::MethodEnum AloeConsensus::GetMethod() const
+	{
+	return method;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of groups in the consensus, leaving out the group of all taxa.
+*/
+inline unsigned AloeConsensus::GetNGroups() const
+	{
+	return (ntax == 0 ? 0 : (unsigned)support.size() - 1);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of trees of which the consensus was built.
+*/
+inline unsigned AloeConsensus::GetNTrees() const
+	{
+	return ntrees;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the trees, and so the consensus, are rooted.
+*/
+inline bool AloeConsensus::IsRooted() const
+	{
+	return rooted;
+	}
+
+#endif
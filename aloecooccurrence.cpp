@@ -0,0 +1,293 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#include "aloecooccurrence.h"
+#include "aloesimilarity.h"
+#include "aloethreadpool.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes one tile of a band of pairs of species on a thread of an AloeThreadPool.
+*/
+class AloeCooccurrenceTile : public AloeTask
+	{
+	public:
+
+		AloeCooccurrenceTile(const AloeBitMatrix &m, const NxsUnsignedVector &r, unsigned r0, unsigned r1, unsigned c0, unsigned c1, AloeWord u)
+		  : matrix(m), ranges(r), firstRow(r0), lastRow(r1), firstCol(c0), lastCol(c1), threshold(u) {}
+
+		void Run()
+			{
+			AloeCooccurrence::ComputeTile(matrix, ranges, firstRow, lastRow, firstCol, lastCol, threshold, sums, pairs);
+			}
+
+		const AloeBitMatrix							&matrix;	/* the species-major matrix */
+		const NxsUnsignedVector						&ranges;	/* number of areas of each species */
+		unsigned									firstRow;	/* first species of the band */
+		unsigned									lastRow;	/* one past the last species of the band */
+		unsigned									firstCol;	/* first species of the tile's columns */
+		unsigned									lastCol;	/* one past the last species of the tile's columns */
+		AloeWord									threshold;	/* pairs with at least this many units are kept (0 for none) */
+		AloeCooccurrence::AloeCooccurrenceTotals	sums;		/* on return, the totals over the pairs of the tile */
+		AloeCooccurrence::AloePairCountVector		pairs;		/* on return, the pairs kept, species by species */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares to compute the co-occurrence of the species in the first `nareas' rows of `m' (every row if `nareas' is
+|	0). The matrix is copied, transposed, so it need not outlive this object. Call Run to compute the totals.
+*/
+AloeCooccurrence::AloeCooccurrence(
+  const AloeBitMatrix &m,	/* the presence/absence matrix, one row per area */
+  unsigned nareas)			/* the number of areas to use */
+	{
+	nrows = (nareas == 0 || nareas > m.GetNRows() ? m.GetNRows() : nareas);
+	ncols = m.GetNCols();
+
+	AloeBitMatrix data(nrows, ncols);
+	unsigned nwords = data.GetNWords();
+	for (unsigned i = 0; i < nrows; i++)
+		{
+		const AloeWord *r = m.GetRow(i);
+		AloeWord *t = data.GetRow(i);
+		for (unsigned w = 0; w < nwords; w++)
+			t[w] = r[w];
+		}
+	data.Transpose(species);
+	ranges.resize(ncols);
+	for (unsigned j = 0; j < ncols; j++)
+		ranges[j] = species.RowCount(j);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds up the checkerboard units of the pairs of species `firstRow' to `lastRow' - 1 with species `firstCol' to
+|	`lastCol' - 1, for the pairs below the diagonal only, in `sums'. Pairs with at least `threshold' units are added to
+|	`pairs' (none if `threshold' is 0), species `firstRow' first. Shared counts for the whole tile are accumulated
+|	`tileWords' words at a time, and each pair is scored as its last chunk is counted.
+*/
+void AloeCooccurrence::ComputeTile(
+  const AloeBitMatrix &t,			/* the species-major matrix */
+  const NxsUnsignedVector &r,		/* number of areas of each species */
+  unsigned firstRow,				/* first species of the band */
+  unsigned lastRow,					/* one past the last species of the band */
+  unsigned firstCol,				/* first species of the tile's columns */
+  unsigned lastCol,					/* one past the last species of the tile's columns (no greater than `lastRow') */
+  AloeWord threshold,				/* the least number of units of the pairs to keep, or 0 to keep none */
+  AloeCooccurrenceTotals &sums,		/* on return, the totals over the pairs of the tile */
+  AloePairCountVector &pairs)		/* on return, the pairs kept */
+	{
+	unsigned ncols = lastCol - firstCol;
+	unsigned nwords = t.GetNWords();
+	NxsUnsignedVector shared((size_t)(lastRow - firstRow) * ncols, 0);
+
+	sums = AloeCooccurrenceTotals();
+	pairs.clear();
+	for (unsigned w = 0; w < nwords || w == 0; w += tileWords)
+		{
+		unsigned nw = nwords - w;
+		if (nw > tileWords)
+			nw = tileWords;
+		bool last = (w + nw == nwords);
+
+		for (unsigned i = firstRow; i < lastRow; i++)
+			{
+			const AloeWord *a = t.GetRow(i) + w;
+			unsigned *c = &shared[(size_t)(i - firstRow) * ncols];
+			unsigned end = (i < lastCol ? i : lastCol);
+			if (!last)
+				{
+				for (unsigned j = firstCol; j < end; j++)
+					c[j - firstCol] += AloeBitMatrix::AndCount(a, t.GetRow(j) + w, nw);
+				continue;
+				}
+
+			// The last chunk completes the shared counts, so the pairs are scored at once
+			//
+			unsigned ri = r[i];
+			for (unsigned j = firstCol; j < end; j++)
+				{
+				unsigned s = c[j - firstCol] + AloeBitMatrix::AndCount(a, t.GetRow(j) + w, nw);
+				AloeWord units = (AloeWord)(ri - s) * (r[j] - s);
+				sums.units += units;
+				if (s == 0 && ri > 0 && r[j] > 0)
+					sums.checkerboards++;
+				if (threshold > 0 && units >= threshold)
+					{
+					AloePairCount p;
+					p.first = i;
+					p.second = j;
+					p.shared = s;
+					p.units = units;
+					pairs.push_back(p);
+					}
+				}
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the C-score of `m', which must have the same area and species totals as the matrix given to the constructor
+|	(as the random matrices of an AloeNullModel do). Uses the calling thread only.
+*/
+double AloeCooccurrence::Evaluate(
+  const AloeBitMatrix &m) const	/* the matrix, one row per area */
+	{
+	assert(m.GetNRows() == nrows && m.GetNCols() == ncols);
+	AloeBitMatrix t;
+	m.Transpose(t);
+	return CScore(Sum(t, ranges, 1, NULL, NULL, 0));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the checkerboard units of every pair of species, sharing the work among `nthreads' threads (0 means one
+|	per core).
+*/
+void AloeCooccurrence::Run(
+  unsigned nthreads)	/* the number of threads to use */
+	{
+	totals = Sum(species, ranges, nthreads, NULL, NULL, 0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	As Run(nthreads), but also writes to `csv' one line for each pair of species with at least `threshold' (which must
+|	be positive) checkerboard units, giving both labels, the number of areas shared and the units. `labels' must hold
+|	a label for every species.
+*/
+void AloeCooccurrence::Run(
+  ostream &csv,						/* stream to receive the pairs */
+  const NxsStringVector &labels,	/* the species labels */
+  AloeWord threshold,				/* the least number of units of the pairs written */
+  unsigned nthreads)				/* the number of threads to use */
+	{
+	assert(labels.size() >= ncols);
+	assert(threshold > 0);
+	csv << "Species1,Species2,Shared,Units" << endl;
+	totals = Sum(species, ranges, nthreads, &csv, &labels, threshold);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the totals over every pair of species of the species-major matrix `t', whose rows hold `r' areas. The pairs
+|	are computed a band at a time, as tiles run on `nthreads' threads; if `csv' is given, the pairs of each band with at
+|	least `threshold' units are written to it, in order, before the next band is started.
+*/
+AloeCooccurrence::AloeCooccurrenceTotals AloeCooccurrence::Sum(
+  const AloeBitMatrix &t,			/* the species-major matrix */
+  const NxsUnsignedVector &r,		/* number of areas of each species */
+  unsigned nthreads,				/* the number of threads to use */
+  ostream *csv,						/* stream to receive the pairs, or NULL */
+  const NxsStringVector *labels,	/* the species labels (if `csv' is given) */
+  AloeWord threshold) const			/* the least number of units of the pairs written */
+	{
+	if (csv == NULL)
+		threshold = 0;
+
+	vector<string> fields;
+	if (csv != NULL)
+		{
+		fields.resize(ncols);
+		for (unsigned j = 0; j < ncols; j++)
+			fields[j] = AloeSimilarity::CsvField((*labels)[j]);
+		}
+
+	AloeCooccurrenceTotals sums;
+	if (nthreads == 1 && csv == NULL)
+		{
+		AloePairCountVector none;
+		for (unsigned first = 0; first < ncols; first += bandSpecies)
+			{
+			unsigned last = (first + bandSpecies < ncols ? first + bandSpecies : ncols);
+			for (unsigned col = 0; col < last; col += tileSpecies)
+				{
+				AloeCooccurrenceTotals s;
+				ComputeTile(t, r, first, last, col, (col + tileSpecies < last ? col + tileSpecies : last), 0, s, none);
+				sums.Add(s);
+				}
+			}
+		return sums;
+		}
+
+	AloeThreadPool pool(nthreads);
+	for (unsigned first = 0; first < ncols; first += bandSpecies)
+		{
+		unsigned last = (first + bandSpecies < ncols ? first + bandSpecies : ncols);
+		vector<AloeCooccurrenceTile *> tiles;
+		for (unsigned col = 0; col < last; col += tileSpecies)
+			{
+			unsigned end = (col + tileSpecies < last ? col + tileSpecies : last);
+			tiles.push_back(new AloeCooccurrenceTile(t, r, first, last, col, end, threshold));
+			pool.Add(tiles.back());
+			}
+		pool.Run();
+
+		for (unsigned k = 0; k < tiles.size(); k++)
+			sums.Add(tiles[k]->sums);
+
+		// Write the pairs kept species by species, taking each species' pairs from the tiles in turn
+		//
+		if (csv != NULL)
+			{
+			NxsUnsignedVector next(tiles.size(), 0);
+			for (unsigned i = first; i < last; i++)
+				{
+				for (unsigned k = 0; k < tiles.size(); k++)
+					{
+					const AloePairCountVector &pairs = tiles[k]->pairs;
+					for (; next[k] < pairs.size() && pairs[next[k]].first == i; next[k]++)
+						{
+						const AloePairCount &p = pairs[next[k]];
+						*csv << fields[p.first] << ',' << fields[p.second] << ',' << p.shared << ',' << p.units << '\n';
+						}
+					}
+				}
+			}
+
+		for (unsigned k = 0; k < tiles.size(); k++)
+			delete tiles[k];
+		}
+	return sums;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the number of pairs of species, the C-score and the number of checkerboard pairs to `out'. If `null' is
+|	given and has made its randomisations, the mean C-score of its random matrices, the standardised effect size and
+|	the probabilities of a value at least and at most as large as that of the data are added; `k' is the number
+|	returned when this object was added to `null'. Left justification is assumed to have been set on `out'.
+*/
+void AloeCooccurrence::Write(
+  ostream &out,					/* the stream to write to */
+  const AloeNullModel *null,	/* the null model against which the C-score was tested, or NULL */
+  unsigned k) const				/* the number of this statistic in `null' */
+	{
+	out << "Species co-occurrence" << endl << endl;
+	out << setw(40) << "Pairs of species " << setprecision(12) << GetNPairs() << endl;
+	out << setw(40) << "Checkerboard units " << totals.units << endl;
+	out << setw(40) << "C-score " << setprecision(4) << GetCScore() << endl;
+	out << setw(40) << "Checkerboard pairs (no shared area) " << totals.checkerboards << endl;
+	if (null == NULL || null->GetNRandomisations() == 0)
+		return;
+
+	unsigned n = null->GetNRandomisations();
+	const AloeNullStatistic &s = null->GetStatistic(k);
+	double ses;
+	out << setw(40) << "Random matrices " << n << " (" << AloeNullModel::GetAlgorithmName(null->GetAlgorithm()) << ")" << endl;
+	out << setw(40) << "Mean C-score of random matrices " << setprecision(4) << s.GetMean(n) << endl;
+	out << setw(40) << "SES ";
+	if (s.GetSES(n, ses))
+		out << setprecision(3) << ses << endl;
+	else
+		out << "-" << endl;
+	out << setw(40) << "P(>=) " << setprecision(3) << s.GetPGreater(n) << endl;
+	out << setw(40) << "P(<=) " << setprecision(3) << s.GetPLess(n) << endl;
+	}
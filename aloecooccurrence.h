@@ -0,0 +1,145 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef ALOE_ALOECOOCCURRENCE_H
+#define ALOE_ALOECOOCCURRENCE_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+#include "aloenullmodel.h"
+
+class AloeThreadPool;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Co-occurrence of the species of a presence/absence matrix, over every pair of species. If species i and j occur in
+|	r(i) and r(j) areas, S of them shared, the pair forms (r(i) - S)(r(j) - S) checkerboard units (Stone & Roberts
+|	1990). The C-score is the mean number of checkerboard units per pair; the pairs that share no area (Diamond's
+|	checkerboard pairs) are also counted.
+|~
+|	o The matrix is transposed once into a species-major copy, one bit row per species, and the areas shared by
+|	  two species are counted by AND and popcount over their rows.
+|	o The pairs are processed in bands of `bandSpecies' species. The lower triangle of each band is split into tiles
+|	  of `tileSpecies' columns, each a task for an AloeThreadPool, within which the words of the rows are visited
+|	  `tileWords' at a time so that the part of the matrix in use stays in cache.
+|	o Each tile sums its checkerboard units and pairs as integers, so the totals do not depend on the number of
+|	  threads. Pairs with at least a given number of checkerboard units can be written to a CSV stream as each band is
+|	  finished, so that the results for billions of pairs are never held in memory.
+|	o AloeCooccurrence is an AloeMatrixStatistic, so the C-score can be tested against the random matrices of an
+|	  AloeNullModel (the classic test of Gotelli 2000, with fixed area and species totals).
+*/
+class AloeCooccurrence : public AloeMatrixStatistic
+	{
+	public:
+
+		enum
+			{
+			bandSpecies	= 256,	/* number of species in each band of pairs */
+			tileSpecies	= 256,	/* number of species in the columns of a tile */
+			tileWords	= 64	/* number of words of each row compared before moving on to the next pair */
+			};
+
+							AloeCooccurrence(const AloeBitMatrix &m, unsigned nareas = 0);
+
+		double				Evaluate(const AloeBitMatrix &m) const;
+		AloeWord			GetNCheckerboardPairs() const;
+		double				GetCScore() const;
+		double				GetNPairs() const;
+		void				Run(unsigned nthreads = 0);
+		void				Run(ostream &csv, const NxsStringVector &labels, AloeWord threshold, unsigned nthreads = 0);
+		void				Write(ostream &out, const AloeNullModel *null = NULL, unsigned k = 0) const;
+
+	private:
+
+		friend class AloeCooccurrenceTile;
+
+		struct AloeCooccurrenceTotals	/* sums over a set of pairs of species */
+			{
+							AloeCooccurrenceTotals() : units(0), checkerboards(0) {}
+
+			void			Add(const AloeCooccurrenceTotals &other);
+
+			AloeWord		units;			/* total checkerboard units */
+			AloeWord		checkerboards;	/* pairs of species (each present somewhere) that share no area */
+			};
+
+		struct AloePairCount	/* a pair of species written to the CSV stream */
+			{
+			unsigned		first;		/* the first species */
+			unsigned		second;		/* the second species (less than `first') */
+			unsigned		shared;		/* number of areas shared */
+			AloeWord		units;		/* checkerboard units */
+			};
+
+		typedef vector<AloePairCount>	AloePairCountVector;
+
+		unsigned				nrows;		/* number of areas */
+		unsigned				ncols;		/* number of species */
+		AloeBitMatrix			species;	/* the matrix transposed, one row per species */
+		NxsUnsignedVector		ranges;		/* number of areas in which each species occurs */
+		AloeCooccurrenceTotals	totals;		/* totals over every pair of species in the data */
+
+		AloeCooccurrenceTotals	Sum(const AloeBitMatrix &t, const NxsUnsignedVector &r, unsigned nthreads, ostream *csv, const NxsStringVector *labels, AloeWord threshold) const;
+		double					CScore(const AloeCooccurrenceTotals &t) const;
+
+		static void			ComputeTile(const AloeBitMatrix &t, const NxsUnsignedVector &r, unsigned firstRow, unsigned lastRow, unsigned firstCol, unsigned lastCol, AloeWord threshold, AloeCooccurrenceTotals &sums, AloePairCountVector &pairs);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds the totals in `other' to these.
+*/
+inline void AloeCooccurrence::AloeCooccurrenceTotals::Add(
+  const AloeCooccurrenceTotals &other)	/* the totals to add */
+	{
+	units += other.units;
+	checkerboards += other.checkerboards;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the C-score given the totals over every pair of species.
+*/
+inline double AloeCooccurrence::CScore(
+  const AloeCooccurrenceTotals &t) const	/* the totals */
+	{
+	double pairs = GetNPairs();
+	return (pairs == 0.0 ? 0.0 : (double)t.units / pairs);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of pairs of species sharing no area found by Run (species found in no area are left out).
+*/
+inline AloeWord AloeCooccurrence::GetNCheckerboardPairs() const
+	{
+	return totals.checkerboards;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the C-score (mean checkerboard units per pair of species) found by Run.
+*/
+inline double AloeCooccurrence::GetCScore() const
+	{
+	return CScore(totals);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of pairs of species.
+*/
+inline double AloeCooccurrence::GetNPairs() const
+	{
+	return 0.5 * ncols * ((double)ncols - 1.0);
+	}
+
+#endif
@@ -0,0 +1,505 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#include "aloeendemicareas.h"
+#include "aloerandom.h"
+#include "aloethreadpool.h"
+
+const double AloeEndemicAreas::minSpeciesScore = 0.5;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	One start of the search for areas of endemism, run on a thread of an AloeThreadPool: grows an area from a random
+|	cell by the best addition or removal of one cell at a time, until no move improves the score.
+*/
+class AloeEndemicAreaSearch : public AloeTask
+	{
+	public:
+
+		AloeEndemicAreaSearch(const AloeEndemicAreas &a, AloeWord s, unsigned k)
+		  : aoe(a), seed(s), start(k), score(0.0) {}
+
+		void Run();
+
+		const AloeEndemicAreas	&aoe;		/* the search to which the start belongs */
+		AloeWord				seed;		/* the seed of the search */
+		unsigned				start;		/* the number of the start, which selects its random number stream */
+		AloeWordVector			cells;		/* on return, the cells of the area found */
+		double					score;		/* on return, the score of the area found */
+
+	private:
+
+		NxsUnsignedVector		in;			/* number of cells of the area in which each species is present */
+		NxsCharVector			inside;		/* 1 for each cell in the area, 0 for the others */
+		NxsUnsignedVector		members;	/* the cells in the area */
+		NxsUnsignedVector		mark;		/* stamp of the last visit to each cell (see `stamp') */
+		unsigned				stamp;		/* changed before each pass over the cells, so `mark' never needs clearing */
+		NxsUnsignedVector		queue;		/* cells waiting to be visited by IsConnectedWithout */
+		double					sumSquares;	/* sum over species of in^2 / range */
+
+		void					Add(unsigned c);
+		double					Change(unsigned c, bool adding) const;
+		bool					IsConnectedWithout(unsigned c);
+		unsigned				Neighbour(unsigned c, unsigned d) const;
+		void					Remove(unsigned c);
+		double					Score(double s, unsigned a) const;
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds cell `c' to the area.
+*/
+void AloeEndemicAreaSearch::Add(
+  unsigned c)	/* the cell to add */
+	{
+	const unsigned *j = &aoe.present[0] + aoe.first[c];
+	const unsigned *last = &aoe.present[0] + aoe.first[c + 1];
+	for (; j < last; j++)
+		{
+		sumSquares += (2.0 * in[*j] + 1.0) / aoe.range[*j];
+		in[*j]++;
+		}
+	inside[c] = 1;
+	members.push_back(c);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the change in `sumSquares' that adding (or removing) cell `c' would make. Only the species in `c' change
+|	their counts, so this costs one visit to each of them.
+*/
+double AloeEndemicAreaSearch::Change(
+  unsigned c,			/* the cell */
+  bool adding) const	/* true if `c' would be added, false if it would be removed */
+	{
+	double d = 0.0;
+	const unsigned *j = &aoe.present[0] + aoe.first[c];
+	const unsigned *last = &aoe.present[0] + aoe.first[c + 1];
+	if (adding)
+		{
+		for (; j < last; j++)
+			d += (2.0 * in[*j] + 1.0) / aoe.range[*j];
+		}
+	else
+		{
+		for (; j < last; j++)
+			d -= (2.0 * in[*j] - 1.0) / aoe.range[*j];
+		}
+	return d;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the cells of the area other than `c' are contiguous. Assumes the area is contiguous and has at
+|	least two cells.
+*/
+bool AloeEndemicAreaSearch::IsConnectedWithout(
+  unsigned c)	/* the cell that would be removed */
+	{
+	stamp++;
+	mark[c] = stamp;
+	unsigned origin = (members[0] != c ? members[0] : members[1]);
+	mark[origin] = stamp;
+	queue.assign(1, origin);
+	for (unsigned q = 0; q < queue.size(); q++)
+		{
+		for (unsigned d = 0; d < 4; d++)
+			{
+			unsigned n = Neighbour(queue[q], d);
+			if (n < aoe.ncells && inside[n] && mark[n] != stamp)
+				{
+				mark[n] = stamp;
+				queue.push_back(n);
+				}
+			}
+		}
+	return (queue.size() + 1 == members.size());
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the cell sharing edge `d' (0 to 3: above, below, left, right) with cell `c' on the grid, or `ncells' if
+|	there is none.
+*/
+unsigned AloeEndemicAreaSearch::Neighbour(
+  unsigned c,			/* the cell */
+  unsigned d) const		/* the edge */
+	{
+	unsigned w = aoe.width;
+	unsigned n = aoe.ncells;
+	switch (d)
+		{
+		case 0:
+			return (c >= w ? c - w : n);
+		case 1:
+			return (c + w < n ? c + w : n);
+		case 2:
+			return (c % w > 0 ? c - 1 : n);
+		default:
+			return (c % w + 1 < w && c + 1 < n ? c + 1 : n);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Removes cell `c' from the area.
+*/
+void AloeEndemicAreaSearch::Remove(
+  unsigned c)	/* the cell to remove */
+	{
+	sumSquares += Change(c, false);
+	const unsigned *j = &aoe.present[0] + aoe.first[c];
+	const unsigned *last = &aoe.present[0] + aoe.first[c + 1];
+	for (; j < last; j++)
+		in[*j]--;
+	inside[c] = 0;
+	members.erase(find(members.begin(), members.end(), c));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the score of an area of `a' cells whose species have the sum of in^2 / range `s'.
+*/
+inline double AloeEndemicAreaSearch::Score(
+  double s,				/* the sum over species of in^2 / range */
+  unsigned a) const		/* the number of cells */
+	{
+	return s / a - a * aoe.background;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs the start. At each step every cell that could be added (the neighbours of the area on a grid, every other
+|	occupied cell otherwise) and every cell that could be removed (without splitting the area on a grid) is tried,
+|	and the move giving the best score is made; moves giving the same score are chosen among at random. Since every
+|	move must improve the score, the search cannot cycle.
+*/
+void AloeEndemicAreaSearch::Run()
+	{
+	const double epsilon = 1e-9;
+	unsigned ncells = aoe.ncells;
+	AloeRandom rng(seed, start);
+	in.assign(aoe.nspecies, 0);
+	inside.assign(ncells, 0);
+	mark.assign(ncells, 0);
+	stamp = 0;
+	members.clear();
+	sumSquares = 0.0;
+
+	Add(aoe.occupied[rng.Below((unsigned)aoe.occupied.size())]);
+	score = Score(sumSquares, 1);
+	NxsUnsignedVector candidates;
+	for (;;)
+		{
+		unsigned a = (unsigned)members.size();
+
+		// Cells that could be added
+		//
+		candidates.clear();
+		if (aoe.width > 0)
+			{
+			stamp++;
+			for (unsigned m = 0; m < a; m++)
+				{
+				for (unsigned d = 0; d < 4; d++)
+					{
+					unsigned n = Neighbour(members[m], d);
+					if (n < ncells && !inside[n] && mark[n] != stamp)
+						{
+						mark[n] = stamp;
+						candidates.push_back(n);
+						}
+					}
+				}
+			}
+		else
+			{
+			for (unsigned k = 0; k < aoe.occupied.size(); k++)
+				{
+				if (!inside[aoe.occupied[k]])
+					candidates.push_back(aoe.occupied[k]);
+				}
+			}
+
+		unsigned bestCell = ncells;
+		bool bestAdding = false;
+		double best = score;
+		unsigned ties = 0;
+		for (unsigned k = 0; k < candidates.size(); k++)
+			{
+			double s = Score(sumSquares + Change(candidates[k], true), a + 1);
+			if (s > best + epsilon || (bestCell < ncells && s >= best - epsilon && rng.Below(++ties) == 0))
+				{
+				if (s > best + epsilon)
+					ties = 1;
+				best = s;
+				bestCell = candidates[k];
+				bestAdding = true;
+				}
+			}
+
+		// Cells that could be removed (contiguity is only checked for moves that would be chosen)
+		//
+		for (unsigned m = 0; a > 1 && m < a; m++)
+			{
+			unsigned c = members[m];
+			double s = Score(sumSquares + Change(c, false), a - 1);
+			bool better = (s > best + epsilon);
+			if (!better && (bestCell == ncells || s < best - epsilon))
+				continue;
+			if (aoe.width > 0 && !IsConnectedWithout(c))
+				continue;
+			if (better || rng.Below(++ties) == 0)
+				{
+				if (better)
+					ties = 1;
+				best = s;
+				bestCell = c;
+				bestAdding = false;
+				}
+			}
+
+		if (bestCell == ncells)
+			break;
+		if (bestAdding)
+			Add(bestCell);
+		else
+			Remove(bestCell);
+		score = Score(sumSquares, (unsigned)members.size());
+		}
+
+	cells.assign(AloeBitMatrix::WordsFor(ncells), 0);
+	for (unsigned m = 0; m < members.size(); m++)
+		cells[members[m] / AloeBitMatrix::wordBits] |= (AloeWord)1 << (members[m] % AloeBitMatrix::wordBits);
+
+	// Only the area found is kept once the start is over
+	//
+	NxsUnsignedVector().swap(in);
+	NxsCharVector().swap(inside);
+	NxsUnsignedVector().swap(mark);
+	NxsUnsignedVector().swap(members);
+	NxsUnsignedVector().swap(queue);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares a search of the first `nrows' rows of `m' (all of them if `nrows' is 0) for areas of endemism. If
+|	`gridWidth' is not 0, the cells are taken to be the squares of a grid `gridWidth' cells wide, listed row by row,
+|	and areas must be contiguous.
+*/
+AloeEndemicAreas::AloeEndemicAreas(
+  const AloeBitMatrix &m,	/* the presences, one row per cell and one column per species */
+  unsigned gridWidth,		/* number of cells in each row of the grid, or 0 if the cells do not form a grid */
+  unsigned nrows)			/* number of rows of `m' to use, or 0 for all of them */
+	{
+	ncells		= (nrows == 0 || nrows > m.GetNRows() ? m.GetNRows() : nrows);
+	nspecies	= m.GetNCols();
+	width		= gridWidth;
+	nstarts		= 0;
+
+	// The species of each cell are listed once, so that the searches visit only the species present
+	//
+	range.assign(nspecies, 0);
+	first.assign(ncells + 1, 0);
+	for (unsigned i = 0; i < ncells; i++)
+		{
+		const AloeWord *row = m.GetRow(i);
+		for (unsigned w = 0; w < m.GetNWords(); w++)
+			{
+			for (AloeWord bits = row[w]; bits != 0; bits &= bits - 1)
+				{
+				unsigned j = w * AloeBitMatrix::wordBits + AloeBitMatrix::LowestBit(bits);
+				present.push_back(j);
+				range[j]++;
+				}
+			}
+		first[i + 1] = (unsigned)present.size();
+		if (first[i + 1] > first[i])
+			occupied.push_back(i);
+		}
+
+	background = 0.0;
+	if (ncells > 0)
+		background = (double)present.size() / ((double)ncells * ncells);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if area `a' scores more than area `b' (areas scoring the same are put in the order of their cell
+|	sets, so that the order never depends on the order in which they were found).
+*/
+bool AloeEndemicAreas::Before(
+  const AloeEndemicArea &a,	/* the first area */
+  const AloeEndemicArea &b)	/* the second area */
+	{
+	if (a.score != b.score)
+		return (a.score > b.score);
+	return (a.cells < b.cells);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the score of `area' afresh from its cells, and lists the species scoring at least `minSpeciesScore',
+|	best first.
+*/
+void AloeEndemicAreas::Describe(
+  AloeEndemicArea &area) const	/* the area, whose `cells' must be set */
+	{
+	map<unsigned, unsigned> in;
+	unsigned a = 0;
+	for (unsigned w = 0; w < area.cells.size(); w++)
+		{
+		for (AloeWord bits = area.cells[w]; bits != 0; bits &= bits - 1)
+			{
+			unsigned c = w * AloeBitMatrix::wordBits + AloeBitMatrix::LowestBit(bits);
+			for (unsigned k = first[c]; k < first[c + 1]; k++)
+				in[present[k]]++;
+			a++;
+			}
+		}
+
+	double sumSquares = 0.0;
+	vector< pair<double, unsigned> > scored;
+	for (map<unsigned, unsigned>::const_iterator i = in.begin(); i != in.end(); i++)
+		{
+		double n = i->second;
+		sumSquares += n * n / range[i->first];
+		double s = (n / a) * (n / range[i->first]);
+		if (s >= minSpeciesScore)
+			scored.push_back(make_pair(-s, i->first));
+		}
+	sort(scored.begin(), scored.end());
+
+	area.score = sumSquares / a - a * background;
+	area.species.clear();
+	area.scores.clear();
+	for (unsigned k = 0; k < scored.size(); k++)
+		{
+		area.species.push_back(scored[k].second);
+		area.scores.push_back(-scored[k].first);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a 64-bit hash of the cell set `cells', used to recognise the areas found by more than one start.
+*/
+AloeWord AloeEndemicAreas::Hash(
+  const AloeWordVector &cells)	/* one bit for each cell in the area */
+	{
+	AloeWord h = 0x9E3779B97F4A7C15ULL ^ cells.size();
+	for (unsigned w = 0; w < cells.size(); w++)
+		{
+		h ^= cells[w];
+		h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+		h ^= h >> 31;
+		}
+	return h;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes `starts' independent searches from random cells, sharing them among `nthreads' threads (one per core if 0),
+|	and keeps the best `maxAreas' distinct areas that have at least `minSpecies' species scoring `minSpeciesScore' or
+|	more. Returns the number of areas kept.
+*/
+unsigned AloeEndemicAreas::Search(
+  unsigned starts,		/* the number of starts */
+  AloeWord seed,		/* the seed from which every start draws its random numbers */
+  unsigned nthreads,	/* the number of threads to use */
+  unsigned maxAreas)	/* the largest number of areas to keep */
+	{
+	areas.clear();
+	nstarts = starts;
+	if (starts == 0 || occupied.empty())
+		return 0;
+
+	AloeThreadPool pool(nthreads);
+	vector<AloeEndemicAreaSearch *> tasks;
+	for (unsigned k = 0; k < starts; k++)
+		{
+		tasks.push_back(new AloeEndemicAreaSearch(*this, seed, k));
+		pool.Add(tasks.back());
+		}
+	pool.Run();
+
+	// An area is described only the first time it is found; later finds are recognised by the hash of the cells
+	//
+	typedef multimap<AloeWord, unsigned> AloeAreaHashMap;
+	AloeAreaHashMap seen;
+	for (unsigned k = 0; k < tasks.size(); k++)
+		{
+		AloeWord h = Hash(tasks[k]->cells);
+		bool found = false;
+		pair<AloeAreaHashMap::iterator, AloeAreaHashMap::iterator> same = seen.equal_range(h);
+		for (AloeAreaHashMap::iterator i = same.first; i != same.second && !found; i++)
+			found = (tasks[i->second]->cells == tasks[k]->cells);
+		if (found)
+			continue;
+		seen.insert(make_pair(h, k));
+
+		AloeEndemicArea area;
+		area.cells = tasks[k]->cells;
+		Describe(area);
+		if (area.species.size() >= minSpecies)
+			areas.push_back(area);
+		}
+
+	for (unsigned k = 0; k < tasks.size(); k++)
+		delete tasks[k];
+
+	sort(areas.begin(), areas.end(), Before);
+	if (areas.size() > maxAreas)
+		areas.resize(maxAreas);
+	return (unsigned)areas.size();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the areas found by Search to `out', each with its score, its cells and the species scoring at least
+|	`minSpeciesScore' (with their scores).
+*/
+void AloeEndemicAreas::Write(
+  ostream &out,							/* the stream to write to */
+  const NxsStringVector &cellLabels,	/* the name of each cell */
+  const NxsStringVector &speciesLabels) const	/* the name of each species */
+	{
+	out << "Areas of endemism" << endl << endl;
+	out << setw(40) << "Random starts " << nstarts << endl;
+	out << setw(40) << "Grid width ";
+	if (width > 0)
+		out << width << endl;
+	else
+		out << "none (any set of areas)" << endl;
+	out << setw(40) << "Areas retained " << areas.size() << endl;
+
+	for (unsigned k = 0; k < areas.size(); k++)
+		{
+		const AloeEndemicArea &area = areas[k];
+		unsigned a = AloeBitMatrix::PopCount(&area.cells[0], (unsigned)area.cells.size());
+		out << endl << "Area " << (k + 1) << " (score " << setprecision(4) << area.score << ", " << a << " cell(s), ";
+		out << area.species.size() << " species)" << endl;
+
+		out << "   Cells:";
+		const char *sep = " ";
+		for (unsigned c = 0; c < ncells; c++)
+			{
+			if (area.cells[c / AloeBitMatrix::wordBits] & ((AloeWord)1 << (c % AloeBitMatrix::wordBits)))
+				{
+				out << sep << cellLabels[c];
+				sep = ", ";
+				}
+			}
+		out << endl;
+
+		out << "   Species:";
+		sep = " ";
+		for (unsigned s = 0; s < area.species.size(); s++)
+			{
+			out << sep << speciesLabels[area.species[s]] << " (" << setprecision(3) << area.scores[s] << ")";
+			sep = ", ";
+			}
+		out << endl;
+		}
+	}
@@ -0,0 +1,136 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef ALOE_ALOEENDEMICAREAS_H
+#define ALOE_ALOEENDEMICAREAS_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Heuristic search for areas of endemism in the manner of NDM (Szumik & Goloboff 2004): sets of cells (the rows of
+|	the matrix) whose species are found mostly in those cells and in most of them. For an area A of a cells, a species
+|	present in `in' cells of A and in `range' cells in all scores (in / a) x (in / range), i.e., the fraction of the
+|	area it occupies times the fraction of its range inside the area. The score of A is the sum of the scores of its
+|	species less the sum expected if the cells of A had been picked at random (a x sum of range / N^2, where N is the
+|	number of cells), so that the whole grid scores 0 however rich it is. An area is retained if at least `minSpecies'
+|	species score `minSpeciesScore' or more.
+|~
+|	o If the width of the grid is given, the cells are taken to be listed row by row and an area must be a set of
+|	  contiguous cells (sharing an edge); otherwise any set of cells is an area.
+|	o The score is a function of a, the sum over species of in^2 / range, and constants, so adding or removing one
+|	  cell updates it in time proportional to the number of species in that cell.
+|	o Each start grows an area from a random cell by the best addition or removal of a cell, until no move improves
+|	  the score. Starts are tasks for an AloeThreadPool; start k draws its random numbers from stream k of the seed,
+|	  so the results do not depend on the number of threads.
+|	o The areas found by more than one start are recognised by a hash of their cell bit sets.
+|~
+|>
+|	AloeEndemicAreas aoe(matrix, width);
+|	aoe.Search(1000, seed, nthreads);
+|	aoe.Write(out, cellLabels, speciesLabels);
+|>
+*/
+class AloeEndemicAreas
+	{
+	public:
+
+		enum
+			{
+			defaultMaxAreas	= 20,	/* number of areas kept by Search unless specified */
+			minSpecies		= 2		/* number of species scoring at least `minSpeciesScore' needed to retain an area */
+			};
+
+		static const double	minSpeciesScore;	/* score a species must reach to count towards `minSpecies' */
+
+							AloeEndemicAreas(const AloeBitMatrix &m, unsigned gridWidth = 0, unsigned nrows = 0);
+
+		const AloeWordVector	&GetCells(unsigned k) const;
+		unsigned			GetNAreas() const;
+		unsigned			GetNStarts() const;
+		double				GetScore(unsigned k) const;
+		unsigned			Search(unsigned starts, AloeWord seed = 1, unsigned nthreads = 0, unsigned maxAreas = defaultMaxAreas);
+		void				Write(ostream &out, const NxsStringVector &cellLabels, const NxsStringVector &speciesLabels) const;
+
+	private:
+
+		friend class AloeEndemicAreaSearch;
+
+		struct AloeEndemicArea	/* an area of endemism found by Search */
+			{
+			AloeWordVector		cells;		/* one bit for each cell in the area */
+			double				score;		/* the score of the area */
+			NxsUnsignedVector	species;	/* the species scoring at least `minSpeciesScore', best first */
+			AloeDoubleVector	scores;		/* the score of each species in `species' */
+			};
+
+		typedef vector<AloeEndemicArea>		AloeEndemicAreaVector;
+
+		unsigned			ncells;			/* number of cells */
+		unsigned			nspecies;		/* number of species */
+		unsigned			width;			/* number of cells in each row of the grid, or 0 if there is no grid */
+		NxsUnsignedVector	first;			/* position in `present' of the first species of each cell (and one past the last) */
+		NxsUnsignedVector	present;		/* the species present in each cell, cell after cell */
+		NxsUnsignedVector	range;			/* number of cells in which each species is present */
+		NxsUnsignedVector	occupied;		/* the cells with at least one species, from which the starts are drawn */
+		double				background;		/* sum of range / N^2: the score of a random cell set of a cells is a times this */
+		unsigned			nstarts;		/* number of starts made by Search */
+		AloeEndemicAreaVector	areas;		/* the areas found, best first */
+
+		void				Describe(AloeEndemicArea &area) const;
+
+		static bool			Before(const AloeEndemicArea &a, const AloeEndemicArea &b);
+		static AloeWord		Hash(const AloeWordVector &cells);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the cells of area `k' as a bit set. Assumes `k' is in the range [0..GetNAreas()).
+*/
+inline const AloeWordVector &AloeEndemicAreas::GetCells(
+  unsigned k) const	/* the (0-offset) index of the area */
+	{
+	assert(k < areas.size());
+	return areas[k].cells;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of areas found by the last call to Search.
+*/
+inline unsigned AloeEndemicAreas::GetNAreas() const
+	{
+	return (unsigned)areas.size();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of starts made by the last call to Search.
+*/
+inline unsigned AloeEndemicAreas::GetNStarts() const
+	{
+	return nstarts;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the score of area `k'. Assumes `k' is in the range [0..GetNAreas()).
+*/
+inline double AloeEndemicAreas::GetScore(
+  unsigned k) const	/* the (0-offset) index of the area */
+	{
+	assert(k < areas.size());
+	return areas[k].score;
+	}
+
+#endif
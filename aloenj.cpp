@@ -0,0 +1,345 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#include "aloenj.h"
+#include "aloethreadpool.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sorts every `step'-th row of the initial distances, starting with row `first', on a thread of an AloeThreadPool.
+*/
+class AloeNjSortTask : public AloeTask
+	{
+	public:
+
+		AloeNjSortTask(const AloeNj &n, unsigned f, unsigned s, const NxsBoolVector &a, AloeNj::AloeNjRowVector &r)
+		  : nj(n), first(f), step(s), active(a), rows(r) {}
+
+		void Run()
+			{
+			for (unsigned i = first; i < rows.size(); i += step)
+				nj.BuildRow(i, i, active, rows[i]);
+			}
+
+	private:
+
+		const AloeNj			&nj;		/* the object doing the work */
+		unsigned				first;		/* the first row to sort */
+		unsigned				step;		/* the distance between the rows sorted */
+		const NxsBoolVector		&active;	/* which slots hold nodes */
+		AloeNj::AloeNjRowVector	&rows;		/* the rows */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Creates an object with nothing to join.
+*/
+AloeNj::AloeNj()
+	{
+	nitems = 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `row' with the distances between the node in slot `s' and the nodes in the active slots below `nslots'
+|	(other than `s' itself), sorted in increasing order.
+*/
+void AloeNj::BuildRow(
+  unsigned s,					/* the slot whose row is wanted */
+  unsigned nslots,				/* one past the last slot to include */
+  const NxsBoolVector &active,	/* which slots hold nodes */
+  AloeNjRow &row) const			/* on return, the sorted row */
+	{
+	unsigned n = 0;
+	for (unsigned t = 0; t < nslots; t++)
+		{
+		if (active[t] && t != s)
+			n++;
+		}
+
+	AloeNjRow sorted(n);
+	n = 0;
+	for (unsigned t = 0; t < nslots; t++)
+		{
+		if (active[t] && t != s)
+			{
+			sorted[n].d = distances[Index(s, t)];
+			sorted[n].slot = t;
+			n++;
+			}
+		}
+	sort(sorted.begin(), sorted.end(), Before);
+	row.swap(sorted);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Builds the neighbour-joining tree of the items, sorting the initial rows on `nthreads' threads (0 means one per
+|	core); the joins themselves are made one at a time. The distances given are used up: on return they hold the
+|	distances between the nodes left at the end of the joining.
+*/
+void AloeNj::Run(
+  unsigned nthreads)	/* the number of threads to use */
+	{
+	left.clear();
+	right.clear();
+	basal.clear();
+	lengths.assign(nitems, 0.0);
+	if (nitems < 3)
+		{
+		for (unsigned i = 0; i < nitems; i++)
+			basal.push_back(i);
+		if (nitems == 2)
+			lengths[0] = lengths[1] = 0.5 * distances[0];
+		return;
+		}
+
+	NxsBoolVector active(nitems, true);
+	NxsUnsignedVector node(nitems);		// the node (item or join) held by each slot
+	NxsUnsignedVector born(nitems);		// when the node in each slot was made (items first; UINT_MAX once joined)
+	NxsUnsignedVector head(nitems, 0);	// entries of each row before this one are known to be stale
+	vector<double> r(nitems, 0.0);		// sums of the distances in each row
+	for (unsigned i = 0; i < nitems; i++)
+		{
+		node[i] = born[i] = i;
+		const float *row = &distances[0] + (size_t)i * (i - 1) / 2;
+		for (unsigned j = 0; j < i; j++)
+			{
+			r[i] += row[j];
+			r[j] += row[j];
+			}
+		}
+
+	AloeNjRowVector rows(nitems);
+	AloeThreadPool pool(nthreads);
+	vector<AloeNjSortTask *> tasks;
+	for (unsigned k = 0; k < pool.GetNThreads(); k++)
+		{
+		tasks.push_back(new AloeNjSortTask(*this, k, pool.GetNThreads(), active, rows));
+		pool.Add(tasks.back());
+		}
+	pool.Run();
+	for (unsigned k = 0; k < tasks.size(); k++)
+		delete tasks[k];
+
+	unsigned compacted = nitems;
+	for (unsigned m = nitems; m > 3; m--)
+		{
+		double rmax = 0.0;
+		for (unsigned s = 0; s < nitems; s++)
+			{
+			if (active[s] && r[s] > rmax)
+				rmax = r[s];
+			}
+
+		// Find the pair with the smallest Q, reading each row only while its bound could beat the best so far, that
+		// is while the distance is below `limit'. An entry is stale if its node has since been joined, or replaced by
+		// a node younger than the row's own
+		//
+		double m2 = m - 2;
+		double best = DBL_MAX;
+		unsigned a = nitems, b = nitems;
+		for (unsigned s = 0; s < nitems; s++)
+			{
+			if (!active[s] || rows[s].empty())
+				continue;
+			const AloeNjRow &row = rows[s];
+			const AloeNjEntry *e = &row[0] + head[s];
+			const AloeNjEntry *end = &row[0] + row.size();
+			unsigned bs = born[s];
+			while (e < end && born[e->slot] > bs)
+				e++;
+			head[s] = (unsigned)(e - &row[0]);
+			double rs = r[s];
+			double limit = (best == DBL_MAX ? DBL_MAX : (best + rs + rmax) / m2);
+			for (; e < end && e->d < limit; e++)
+				{
+				unsigned t = e->slot;
+				if (born[t] > bs)
+					continue;
+				double q = m2 * e->d - rs - r[t];
+				if (q < best)
+					{
+					best = q;
+					limit = (best + rs + rmax) / m2;
+					a = s;
+					b = t;
+					}
+				}
+			}
+		assert(a < nitems && b < nitems);
+
+		// Join them, putting the new node in the lower numbered slot
+		//
+		double dab = distances[Index(a, b)];
+		double la = 0.5 * dab + (r[a] - r[b]) / (2.0 * m2);
+		lengths[node[a]] = la;
+		lengths[node[b]] = dab - la;
+		left.push_back(node[a]);
+		right.push_back(node[b]);
+
+		unsigned keep = (a < b ? a : b);
+		unsigned drop = (a < b ? b : a);
+		double rkeep = 0.0;
+		for (unsigned t = 0; t < nitems; t++)
+			{
+			if (!active[t] || t == a || t == b)
+				continue;
+			double dat = distances[Index(a, t)];
+			double dbt = distances[Index(b, t)];
+			float d = (float)(0.5 * (dat + dbt - dab));
+			distances[Index(keep, t)] = d;
+			r[t] += d - dat - dbt;
+			rkeep += d;
+			}
+		r[keep] = rkeep;
+		active[drop] = false;
+		born[drop] = UINT_MAX;
+		node[keep] = nitems + (unsigned)left.size() - 1;
+		born[keep] = node[keep];
+		lengths.push_back(0.0);
+		BuildRow(keep, nitems, active, rows[keep]);
+		head[keep] = 0;
+		AloeNjRow().swap(rows[drop]);
+
+		// Drop the stale entries from every row each time the number of nodes has halved
+		//
+		if (2 * (m - 1) <= compacted)
+			{
+			compacted = m - 1;
+			for (unsigned s = 0; s < nitems; s++)
+				{
+				if (!active[s])
+					continue;
+				AloeNjRow &row = rows[s];
+				unsigned n = 0;
+				for (unsigned k = head[s]; k < row.size(); k++)
+					{
+					if (born[row[k].slot] < born[s])
+						row[n++] = row[k];
+					}
+				AloeNjRow(row.begin(), row.begin() + n).swap(row);
+				head[s] = 0;
+				}
+			}
+		}
+
+	// Join the last three nodes at the root
+	//
+	for (unsigned s = 0; s < nitems; s++)
+		{
+		if (active[s])
+			basal.push_back(s);
+		}
+	assert(basal.size() == 3);
+	double d01 = distances[Index(basal[0], basal[1])];
+	double d02 = distances[Index(basal[0], basal[2])];
+	double d12 = distances[Index(basal[1], basal[2])];
+	lengths[node[basal[0]]] = 0.5 * (d01 + d02 - d12);
+	lengths[node[basal[1]]] = 0.5 * (d01 + d12 - d02);
+	lengths[node[basal[2]]] = 0.5 * (d02 + d12 - d01);
+	for (unsigned k = 0; k < 3; k++)
+		basal[k] = node[basal[k]];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Takes `packed' as the distances between `n' items: the lower triangle of the distance matrix stored row after row
+|	without the diagonal (the pair i, j with j < i being at i x (i - 1) / 2 + j). The contents of `packed' are taken
+|	over rather than copied, leaving it empty.
+*/
+void AloeNj::SetDistances(
+  unsigned n,				/* the number of items */
+  vector<float> &packed)	/* the distances */
+	{
+	assert(packed.size() == (size_t)n * (n > 0 ? n - 1 : 0) / 2);
+	nitems = n;
+	distances.swap(packed);
+	packed.clear();
+	left.clear();
+	right.clear();
+	basal.clear();
+	lengths.clear();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the tree found by Run to `out' as a NEXUS file holding a TAXA block and a TREES block, which can be read by
+|	NxsTreesBlock. The tree is unrooted, and (as usual with neighbour-joining) some branch lengths may be negative.
+|	`labels' must hold a label for every item. The tree is written without recursion, since it may be very deep.
+*/
+void AloeNj::Write(
+  ostream &out,						/* the stream to write to */
+  const NxsStringVector &labels) const	/* the item (area) labels */
+	{
+	assert(labels.size() >= nitems);
+
+	out << "#NEXUS" << endl << endl;
+	out << "[Neighbour-joining tree of " << nitems << " areas]" << endl << endl;
+
+	NxsStringVector quoted(labels.begin(), labels.begin() + nitems);
+	for (unsigned i = 0; i < nitems; i++)
+		{
+		if (quoted[i].QuotesNeeded())
+			quoted[i].AddQuotes();
+		}
+
+	out << "BEGIN TAXA;" << endl;
+	out << "\tDIMENSIONS NTAX=" << nitems << ";" << endl;
+	out << "\tTAXLABELS" << endl;
+	for (unsigned i = 0; i < nitems; i++)
+		out << "\t\t" << quoted[i] << endl;
+	out << "\t;" << endl;
+	out << "END;" << endl << endl;
+
+	out << "BEGIN TREES;" << endl;
+	out << "\tTRANSLATE" << endl;
+	for (unsigned i = 0; i < nitems; i++)
+		out << "\t\t" << (i + 1) << " " << quoted[i] << (i + 1 < nitems ? "," : "") << endl;
+	out << "\t;" << endl;
+	out << "\tTREE NJ = [&U] ";
+	if (nitems == 1)
+		out << "1";
+	else if (nitems > 1)
+		{
+		out << '(';
+		for (unsigned k = 0; k < basal.size(); k++)
+			{
+			if (k > 0)
+				out << ',';
+
+			// Each entry of the stack is a node and the number of its children written so far
+			//
+			vector< pair<unsigned, unsigned> > stack(1, make_pair(basal[k], 0u));
+			while (!stack.empty())
+				{
+				unsigned v = stack.back().first;
+				unsigned done = stack.back().second;
+				if (v < nitems || done == 2)
+					{
+					if (v < nitems)
+						out << (v + 1);
+					else
+						out << ')';
+					out << ':' << setprecision(6) << lengths[v];
+					stack.pop_back();
+					continue;
+					}
+				out << (done == 0 ? "(" : ",");
+				stack.back().second++;
+				stack.push_back(make_pair(done == 0 ? left[v - nitems] : right[v - nitems], 0u));
+				}
+			}
+		out << ')';
+		}
+	out << ";" << endl;
+	out << "END;" << endl;
+	}
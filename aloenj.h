@@ -0,0 +1,123 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef ALOE_ALOENJ_H
+#define ALOE_ALOENJ_H
+
+#include <ncl.h>
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Neighbour-joining (Saitou & Nei 1987) of areas, with the search for the pair to join bounded as in RapidNJ
+|	(Simonsen, Mailund & Pedersen 2008), so that trees of tens of thousands of areas can be built:
+|~
+|	o The distances are held as a packed lower triangle of floats (n(n - 1)/2 values), and a new node takes the place
+|	  of the lower numbered of the two it joins. No square matrix is ever made.
+|	o Each row keeps its distances to the nodes older than itself, sorted in increasing order, so that every pair of
+|	  nodes is found in exactly one row. Rows of the initial areas are sorted once, on several threads; a new node
+|	  gets a sorted row of its distances to every other node.
+|	o Q(i, j) = (m - 2) d(i, j) - r(i) - r(j), where m is the number of nodes and r the row sums, is never less than
+|	  (m - 2) d(i, j) - r(i) - max r. Each sorted row is therefore read only until this bound reaches the smallest Q
+|	  found so far, which for most rows is after the first few entries. Entries left behind by nodes that have been
+|	  joined are skipped, and dropped from the rows whenever the number of nodes has halved.
+|~
+|	The distances are given to SetDistances (e.g. from AloeSimilarity::GetDissimilarities, or from a DISTANCES block
+|	with AloeCluster::PackDistances). Write saves the unrooted tree as a NEXUS TREES block:
+|>
+|	AloeNj nj;
+|	nj.SetDistances(n, packed);
+|	nj.Run();
+|	nj.Write(out, labels);
+|>
+*/
+class AloeNj
+	{
+	public:
+
+							AloeNj();
+
+		double				GetLength() const;
+		unsigned			GetNItems() const;
+		void				Run(unsigned nthreads = 0);
+		void				SetDistances(unsigned n, vector<float> &packed);
+		void				Write(ostream &out, const NxsStringVector &labels) const;
+
+	private:
+
+		struct AloeNjEntry	/* one entry of a sorted row */
+			{
+			float		d;		/* the distance between the row's node and node `slot' */
+			unsigned	slot;	/* the slot holding the other node */
+			};
+
+		typedef vector<AloeNjEntry>	AloeNjRow;
+		typedef vector<AloeNjRow>	AloeNjRowVector;
+
+		friend class AloeNjSortTask;
+
+		unsigned			nitems;		/* number of items (areas) */
+		vector<float>		distances;	/* lower triangle of the distances between nodes (see Index) */
+		NxsUnsignedVector	left;		/* first node joined by each join (items are 0 to n - 1, join k is n + k) */
+		NxsUnsignedVector	right;		/* second node joined by each join */
+		NxsUnsignedVector	basal;		/* the (up to three) nodes left when the joining stops, joined at the root */
+		vector<double>		lengths;	/* length of the branch above each node (item or join) */
+
+		void				BuildRow(unsigned s, unsigned nslots, const NxsBoolVector &active, AloeNjRow &row) const;
+		size_t				Index(unsigned i, unsigned j) const;
+
+		static bool			Before(const AloeNjEntry &a, const AloeNjEntry &b);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the total length of the branches of the tree found by Run.
+*/
+inline double AloeNj::GetLength() const
+	{
+	double total = 0.0;
+	for (unsigned v = 0; v < lengths.size(); v++)
+		total += lengths[v];
+	return total;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of items (areas) whose distances were given.
+*/
+inline unsigned AloeNj::GetNItems() const
+	{
+	return nitems;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the position in `distances' of the distance between the nodes in slots `i' and `j', which must differ.
+*/
+inline size_t AloeNj::Index(
+  unsigned i,	/* the first slot */
+  unsigned j) const	/* the second slot */
+	{
+	return (i > j ? (size_t)i * (i - 1) / 2 + j : (size_t)j * (j - 1) / 2 + i);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Orders the entries of a row by distance (then by slot, so that the order does not depend on the sort).
+*/
+inline bool AloeNj::Before(
+  const AloeNjEntry &a,	/* the first entry */
+  const AloeNjEntry &b)	/* the second entry */
+	{
+	return (a.d < b.d || (a.d == b.d && a.slot < b.slot));
+	}
+
+#endif
@@ -0,0 +1,223 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#include "aloenodf.h"
+#include "aloethreadpool.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Counts, for some of the rows of a matrix taken in order of decreasing totals, the presences each shares with the
+|	rows ahead of its group of equal totals. Run on a thread of an AloeThreadPool, or directly.
+*/
+class AloeNodfTask : public AloeTask
+	{
+	public:
+
+		AloeNodfTask(const AloeBitMatrix &m, const AloeNodf::AloeNodfOrder &o, unsigned f, unsigned s, AloeWordVector &sh)
+		  : matrix(m), order(o), first(f), stride(s), shared(sh) {}
+
+		void Run();
+
+		const AloeBitMatrix				&matrix;	/* the matrix */
+		const AloeNodf::AloeNodfOrder	&order;		/* its rows in order of decreasing totals */
+		unsigned						first;		/* the first block of positions in `order' handled by the task */
+		unsigned						stride;		/* the task handles every `stride'th block from `first' */
+		AloeWordVector					&shared;	/* on return, the shared counts of each position handled */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `shared' for the blocks of positions given to the task. The blocks are interleaved among the tasks, since
+|	positions further down the order have more rows ahead of them. Each row ahead is compared with every row of the
+|	block in turn, so that it is read from memory once per block rather than once per row.
+*/
+void AloeNodfTask::Run()
+	{
+	unsigned nwords = matrix.GetNWords();
+	unsigned n = (unsigned)order.order.size();
+	unsigned block = AloeNodf::blockRows;
+	for (unsigned q0 = first * block; q0 < n; q0 += stride * block)
+		{
+		unsigned q1 = (q0 + block < n ? q0 + block : n);
+		for (unsigned q = q0; q < q1; q++)
+			shared[q] = 0;
+
+		unsigned last = order.ahead[q1 - 1];
+		for (unsigned p = 0; p < last; p++)
+			{
+			const AloeWord *a = matrix.GetRow(order.order[p]);
+			for (unsigned q = q0; q < q1; q++)
+				{
+				if (p < order.ahead[q])
+					shared[q] += AloeBitMatrix::AndCount(a, matrix.GetRow(order.order[q]), nwords);
+				}
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes NODF for the first `nareas' rows of `m' (every row if `nareas' is 0), using `nthreads' threads (one per
+|	core if 0). The matrix is not kept.
+*/
+AloeNodf::AloeNodf(
+  const AloeBitMatrix &m,	/* the presence/absence matrix, one row per area */
+  unsigned nareas,			/* the number of areas to use */
+  unsigned nthreads)		/* the number of threads to use */
+	{
+	nrows = (nareas == 0 || nareas > m.GetNRows() ? m.GetNRows() : nareas);
+	ncols = m.GetNCols();
+
+	AloeBitMatrix data(nrows, ncols);
+	unsigned nwords = data.GetNWords();
+	NxsUnsignedVector totals(nrows);
+	for (unsigned i = 0; i < nrows; i++)
+		{
+		const AloeWord *r = m.GetRow(i);
+		AloeWord *t = data.GetRow(i);
+		for (unsigned w = 0; w < nwords; w++)
+			t[w] = r[w];
+		totals[i] = data.RowCount(i);
+		}
+	Sort(totals, areas);
+	data.ColumnCounts(totals);
+	Sort(totals, species);
+
+	areaSum = PairSum(data, areas, nthreads);
+	AloeBitMatrix t;
+	data.Transpose(t);
+	speciesSum = PairSum(t, species, nthreads);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns NODF given the sums of the scores of the pairs of areas and of species.
+*/
+double AloeNodf::Combine(
+  double areaTotal,				/* sum of the scores of the pairs of areas */
+  double speciesTotal) const	/* sum of the scores of the pairs of species */
+	{
+	double pairs = Pairs(nrows) + Pairs(ncols);
+	return (pairs == 0.0 ? 0.0 : 100.0 * (areaTotal + speciesTotal) / pairs);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns NODF for `m', which must have the same row and column totals as the matrix given to the constructor (as
+|	the random matrices of an AloeNullModel do). Uses the calling thread only.
+*/
+double AloeNodf::Evaluate(
+  const AloeBitMatrix &m) const	/* the matrix */
+	{
+	assert(m.GetNRows() == nrows && m.GetNCols() == ncols);
+	double a = PairSum(m, areas, 1);
+	AloeBitMatrix t;
+	m.Transpose(t);
+	return Combine(a, PairSum(t, species, 1));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the sum of the scores (shared presences / total of the second row, as a fraction) of the pairs of rows of
+|	`m' with different totals. The shared counts are integers, so their sum for each row does not depend on how the
+|	rows are shared among the threads, and the scores are then added up in order.
+*/
+double AloeNodf::PairSum(
+  const AloeBitMatrix &m,	/* the matrix */
+  const AloeNodfOrder &o,	/* its rows in order of decreasing totals */
+  unsigned nthreads)		/* the number of threads to use (0 for one per core) */
+	{
+	unsigned n = (unsigned)o.order.size();
+	AloeWordVector shared(n, 0);
+	if (nthreads == 1)
+		{
+		AloeNodfTask task(m, o, 0, 1, shared);
+		task.Run();
+		}
+	else
+		{
+		AloeThreadPool pool(nthreads);
+		unsigned ntasks = 4 * pool.GetNThreads();
+		vector<AloeNodfTask *> tasks;
+		for (unsigned k = 0; k < ntasks && k * blockRows < n; k++)
+			{
+			tasks.push_back(new AloeNodfTask(m, o, k, ntasks, shared));
+			pool.Add(tasks.back());
+			}
+		pool.Run();
+		for (unsigned k = 0; k < tasks.size(); k++)
+			delete tasks[k];
+		}
+
+	double sum = 0.0;
+	for (unsigned q = 0; q < n; q++)
+		{
+		if (shared[q] > 0)
+			sum += (double)shared[q] / o.totals[o.order[q]];
+		}
+	return sum;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `o' with the rows whose totals are `totals' in order of decreasing totals (rows with equal totals in their
+|	original order), and the number of rows ahead of the group of equal totals of each.
+*/
+void AloeNodf::Sort(
+  const NxsUnsignedVector &totals,	/* the total of each row */
+  AloeNodfOrder &o)					/* on return, the order of the rows */
+	{
+	unsigned n = (unsigned)totals.size();
+	vector< pair<unsigned, unsigned> > keyed(n);
+	for (unsigned i = 0; i < n; i++)
+		keyed[i] = make_pair(UINT_MAX - totals[i], i);
+	sort(keyed.begin(), keyed.end());
+
+	o.totals = totals;
+	o.order.resize(n);
+	o.ahead.resize(n);
+	for (unsigned q = 0; q < n; q++)
+		{
+		o.order[q] = keyed[q].second;
+		o.ahead[q] = (q > 0 && keyed[q].first == keyed[q - 1].first ? o.ahead[q - 1] : q);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes NODF for the areas, the species and both to `out'. If `null' is given and has made its randomisations, the
+|	mean NODF of its random matrices, the standardised effect size and the probabilities of a value at least and at
+|	most as large as that of the data are added; `k' is the number returned when this object was added to `null'.
+|	Left justification is assumed to have been set on `out'.
+*/
+void AloeNodf::Write(
+  ostream &out,					/* the stream to write to */
+  const AloeNullModel *null,	/* the null model against which NODF was tested, or NULL */
+  unsigned k) const				/* the number of this statistic in `null' */
+	{
+	out << "Nestedness (NODF)" << endl << endl;
+	out << setw(40) << "NODF (pairs of areas) " << setprecision(4) << GetAreaNodf() << endl;
+	out << setw(40) << "NODF (pairs of species) " << setprecision(4) << GetSpeciesNodf() << endl;
+	out << setw(40) << "NODF " << setprecision(4) << GetNodf() << endl;
+	if (null == NULL || null->GetNRandomisations() == 0)
+		return;
+
+	unsigned n = null->GetNRandomisations();
+	const AloeNullStatistic &s = null->GetStatistic(k);
+	double ses;
+	out << setw(40) << "Random matrices " << n << " (" << AloeNullModel::GetAlgorithmName(null->GetAlgorithm()) << ")" << endl;
+	out << setw(40) << "Mean NODF of random matrices " << setprecision(4) << s.GetMean(n) << endl;
+	out << setw(40) << "SES ";
+	if (s.GetSES(n, ses))
+		out << setprecision(3) << ses << endl;
+	else
+		out << "-" << endl;
+	out << setw(40) << "P(>=) " << setprecision(3) << s.GetPGreater(n) << endl;
+	out << setw(40) << "P(<=) " << setprecision(3) << s.GetPLess(n) << endl;
+	}
@@ -0,0 +1,113 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef ALOE_ALOENODF_H
+#define ALOE_ALOENODF_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+#include "aloenullmodel.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Nestedness of a presence/absence matrix measured by NODF (Almeida-Neto et al. 2008). With the areas (rows) sorted
+|	by decreasing number of species, each pair of areas where the first has more species than the second scores the
+|	percentage of the species of the second also found in the first; pairs with equal totals score 0. The same is done
+|	for the species (columns) sorted by decreasing number of areas. NODF is the mean score over all pairs of areas and
+|	of species; the means over the pairs of areas alone and of species alone are also given.
+|~
+|	o The rows and columns are ordered once, by their totals. A pair is only visited if the totals differ, so every
+|	  area is compared with the areas ahead of its group of equal totals.
+|	o The shared species of two areas are counted by AND and popcount over their bit rows, and the shared areas of two
+|	  species over the rows of the transposed matrix. The areas (species) are shared among the threads of an
+|	  AloeThreadPool, each thread summing the shared counts of the areas (species) it was given, so the result is the
+|	  same whatever the number of threads.
+|	o AloeNodf is an AloeMatrixStatistic, so NODF can be tested against the random matrices of an AloeNullModel. Their
+|	  totals are those of the data, so the order found once serves for all of them.
+*/
+class AloeNodf : public AloeMatrixStatistic
+	{
+	public:
+
+		enum {blockRows = 16};	/* number of rows compared with each row ahead of them in one pass */
+
+							AloeNodf(const AloeBitMatrix &m, unsigned nareas = 0, unsigned nthreads = 0);
+
+		double				Evaluate(const AloeBitMatrix &m) const;
+		double				GetAreaNodf() const;
+		double				GetNodf() const;
+		double				GetSpeciesNodf() const;
+		void				Write(ostream &out, const AloeNullModel *null = NULL, unsigned k = 0) const;
+
+	private:
+
+		friend class AloeNodfTask;
+
+		struct AloeNodfOrder	/* the rows of a matrix in order of decreasing totals */
+			{
+			NxsUnsignedVector	order;		/* the rows, largest total first */
+			NxsUnsignedVector	ahead;		/* number of rows ahead of the group of equal totals of each row in `order' */
+			NxsUnsignedVector	totals;		/* the total of each row */
+			};
+
+		unsigned			nrows;			/* number of areas */
+		unsigned			ncols;			/* number of species */
+		AloeNodfOrder		areas;			/* the areas, by decreasing number of species */
+		AloeNodfOrder		species;		/* the species, by decreasing number of areas */
+		double				areaSum;		/* sum of the scores of the pairs of areas in the data */
+		double				speciesSum;		/* sum of the scores of the pairs of species in the data */
+
+		double				Combine(double areaTotal, double speciesTotal) const;
+
+		static double		PairSum(const AloeBitMatrix &m, const AloeNodfOrder &o, unsigned nthreads);
+		static void			Sort(const NxsUnsignedVector &totals, AloeNodfOrder &o);
+		static double		Pairs(unsigned n);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns NODF over the pairs of areas only.
+*/
+inline double AloeNodf::GetAreaNodf() const
+	{
+	return (nrows < 2 ? 0.0 : 100.0 * areaSum / Pairs(nrows));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns NODF over every pair of areas and of species.
+*/
+inline double AloeNodf::GetNodf() const
+	{
+	return Combine(areaSum, speciesSum);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns NODF over the pairs of species only.
+*/
+inline double AloeNodf::GetSpeciesNodf() const
+	{
+	return (ncols < 2 ? 0.0 : 100.0 * speciesSum / Pairs(ncols));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of pairs of `n' items.
+*/
+inline double AloeNodf::Pairs(
+  unsigned n)	/* the number of items */
+	{
+	return 0.5 * n * ((double)n - 1.0);
+	}
+
+#endif
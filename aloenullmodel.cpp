@@ -0,0 +1,446 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloenullmodel.h"
+#include "aloerandom.h"
+#include "aloethreadpool.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	One Markov chain of random matrices, run on a thread of an AloeThreadPool. The chain works on its own copy of the
+|	matrix and keeps the number of endemic species in each area up to date as it goes.
+*/
+class AloeNullChain : public AloeTask
+	{
+	public:
+
+		enum {maxAttempts = 1000};	/* number of 2 x 2 submatrices tried by a swap step before it gives up */
+
+		AloeNullChain(const AloeNullModel &m, AloeWord s, unsigned c, unsigned n)
+		  : model(m), seed(s), chain(c), samples(n) {}
+
+		void Run();
+
+		const AloeNullModel		&model;			/* the test to which the chain belongs */
+		AloeWord				seed;			/* the seed of the test */
+		unsigned				chain;			/* the number of the chain, which selects its random number stream */
+		unsigned				samples;		/* the number of randomisations to make */
+		AloeNullStatisticVector	areas;			/* on return, the simulated endemic counts of each area */
+		AloeNullStatistic		endemicAreas;	/* on return, the simulated numbers of areas with endemic species */
+		AloeNullStatisticVector	values;			/* on return, the simulated values of the statistics of the model */
+
+	private:
+
+		AloeBitMatrix			matrix;			/* the current random matrix */
+		NxsUnsignedVector		endemics;		/* number of endemic species in each area of `matrix' */
+		unsigned				withEndemics;	/* number of areas of `matrix' with at least one endemic species */
+		NxsUnsignedVector		traded;			/* the species traded by the last curveball step */
+
+		void					Recount(unsigned i);
+		void					Step(AloeRandom &rng);
+		void					Swap(AloeRandom &rng);
+		void					Trade(AloeRandom &rng);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs the chain: `burnIn' steps from the observed matrix, then `samples' randomisations `thin' steps apart.
+*/
+void AloeNullChain::Run()
+	{
+	AloeRandom rng(seed, chain);
+	matrix = model.matrix;
+	unsigned nareas = matrix.GetNRows();
+
+	areas.assign(nareas, AloeNullStatistic());
+	endemics.assign(nareas, 0);
+	withEndemics = 0;
+	for (unsigned i = 0; i < nareas; i++)
+		{
+		areas[i].observed = model.areas[i].observed;
+		endemics[i] = (unsigned)model.areas[i].observed;
+		if (endemics[i] > 0)
+			withEndemics++;
+		}
+	endemicAreas = AloeNullStatistic();
+	endemicAreas.observed = model.endemicAreas.observed;
+	values = model.values;
+	for (unsigned k = 0; k < values.size(); k++)
+		{
+		double observed = values[k].observed;
+		values[k] = AloeNullStatistic();
+		values[k].observed = observed;
+		}
+
+	for (unsigned k = 0; k < model.burnIn; k++)
+		Step(rng);
+
+	for (unsigned s = 0; s < samples; s++)
+		{
+		for (unsigned k = 0; k < model.thin; k++)
+			Step(rng);
+		for (unsigned i = 0; i < nareas; i++)
+			areas[i].Add(endemics[i]);
+		endemicAreas.Add(withEndemics);
+		for (unsigned k = 0; k < values.size(); k++)
+			values[k].Add(model.statistics[k]->Evaluate(matrix));
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Recomputes the number of endemic species in area `i'.
+*/
+void AloeNullChain::Recount(
+  unsigned i)	/* the (0-offset) index of the area */
+	{
+	if (endemics[i] > 0)
+		withEndemics--;
+	endemics[i] = AloeBitMatrix::AndCount(matrix.GetRow(i), &model.endemic[0], matrix.GetNWords());
+	if (endemics[i] > 0)
+		withEndemics++;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes one step of the chosen algorithm.
+*/
+inline void AloeNullChain::Step(
+  AloeRandom &rng)	/* the random number generator of the chain */
+	{
+	if (model.algorithm == AloeNullModel::swap)
+		Swap(rng);
+	else
+		Trade(rng);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Curveball step: the species found in one of two random areas but not the other are pooled, and each area is given
+|	back as many of them as it had, drawn at random.
+*/
+void AloeNullChain::Trade(
+  AloeRandom &rng)	/* the random number generator of the chain */
+	{
+	unsigned nareas = matrix.GetNRows();
+	unsigned i = rng.Below(nareas);
+	unsigned j = rng.Below(nareas - 1);
+	if (j >= i)
+		j++;
+
+	AloeWord *a = matrix.GetRow(i);
+	AloeWord *b = matrix.GetRow(j);
+	unsigned nwords = matrix.GetNWords();
+	unsigned fromA = 0;
+	traded.clear();
+	for (unsigned w = 0; w < nwords; w++)
+		{
+		AloeWord d = a[w] ^ b[w];
+		if (d == 0)
+			continue;
+		fromA += AloeBitMatrix::PopCount(a[w] & d);
+		a[w] &= ~d;
+		b[w] &= ~d;
+		for (; d != 0; d &= d - 1)
+			traded.push_back(w * AloeBitMatrix::wordBits + AloeBitMatrix::LowestBit(d));
+		}
+	if (traded.empty())
+		return;
+
+	unsigned n = (unsigned)traded.size();
+	for (unsigned k = 0; k < n; k++)
+		{
+		if (k < fromA)
+			{
+			unsigned r = k + rng.Below(n - k);
+			unsigned t = traded[r];
+			traded[r] = traded[k];
+			traded[k] = t;
+			}
+		unsigned col = traded[k];
+		AloeWord bit = (AloeWord)1 << (col % AloeBitMatrix::wordBits);
+		(k < fromA ? a : b)[col / AloeBitMatrix::wordBits] |= bit;
+		}
+
+	Recount(i);
+	Recount(j);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sequential swap step: random 2 x 2 submatrices are tried until one is a checkerboard (10/01 or 01/10), which is
+|	then swapped. Gives up after `maxAttempts' tries, which only happens if the matrix has few or no checkerboards.
+*/
+void AloeNullChain::Swap(
+  AloeRandom &rng)	/* the random number generator of the chain */
+	{
+	unsigned nareas = matrix.GetNRows();
+	unsigned nspecies = matrix.GetNCols();
+	if (nspecies < 2)
+		return;
+
+	for (unsigned attempt = 0; attempt < maxAttempts; attempt++)
+		{
+		unsigned i = rng.Below(nareas);
+		unsigned j = rng.Below(nareas - 1);
+		if (j >= i)
+			j++;
+		unsigned x = rng.Below(nspecies);
+		unsigned y = rng.Below(nspecies - 1);
+		if (y >= x)
+			y++;
+
+		bool ix = matrix.Test(i, x);
+		if (ix == matrix.Test(i, y) || ix != matrix.Test(j, y) || ix == matrix.Test(j, x))
+			continue;
+
+		matrix.Set(i, x, !ix);
+		matrix.Set(i, y, ix);
+		matrix.Set(j, x, ix);
+		matrix.Set(j, y, !ix);
+
+		AloeWord ex = (model.endemic[x / AloeBitMatrix::wordBits] >> (x % AloeBitMatrix::wordBits)) & 1;
+		AloeWord ey = (model.endemic[y / AloeBitMatrix::wordBits] >> (y % AloeBitMatrix::wordBits)) & 1;
+		if (ex != 0 || ey != 0)
+			{
+			Recount(i);
+			Recount(j);
+			}
+		return;
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares to test the first `nareas' areas (rows) of `m', or every row if `nareas' is 0 (or more than the number
+|	of rows). The rows are copied, so `m' may be changed or destroyed afterwards.
+*/
+AloeNullModel::AloeNullModel(
+  const AloeBitMatrix &m,	/* the presence/absence matrix, one row per area */
+  unsigned nareas)			/* the number of areas to test */
+	{
+	if (nareas == 0 || nareas > m.GetNRows())
+		nareas = m.GetNRows();
+
+	matrix.Reset(nareas, m.GetNCols());
+	unsigned nwords = matrix.GetNWords();
+	presences = 0;
+	for (unsigned i = 0; i < nareas; i++)
+		{
+		const AloeWord *r = m.GetRow(i);
+		AloeWord *t = matrix.GetRow(i);
+		for (unsigned w = 0; w < nwords; w++)
+			t[w] = r[w];
+		presences += matrix.RowCount(i);
+		}
+
+	AloeWordVector once, twice;
+	matrix.GetSingletonMask(once, twice);
+	endemic.resize(nwords);
+	for (unsigned w = 0; w < nwords; w++)
+		endemic[w] = once[w] & ~twice[w];
+	if (endemic.empty())
+		endemic.push_back(0);
+
+	areas.resize(nareas);
+	for (unsigned i = 0; i < nareas; i++)
+		{
+		areas[i].observed = AloeBitMatrix::AndCount(matrix.GetRow(i), &endemic[0], nwords);
+		if (areas[i].observed > 0)
+			endemicAreas.observed++;
+		}
+
+	algorithm	= curveball;
+	nrandom		= 0;
+	burnIn		= 0;
+	thin		= 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds statistic `s' to those tested by Run, evaluating it on the data at once, and returns the number by which its
+|	results can be obtained from GetStatistic. The statistic must outlive the calls to Run.
+*/
+unsigned AloeNullModel::AddStatistic(
+  const AloeMatrixStatistic *s)	/* the statistic */
+	{
+	statistics.push_back(s);
+	values.push_back(AloeNullStatistic());
+	values.back().observed = s->Evaluate(matrix);
+	return (unsigned)values.size() - 1;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the name of algorithm `which', as accepted by ParseAlgorithm.
+*/
+const char *AloeNullModel::GetAlgorithmName(
+  AlgorithmEnum which)	/* the algorithm in question */
+	{
+	return (which == swap ? "swap" : "curveball");
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the total number of endemic species, which is the same in the data and in every random matrix.
+*/
+unsigned AloeNullModel::GetTotalEndemics() const
+	{
+	return AloeBitMatrix::PopCount(&endemic[0], (unsigned)endemic.size());
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets `which' to the algorithm named `name' ("curveball" or "swap", in any case) and returns true, or returns false
+|	if the name is not recognized.
+*/
+bool AloeNullModel::ParseAlgorithm(
+  const string &name,		/* the name of the algorithm */
+  AlgorithmEnum &which)		/* on return, the algorithm named */
+	{
+	NxsString s = name.c_str();
+	s.ToUpper();
+	for (int k = curveball; k <= swap; k++)
+		{
+		NxsString t = GetAlgorithmName((AlgorithmEnum)k);
+		if (s == t.ToUpper())
+			{
+			which = (AlgorithmEnum)k;
+			return true;
+			}
+		}
+	return false;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes `randomisations' random matrices with algorithm `which' and compares the endemic counts of the data with
+|	them. The randomisations are shared among (at most) `defaultChains' chains run on `nthreads' threads (0 means one
+|	per core). Each chain makes 10 x `thin' steps before its first randomisation and `thin' steps between
+|	randomisations, where `thin' is the number of areas for curveball (so each area takes part in two trades on
+|	average) and the number of presences for the swap algorithm.
+*/
+void AloeNullModel::Run(
+  unsigned randomisations,	/* the number of random matrices */
+  AlgorithmEnum which,		/* the algorithm */
+  AloeWord seed,			/* the seed from which every chain draws its random numbers */
+  unsigned nthreads)		/* the number of threads to use */
+	{
+	algorithm	= which;
+	nrandom		= 0;
+	for (unsigned i = 0; i < areas.size(); i++)
+		{
+		double observed = areas[i].observed;
+		areas[i] = AloeNullStatistic();
+		areas[i].observed = observed;
+		}
+	double observed = endemicAreas.observed;
+	endemicAreas = AloeNullStatistic();
+	endemicAreas.observed = observed;
+	for (unsigned k = 0; k < values.size(); k++)
+		{
+		observed = values[k].observed;
+		values[k] = AloeNullStatistic();
+		values[k].observed = observed;
+		}
+
+	if (matrix.GetNRows() < 2 || randomisations == 0)
+		return;
+
+	thin = (which == curveball ? matrix.GetNRows() : presences);
+	if (thin == 0)
+		thin = 1;
+	burnIn = 10 * thin;
+
+	unsigned nchains = (randomisations < (unsigned)defaultChains ? randomisations : (unsigned)defaultChains);
+	AloeThreadPool pool(nthreads);
+	vector<AloeNullChain *> chains;
+	for (unsigned c = 0; c < nchains; c++)
+		{
+		unsigned n = randomisations / nchains + (c < randomisations % nchains ? 1 : 0);
+		chains.push_back(new AloeNullChain(*this, seed, c, n));
+		pool.Add(chains.back());
+		}
+	pool.Run();
+
+	for (unsigned c = 0; c < nchains; c++)
+		{
+		for (unsigned i = 0; i < areas.size(); i++)
+			areas[i].Merge(chains[c]->areas[i]);
+		endemicAreas.Merge(chains[c]->endemicAreas);
+		for (unsigned k = 0; k < values.size(); k++)
+			values[k].Merge(chains[c]->values[k]);
+		delete chains[c];
+		}
+	nrandom = randomisations;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes a table giving, for each area, the observed number of endemic species, their mean number in the random
+|	matrices, the standardised effect size (observed - mean) / standard deviation and the probabilities of a count at
+|	least and at most as large as that observed; the same is then given for the number of areas with endemic species.
+|	`labels' must hold a label for every area. Left justification is assumed to have been set on `out'.
+*/
+void AloeNullModel::Write(
+  ostream &out,						/* the stream to write to */
+  const NxsStringVector &labels) const	/* the area labels */
+	{
+	assert(labels.size() >= areas.size());
+
+	out << "Null model (" << GetAlgorithmName(algorithm) << ", " << nrandom << " random matrices with area and species totals fixed)" << endl << endl;
+	out << setw(40) << "Area" << setw(10) << "Endemics" << setw(10) << "Mean" << setw(10) << "SES" << setw(10) << "P(>=)" << "P(<=)" << endl;
+	for (unsigned i = 0; i <= areas.size(); i++)
+		{
+		const AloeNullStatistic &s = (i < areas.size() ? areas[i] : endemicAreas);
+		if (i < areas.size())
+			out << setw(40) << labels[i].c_str();
+		else
+			{
+			out << string(90, '-') << endl;
+			out << setw(40) << "Areas with endemics";
+			}
+
+		double ses;
+		out << setw(10) << (unsigned)s.observed << setw(10) << setprecision(3) << s.GetMean(nrandom);
+		if (s.GetSES(nrandom, ses))
+			out << setw(10) << setprecision(3) << ses;
+		else
+			out << setw(10) << "-";
+		out << setw(10) << setprecision(3) << s.GetPGreater(nrandom) << setprecision(3) << s.GetPLess(nrandom) << endl;
+		}
+	out << string(90, '-') << endl;
+	out << "Total endemics = " << GetTotalEndemics() << " (the same in every random matrix)" << endl;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets `ses' to the standardised effect size of the observed value among `n' simulated values and returns true, or
+|	returns false if it is undefined (no simulated values, or all the same).
+*/
+bool AloeNullStatistic::GetSES(
+  unsigned n,			/* the number of simulated values */
+  double &ses) const	/* on return, (observed - mean) / standard deviation */
+	{
+	if (n == 0)
+		return false;
+	double mean = sum / n;
+	double var = sumSquares / n - mean * mean;
+	if (var <= 1e-12 * (mean * mean + 1.0))
+		return false;
+	ses = (observed - mean) / sqrt(var);
+	return true;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds the simulated values counted by `other' to those counted by this object.
+*/
+void AloeNullStatistic::Merge(
+  const AloeNullStatistic &other)	/* statistics from another chain */
+	{
+	sum			+= other.sum;
+	sumSquares	+= other.sumSquares;
+	atLeast		+= other.atLeast;
+	atMost		+= other.atMost;
+	}
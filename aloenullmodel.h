@@ -0,0 +1,221 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOENULLMODEL_H
+#define ALOE_ALOENULLMODEL_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Observed value of a statistic together with the totals needed to compare it with its distribution under a null
+|	model: the sum and sum of squares of the simulated values and the number of simulated values at least as large
+|	(`atLeast') and at most as large (`atMost') as the observed value.
+*/
+struct AloeNullStatistic
+	{
+						AloeNullStatistic() : observed(0), sum(0.0), sumSquares(0.0), atLeast(0), atMost(0) {}
+
+	double				GetMean(unsigned n) const;
+	double				GetPGreater(unsigned n) const;
+	double				GetPLess(unsigned n) const;
+	bool				GetSES(unsigned n, double &ses) const;
+	void				Add(double value);
+	void				Merge(const AloeNullStatistic &other);
+
+	double				observed;	/* the value in the data */
+	double				sum;		/* sum of the simulated values */
+	double				sumSquares;	/* sum of the squares of the simulated values */
+	unsigned			atLeast;	/* number of simulated values greater than or equal to `observed' */
+	unsigned			atMost;		/* number of simulated values less than or equal to `observed' */
+	};
+
+typedef vector<AloeNullStatistic>	AloeNullStatisticVector;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	A statistic of a whole presence/absence matrix, which can be tested against an AloeNullModel by passing it to
+|	AddStatistic. Evaluate is called by every chain of the model, from several threads at once, so it must not change
+|	the object. The matrices passed to it have the same area and species totals as the data.
+*/
+class AloeMatrixStatistic
+	{
+	public:
+
+		virtual				~AloeMatrixStatistic() {}
+
+		virtual double		Evaluate(const AloeBitMatrix &m) const = 0;
+	};
+
+typedef vector<const AloeMatrixStatistic *>	AloeMatrixStatisticVector;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Monte Carlo test of the number of endemic species in each area (species found in that area alone) against random
+|	matrices with the same area and species totals (fixed-fixed null model). Two algorithms are provided, both working
+|	on the bit rows of an AloeBitMatrix:
+|~
+|	o curveball (Strona et al. 2014): two areas trade the species found in one of them but not the other, the set
+|	  of species each holds being drawn at random among those traded (with the number held by each unchanged). A
+|	  trade costs one pass over the words of the two rows plus a shuffle of the species traded.
+|	o sequential swap: a random 2 x 2 submatrix is swapped if it is a checkerboard. Each swap is very cheap but many
+|	  are needed to mix the matrix, so curveball is much faster on large matrices.
+|~
+|	Because the species totals are fixed, the species that are endemic (present in one area) are the same in every
+|	random matrix, and so is their total; only their distribution among the areas varies. The global statistic tested
+|	is therefore the number of areas holding at least one endemic species.
+|~
+|	The randomisations are shared among a fixed number of Markov chains (`chains'), each with its own copy of the
+|	matrix and its own random number stream, run as tasks on an AloeThreadPool. Chain c uses stream c of the seed, so
+|	the results depend on the seed but not on the number of threads. The endemic counts are updated as the chains go
+|	(only two rows change at each step), so a randomisation costs `thin' steps and no pass over the whole matrix.
+|	Other statistics of the whole matrix (e.g., nestedness) can be tested against the same random matrices by adding
+|	them with AddStatistic before calling Run; each is then evaluated on every random matrix.
+*/
+class AloeNullModel
+	{
+	public:
+
+		enum AlgorithmEnum	/* the randomisation algorithms available */
+			{
+			curveball = 0,
+			swap
+			};
+
+		enum {defaultChains = 16};	/* number of chains used unless there are fewer randomisations */
+
+							AloeNullModel(const AloeBitMatrix &m, unsigned nareas = 0);
+
+		unsigned			AddStatistic(const AloeMatrixStatistic *s);
+
+		AlgorithmEnum		GetAlgorithm() const;
+		const AloeNullStatistic	&GetArea(unsigned i) const;
+		const AloeNullStatistic	&GetEndemicAreas() const;
+		unsigned			GetNRandomisations() const;
+		const AloeNullStatistic	&GetStatistic(unsigned k) const;
+		unsigned			GetTotalEndemics() const;
+		void				Run(unsigned randomisations, AlgorithmEnum which = curveball, AloeWord seed = 1, unsigned nthreads = 0);
+		void				Write(ostream &out, const NxsStringVector &labels) const;
+
+		static const char	*GetAlgorithmName(AlgorithmEnum which);
+		static bool			ParseAlgorithm(const string &name, AlgorithmEnum &which);
+
+	private:
+
+		friend class AloeNullChain;
+
+		AloeBitMatrix		matrix;			/* the observed presences of the areas tested */
+		AloeWordVector		endemic;		/* one bit for each species present in exactly one area */
+		unsigned			presences;		/* number of bits set in `matrix' */
+		AlgorithmEnum		algorithm;		/* the algorithm used by Run */
+		unsigned			nrandom;		/* number of randomisations made by Run */
+		unsigned			burnIn;			/* number of steps made by each chain before its first randomisation */
+		unsigned			thin;			/* number of steps between randomisations */
+		AloeNullStatisticVector	areas;		/* endemic species in each area */
+		AloeNullStatistic	endemicAreas;	/* number of areas with at least one endemic species */
+		AloeMatrixStatisticVector	statistics;	/* the statistics added by AddStatistic */
+		AloeNullStatisticVector	values;		/* the values of each of `statistics' */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds a simulated value.
+*/
+inline void AloeNullStatistic::Add(
+  double value)	/* the value of the statistic in a random matrix */
+	{
+	sum += value;
+	sumSquares += value * value;
+	if (value >= observed)
+		atLeast++;
+	if (value <= observed)
+		atMost++;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the mean of the `n' simulated values.
+*/
+inline double AloeNullStatistic::GetMean(
+  unsigned n) const	/* the number of simulated values */
+	{
+	return (n == 0 ? 0.0 : sum / n);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the probability of a value at least as large as that observed, counting the observed value as one of the
+|	`n' + 1 values (so it is never 0).
+*/
+inline double AloeNullStatistic::GetPGreater(
+  unsigned n) const	/* the number of simulated values */
+	{
+	return (atLeast + 1.0) / (n + 1.0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the probability of a value at most as large as that observed (see GetPGreater).
+*/
+inline double AloeNullStatistic::GetPLess(
+  unsigned n) const	/* the number of simulated values */
+	{
+	return (atMost + 1.0) / (n + 1.0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the algorithm used by the last call to Run.
+*/
+inline AloeNullModel::AlgorithmEnum AloeNullModel::GetAlgorithm() const
+	{
+	return algorithm;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the statistics for the number of endemic species in area `i'. Assumes `i' is in the range
+|	[0..number of areas).
+*/
+inline const AloeNullStatistic &AloeNullModel::GetArea(
+  unsigned i) const	/* the (0-offset) index of the area */
+	{
+	assert(i < areas.size());
+	return areas[i];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the statistics for the number of areas holding at least one endemic species.
+*/
+inline const AloeNullStatistic &AloeNullModel::GetEndemicAreas() const
+	{
+	return endemicAreas;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the values of the statistic numbered `k' by AddStatistic. Assumes `k' is in the range [0..number of
+|	statistics added).
+*/
+inline const AloeNullStatistic &AloeNullModel::GetStatistic(
+  unsigned k) const	/* the number returned by AddStatistic */
+	{
+	assert(k < values.size());
+	return values[k];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of randomisations made by the last call to Run.
+*/
+inline unsigned AloeNullModel::GetNRandomisations() const
+	{
+	return nrandom;
+	}
+
+#endif
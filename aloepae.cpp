@@ -0,0 +1,1240 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloepae.h"
+#include "aloerandom.h"
+#include "aloethreadpool.h"
+
+static const unsigned noNode = (unsigned)-1;	/* stands for a missing parent or child */
+
+const double AloePae::jackknifeDeletion = 0.3679;	/* e^-1, as proposed by Farris et al. (1996) */
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	The working storage for building and swapping one tree at a time. Terminals are the nodes 0..`nterms'-1 and the
+|	internal nodes follow, the last being the `root', whose children are always the anchor terminal (left) and the rest
+|	of the tree (right). For every node the state sets are held as 2 x `nwords' words: first the species in which state
+|	0 is possible, then those in which state 1 is possible. Besides the downpass sets (`down'), each node has an uppass
+|	set (`up', the set of the part of the tree on the far side of the branch below the node) and a branch set (`edge',
+|	the set the node's branch would have if the tree were rooted on it). A subtree can be joined to a branch at a cost
+|	given by its own set and the branch set alone. Species may be given integer weights, held as `nplanes' bit planes
+|	of `nwords' words each (bit b of the weight of every species in plane b).
+*/
+class AloePaeSearch
+	{
+	public:
+
+							AloePaeSearch(const AloePae &p, const AloeWordVector *weights = NULL);
+
+		void				Clades(AloePae::AloeCladeVector &groups);
+		unsigned			Downpass();
+		void				Load(const AloePae::AloePaeTree &t);
+		unsigned			Neighbours(unsigned len, AloePae::AloePaeTreeVector &found, set<string> &seen, unsigned maxTrees);
+		void				Save(AloePae::AloePaeTree &t) const;
+		unsigned			Swap(bool tbr);
+		void				Wagner(AloeRandom &rng);
+
+	private:
+
+		const AloePae		&pae;			/* the analysis supplying the data */
+		unsigned			nterms;			/* number of terminals */
+		unsigned			nwords;			/* number of words in each half of a state set */
+		unsigned			root;			/* the root node */
+		unsigned			nplanes;		/* number of bit planes in `planes' (0 if every species has weight 1) */
+		const AloeWord		*planes;		/* the weights of the species, or NULL */
+		NxsUnsignedVector	parent;			/* parent of each node (noNode for the root) */
+		NxsUnsignedVector	left;			/* left child of each internal node */
+		NxsUnsignedVector	right;			/* right child of each internal node */
+		NxsUnsignedVector	steps;			/* steps at each node (downpass) */
+		NxsUnsignedVector	subtree;		/* steps in the subtree of each node (downpass) */
+		AloeWordVector		down;			/* downpass state set of each node */
+		AloeWordVector		up;				/* uppass state set of each node */
+		AloeWordVector		edge;			/* state set of the branch below each node */
+		AloeWordVector		scratch;		/* room for one state set */
+		NxsUnsignedVector	order;			/* nodes in preorder (used by Preorder) */
+		NxsUnsignedVector	targets;		/* branches of the tree to which the clipped subtree can be joined */
+		NxsUnsignedVector	sources;		/* branches of the clipped subtree on which it can be rerooted */
+		unsigned			clipped;		/* root of the clipped subtree */
+		unsigned			clipParent;		/* the node that joined the clipped subtree to the rest of the tree */
+		unsigned			clipSibling;	/* the node that was the sibling of the clipped subtree */
+
+		AloeWord			*Down(unsigned v);
+		AloeWord			*Edge(unsigned v);
+		AloeWord			*Up(unsigned v);
+
+		bool				CanClip(unsigned c) const;
+		unsigned			Clip(unsigned c, bool tbr);
+		unsigned			Describe(unsigned v, string &s) const;
+		const AloeWord		*EdgeSet(unsigned v);
+		void				Insert(unsigned c, unsigned p, unsigned v);
+		void				Join(unsigned a, unsigned e);
+		void				Preorder(unsigned top);
+		void				Replace(unsigned p, unsigned oldChild, unsigned newChild);
+		void				Reroot(unsigned c, unsigned v);
+		unsigned			Sibling(unsigned v) const;
+		void				Unclip();
+		void				UpdatePath(unsigned v);
+		void				Uppass(unsigned top);
+
+		unsigned			Fitch(const AloeWord *a, const AloeWord *b, AloeWord *r) const;
+		unsigned			JoinCost(const AloeWord *a, const AloeWord *b, unsigned bound) const;
+		unsigned			Steps(AloeWord changes, unsigned w) const;
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs one replicate (random addition sequence followed by branch swapping) on a thread of an AloeThreadPool.
+*/
+class AloePaeReplicate : public AloeTask
+	{
+	public:
+
+		AloePaeReplicate(const AloePae &p, bool t, AloeWord s, unsigned k)
+		  : pae(p), tbr(t), seed(s), replicate(k), length(0) {}
+
+		void Run()
+			{
+			AloeRandom rng(seed, replicate);
+			AloePaeSearch search(pae);
+			search.Wagner(rng);
+			length = search.Swap(tbr);
+			search.Save(tree);
+			}
+
+		const AloePae		&pae;		/* the analysis to which the replicate belongs */
+		bool				tbr;		/* true for TBR, false for SPR */
+		AloeWord			seed;		/* the seed of the analysis */
+		unsigned			replicate;	/* the number of the replicate, which selects its random number stream */
+		unsigned			length;		/* on return, the length of the tree found (informative species only) */
+		AloePae::AloePaeTree	tree;	/* on return, the tree found */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs one bootstrap or jackknife replicate on a thread of an AloeThreadPool: draws the weights of the species, finds
+|	a tree for the reweighted data and lists its groups.
+*/
+class AloePaeResample : public AloeTask
+	{
+	public:
+
+		AloePaeResample(const AloePae &p, AloePae::ResampleEnum m, AloeWord s, AloeWord k)
+		  : pae(p), method(m), seed(s), stream(k) {}
+
+		void Run();
+
+		const AloePae			&pae;		/* the analysis to which the replicate belongs */
+		AloePae::ResampleEnum	method;		/* bootstrap or jackknife */
+		AloeWord				seed;		/* the seed of the analysis */
+		AloeWord				stream;		/* the random number stream of the replicate */
+		AloePae::AloeCladeVector	groups;	/* on return, the groups of the tree found */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Draws the weights and searches. A bootstrap replicate draws as many species as there are, with replacement, so a
+|	species has the weight of the number of times it was drawn; a jackknife replicate leaves out each species with
+|	probability `jackknifeDeletion'. Only the informative species need weights, but the bootstrap draws are made from
+|	every species so that the informative ones are drawn in the right proportion.
+*/
+void AloePaeResample::Run()
+	{
+	AloeRandom rng(seed, stream);
+	unsigned ninf = pae.informative.GetNCols();
+	NxsUnsignedVector weight(ninf, 0);
+	if (method == AloePae::bootstrap)
+		{
+		unsigned nspecies = (unsigned)pae.column.size();
+		for (unsigned n = 0; n < nspecies; n++)
+			{
+			unsigned k = pae.column[rng.Below(nspecies)];
+			if (k != noNode)
+				weight[k]++;
+			}
+		}
+	else
+		{
+		for (unsigned k = 0; k < ninf; k++)
+			weight[k] = (rng.Uniform() < AloePae::jackknifeDeletion ? 0 : 1);
+		}
+
+	unsigned heaviest = 0;
+	for (unsigned k = 0; k < ninf; k++)
+		{
+		if (weight[k] > heaviest)
+			heaviest = weight[k];
+		}
+	unsigned nplanes = 0;
+	while ((heaviest >> nplanes) != 0)
+		nplanes++;
+
+	unsigned nwords = AloeBitMatrix::WordsFor(ninf);
+	if (nwords == 0)
+		nwords = 1;
+	AloeWordVector planes((size_t)(nplanes > 0 ? nplanes : 1) * nwords, 0);
+	for (unsigned k = 0; k < ninf; k++)
+		{
+		for (unsigned b = 0; b < nplanes; b++)
+			{
+			if ((weight[k] >> b) & 1)
+				planes[(size_t)b * nwords + k / AloeBitMatrix::wordBits] |= (AloeWord)1 << (k % AloeBitMatrix::wordBits);
+			}
+		}
+
+	AloePaeSearch search(pae, &planes);
+	search.Wagner(rng);
+	search.Swap(true);
+	search.Clades(groups);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares storage for the trees of `p' and fills in the state sets of the terminals. Bits beyond the last species
+|	are put in state 0 for every terminal, so they never add steps. If `weights' is not NULL, it holds the weights of
+|	the informative species as bit planes of WordsFor(number of informative species) words each (at least one word);
+|	it must outlive this object.
+*/
+AloePaeSearch::AloePaeSearch(
+  const AloePae &p,					/* the analysis supplying the data */
+  const AloeWordVector *weights)	/* the weights of the informative species, or NULL */
+  : pae(p)
+	{
+	nterms	= pae.nterms;
+	nwords	= pae.informative.GetNWords();
+	if (nwords == 0)
+		nwords = 1;
+	root	= 2 * nterms - 2;
+	nplanes	= (weights == NULL ? 0 : (unsigned)(weights->size() / nwords));
+	planes	= (weights == NULL ? NULL : &(*weights)[0]);
+
+	unsigned nnodes = root + 1;
+	parent.assign(nnodes, noNode);
+	left.assign(nnodes, noNode);
+	right.assign(nnodes, noNode);
+	steps.assign(nnodes, 0);
+	subtree.assign(nnodes, 0);
+	down.assign((size_t)nnodes * 2 * nwords, 0);
+	up.assign(down.size(), 0);
+	edge.assign(down.size(), 0);
+	scratch.assign(2 * nwords, 0);
+
+	for (unsigned i = 0; i < nterms; i++)
+		{
+		AloeWord *d = Down(i);
+		for (unsigned w = 0; w < nwords; w++)
+			{
+			AloeWord presence = (w < pae.informative.GetNWords() ? pae.informative.GetRow(i)[w] : 0);
+			d[w] = ~presence;
+			d[nwords + w] = presence;
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the downpass state set of node `v'.
+*/
+inline AloeWord *AloePaeSearch::Down(
+  unsigned v)	/* the node */
+	{
+	return &down[(size_t)v * 2 * nwords];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the state set of the branch below node `v'.
+*/
+inline AloeWord *AloePaeSearch::Edge(
+  unsigned v)	/* the node */
+	{
+	return &edge[(size_t)v * 2 * nwords];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the uppass state set of node `v'.
+*/
+inline AloeWord *AloePaeSearch::Up(
+  unsigned v)	/* the node */
+	{
+	return &up[(size_t)v * 2 * nwords];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Puts in `r' the Fitch state set of a node whose children have the sets `a' and `b', and returns the number of steps
+|	needed (the number of species for which `a' and `b' have no state in common). `r' may be the same as `a' or `b'.
+*/
+inline unsigned AloePaeSearch::Fitch(
+  const AloeWord *a,	/* the state set of the first child */
+  const AloeWord *b,	/* the state set of the second child */
+  AloeWord *r) const	/* the state set of the parent */
+	{
+	unsigned n = 0;
+	for (unsigned w = 0; w < nwords; w++)
+		{
+		AloeWord a0 = a[w], a1 = a[nwords + w];
+		AloeWord b0 = b[w], b1 = b[nwords + w];
+		AloeWord i0 = a0 & b0;
+		AloeWord i1 = a1 & b1;
+		AloeWord empty = ~(i0 | i1);
+		r[w] = i0 | (empty & (a0 | b0));
+		r[nwords + w] = i1 | (empty & (a1 | b1));
+		n += Steps(empty, w);
+		}
+	return n;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of steps added by joining nodes with the state sets `a' and `b'. Counting stops once `bound'
+|	steps have been reached, since the caller is not interested in anything that long.
+*/
+inline unsigned AloePaeSearch::JoinCost(
+  const AloeWord *a,	/* the first state set */
+  const AloeWord *b,	/* the second state set */
+  unsigned bound) const	/* the number of steps at which to give up */
+	{
+	unsigned n = 0;
+	for (unsigned w = 0; w < nwords && n < bound; w++)
+		n += Steps(~((a[w] & b[w]) | (a[nwords + w] & b[nwords + w])), w);
+	return n;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the steps taken by the species of word `w' that have a bit set in `changes': their number or, if the species
+|	are weighted, the sum of their weights.
+*/
+inline unsigned AloePaeSearch::Steps(
+  AloeWord changes,	/* one bit for each species that changes state */
+  unsigned w) const	/* the word of species to which `changes' belongs */
+	{
+	if (planes == NULL)
+		return AloeBitMatrix::PopCount(changes);
+
+	unsigned n = 0;
+	for (unsigned b = 0; b < nplanes; b++)
+		n += AloeBitMatrix::PopCount(changes & planes[(size_t)b * nwords + w]) << b;
+	return n;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the subtree of `c' may be clipped: every node except the root, the anchor and the node on the other
+|	side of the root (clipping which would only reroot the tree).
+*/
+inline bool AloePaeSearch::CanClip(
+  unsigned c) const	/* the root of the subtree */
+	{
+	return (c != root && parent[c] != root);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the other child of the parent of `v'.
+*/
+inline unsigned AloePaeSearch::Sibling(
+  unsigned v) const	/* the node */
+	{
+	unsigned p = parent[v];
+	return (left[p] == v ? right[p] : left[p]);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes `newChild' a child of `p' in place of `oldChild'. The parent of `newChild' is not changed.
+*/
+inline void AloePaeSearch::Replace(
+  unsigned p,			/* the parent */
+  unsigned oldChild,	/* the child to remove */
+  unsigned newChild)	/* the child to put in its place */
+	{
+	if (left[p] == oldChild)
+		left[p] = newChild;
+	else
+		right[p] = newChild;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the state set of branch `v', which is either a branch of the tree or of the clipped subtree.
+*/
+inline const AloeWord *AloePaeSearch::EdgeSet(
+  unsigned v)	/* the node below the branch */
+	{
+	return (v == clipped ? Down(v) : Edge(v));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Removes the subtree of `c' (with its parent, which stays attached to it) from the tree and gets ready to join it
+|	elsewhere: the downpass sets are updated along the path from the clipping point to the root, and the branch sets
+|	of the rest of the tree are found. If `tbr' is true, the branch sets of the subtree are found too, since it may be
+|	rerooted. Returns the number of steps in the rest of the tree plus the steps in the subtree.
+*/
+unsigned AloePaeSearch::Clip(
+  unsigned c,	/* the root of the subtree to clip */
+  bool tbr)		/* true if the subtree will be rerooted */
+	{
+	clipped		= c;
+	clipParent	= parent[c];
+	clipSibling	= Sibling(c);
+
+	unsigned g = parent[clipParent];
+	Replace(g, clipParent, clipSibling);
+	parent[clipSibling] = g;
+	UpdatePath(g);
+
+	Uppass(root);
+	targets.clear();
+	for (unsigned k = 1; k < order.size(); k++)
+		{
+		if (order[k] != left[root])
+			targets.push_back(order[k]);
+		}
+
+	sources.clear();
+	sources.push_back(c);
+	if (tbr && c >= nterms)
+		{
+		Uppass(c);
+		for (unsigned k = 1; k < order.size(); k++)
+			{
+			if (parent[order[k]] != c)
+				sources.push_back(order[k]);
+			}
+		}
+
+	return subtree[root] + subtree[c];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Puts back the subtree clipped by Clip where it came from.
+*/
+void AloePaeSearch::Unclip()
+	{
+	Insert(clipped, clipParent, clipSibling);
+	UpdatePath(clipParent);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Joins the clipped subtree, rerooted on its branch `a', to branch `e' of the rest of the tree. The state sets are not
+|	updated (call Downpass).
+*/
+void AloePaeSearch::Join(
+  unsigned a,	/* the branch of the subtree on which to reroot it */
+  unsigned e)	/* the branch of the tree to which the subtree is joined */
+	{
+	if (a != clipped)
+		Reroot(clipped, a);
+	Insert(clipped, clipParent, e);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Places the internal node `p' on the branch below `v', with `v' and `c' as its children.
+*/
+void AloePaeSearch::Insert(
+  unsigned c,	/* the node to join to the tree */
+  unsigned p,	/* an internal node not in the tree */
+  unsigned v)	/* the node below the branch */
+	{
+	unsigned g = parent[v];
+	Replace(g, v, p);
+	parent[p]	= g;
+	left[p]		= v;
+	right[p]	= c;
+	parent[v]	= p;
+	parent[c]	= p;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Rearranges the subtree whose root is `c' so that `c' lies on the branch below `v' (which must not be a child of
+|	`c'). The nodes on the path from `v' to `c' have their parent and child swapped.
+*/
+void AloePaeSearch::Reroot(
+  unsigned c,	/* the root of the subtree */
+  unsigned v)	/* the node below the new root branch */
+	{
+	NxsUnsignedVector path;
+	for (unsigned u = v; u != c; u = parent[u])
+		path.push_back(u);
+
+	unsigned k = (unsigned)path.size() - 1;
+	unsigned other = (left[c] == path[k] ? right[c] : left[c]);
+	for (unsigned i = k; i >= 1; i--)
+		{
+		unsigned next = (i == k ? other : path[i + 1]);
+		Replace(path[i], path[i - 1], next);
+		parent[next] = path[i];
+		}
+	for (unsigned i = 2; i <= k; i++)
+		parent[path[i]] = path[i - 1];
+
+	left[c]			= path[0];
+	right[c]		= path[1];
+	parent[path[0]]	= c;
+	parent[path[1]]	= c;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `order' with the nodes of the subtree of `top' in preorder.
+*/
+void AloePaeSearch::Preorder(
+  unsigned top)	/* the root of the subtree */
+	{
+	order.clear();
+	NxsUnsignedVector stack(1, top);
+	while (!stack.empty())
+		{
+		unsigned v = stack.back();
+		stack.pop_back();
+		order.push_back(v);
+		if (v >= nterms)
+			{
+			stack.push_back(right[v]);
+			stack.push_back(left[v]);
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the downpass sets of every node from scratch and returns the length of the tree.
+*/
+unsigned AloePaeSearch::Downpass()
+	{
+	Preorder(root);
+	for (unsigned k = (unsigned)order.size(); k-- > 0;)
+		{
+		unsigned v = order[k];
+		if (v < nterms)
+			continue;
+		steps[v]	= Fitch(Down(left[v]), Down(right[v]), Down(v));
+		subtree[v]	= steps[v] + subtree[left[v]] + subtree[right[v]];
+		}
+	return subtree[root];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Recomputes the downpass sets of `v' and its ancestors after the children of `v' (and possibly those of its parent)
+|	have been changed. Sets above the parent of `v' are recomputed only until one turns out to be unchanged; above that
+|	point only the step counts need to be added up again.
+*/
+void AloePaeSearch::UpdatePath(
+  unsigned v)	/* the lowest node whose children have changed */
+	{
+	bool changed = true;
+	bool first = true;
+	AloeWord *s = &scratch[0];
+	for (; v != noNode; v = parent[v])
+		{
+		if (changed)
+			{
+			steps[v] = Fitch(Down(left[v]), Down(right[v]), s);
+			AloeWord *d = Down(v);
+			changed = first;
+			first = false;
+			for (unsigned w = 0; w < 2 * nwords; w++)
+				{
+				if (d[w] != s[w])
+					{
+					changed = true;
+					d[w] = s[w];
+					}
+				}
+			}
+		subtree[v] = steps[v] + subtree[left[v]] + subtree[right[v]];
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the uppass and branch sets of the subtree of `top', which is either the root or the root of the clipped
+|	subtree, leaving the subtree in `order'. The branches below the children of `top' form a single branch once `top'
+|	is left out, whose set is the downpass set of `top'; for the root this is the branch below the right child, so the
+|	branch sets are found for the children of the root but not for those of a clipped subtree.
+*/
+void AloePaeSearch::Uppass(
+  unsigned top)	/* the root of the subtree */
+	{
+	Preorder(top);
+	for (unsigned k = 1; k < order.size(); k++)
+		{
+		unsigned v = order[k];
+		unsigned p = parent[v];
+		unsigned s = Sibling(v);
+		if (p == top)
+			{
+			const AloeWord *d = Down(s);
+			AloeWord *u = Up(v);
+			for (unsigned w = 0; w < 2 * nwords; w++)
+				u[w] = d[w];
+			if (top != root)
+				continue;
+			}
+		else
+			Fitch(Up(p), Down(s), Up(v));
+		Fitch(Down(v), Up(v), Edge(v));
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Builds a tree by adding the terminals one at a time, in random order, each to the branch where it adds the fewest
+|	steps (ties are broken at random).
+*/
+void AloePaeSearch::Wagner(
+  AloeRandom &rng)	/* the random number generator of the replicate */
+	{
+	unsigned anchor = pae.anchor;
+	NxsUnsignedVector terms;
+	for (unsigned i = 0; i < nterms; i++)
+		{
+		if (i != anchor)
+			terms.push_back(i);
+		}
+	rng.Shuffle(terms);
+
+	parent.assign(parent.size(), noNode);
+	left.assign(left.size(), noNode);
+	right.assign(right.size(), noNode);
+
+	unsigned next = nterms;
+	left[root]		= anchor;
+	parent[anchor]	= root;
+	if (terms.size() == 1)
+		{
+		right[root]		= terms[0];
+		parent[terms[0]]	= root;
+		Downpass();
+		return;
+		}
+
+	unsigned first = next++;
+	left[first]			= terms[0];
+	right[first]		= terms[1];
+	parent[terms[0]]	= first;
+	parent[terms[1]]	= first;
+	right[root]			= first;
+	parent[first]		= root;
+	Downpass();
+
+	for (unsigned t = 2; t < terms.size(); t++)
+		{
+		unsigned x = terms[t];
+		Uppass(root);
+
+		unsigned best = noNode, ties = 0, chosen = noNode;
+		for (unsigned k = 1; k < order.size(); k++)
+			{
+			unsigned v = order[k];
+			if (v == anchor)
+				continue;
+			unsigned n = JoinCost(Down(x), Edge(v), (best == noNode ? noNode : best + 1));
+			if (n < best)
+				{
+				best	= n;
+				chosen	= v;
+				ties	= 1;
+				}
+			else if (n == best && rng.Below(++ties) == 0)
+				chosen = v;
+			}
+
+		unsigned p = next++;
+		Insert(x, p, chosen);
+		UpdatePath(p);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Improves the tree by branch swapping (TBR if `tbr' is true, SPR otherwise) until no rearrangement makes it shorter.
+|	For each subtree clipped, the best of the shorter rearrangements (if any) is made. Returns the length of the tree.
+*/
+unsigned AloePaeSearch::Swap(
+  bool tbr)	/* true for TBR, false for SPR */
+	{
+	unsigned len = Downpass();
+	bool improved = true;
+	while (improved)
+		{
+		improved = false;
+		for (unsigned c = 0; c < root; c++)
+			{
+			if (!CanClip(c))
+				continue;
+
+			unsigned bound = len - Clip(c, tbr);
+			unsigned bestSource = noNode, bestTarget = noNode;
+			for (unsigned i = 0; i < sources.size(); i++)
+				{
+				unsigned a = sources[i];
+				const AloeWord *as = EdgeSet(a);
+				for (unsigned j = 0; j < targets.size(); j++)
+					{
+					unsigned e = targets[j];
+					if (a == c && e == clipSibling)
+						continue;
+					unsigned n = JoinCost(as, Edge(e), bound);
+					if (n < bound)
+						{
+						bound		= n;
+						bestSource	= a;
+						bestTarget	= e;
+						}
+					}
+				}
+
+			if (bestSource == noNode)
+				Unclip();
+			else
+				{
+				Join(bestSource, bestTarget);
+				len = Downpass();
+				improved = true;
+				}
+			}
+		}
+	return len;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Looks for trees one TBR rearrangement away from the current tree (of length `len') that are just as long, adding
+|	those not yet in `seen' to `found' until it holds `maxTrees' trees. If a shorter tree turns up instead, it is made
+|	the current tree and swapped to a local optimum, and its length is returned; otherwise `len' is returned.
+*/
+unsigned AloePaeSearch::Neighbours(
+  unsigned len,							/* the length of the current tree */
+  AloePae::AloePaeTreeVector &found,	/* the trees found so far */
+  set<string> &seen,					/* the keys of the trees in `found' */
+  unsigned maxTrees)					/* the number of trees wanted */
+	{
+	NxsUnsignedVector saveParent, saveLeft, saveRight;
+	for (unsigned c = 0; c < root && found.size() < maxTrees; c++)
+		{
+		if (!CanClip(c))
+			continue;
+
+		unsigned bound = len - Clip(c, true);
+		for (unsigned i = 0; i < sources.size() && found.size() < maxTrees; i++)
+			{
+			unsigned a = sources[i];
+			const AloeWord *as = EdgeSet(a);
+			for (unsigned j = 0; j < targets.size() && found.size() < maxTrees; j++)
+				{
+				unsigned e = targets[j];
+				if (a == c && e == clipSibling)
+					continue;
+				unsigned n = JoinCost(as, Edge(e), bound + 1);
+				if (n > bound)
+					continue;
+				if (n < bound)
+					{
+					Join(a, e);
+					return Swap(true);
+					}
+
+				// Make the rearrangement just long enough to describe the tree, then undo it (the state sets
+				// are left alone, so they are still valid once the topology is restored)
+				//
+				saveParent	= parent;
+				saveLeft	= left;
+				saveRight	= right;
+				Join(a, e);
+				AloePae::AloePaeTree t;
+				Save(t);
+				if (seen.insert(t.key).second)
+					found.push_back(t);
+				parent	= saveParent;
+				left	= saveLeft;
+				right	= saveRight;
+				}
+			}
+		Unclip();
+		}
+	return len;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Appends to `s' a description of the subtree of `v' in which the terminals are numbers and the two subtrees of every
+|	node are listed in order of their lowest-numbered terminal, which is returned.
+*/
+unsigned AloePaeSearch::Describe(
+  unsigned v,		/* the root of the subtree */
+  string &s) const	/* the string to which the description is appended */
+	{
+	if (v < nterms)
+		{
+		char buf[16];
+		sprintf(buf, "%u", v);
+		s += buf;
+		return v;
+		}
+
+	string a, b;
+	unsigned ma = Describe(left[v], a);
+	unsigned mb = Describe(right[v], b);
+	s += '(';
+	s += (ma < mb ? a : b);
+	s += ',';
+	s += (ma < mb ? b : a);
+	s += ')';
+	return (ma < mb ? ma : mb);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `groups' with the groups of the current tree, each as a bit vector with one bit per terminal. Only the groups
+|	that can differ from tree to tree are listed (not the terminals, nor the group of every terminal but the anchor).
+*/
+void AloePaeSearch::Clades(
+  AloePae::AloeCladeVector &groups)	/* the vector to fill */
+	{
+	unsigned n = AloeBitMatrix::WordsFor(nterms);
+	AloePae::AloeCladeVector members(root + 1, AloeWordVector(n, 0));
+	groups.clear();
+
+	Preorder(root);
+	for (unsigned k = (unsigned)order.size(); k-- > 0;)
+		{
+		unsigned v = order[k];
+		AloeWordVector &m = members[v];
+		if (v < nterms)
+			{
+			m[v / AloeBitMatrix::wordBits] |= (AloeWord)1 << (v % AloeBitMatrix::wordBits);
+			continue;
+			}
+		const AloeWordVector &a = members[left[v]];
+		const AloeWordVector &b = members[right[v]];
+		for (unsigned w = 0; w < n; w++)
+			m[w] = a[w] | b[w];
+		if (v != root && v != right[root])
+			groups.push_back(m);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Stores the current tree in `t'.
+*/
+void AloePaeSearch::Save(
+  AloePae::AloePaeTree &t) const	/* the tree to fill */
+	{
+	t.left	= left;
+	t.right	= right;
+	t.key.clear();
+	Describe(right[root], t.key);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes `t' the current tree and computes its downpass sets.
+*/
+void AloePaeSearch::Load(
+  const AloePae::AloePaeTree &t)	/* the tree */
+	{
+	left	= t.left;
+	right	= t.right;
+	parent.assign(parent.size(), noNode);
+	for (unsigned v = nterms; v <= root; v++)
+		{
+		parent[left[v]]		= v;
+		parent[right[v]]	= v;
+		}
+	Downpass();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares the data in `m' (one row per area, one column per species) for analysis. The trees are rooted on the area
+|	in row `outgroupRow' or, if that is noOutgroup, on a hypothetical area in which every species is absent, which
+|	becomes the last terminal. Species that are not informative are set aside here, and the steps they add to every
+|	tree counted once.
+*/
+AloePae::AloePae(
+  const AloeBitMatrix &m,	/* the presence/absence matrix */
+  int outgroupRow)			/* the (0-offset) row of the outgroup area, or noOutgroup */
+	{
+	hypothetical	= (outgroupRow < 0 || outgroupRow >= (int)m.GetNRows());
+	nterms			= m.GetNRows() + (hypothetical ? 1 : 0);
+	anchor			= (hypothetical ? nterms - 1 : (unsigned)outgroupRow);
+	extraSteps		= 0;
+	minSteps		= 0;
+	maxSteps		= 0;
+	length			= 0;
+	resampling		= bootstrap;
+	resamples		= 0;
+
+	NxsUnsignedVector counts;
+	m.ColumnCounts(counts);
+	NxsUnsignedVector keep;
+	column.assign(counts.size(), noNode);
+	for (unsigned j = 0; j < counts.size(); j++)
+		{
+		unsigned ones = counts[j];
+		unsigned fewer = (ones < nterms - ones ? ones : nterms - ones);
+		if (fewer > 0)
+			minSteps++;
+		maxSteps += fewer;
+		if (fewer >= 2)
+			{
+			column[j] = (unsigned)keep.size();
+			keep.push_back(j);
+			}
+		else
+			extraSteps += fewer;
+		}
+
+	informative.Reset(nterms, (unsigned)keep.size());
+	for (unsigned i = 0; i < m.GetNRows(); i++)
+		{
+		for (unsigned k = 0; k < keep.size(); k++)
+			{
+			if (m.Test(i, keep[k]))
+				informative.Set(i, k);
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the consistency index (minimum possible length / length) of the shortest trees, counting every species.
+*/
+double AloePae::GetConsistencyIndex() const
+	{
+	return (length == 0 ? 1.0 : (double)minSteps / length);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the retention index ((maximum length - length) / (maximum length - minimum length)) of the shortest trees.
+*/
+double AloePae::GetRetentionIndex() const
+	{
+	return (maxSteps == minSteps ? 1.0 : (double)(maxSteps - length) / (maxSteps - minSteps));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs `replicates' replicates of a random addition sequence followed by branch swapping of type `swap', sharing them
+|	among `nthreads' threads (0 means one per core), and keeps the shortest trees found. These are then swapped in turn
+|	to collect every tree of the same length within one TBR rearrangement of a tree already kept, until `maxTrees'
+|	trees are held. Returns the length of the shortest trees.
+*/
+unsigned AloePae::Search(
+  unsigned replicates,	/* the number of random addition sequences */
+  AloeWord seed,		/* the seed from which every replicate draws its random numbers */
+  unsigned nthreads,	/* the number of threads to use */
+  SwapEnum swap,		/* the branch swapping algorithm */
+  unsigned maxTrees)	/* the largest number of trees to keep */
+	{
+	trees.clear();
+	length = extraSteps;
+	if (nterms < 2)
+		return length;
+	if (replicates == 0)
+		replicates = 1;
+	if (maxTrees == 0)
+		maxTrees = 1;
+
+	AloeThreadPool pool(nthreads);
+	vector<AloePaeReplicate *> tasks;
+	for (unsigned k = 0; k < replicates; k++)
+		{
+		tasks.push_back(new AloePaeReplicate(*this, swap == tbr, seed, k));
+		pool.Add(tasks.back());
+		}
+	pool.Run();
+
+	unsigned best = tasks[0]->length;
+	for (unsigned k = 1; k < tasks.size(); k++)
+		{
+		if (tasks[k]->length < best)
+			best = tasks[k]->length;
+		}
+
+	set<string> seen;
+	for (unsigned k = 0; k < tasks.size(); k++)
+		{
+		if (tasks[k]->length == best && trees.size() < maxTrees && seen.insert(tasks[k]->tree.key).second)
+			trees.push_back(tasks[k]->tree);
+		delete tasks[k];
+		}
+
+	length = best;
+	CollectEqualTrees(maxTrees);
+	length += extraSteps;
+	return length;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Swaps each tree in `trees' in turn (the list growing as it goes), adding the trees of equal length found, until
+|	`maxTrees' are held or every tree has been swapped. Should a shorter tree be found, the list is started again from
+|	that tree. Expects `length' to hold the length of the trees counting informative species only.
+*/
+void AloePae::CollectEqualTrees(
+  unsigned maxTrees)	/* the largest number of trees to keep */
+	{
+	if (nterms < 4)
+		return;
+
+	AloePaeSearch search(*this);
+	set<string> seen;
+	for (unsigned k = 0; k < trees.size(); k++)
+		seen.insert(trees[k].key);
+
+	for (unsigned k = 0; k < trees.size() && trees.size() < maxTrees; k++)
+		{
+		search.Load(trees[k]);
+		unsigned len = search.Neighbours(length, trees, seen, maxTrees);
+		if (len < length)
+			{
+			length = len;
+			trees.assign(1, AloePaeTree());
+			search.Save(trees[0]);
+			seen.clear();
+			seen.insert(trees[0].key);
+			k = (unsigned)-1;
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the subtree of `v' of tree `t' in Newick format, the terminals being given by their (1-offset) numbers.
+*/
+void AloePae::WriteNewick(
+  ostream &out,				/* the stream to write to */
+  const AloePaeTree &t,		/* the tree */
+  unsigned v) const			/* the root of the subtree */
+	{
+	if (v < nterms)
+		{
+		out << (v + 1);
+		return;
+		}
+	out << '(';
+	WriteNewick(out, t, t.left[v]);
+	out << ',';
+	WriteNewick(out, t, t.right[v]);
+	out << ')';
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the subtree of `v' of a consensus tree, whose groups are numbered from `nterms' on, the last standing for the
+|	group of every terminal but the anchor. `children' gives the members of each group (terminals or groups) and
+|	`support' the percentage written after each group.
+*/
+void AloePae::WriteGroup(
+  ostream &out,								/* the stream to write to */
+  const vector<NxsUnsignedVector> &children,	/* the members of each group */
+  const NxsUnsignedVector &support,				/* the support of each group */
+  unsigned v) const								/* the terminal or group to write */
+	{
+	if (v < nterms)
+		{
+		out << (v + 1);
+		return;
+		}
+
+	const NxsUnsignedVector &c = children[v - nterms];
+	if (c.size() == 1)
+		{
+		WriteGroup(out, children, support, c[0]);
+		return;
+		}
+	out << '(';
+	for (unsigned k = 0; k < c.size(); k++)
+		{
+		if (k > 0)
+			out << ',';
+		WriteGroup(out, children, support, c[k]);
+		}
+	out << ')';
+	if (v - nterms < support.size())
+		out << support[v - nterms];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the start of a NEXUS tree file: a TAXA block listing the terminals (the areas, followed by the hypothetical
+|	area "Root" if there is no outgroup), then the TREES block up to and including its TRANSLATE command, so that the
+|	trees can give the terminals by number. `labels' must hold a label for every area.
+*/
+void AloePae::BeginTrees(
+  ostream &out,						/* the stream to write to */
+  const NxsStringVector &labels) const	/* the area labels */
+	{
+	unsigned nareas = nterms - (hypothetical ? 1 : 0);
+	assert(labels.size() >= nareas);
+
+	NxsStringVector quoted(nterms);
+	for (unsigned i = 0; i < nterms; i++)
+		{
+		quoted[i] = (i < nareas ? labels[i] : NxsString("Root"));
+		if (quoted[i].QuotesNeeded())
+			quoted[i].AddQuotes();
+		}
+
+	out << "BEGIN TAXA;" << endl;
+	out << "\tDIMENSIONS NTAX=" << nterms << ";" << endl;
+	out << "\tTAXLABELS" << endl;
+	for (unsigned i = 0; i < nterms; i++)
+		out << "\t\t" << quoted[i] << endl;
+	out << "\t;" << endl;
+	out << "END;" << endl << endl;
+
+	out << "BEGIN TREES;" << endl;
+	out << "\tTRANSLATE" << endl;
+	for (unsigned i = 0; i < nterms; i++)
+		out << "\t\t" << (i + 1) << " " << quoted[i] << (i + 1 < nterms ? "," : "") << endl;
+	out << "\t;" << endl;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the name of resampling method `method'.
+*/
+const char *AloePae::GetResampleName(
+  ResampleEnum method)	/* the method */
+	{
+	return (method == jackknife ? "jackknife" : "bootstrap");
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes `replicates' bootstrap or jackknife replicates, sharing them among `nthreads' threads (0 means one per core),
+|	and counts the groups found in each. Replicate k draws its weights and its addition sequence from a stream of its
+|	own, which depends only on `seed', `method' and k (and differs from the streams used by Search), so the counts do
+|	not depend on the number of threads. Replicates are run in batches, so that only the groups of one batch are held
+|	before being counted.
+*/
+void AloePae::Resample(
+  ResampleEnum method,	/* bootstrap or jackknife */
+  unsigned replicates,	/* the number of replicates */
+  AloeWord seed,		/* the seed from which every replicate draws its random numbers */
+  unsigned nthreads)	/* the number of threads to use */
+	{
+	clades.clear();
+	resampling	= method;
+	resamples	= 0;
+	if (nterms < 2)
+		return;
+
+	AloeThreadPool pool(nthreads);
+	unsigned batch = 16 * pool.GetNThreads();
+	AloeWord first = (AloeWord)(method + 1) << 32;
+	vector<AloePaeResample *> tasks;
+	for (unsigned done = 0; done < replicates; done += batch)
+		{
+		unsigned end = (replicates - done > batch ? done + batch : replicates);
+		for (unsigned k = done; k < end; k++)
+			{
+			tasks.push_back(new AloePaeResample(*this, method, seed, k + first));
+			pool.Add(tasks.back());
+			}
+		pool.Run();
+
+		for (unsigned k = 0; k < tasks.size(); k++)
+			{
+			const AloeCladeVector &g = tasks[k]->groups;
+			for (unsigned i = 0; i < g.size(); i++)
+				clades[g[i]]++;
+			delete tasks[k];
+			}
+		tasks.clear();
+		}
+	resamples = replicates;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the shortest trees found by Search as a NEXUS file holding a TAXA block and a TREES block with one rooted
+|	tree per line, which can be read by NxsTreesBlock. `labels' must hold a label for every area.
+*/
+void AloePae::Write(
+  ostream &out,						/* the stream to write to */
+  const NxsStringVector &labels) const	/* the area labels */
+	{
+	out << "#NEXUS" << endl << endl;
+	out << "[Parsimony analysis of endemicity: " << trees.size() << " most parsimonious tree(s) of length " << length;
+	out << ", CI = " << setprecision(3) << GetConsistencyIndex() << ", RI = " << setprecision(3) << GetRetentionIndex() << "]" << endl << endl;
+
+	BeginTrees(out, labels);
+	unsigned top = 2 * nterms - 2;
+	for (unsigned k = 0; k < trees.size(); k++)
+		{
+		const AloePaeTree &t = trees[k];
+		out << "\tTREE PAE_" << (k + 1) << " = [&R] (" << (anchor + 1) << ',';
+		WriteNewick(out, t, t.right[top]);
+		out << ");" << endl;
+		}
+	out << "END;" << endl;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the majority-rule consensus of the replicates made by Resample (the groups found in more than half of them)
+|	as a NEXUS file like that of Write, each group being labelled with the percentage of replicates in which it was
+|	found. `labels' must hold a label for every area.
+*/
+void AloePae::WriteConsensus(
+  ostream &out,						/* the stream to write to */
+  const NxsStringVector &labels) const	/* the area labels */
+	{
+	// Majority groups, largest first
+	//
+	AloeCladeVector groups;
+	NxsUnsignedVector support;
+	vector< pair<unsigned, unsigned> > bySize;
+	for (AloeCladeMap::const_iterator c = clades.begin(); c != clades.end(); c++)
+		{
+		if (2 * c->second <= resamples)
+			continue;
+		unsigned size = AloeBitMatrix::PopCount(&c->first[0], (unsigned)c->first.size());
+		bySize.push_back(pair<unsigned, unsigned>(nterms - size, (unsigned)groups.size()));
+		groups.push_back(c->first);
+		support.push_back((c->second * 100 + resamples / 2) / resamples);
+		}
+	sort(bySize.begin(), bySize.end());
+
+	AloeCladeVector sorted;
+	NxsUnsignedVector sortedSupport;
+	for (unsigned g = 0; g < bySize.size(); g++)
+		{
+		sorted.push_back(groups[bySize[g].second]);
+		sortedSupport.push_back(support[bySize[g].second]);
+		}
+
+	// Every group (and terminal) belongs to the smallest group containing it; the group of every terminal but the
+	// anchor is numbered after the majority groups
+	//
+	unsigned ngroups = (unsigned)sorted.size();
+	unsigned nw = AloeBitMatrix::WordsFor(nterms);
+	vector<NxsUnsignedVector> children(ngroups + 1);
+	for (unsigned g = 0; g < ngroups; g++)
+		{
+		unsigned owner = ngroups;
+		for (unsigned h = g; h-- > 0;)
+			{
+			unsigned w = 0;
+			while (w < nw && (sorted[g][w] & ~sorted[h][w]) == 0)
+				w++;
+			if (w == nw)
+				{
+				owner = h;
+				break;
+				}
+			}
+		children[owner].push_back(nterms + g);
+		}
+	for (unsigned t = 0; t < nterms; t++)
+		{
+		if (t == anchor)
+			continue;
+		unsigned owner = ngroups;
+		for (unsigned h = ngroups; h-- > 0;)
+			{
+			if ((sorted[h][t / AloeBitMatrix::wordBits] >> (t % AloeBitMatrix::wordBits)) & 1)
+				{
+				owner = h;
+				break;
+				}
+			}
+		children[owner].push_back(t);
+		}
+
+	NxsString method = GetResampleName(resampling);
+	out << "#NEXUS" << endl << endl;
+	out << "[Majority-rule consensus of " << resamples << " " << method << " replicates; each group is labelled with the percentage of replicates in which it was found]" << endl << endl;
+
+	BeginTrees(out, labels);
+	out << "\tTREE " << method.ToUpper() << " = [&R] (" << (anchor + 1) << ',';
+	WriteGroup(out, children, sortedSupport, nterms + ngroups);
+	out << ");" << endl;
+	out << "END;" << endl;
+	}
@@ -0,0 +1,168 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOEPAE_H
+#define ALOE_ALOEPAE_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Parsimony analysis of endemicity (PAE): finds the most parsimonious area cladograms for a presence/absence matrix,
+|	treating the areas as terminals and the species as binary characters (absence = 0, presence = 1). The trees are
+|	rooted on an outgroup area or, if none is given, on a hypothetical area in which every species is absent.
+|~
+|	o Only the informative species (present in, and absent from, at least two terminals) take part in the search; the
+|	  others add the same number of steps to every tree and are accounted for separately.
+|	o The state sets of each node are kept as two bit vectors (state 0 and state 1) with one bit per species, so the
+|	  Fitch downpass and uppass deal with 64 species per word operation.
+|	o Each replicate builds a Wagner tree with a random addition sequence and improves it by SPR or TBR branch
+|	  swapping. When a subtree is clipped, the downpass sets are updated only on the path from the clipping point to
+|	  the root, and the cost of every reconnection is found from the cached state sets of the two branches joined,
+|	  without visiting the rest of the tree (stopping as soon as the cost exceeds the best found so far).
+|	o Replicates are tasks for an AloeThreadPool. Replicate k draws its random numbers from stream k of the seed, so
+|	  the results do not depend on the number of threads.
+|	o The distinct shortest trees found are then swapped (TBR) to collect further trees of the same length, up to
+|	  `maxTrees'.
+|~
+|	Write saves the trees as a NEXUS TREES block (with the TAXA block it needs) that NxsTreesBlock can read:
+|>
+|	AloePae pae(matrix, outgroup);
+|	pae.Search(100, seed, nthreads);
+|	pae.Write(out, labels);
+|>
+|	Clade support is estimated by Resample (bootstrap or jackknife). The matrix is never copied: each replicate draws a
+|	weight for every informative species, and the weights are held as bit planes (bit b of every weight in plane b),
+|	so that the steps of a word of species are still counted with a few popcounts. Each replicate is searched by one
+|	random addition sequence and TBR, and the groups of the tree found are counted. WriteConsensus saves the majority-
+|	rule consensus of the replicates, with the percentage of replicates supporting each group as its label.
+*/
+class AloePae
+	{
+	public:
+
+		enum SwapEnum	/* the branch swapping algorithms available */
+			{
+			spr = 0,
+			tbr
+			};
+
+		enum ResampleEnum	/* the resampling methods available */
+			{
+			bootstrap = 0,
+			jackknife
+			};
+
+		enum {noOutgroup = -1};	/* root on a hypothetical area with every species absent */
+
+		static const double	jackknifeDeletion;	/* chance that a species is left out of a jackknife replicate */
+
+							AloePae(const AloeBitMatrix &m, int outgroupRow = noOutgroup);
+
+		double				GetConsistencyIndex() const;
+		unsigned			GetLength() const;
+		unsigned			GetNInformative() const;
+		unsigned			GetNResamples() const;
+		unsigned			GetNTerminals() const;
+		unsigned			GetNTrees() const;
+		double				GetRetentionIndex() const;
+		void				Resample(ResampleEnum method, unsigned replicates, AloeWord seed = 1, unsigned nthreads = 0);
+		unsigned			Search(unsigned replicates, AloeWord seed = 1, unsigned nthreads = 0, SwapEnum swap = tbr, unsigned maxTrees = 100);
+		void				Write(ostream &out, const NxsStringVector &labels) const;
+		void				WriteConsensus(ostream &out, const NxsStringVector &labels) const;
+
+		static const char	*GetResampleName(ResampleEnum method);
+
+	private:
+
+		friend class AloePaeSearch;
+		friend class AloePaeReplicate;
+		friend class AloePaeResample;
+
+		struct AloePaeTree	/* a rooted binary tree, stored as the children of each internal node */
+			{
+			NxsUnsignedVector	left;	/* left child of each node (leaves have none) */
+			NxsUnsignedVector	right;	/* right child of each node (leaves have none) */
+			string				key;	/* description of the topology that is the same for every way of storing it */
+			};
+
+		typedef vector<AloePaeTree>					AloePaeTreeVector;
+		typedef vector<AloeWordVector>				AloeCladeVector;
+		typedef map<AloeWordVector, unsigned>		AloeCladeMap;
+
+		unsigned			nterms;			/* number of terminals, including the hypothetical area (if any) */
+		unsigned			anchor;			/* the terminal on which the trees are rooted */
+		bool				hypothetical;	/* true if the last terminal is the hypothetical all-absent area */
+		AloeBitMatrix		informative;	/* presences of the informative species, one row per terminal */
+		NxsUnsignedVector	column;			/* column of each species in `informative' (or none if not informative) */
+		unsigned			extraSteps;		/* steps added to every tree by the uninformative species */
+		unsigned			minSteps;		/* length of the data on an ideal tree (one step per variable species) */
+		unsigned			maxSteps;		/* length of the data on a bush */
+		unsigned			length;			/* length of the shortest trees found by Search */
+		AloePaeTreeVector	trees;			/* the shortest trees found by Search */
+		ResampleEnum		resampling;		/* the method used by Resample */
+		unsigned			resamples;		/* number of replicates made by Resample */
+		AloeCladeMap		clades;			/* number of replicates of Resample in which each group was found */
+
+		void				CollectEqualTrees(unsigned maxTrees);
+		void				WriteNewick(ostream &out, const AloePaeTree &t, unsigned v) const;
+		void				BeginTrees(ostream &out, const NxsStringVector &labels) const;
+		void				WriteGroup(ostream &out, const vector<NxsUnsignedVector> &children, const NxsUnsignedVector &support, unsigned v) const;
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the length of the shortest trees found, counting every species.
+*/
+inline unsigned AloePae::GetLength() const
+	{
+	return length;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of species that are informative for parsimony.
+*/
+inline unsigned AloePae::GetNInformative() const
+	{
+	return informative.GetNCols();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of replicates made by the last call to Resample.
+*/
+inline unsigned AloePae::GetNResamples() const
+	{
+	return resamples;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of terminals, which includes the hypothetical area if no outgroup was given.
+*/
+inline unsigned AloePae::GetNTerminals() const
+	{
+	return nterms;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of most parsimonious trees found.
+*/
+inline unsigned AloePae::GetNTrees() const
+	{
+	return (unsigned)trees.size();
+	}
+
+#endif
@@ -0,0 +1,122 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOERANDOM_H
+#define ALOE_ALOERANDOM_H
+
+#include "aloebitmatrix.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Small, fast pseudorandom number generator (xorshift64*, seeded through splitmix64) for the randomized analyses.
+|	Unlike rand, each object carries its own state, so threads never share a generator. A generator is identified by a
+|	`seed' and a `stream' number; analyses made of many replicates give replicate k the stream k, so that the numbers
+|	drawn by each replicate depend only on the seed and not on the number of threads or the order in which the
+|	replicates happen to run.
+*/
+class AloeRandom
+	{
+	public:
+
+							AloeRandom(AloeWord seed = 1, AloeWord stream = 0);
+
+		unsigned			Below(unsigned n);
+		AloeWord			Next();
+		double				Uniform();
+		template <class T>
+		void				Shuffle(vector<T> &v);
+
+	private:
+
+		AloeWord			state;	/* current state of the generator (never zero) */
+
+		static AloeWord		SplitMix(AloeWord &x);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Starts the sequence of numbers identified by `seed' and `stream'.
+*/
+inline AloeRandom::AloeRandom(
+  AloeWord seed,	/* the seed given by the user */
+  AloeWord stream)	/* the number of the replicate (or other independent unit of work) using the generator */
+	{
+	AloeWord x = seed;
+	state = SplitMix(x);
+	x ^= stream * (AloeWord)0xD1B54A32D192ED03ULL;
+	state ^= SplitMix(x);
+	if (state == 0)
+		state = 0x9E3779B97F4A7C15ULL;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a number in the range [0..`n'). Assumes `n' is greater than zero.
+*/
+inline unsigned AloeRandom::Below(
+  unsigned n)	/* the number of possible values */
+	{
+	assert(n > 0);
+	return (unsigned)((Next() >> 32) * n >> 32);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the next 64-bit number of the sequence.
+*/
+inline AloeWord AloeRandom::Next()
+	{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545F4914F6CDD1DULL;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a number in the range [0..1), with 53 random bits.
+*/
+inline double AloeRandom::Uniform()
+	{
+	return (double)(Next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Puts the elements of `v' in random order (Fisher-Yates).
+*/
+template <class T>
+inline void AloeRandom::Shuffle(
+  vector<T> &v)	/* the vector to shuffle */
+	{
+	for (unsigned k = (unsigned)v.size(); k > 1; k--)
+		{
+		unsigned r = Below(k);
+		T t = v[k - 1];
+		v[k - 1] = v[r];
+		v[r] = t;
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Advances `x' by the splitmix64 increment and returns a well-mixed function of the new value.
+*/
+inline AloeWord AloeRandom::SplitMix(
+  AloeWord &x)	/* the splitmix64 state */
+	{
+	AloeWord z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+	}
+
+#endif
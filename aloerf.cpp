@@ -0,0 +1,307 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloerf.h"
+#include "aloethreadpool.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Turns a range of trees into sorted vectors of split IDs on a thread of an AloeThreadPool.
+*/
+class AloeRfRead : public AloeTask
+	{
+	public:
+
+		AloeRfRead(AloeSplitReader &r, const AloeSplitTable &t, const NxsUnsignedVector &k, unsigned f, unsigned l, unsigned *n)
+		  : reader(r), table(t), kept(k), first(f), last(l), nsplits(n), failed(UINT_MAX) {}
+
+		void Run()
+			{
+			NxsUnsignedVector splits;
+			offsets.push_back(0);
+			for (unsigned i = first; i < last; i++)
+				{
+				try
+					{
+					reader.GetTreeSplits(i, table, splits);
+					}
+				catch (NxsException &x)
+					{
+					failed = i;
+					message = x.msg;
+					return;
+					}
+
+				size_t start = ids.size();
+				for (unsigned k = 0; k < splits.size(); k++)
+					{
+					if (kept[splits[k]] != UINT_MAX)
+						ids.push_back(kept[splits[k]]);
+					}
+				sort(ids.begin() + start, ids.end());
+				nsplits[i - first] = (unsigned)splits.size();
+				offsets.push_back((unsigned)ids.size());
+				}
+			}
+
+		AloeSplitReader			&reader;	/* the reader of the trees */
+		const AloeSplitTable	&table;		/* the splits of every tree */
+		const NxsUnsignedVector	&kept;		/* the ID of each split of `table', or UINT_MAX if it is not kept */
+		unsigned				first;		/* the first tree to read */
+		unsigned				last;		/* one past the last tree to read */
+		unsigned				*nsplits;	/* on return, the number of splits of each tree of the range */
+		NxsUnsignedVector		offsets;	/* on return, the start of the IDs of each tree of the range in `ids' */
+		NxsUnsignedVector		ids;		/* on return, the split IDs kept for the trees of the range */
+		unsigned				failed;		/* the tree that could not be read, or UINT_MAX */
+		NxsString				message;	/* why tree `failed' could not be read */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes one tile of a band of the distance matrix on a thread of an AloeThreadPool.
+*/
+class AloeRfTile : public AloeTask
+	{
+	public:
+
+		AloeRfTile(const AloeRf &r, unsigned r0, unsigned r1, unsigned c0, unsigned c1, unsigned *b)
+		  : rf(r), firstRow(r0), lastRow(r1), firstCol(c0), lastCol(c1), band(b) {}
+
+		void Run()
+			{
+			rf.ComputeTile(firstRow, lastRow, firstCol, lastCol, band);
+			}
+
+	private:
+
+		const AloeRf	&rf;		/* the object doing the work */
+		unsigned		firstRow;	/* first row of the tile */
+		unsigned		lastRow;	/* one past the last row of the tile */
+		unsigned		firstCol;	/* first column of the tile */
+		unsigned		lastCol;	/* one past the last column of the tile */
+		unsigned		*band;		/* the band of results to which the tile belongs */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes `v' in decimal to `buf', which must have room for 10 characters, and returns the number of characters
+|	written.
+*/
+static unsigned FormatUnsigned(
+  unsigned v,	/* the number to write */
+  char *buf)	/* the buffer to receive it */
+	{
+	char digits[10];
+	unsigned n = 0;
+	do
+		{
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+		}
+	while (v > 0);
+	for (unsigned k = 0; k < n; k++)
+		buf[k] = digits[n - 1 - k];
+	return n;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes an object with no trees. Call Read to give it the trees.
+*/
+AloeRf::AloeRf()
+	{
+	ntrees		= 0;
+	maxDistance	= 0;
+	common		= 0;
+	nids		= 0;
+	total		= 0;
+	offsets.assign(1, 0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the distances between trees `firstRow' to `lastRow' - 1 and trees `firstCol' to `lastCol' - 1, for the
+|	pairs below the diagonal, into the band.
+*/
+void AloeRf::ComputeTile(
+  unsigned firstRow,	/* first tree of the band (a multiple of `bandTrees') */
+  unsigned lastRow,		/* one past the last tree of the band */
+  unsigned firstCol,	/* first tree of the tile's columns */
+  unsigned lastCol,		/* one past the last tree of the tile's columns (no greater than `lastRow') */
+  unsigned *band) const	/* storage for the band, (`lastRow' - `firstRow') x `lastRow' values */
+	{
+	vector<unsigned char> flags(nids + 1, 0);
+	const unsigned *base = (ids.empty() ? NULL : &ids[0]);
+	for (unsigned i = firstRow; i < lastRow; i++)
+		{
+		unsigned end = (i < lastCol ? i : lastCol);
+		if (end <= firstCol)
+			continue;
+		for (unsigned k = offsets[i]; k < offsets[i + 1]; k++)
+			flags[ids[k]] = 1;
+
+		unsigned *row = band + (size_t)(i - firstRow) * lastRow;
+		for (unsigned j = firstCol; j < end; j++)
+			{
+			unsigned shared = common;
+			for (const unsigned *b = base + offsets[j], *bEnd = base + offsets[j + 1]; b != bEnd; b++)
+				shared += flags[*b];
+			row[j] = nsplits[i] + nsplits[j] - 2 * shared;
+			}
+
+		for (unsigned k = offsets[i]; k < offsets[i + 1]; k++)
+			flags[ids[k]] = 0;
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the distances between trees `first' to `last' - 1 and every tree before them into `band', in rows of `last'
+|	distances (only those below the diagonal are set), running the tiles on the threads of `pool'.
+*/
+void AloeRf::ComputeBand(
+  AloeThreadPool &pool,				/* the threads on which to run the tiles */
+  unsigned first,					/* first tree of the band */
+  unsigned last,					/* one past the last tree of the band */
+  NxsUnsignedVector &band) const	/* on return, the distances */
+	{
+	band.resize((size_t)(last - first) * last);
+
+	vector<AloeRfTile *> tiles;
+	for (unsigned col = 0; col < last; col += tileTrees)
+		{
+		unsigned end = (col + tileTrees < last ? col + tileTrees : last);
+		tiles.push_back(new AloeRfTile(*this, first, last, col, end, &band[0]));
+		pool.Add(tiles.back());
+		}
+	pool.Run();
+	for (unsigned k = 0; k < tiles.size(); k++)
+		delete tiles[k];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Reads the trees of `reader', whose splits have been counted into `table', turning each into the sorted IDs of its
+|	splits. The trees are shared among `nthreads' threads (0 means one per core). If the trees were read as a stream,
+|	`reader' must have been asked to keep the splits of each tree. Throws NxsException, for the first tree that cannot
+|	be read, if any cannot.
+*/
+void AloeRf::Read(
+  AloeSplitReader &reader,		/* the reader of the trees */
+  const AloeSplitTable &table,	/* the splits of the trees, counted by `reader' */
+  unsigned nthreads)			/* the number of threads to use */
+	{
+	ntrees = reader.GetNTrees();
+	unsigned ntax = reader.GetNTaxa();
+	unsigned others = (reader.IsRooted() ? 2 : 3);
+	maxDistance = (ntax > others ? 2 * (ntax - others) : 0);
+	total = 0;
+	nsplits.assign(ntrees, 0);
+	offsets.assign(1, 0);
+	ids.clear();
+
+	common = 0;
+	nids = 0;
+	NxsUnsignedVector kept(table.GetNSplits(), UINT_MAX);
+	for (unsigned k = 0; k < table.GetNSplits(); k++)
+		{
+		unsigned count = table.GetSplit(k).count;
+		if (count == ntrees)
+			common++;
+		else if (count > 1)
+			kept[k] = nids++;
+		}
+	if (ntrees == 0)
+		return;
+
+	AloeThreadPool pool(nthreads);
+	unsigned ntasks = (pool.GetNThreads() < ntrees ? pool.GetNThreads() : ntrees);
+	vector<AloeRfRead *> tasks;
+	for (unsigned t = 0; t < ntasks; t++)
+		{
+		unsigned first = (unsigned)((AloeWord)ntrees * t / ntasks);
+		unsigned last = (unsigned)((AloeWord)ntrees * (t + 1) / ntasks);
+		tasks.push_back(new AloeRfRead(reader, table, kept, first, last, &nsplits[first]));
+		pool.Add(tasks.back());
+		}
+	pool.Run();
+
+	NxsString message;
+	for (unsigned t = 0; t < ntasks; t++)
+		{
+		AloeRfRead &r = *tasks[t];
+		if (message.empty() && r.failed != UINT_MAX)
+			message = r.message;
+		if (message.empty())
+			{
+			unsigned base = (unsigned)ids.size();
+			ids.insert(ids.end(), r.ids.begin(), r.ids.end());
+			for (unsigned k = 1; k < r.offsets.size(); k++)
+				offsets.push_back(base + r.offsets[k]);
+			}
+		delete tasks[t];
+		}
+	if (!message.empty())
+		throw NxsException(message);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the distances as a NEXUS DISTANCES block (lower triangle, with each tree as a taxon named after it), band
+|	by band, sharing the work of each band among `nthreads' threads (0 means one per core). `names' must hold a name
+|	for every tree. The distances are summed for GetMeanDistance.
+*/
+void AloeRf::Write(
+  ostream &out,							/* the stream to write to */
+  const NxsStringVector &names,			/* the tree names */
+  unsigned nthreads)					/* the number of threads to use */
+	{
+	assert(names.size() >= ntrees);
+
+	NxsStringVector quoted(names.begin(), names.begin() + ntrees);
+	for (unsigned i = 0; i < ntrees; i++)
+		{
+		if (quoted[i].QuotesNeeded())
+			quoted[i].AddQuotes();
+		}
+
+	out << "#NEXUS" << endl << endl;
+	out << "[Robinson-Foulds distances between trees (at most " << maxDistance << ")]" << endl;
+	out << "BEGIN DISTANCES;" << endl;
+	out << "\tDIMENSIONS NEWTAXA NTAX=" << ntrees << ";" << endl;
+	out << "\tFORMAT TRIANGLE=LOWER DIAGONAL LABELS;" << endl;
+	out << "\tMATRIX" << endl;
+
+	AloeThreadPool pool(nthreads);
+	NxsUnsignedVector band;
+	total = 0;
+	for (unsigned first = 0; first < ntrees; first += bandTrees)
+		{
+		unsigned last = (first + bandTrees < ntrees ? first + bandTrees : ntrees);
+		ComputeBand(pool, first, last, band);
+
+		char buf[16];
+		buf[0] = ' ';
+		for (unsigned i = first; i < last; i++)
+			{
+			const unsigned *row = &band[(size_t)(i - first) * last];
+			out << "\t" << quoted[i];
+			for (unsigned j = 0; j < i; j++)
+				{
+				out.write(buf, 1 + FormatUnsigned(row[j], buf + 1));
+				total += row[j];
+				}
+			out << " 0" << endl;
+			}
+		}
+
+	out << "\t;" << endl;
+	out << "END;" << endl;
+	}
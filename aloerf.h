@@ -0,0 +1,139 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOERF_H
+#define ALOE_ALOERF_H
+
+#include <ncl.h>
+#include "aloesplits.h"
+
+class AloeThreadPool;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Robinson-Foulds distances between every pair of trees of a TREES block: the number of splits found in one tree of
+|	the pair but not in the other (Robinson & Foulds 1981). The splits are those counted by an AloeSplitReader, so the
+|	trees are compared as rooted trees (by their groups) only if every tree is rooted.
+|~
+|	o Each tree is turned into the sorted vector of the IDs of its splits, found in the AloeSplitTable shared by all
+|	  the trees, so that the splits shared by two trees can be counted by merging their vectors (Compute).
+|	o Splits found in every tree are shared by every pair, and splits found in one tree only by none, so neither is
+|	  kept in the vectors: they only enter the number of splits of each tree. The splits that are kept are numbered
+|	  afresh from 0, so that a tile can flag the splits of one tree in an array of bytes and count those of every
+|	  other tree it shares by adding up their flags, with no branches to mispredict.
+|	o As in AloeSimilarity, the pairs are computed in bands of `bandTrees' trees, the lower triangle of each band split
+|	  into tiles of `tileTrees' columns that are tasks for an AloeThreadPool, and each band is written out as soon as
+|	  it is finished, so that the matrix for tens of thousands of trees is never stored.
+|~
+|>
+|	AloeSplitReader reader(trees, taxa);
+|	AloeSplitTable table;
+|	reader.Count(table, nthreads);
+|	AloeRf rf;
+|	rf.Read(reader, table, nthreads);
+|	rf.Write(out, names, nthreads);
+|>
+*/
+class AloeRf
+	{
+	public:
+
+		enum
+			{
+			bandTrees	= 128,	/* number of rows of the result computed before they are written */
+			tileTrees	= 256	/* number of trees in the columns of a tile */
+			};
+
+							AloeRf();
+
+		unsigned			Compute(unsigned i, unsigned j) const;
+		unsigned			GetMaxDistance() const;
+		double				GetMeanDistance() const;
+		unsigned			GetNTrees() const;
+		void				Read(AloeSplitReader &reader, const AloeSplitTable &table, unsigned nthreads = 0);
+		void				Write(ostream &out, const NxsStringVector &names, unsigned nthreads = 0);
+
+	private:
+
+		friend class AloeRfTile;
+
+		unsigned			ntrees;			/* number of trees */
+		unsigned			maxDistance;	/* largest possible distance between two trees */
+		unsigned			common;			/* number of splits found in every tree */
+		unsigned			nids;			/* number of splits found in some but not all trees */
+		NxsUnsignedVector	nsplits;		/* number of splits of each tree */
+		NxsUnsignedVector	offsets;		/* start of the split IDs of each tree in `ids' (ntrees + 1 entries) */
+		NxsUnsignedVector	ids;			/* sorted IDs of the splits of each tree found in some but not all others */
+		AloeWord			total;			/* sum of the distances written by Write */
+
+		void				ComputeBand(AloeThreadPool &pool, unsigned first, unsigned last, NxsUnsignedVector &band) const;
+		void				ComputeTile(unsigned firstRow, unsigned lastRow, unsigned firstCol, unsigned lastCol, unsigned *band) const;
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the Robinson-Foulds distance between trees `i' and `j'.
+*/
+inline unsigned AloeRf::Compute(
+  unsigned i,		/* the first tree */
+  unsigned j) const	/* the second tree */
+	{
+	assert(i < ntrees && j < ntrees);
+	const unsigned *base = (ids.empty() ? NULL : &ids[0]);
+	const unsigned *a = base + offsets[i], *aEnd = base + offsets[i + 1];
+	const unsigned *b = base + offsets[j], *bEnd = base + offsets[j + 1];
+	unsigned shared = common;
+	while (a != aEnd && b != bEnd)
+		{
+		if (*a < *b)
+			a++;
+		else if (*b < *a)
+			b++;
+		else
+			{
+			shared++;
+			a++;
+			b++;
+			}
+		}
+	return nsplits[i] + nsplits[j] - 2 * shared;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the largest possible distance: twice the number of splits of a fully resolved tree.
+*/
+inline unsigned AloeRf::GetMaxDistance() const
+	{
+	return maxDistance;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the mean of the distances written by the last call to Write.
+*/
+inline double AloeRf::GetMeanDistance() const
+	{
+	return (ntrees < 2 ? 0.0 : (double)total / (0.5 * ntrees * (ntrees - 1.0)));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of trees.
+*/
+inline unsigned AloeRf::GetNTrees() const
+	{
+	return ntrees;
+	}
+
+#endif
@@ -0,0 +1,510 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloesimilarity.h"
+#include "aloethreadpool.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Receives the bands of the similarity matrix, in order, from AloeSimilarity::ComputeBands. Only one thread at a time
+|	calls Band.
+*/
+class AloeSimilaritySink
+	{
+	public:
+
+		virtual			~AloeSimilaritySink() {}
+
+		virtual void	Band(unsigned first, unsigned last, const float *band) = 0;
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Shares the tiles of every band of the similarity matrix among the threads of an AloeThreadPool in a single run, so
+|	that the few tiles of the early bands do not leave threads idle. Each thread runs Work, which takes the next tile in
+|	order (band after band), computes it and then passes every complete band that follows those already passed on to
+|	the sink. Only one thread passes bands on at a time, so they reach the sink in order, and at most `maxBands' bands
+|	are held at once: a thread that would start a band beyond them waits until the earliest has been passed on.
+*/
+class AloeSimilarityBands
+	{
+	public:
+
+							AloeSimilarityBands(const AloeSimilarity &s, unsigned n, unsigned maxBands, AloeSimilaritySink &k);
+							~AloeSimilarityBands();
+
+		void				Work();
+
+	private:
+
+		struct AloeSimilarityBand	/* a band of results being computed */
+			{
+			vector<float>	values;		/* the similarities, stored as described for ComputeTile */
+			unsigned		pending;	/* number of its tiles not yet finished */
+			};
+
+		const AloeSimilarity			&sim;		/* the object doing the work */
+		AloeSimilaritySink				&sink;		/* the receiver of the finished bands */
+		unsigned						nareas;		/* number of areas (rows) */
+		unsigned						limit;		/* the most bands held at once */
+		vector<AloeSimilarityBand *>	bands;		/* the bands started and not yet passed on (NULL otherwise) */
+		unsigned						nextRow;	/* first row of the band of the next tile to compute */
+		unsigned						nextCol;	/* first column of the next tile to compute */
+		unsigned						passed;		/* number of bands passed on to the sink */
+		bool							passing;	/* true while a thread is passing bands on */
+		pthread_mutex_t					lock;		/* protects everything above but `sim' and `sink' */
+		pthread_cond_t					room;		/* signalled whenever a band has been passed on */
+
+							AloeSimilarityBands(const AloeSimilarityBands &);		/* not implemented */
+		AloeSimilarityBands	&operator=(const AloeSimilarityBands &);				/* not implemented */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs AloeSimilarityBands::Work on a thread of an AloeThreadPool.
+*/
+class AloeSimilarityWorker : public AloeTask
+	{
+	public:
+
+		AloeSimilarityWorker(AloeSimilarityBands &b) : bands(b) {}
+
+		void Run()
+			{
+			bands.Work();
+			}
+
+	private:
+
+		AloeSimilarityBands	&bands;	/* the tiles to share */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes the bands of the similarity matrix as the rows of a NEXUS DISTANCES block (dissimilarities) and of a CSV
+|	table (similarities), as described for AloeSimilarity::Write.
+*/
+class AloeSimilarityWriter : public AloeSimilaritySink
+	{
+	public:
+
+		AloeSimilarityWriter(ostream &n, ostream &c, const NxsStringVector &q, const vector<string> &l)
+		  : nexus(n), csv(c), quoted(q), csvLabels(l) {}
+
+		void Band(unsigned first, unsigned last, const float *band)
+			{
+			char buf[16];
+			for (unsigned i = first; i < last; i++)
+				{
+				const float *row = band + (size_t)(i - first) * last;
+				string rowField = csvLabels[i] + ',';
+				nexus << "\t" << quoted[i];
+				for (unsigned j = 0; j < i; j++)
+					{
+					buf[0] = ' ';
+					nexus.write(buf, 1 + AloeSimilarity::FormatFraction(1.0 - row[j], buf + 1));
+					csv << rowField << csvLabels[j];
+					buf[0] = ',';
+					unsigned len = 1 + AloeSimilarity::FormatFraction(row[j], buf + 1);
+					buf[len++] = '\n';
+					csv.write(buf, len);
+					}
+				nexus << " 0" << endl;
+				}
+			}
+
+	private:
+
+		ostream					&nexus;		/* stream receiving the DISTANCES block */
+		ostream					&csv;		/* stream receiving the CSV table */
+		const NxsStringVector	&quoted;	/* the area labels, quoted where NEXUS needs it */
+		const vector<string>	&csvLabels;	/* the area labels as CSV fields */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Copies the bands of the similarity matrix, as dissimilarities, into the packed lower triangle described for
+|	AloeSimilarity::GetDissimilarities.
+*/
+class AloeDissimilarityFiller : public AloeSimilaritySink
+	{
+	public:
+
+		AloeDissimilarityFiller(vector<float> &p) : packed(p) {}
+
+		void Band(unsigned first, unsigned last, const float *band)
+			{
+			for (unsigned i = first; i < last; i++)
+				{
+				const float *row = band + (size_t)(i - first) * last;
+				float *out = &packed[0] + (size_t)i * (i - 1) / 2;
+				for (unsigned j = 0; j < i; j++)
+					out[j] = 1.0f - row[j];
+				}
+			}
+
+	private:
+
+		vector<float>	&packed;	/* the lower triangle being filled */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares to share the tiles of the similarities among the first `n' areas compared by `s', passing each band on to
+|	`k' and holding at most `maxBands' bands (at least 1) at once.
+*/
+AloeSimilarityBands::AloeSimilarityBands(
+  const AloeSimilarity &s,	/* the object doing the work */
+  unsigned n,				/* the number of areas */
+  unsigned maxBands,		/* the most bands held at once */
+  AloeSimilaritySink &k)	/* the receiver of the finished bands */
+  : sim(s), sink(k)
+	{
+	nareas	= n;
+	limit	= (maxBands > 0 ? maxBands : 1);
+	nextRow	= 0;
+	nextCol	= 0;
+	passed	= 0;
+	passing	= false;
+	bands.assign((n + AloeSimilarity::bandRows - 1) / AloeSimilarity::bandRows, NULL);
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&room, NULL);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Releases the lock, and any bands not passed on.
+*/
+AloeSimilarityBands::~AloeSimilarityBands()
+	{
+	for (unsigned b = 0; b < bands.size(); b++)
+		delete bands[b];
+	pthread_cond_destroy(&room);
+	pthread_mutex_destroy(&lock);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes tiles, and passes finished bands on to the sink, until no tile is left. Called by every thread of the
+|	pool at once.
+*/
+void AloeSimilarityBands::Work()
+	{
+	pthread_mutex_lock(&lock);
+	while (nextRow < nareas)
+		{
+		// Take the next tile, starting its band if it is the first, unless that band would be one too many
+		//
+		unsigned b = nextRow / AloeSimilarity::bandRows;
+		if (b >= passed + limit)
+			{
+			pthread_cond_wait(&room, &lock);
+			continue;
+			}
+		unsigned first = nextRow;
+		unsigned last = (first + AloeSimilarity::bandRows < nareas ? first + AloeSimilarity::bandRows : nareas);
+		if (nextCol == 0)
+			{
+			bands[b] = new AloeSimilarityBand;
+			bands[b]->values.resize((size_t)(last - first) * last);
+			bands[b]->pending = (last + AloeSimilarity::tileRows - 1) / AloeSimilarity::tileRows;
+			}
+		unsigned col = nextCol;
+		unsigned end = (col + AloeSimilarity::tileRows < last ? col + AloeSimilarity::tileRows : last);
+		nextCol = end;
+		if (nextCol == last)
+			{
+			nextRow = last;
+			nextCol = 0;
+			}
+		AloeSimilarityBand *band = bands[b];
+		pthread_mutex_unlock(&lock);
+
+		sim.ComputeTile(first, last, col, end, &band->values[0]);
+
+		pthread_mutex_lock(&lock);
+		band->pending--;
+		if (passing)
+			continue;
+
+		// Pass on the finished bands that come next, leaving the lock to other threads while each is passed on
+		//
+		passing = true;
+		while (passed < bands.size() && bands[passed] != NULL && bands[passed]->pending == 0)
+			{
+			AloeSimilarityBand *done = bands[passed];
+			unsigned f = passed * AloeSimilarity::bandRows;
+			unsigned l = (f + AloeSimilarity::bandRows < nareas ? f + AloeSimilarity::bandRows : nareas);
+			pthread_mutex_unlock(&lock);
+
+			sink.Band(f, l, &done->values[0]);
+			delete done;
+
+			pthread_mutex_lock(&lock);
+			bands[passed++] = NULL;
+			pthread_cond_broadcast(&room);
+			}
+		passing = false;
+		}
+	pthread_mutex_unlock(&lock);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares to compute index `which' for the first `nareas' areas (rows) of `m', or for every row if `nareas' is 0 (or
+|	more than the number of rows). The matrix must not be changed or destroyed while this object is in use.
+*/
+AloeSimilarity::AloeSimilarity(
+  const AloeBitMatrix &m,	/* the presence/absence matrix, one row per area */
+  IndexEnum which,			/* the index to compute */
+  unsigned nareas)			/* the number of areas to compare */
+  : matrix(m)
+	{
+	index = which;
+	if (nareas == 0 || nareas > matrix.GetNRows())
+		nareas = matrix.GetNRows();
+	richness.resize(nareas);
+	for (unsigned i = 0; i < nareas; i++)
+		richness[i] = matrix.RowCount(i);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the similarity between areas `i' and `j'. Assumes both are in the range [0..number of areas).
+*/
+double AloeSimilarity::Compute(
+  unsigned i,	/* the (0-offset) index of the first area */
+  unsigned j) const	/* the (0-offset) index of the second area */
+	{
+	unsigned c = AloeBitMatrix::AndCount(matrix.GetRow(i), matrix.GetRow(j), matrix.GetNWords());
+	return Similarity(richness[i], richness[j], c);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the similarities between every pair of areas on `nthreads' threads (0 means one per core), in bands of
+|	`bandRows' areas, and passes each band to `sink', in order, as soon as it is finished. The tiles of every band are
+|	shared among the threads in a single run of the pool. Only as many bands are held at once as are needed to give
+|	every thread two tiles, and never fewer than two.
+*/
+void AloeSimilarity::ComputeBands(
+  AloeSimilaritySink &sink,	/* the receiver of the bands */
+  unsigned nthreads) const	/* the number of threads to use */
+	{
+	unsigned n = (unsigned)richness.size();
+	AloeThreadPool pool(nthreads);
+	unsigned maxBands = 2 + 2 * pool.GetNThreads() * tileRows / (n > 0 ? n : 1);
+	AloeSimilarityBands bands(*this, n, maxBands, sink);
+
+	vector<AloeSimilarityWorker *> workers;
+	for (unsigned k = 0; k < pool.GetNThreads(); k++)
+		{
+		workers.push_back(new AloeSimilarityWorker(bands));
+		pool.Add(workers.back());
+		}
+	pool.Run();
+	for (unsigned k = 0; k < workers.size(); k++)
+		delete workers[k];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `packed' with the dissimilarity (1 - similarity) of every pair of areas, as the lower triangle of the matrix
+|	stored row after row without the diagonal: the pair i, j (j < i) is at i x (i - 1) / 2 + j. This is the form taken
+|	by AloeCluster::SetDistances. The work is shared among `nthreads' threads (0 means one per core).
+*/
+void AloeSimilarity::GetDissimilarities(
+  vector<float> &packed,	/* on return, the dissimilarities */
+  unsigned nthreads) const	/* the number of threads to use */
+	{
+	size_t n = richness.size();
+	packed.resize(n * (n > 0 ? n - 1 : 0) / 2);
+
+	AloeDissimilarityFiller filler(packed);
+	ComputeBands(filler, nthreads);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the similarities between areas `firstRow' to `lastRow' - 1 and areas `firstCol' to `lastCol' - 1, for the
+|	pairs below the diagonal only. The similarity of areas i and j is stored in `band' at (i - `firstRow') x `lastRow'
+|	+ j. Shared counts for the whole tile are accumulated `tileWords' words at a time.
+*/
+void AloeSimilarity::ComputeTile(
+  unsigned firstRow,	/* first area of the band (a multiple of `bandRows') */
+  unsigned lastRow,		/* one past the last area of the band */
+  unsigned firstCol,	/* first area of the tile's columns */
+  unsigned lastCol,		/* one past the last area of the tile's columns (no greater than `lastRow') */
+  float *band) const	/* storage for the band, (`lastRow' - `firstRow') x `lastRow' values */
+	{
+	unsigned ncols = lastCol - firstCol;
+	unsigned nwords = matrix.GetNWords();
+	NxsUnsignedVector shared((size_t)(lastRow - firstRow) * ncols, 0);
+
+	for (unsigned w = 0; w < nwords; w += tileWords)
+		{
+		unsigned nw = nwords - w;
+		if (nw > tileWords)
+			nw = tileWords;
+
+		for (unsigned i = firstRow; i < lastRow; i++)
+			{
+			const AloeWord *a = matrix.GetRow(i) + w;
+			unsigned *c = &shared[(size_t)(i - firstRow) * ncols];
+			unsigned end = (i < lastCol ? i : lastCol);
+			for (unsigned j = firstCol; j < end; j++)
+				c[j - firstCol] += AloeBitMatrix::AndCount(a, matrix.GetRow(j) + w, nw);
+			}
+		}
+
+	for (unsigned i = firstRow; i < lastRow; i++)
+		{
+		const unsigned *c = &shared[(size_t)(i - firstRow) * ncols];
+		float *out = band + (size_t)(i - firstRow) * lastRow;
+		unsigned end = (i < lastCol ? i : lastCol);
+		for (unsigned j = firstCol; j < end; j++)
+			out[j] = (float)Similarity(richness[i], richness[j], c[j - firstCol]);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns `s' as a CSV field, surrounded by double quotes (with embedded double quotes doubled) if necessary.
+*/
+string AloeSimilarity::CsvField(
+  const NxsString &s)	/* the text of the field */
+	{
+	if (s.find_first_of(",\"\n\r") == string::npos)
+		return s;
+
+	string f = "\"";
+	for (unsigned k = 0; k < s.size(); k++)
+		{
+		if (s[k] == '"')
+			f += '"';
+		f += s[k];
+		}
+	f += '"';
+	return f;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Writes `v', which must lie in the range [0, 1], to `buf' rounded to six decimal places, without trailing zeros
+|	(e.g., "0", "0.0625", "1"), and returns the number of characters written (at most 8; no terminating null is 
+|	added). This is many times faster than sprintf or operator<<, which matters when hundreds of millions of values
+|	are written for a large matrix.
+*/
+unsigned AloeSimilarity::FormatFraction(
+  double v,		/* the value to be written */
+  char *buf)	/* buffer of at least 8 characters */
+	{
+	long k = (long)(v * 1000000.0 + 0.5);
+	if (k <= 0)
+		{
+		buf[0] = '0';
+		return 1;
+		}
+	if (k >= 1000000)
+		{
+		buf[0] = '1';
+		return 1;
+		}
+
+	unsigned len = 8;
+	while (k % 10 == 0)
+		{
+		k /= 10;
+		len--;
+		}
+
+	buf[0] = '0';
+	buf[1] = '.';
+	for (unsigned p = len - 1; p >= 2; p--)
+		{
+		buf[p] = (char)('0' + k % 10);
+		k /= 10;
+		}
+	return len;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the name of index `which', as accepted by ParseIndex.
+*/
+const char *AloeSimilarity::GetIndexName(
+  IndexEnum which)	/* the index in question */
+	{
+	switch (which)
+		{
+		case sorensen:
+			return "sorensen";
+		case simpson:
+			return "simpson";
+		default:
+			return "jaccard";
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets `which' to the index named `name' ("jaccard", "sorensen" or "simpson", in any case) and returns true, or 
+|	returns false if the name is not recognized.
+*/
+bool AloeSimilarity::ParseIndex(
+  const string &name,	/* the name of the index */
+  IndexEnum &which)		/* on return, the index named */
+	{
+	NxsString s = name.c_str();
+	s.ToUpper();
+	for (int k = jaccard; k <= simpson; k++)
+		{
+		NxsString t = GetIndexName((IndexEnum)k);
+		if (s == t.ToUpper())
+			{
+			which = (IndexEnum)k;
+			return true;
+			}
+		}
+	return false;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the similarity between every pair of areas and writes the results twice: to `nexus', as a NEXUS file
+|	holding a DISTANCES block (lower triangle, with labels) of dissimilarities 1 - similarity, which can be read by
+|	NxsDistancesBlock; and to `csv', as one line per pair of areas giving both labels and the similarity. `labels'
+|	must hold a label for every area. The work is shared among `nthreads' threads (0 means one per core).
+*/
+void AloeSimilarity::Write(
+  ostream &nexus,					/* stream to receive the DISTANCES block */
+  ostream &csv,						/* stream to receive the CSV table */
+  const NxsStringVector &labels,	/* the area labels */
+  unsigned nthreads)				/* the number of threads to use */
+	{
+	unsigned n = (unsigned)richness.size();
+	assert(labels.size() >= n);
+
+	NxsStringVector quoted(n);
+	vector<string> csvLabels(n);
+	for (unsigned i = 0; i < n; i++)
+		{
+		quoted[i] = labels[i];
+		if (quoted[i].QuotesNeeded())
+			quoted[i].AddQuotes();
+		csvLabels[i] = CsvField(labels[i]);
+		}
+
+	nexus << "#NEXUS" << endl << endl;
+	nexus << "[" << GetIndexName(index) << " dissimilarity (1 - similarity) between areas]" << endl;
+	nexus << "BEGIN DISTANCES;" << endl;
+	nexus << "\tDIMENSIONS NEWTAXA NTAX=" << n << ";" << endl;
+	nexus << "\tFORMAT TRIANGLE=LOWER DIAGONAL LABELS;" << endl;
+	nexus << "\tMATRIX" << endl;
+
+	csv << "Area1,Area2," << GetIndexName(index) << endl;
+
+	AloeSimilarityWriter writer(nexus, csv, quoted, csvLabels);
+	ComputeBands(writer, nthreads);
+
+	nexus << "\t;" << endl;
+	nexus << "END;" << endl;
+	csv.flush();
+	}
@@ -0,0 +1,119 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOESIMILARITY_H
+#define ALOE_ALOESIMILARITY_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+
+class AloeSimilaritySink;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the similarity between every pair of areas of a presence/absence matrix using one of the usual indices
+|	for binary data. If a and b are the numbers of species in the two areas and c the number they share:
+|~
+|	o Jaccard: c / (a + b - c)
+|	o Sorensen: 2c / (a + b)
+|	o Simpson: c / min(a, b)
+|~
+|	Where the index is undefined (an area with no species) the similarity is taken to be 0. The shared counts c are
+|	obtained by AND and popcount over the bit rows of the matrix. Rows are processed in bands, and the lower triangle
+|	of each band is split into tiles of `tileRows' areas. The threads of an AloeThreadPool take the tiles of all bands
+|	in order in a single run, so the small early bands do not leave threads idle. Within a tile the words of every row
+|	are visited `tileWords' at a time, so that the part of the matrix in use stays in cache. Only a few bands of results
+|	are held in memory at a time; as each band is finished it is written out, in order, so that the matrix for tens of
+|	thousands of areas never has to be stored.
+*/
+class AloeSimilarity
+	{
+	public:
+
+		enum IndexEnum	/* the similarity indices available */
+			{
+			jaccard = 0,
+			sorensen,
+			simpson
+			};
+
+		enum
+			{
+			bandRows	= 128,	/* number of rows of the result computed before they are written */
+			tileRows	= 256,	/* number of areas in the columns of a tile */
+			tileWords	= 64	/* number of words of each row compared before moving on to the next pair */
+			};
+
+							AloeSimilarity(const AloeBitMatrix &m, IndexEnum which = jaccard, unsigned nareas = 0);
+
+		double				Compute(unsigned i, unsigned j) const;
+		void				GetDissimilarities(vector<float> &packed, unsigned nthreads = 0) const;
+		IndexEnum			GetIndex() const;
+		void				Write(ostream &nexus, ostream &csv, const NxsStringVector &labels, unsigned nthreads = 0);
+
+		static string		CsvField(const NxsString &s);
+		static const char	*GetIndexName(IndexEnum which);
+		static bool			ParseIndex(const string &name, IndexEnum &which);
+
+	private:
+
+		friend class AloeSimilarityBands;
+		friend class AloeSimilarityWriter;
+
+		const AloeBitMatrix	&matrix;	/* the presence/absence matrix, one row per area */
+		IndexEnum			index;		/* the index to compute */
+		NxsUnsignedVector	richness;	/* number of species present in each area */
+
+		void				ComputeBands(AloeSimilaritySink &sink, unsigned nthreads) const;
+		void				ComputeTile(unsigned firstRow, unsigned lastRow, unsigned firstCol, unsigned lastCol, float *band) const;
+		double				Similarity(unsigned a, unsigned b, unsigned c) const;
+
+		static unsigned		FormatFraction(double v, char *buf);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the index being computed.
+*/
+inline AloeSimilarity::IndexEnum AloeSimilarity::GetIndex() const
+	{
+	return index;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the similarity of two areas with `a' and `b' species, of which `c' are shared.
+*/
+inline double AloeSimilarity::Similarity(
+  unsigned a,	/* number of species in the first area */
+  unsigned b,	/* number of species in the second area */
+  unsigned c) const	/* number of species present in both areas */
+	{
+	unsigned d;
+	switch (index)
+		{
+		case sorensen:
+			d = a + b;
+			return (d == 0 ? 0.0 : 2.0 * c / d);
+		case simpson:
+			d = (a < b ? a : b);
+			return (d == 0 ? 0.0 : (double)c / d);
+		default:
+			d = a + b - c;
+			return (d == 0 ? 0.0 : (double)c / d);
+		}
+	}
+
+#endif
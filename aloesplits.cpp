@@ -0,0 +1,762 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloesplits.h"
+#include "aloerandom.h"
+#include "aloethreadpool.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	A node of a tree being walked, whose taxa are those of the children visited so far.
+*/
+struct AloeSplitFrame
+	{
+	AloeWord	key;		/* exclusive or of the first random numbers of the taxa so far */
+	AloeWord	check;		/* exclusive or of the second random numbers of the taxa so far */
+	unsigned	first;		/* position of the first taxon of the node in the order of the leaves */
+	unsigned	nchildren;	/* number of children visited so far */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Counts the splits of a range of trees into a table of its own.
+*/
+class AloeSplitCount : public AloeTask
+	{
+	public:
+
+		AloeSplitCount(AloeSplitReader &r, unsigned f, unsigned l) : reader(r), first(f), last(l), failed(UINT_MAX) {}
+
+		void Run()
+			{
+			AloeSplitReader::AloeTreeSplitVector splits;
+			NxsUnsignedVector leaves;
+			unsigned n = reader.GetNTaxa();
+			for (unsigned i = first; i < last; i++)
+				{
+				try
+					{
+					reader.Read(i, splits, leaves);
+					}
+				catch (NxsException &x)
+					{
+					failed = i;
+					message = x.msg;
+					return;
+					}
+
+				for (unsigned k = 0; k < splits.size(); k++)
+					{
+					const AloeSplitReader::AloeTreeSplit &t = splits[k];
+					AloeSplitTable::AloeSplit s;
+					s.key = t.key;
+					s.check = t.check;
+					s.size = (t.complemented ? n - (t.last - t.first) : t.last - t.first);
+					s.count = 1;
+					s.tree = i;
+					s.group = t.group;
+					table.Add(s);
+					}
+				}
+			}
+
+		AloeSplitReader		&reader;	/* the reader of the trees */
+		unsigned			first;		/* the first tree to read */
+		unsigned			last;		/* one past the last tree to read */
+		AloeSplitTable		table;		/* on return, the splits of the trees */
+		unsigned			failed;		/* the tree that could not be read, or UINT_MAX */
+		NxsString			message;	/* why tree `failed' could not be read */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Orders splits by the first tree having them, then by group.
+*/
+static bool IsEarlierSplit(
+  const AloeSplitTable::AloeSplit &a,	/* the first split */
+  const AloeSplitTable::AloeSplit &b)	/* the second split */
+	{
+	return (a.tree < b.tree || (a.tree == b.tree && a.group < b.group));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Orders the splits of a tree by group.
+*/
+static bool IsEarlierGroup(
+  const AloeSplitReader::AloeTreeSplit &a,	/* the first split */
+  const AloeSplitReader::AloeTreeSplit &b)	/* the second split */
+	{
+	return (a.group < b.group);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes an empty table.
+*/
+AloeSplitTable::AloeSplitTable()
+	{
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds the count of split `s' to the table, adding the split if it is new, and returns the number of the split. The
+|	first tree (and group) recorded for the split is the earlier of those already recorded and those of `s'.
+*/
+unsigned AloeSplitTable::Add(
+  const AloeSplit &s)	/* the split, with the number of trees having it */
+	{
+	if (2 * (splits.size() + 1) > slots.size())
+		Resize(slots.empty() ? 16 : 2 * (unsigned)slots.size());
+
+	unsigned k = Probe(s.key, s.check);
+	if (slots[k] == UINT_MAX)
+		{
+		slots[k] = (unsigned)splits.size();
+		splits.push_back(s);
+		return slots[k];
+		}
+
+	AloeSplit &e = splits[slots[k]];
+	e.count += s.count;
+	if (IsEarlierSplit(s, e))
+		{
+		e.tree = s.tree;
+		e.group = s.group;
+		}
+	return slots[k];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Removes every split.
+*/
+void AloeSplitTable::Clear()
+	{
+	splits.clear();
+	slots.clear();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds the splits and counts of `other' to this table.
+*/
+void AloeSplitTable::Merge(
+  const AloeSplitTable &other)	/* the table to add */
+	{
+	for (unsigned k = 0; k < other.splits.size(); k++)
+		Add(other.splits[k]);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Numbers the splits in the order in which they first occur in the trees (by tree, then by group), which does not
+|	depend on the order in which they were added.
+*/
+void AloeSplitTable::Renumber()
+	{
+	sort(splits.begin(), splits.end(), IsEarlierSplit);
+	Resize((unsigned)slots.size());
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Rebuilds the hash table with `nslots' slots (a power of 2 greater than the number of splits).
+*/
+void AloeSplitTable::Resize(
+  unsigned nslots)	/* the new number of slots */
+	{
+	slots.assign(nslots, UINT_MAX);
+	for (unsigned k = 0; k < splits.size(); k++)
+		slots[Probe(splits[k].key, splits[k].check)] = k;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares to read the trees of `t', whose taxa are those of `tb', once the block has been read. The random numbers
+|	given to the taxa are always the same, so the hashes of a split do not change from one run to the next.
+*/
+AloeSplitReader::AloeSplitReader(
+  NxsTreesBlock &t,		/* the trees */
+  NxsTaxaBlock &tb)		/* the taxa of the trees */
+  : trees(&t), taxa(tb)
+	{
+	keepingTreeSplits = false;
+	Prepare();
+
+	ntrees	= t.GetNumTrees();
+	rooted	= (ntrees > 0);
+	for (unsigned i = 0; i < ntrees; i++)
+		{
+		if (!t.IsRootedTree(i))
+			rooted = false;
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Prepares to read the trees of a TREES block as a stream, the reader being the tree listener of the block. The taxa
+|	are those of `tb', which need not have been read yet. If `keepTreeSplits' is true, the splits of each tree are kept
+|	for GetTreeSplits.
+*/
+AloeSplitReader::AloeSplitReader(
+  NxsTaxaBlock &tb,			/* the taxa of the trees */
+  bool keepTreeSplits)		/* true if the splits of each tree are to be kept */
+  : trees(NULL), taxa(tb)
+	{
+	keepingTreeSplits = keepTreeSplits;
+	Prepare();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds the splits of tree `i', as found by Walk, to `stream', with the trees taken to be rooted if `asRooted' is
+|	true. The taxa of each split not seen before are stored, and, if asked for, the numbers of the splits of the tree.
+*/
+void AloeSplitReader::AddToStream(
+  AloeSplitStream &stream,				/* the splits counted so far */
+  AloeTreeSplitVector splits,			/* the splits of the tree (before Orient) */
+  const NxsUnsignedVector &leaves,		/* the taxa of the tree in the order of the description */
+  unsigned firstTaxon,					/* the position of the first taxon in `leaves' */
+  unsigned i,							/* the tree */
+  bool asRooted)						/* true if the tree is taken to be rooted */
+	{
+	Orient(splits, firstTaxon, asRooted);
+
+	// Splits are added in the order of their groups, so that they are numbered in the order in which they first
+	// occur (the order given by AloeSplitTable::Renumber)
+	//
+	sort(splits.begin(), splits.end(), IsEarlierGroup);
+	for (unsigned k = 0; k < splits.size(); k++)
+		{
+		const AloeTreeSplit &t = splits[k];
+		unsigned inside = t.last - t.first;
+		AloeSplitTable::AloeSplit s;
+		s.key = t.key;
+		s.check = t.check;
+		s.size = (t.complemented ? ntax - inside : inside);
+		s.count = 1;
+		s.tree = i;
+		s.group = t.group;
+
+		unsigned id = stream.table.Add(s);
+		if (id + 1 == stream.taxaStart.size())
+			{
+			// Store the group or the taxa outside it, whichever are fewer
+			//
+			bool outside = (2 * inside > ntax);
+			if (outside)
+				{
+				stream.taxa.insert(stream.taxa.end(), leaves.begin(), leaves.begin() + t.first);
+				stream.taxa.insert(stream.taxa.end(), leaves.begin() + t.last, leaves.end());
+				}
+			else
+				stream.taxa.insert(stream.taxa.end(), leaves.begin() + t.first, leaves.begin() + t.last);
+			stream.taxaStart.push_back((unsigned)stream.taxa.size());
+			stream.taxaOutside.push_back(outside != t.complemented);
+			}
+		if (keepingTreeSplits)
+			stream.treeSplits.push_back(id);
+		}
+	if (keepingTreeSplits)
+		stream.treeStart.push_back((unsigned)stream.treeSplits.size());
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	If the root of the rooted tree whose groups (as found by Walk) are `splits' has two children that are both groups,
+|	adds one to the number of trees in which the child holding the first taxon is such a group (see Unroot). The
+|	children are the groups of the leaves before and after some position, which are disjoint and together hold every
+|	taxon; no other two groups of a tree do. Assumes the splits of the tree have been added to `rootedSplits'.
+*/
+void AloeSplitReader::CountRootSide(
+  const AloeTreeSplitVector &splits,	/* the groups of the tree */
+  unsigned firstTaxon)					/* the position of the first taxon in the order of the leaves */
+	{
+	NxsUnsignedVector ends;
+	for (unsigned k = 0; k < splits.size(); k++)
+		{
+		if (splits[k].first == 0 && splits[k].last < ntax)
+			ends.push_back(splits[k].last);
+		}
+
+	for (unsigned k = 0; k < splits.size(); k++)
+		{
+		const AloeTreeSplit &right = splits[k];
+		if (right.last != ntax || right.first == 0 || find(ends.begin(), ends.end(), right.first) == ends.end())
+			continue;
+
+		// The left child is the group of the leaves before the right child: its hash is that of the other side
+		//
+		AloeWord key = right.key;
+		AloeWord check = right.check;
+		if (firstTaxon < right.first)
+			{
+			key ^= allKeys;
+			check ^= allChecks;
+			}
+		unsigned id = rootedSplits.table.Find(key, check);
+		assert(id != UINT_MAX);
+		if (id >= rootSides.size())
+			rootSides.resize(rootedSplits.table.GetNSplits(), 0);
+		rootSides[id]++;
+		return;
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Counts the splits of every tree into `table' (emptied first), and numbers the splits in the order in which they
+|	first occur. If the trees were read as a stream, the splits counted while they were read are simply handed over
+|	(and `nthreads' is not used); otherwise the trees are shared among `nthreads' threads (0 means one per core).
+|	Throws NxsException, for the first tree that cannot be read, if any cannot.
+*/
+void AloeSplitReader::Count(
+  AloeSplitTable &table,	/* on return, the splits of the trees */
+  unsigned nthreads)		/* the number of threads to use */
+	{
+	table.Clear();
+	if (ntrees == 0)
+		return;
+
+	if (trees == NULL)
+		{
+		table = (rooted ? rootedSplits : unrootedSplits).table;
+		return;
+		}
+
+	AloeThreadPool pool(nthreads);
+	unsigned ntasks = (pool.GetNThreads() < ntrees ? pool.GetNThreads() : ntrees);
+	vector<AloeSplitCount *> tasks;
+	for (unsigned t = 0; t < ntasks; t++)
+		{
+		unsigned first = (unsigned)((AloeWord)ntrees * t / ntasks);
+		unsigned last = (unsigned)((AloeWord)ntrees * (t + 1) / ntasks);
+		tasks.push_back(new AloeSplitCount(*this, first, last));
+		pool.Add(tasks.back());
+		}
+	pool.Run();
+
+	NxsString message;
+	for (unsigned t = 0; t < ntasks; t++)
+		{
+		if (message.empty() && tasks[t]->failed != UINT_MAX)
+			message = tasks[t]->message;
+		if (message.empty())
+			table.Merge(tasks[t]->table);
+		delete tasks[t];
+		}
+	if (!message.empty())
+		{
+		table.Clear();
+		throw NxsException(message);
+		}
+	table.Renumber();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Throws NxsException with message `msg' about the tree named `name'.
+*/
+void AloeSplitReader::Fail(
+  const NxsString &name,		/* the name of the tree */
+  const NxsString &msg) const	/* what is wrong with it */
+	{
+	NxsString s = "Tree ";
+	s += name;
+	s += ": ";
+	s += msg;
+	throw NxsException(s);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets the taxa of each split `which[r]' of `table' as row r of `bits' (one column per taxon). If the trees were read
+|	as a stream, the taxa stored when the splits were first seen are used; otherwise the trees in which the splits were
+|	first seen are read again, each once, in order.
+*/
+void AloeSplitReader::GetTaxa(
+  const AloeSplitTable &table,		/* the splits of the trees */
+  const NxsUnsignedVector &which,	/* the numbers of the splits wanted */
+  AloeBitMatrix &bits)				/* on return, the taxa of the splits */
+	{
+	bits.Reset((unsigned)which.size(), ntax);
+
+	if (trees == NULL)
+		{
+		const AloeSplitStream &stream = (rooted ? rootedSplits : unrootedSplits);
+		for (unsigned r = 0; r < which.size(); r++)
+			{
+			unsigned k = which[r];
+			assert(k + 1 < stream.taxaStart.size());
+			bool outside = (stream.taxaOutside[k] != 0);
+			if (outside)
+				{
+				for (unsigned j = 0; j < ntax; j++)
+					bits.Set(r, j);
+				}
+			for (unsigned p = stream.taxaStart[k]; p < stream.taxaStart[k + 1]; p++)
+				bits.Set(r, stream.taxa[p], !outside);
+			}
+		return;
+		}
+
+	vector< pair<unsigned, unsigned> > byTree;
+	for (unsigned r = 0; r < which.size(); r++)
+		byTree.push_back(pair<unsigned, unsigned>(table.GetSplit(which[r]).tree, r));
+	sort(byTree.begin(), byTree.end());
+
+	AloeTreeSplitVector splits;
+	NxsUnsignedVector leaves;
+	for (unsigned k = 0; k < byTree.size(); )
+		{
+		unsigned i = byTree[k].first;
+		Read(i, splits, leaves);
+		for (; k < byTree.size() && byTree[k].first == i; k++)
+			{
+			unsigned r = byTree[k].second;
+			const AloeSplitTable::AloeSplit &s = table.GetSplit(which[r]);
+			AloeTreeSplit wanted;
+			wanted.key = s.key;
+			wanted.check = s.check;
+			wanted.group = 0;
+			AloeTreeSplitVector::const_iterator t = lower_bound(splits.begin(), splits.end(), wanted, IsLess);
+			assert(t != splits.end() && t->key == s.key && t->check == s.check);
+
+			for (unsigned p = 0; p < ntax; p++)
+				{
+				bool inside = (p >= t->first && p < t->last);
+				if (inside != t->complemented)
+					bits.Set(r, leaves[p]);
+				}
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets `ids' to the numbers in `table', as filled by Count, of the splits of tree `i'. If the trees were read as a
+|	stream, the reader must have been asked to keep the splits of each tree; otherwise the tree is read again. May be
+|	called for different trees from several threads at once.
+*/
+void AloeSplitReader::GetTreeSplits(
+  unsigned i,					/* the tree */
+  const AloeSplitTable &table,	/* the splits of the trees */
+  NxsUnsignedVector &ids)		/* on return, the numbers of the splits of the tree */
+	{
+	assert(i < ntrees);
+	ids.clear();
+
+	if (trees == NULL)
+		{
+		assert(keepingTreeSplits);
+		const AloeSplitStream &stream = (rooted ? rootedSplits : unrootedSplits);
+		ids.assign(stream.treeSplits.begin() + stream.treeStart[i], stream.treeSplits.begin() + stream.treeStart[i + 1]);
+		return;
+		}
+
+	AloeTreeSplitVector splits;
+	NxsUnsignedVector leaves;
+	Read(i, splits, leaves);
+	for (unsigned k = 0; k < splits.size(); k++)
+		{
+		unsigned id = table.Find(splits[k].key, splits[k].check);
+		assert(id != UINT_MAX);
+		ids.push_back(id);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Keeps the side of each split given by Walk that is used for trees taken to be rooted (if `asRooted' is true) or
+|	unrooted, drops the trivial splits, and orders the splits by IsLess, each given once (by the first group giving it).
+*/
+void AloeSplitReader::Orient(
+  AloeTreeSplitVector &splits,	/* the splits of a tree */
+  unsigned firstTaxon,			/* the position of the first taxon in the order of the leaves */
+  bool asRooted) const			/* true if the tree is taken to be rooted */
+	{
+	// Keep the side without the first taxon if the trees are unrooted, and drop the trivial splits
+	//
+	unsigned nkept = 0;
+	unsigned others = (asRooted ? 1 : 2);
+	for (unsigned k = 0; k < splits.size(); k++)
+		{
+		AloeTreeSplit t = splits[k];
+		unsigned size = t.last - t.first;
+		if (!asRooted && t.first <= firstTaxon && firstTaxon < t.last)
+			{
+			t.key ^= allKeys;
+			t.check ^= allChecks;
+			t.complemented = true;
+			size = ntax - size;
+			}
+		if (size >= 2 && size + others <= ntax)
+			splits[nkept++] = t;
+		}
+	splits.resize(nkept);
+
+	// The two groups at a root of two children give the same split of an unrooted tree
+	//
+	sort(splits.begin(), splits.end(), IsLess);
+	nkept = 0;
+	for (unsigned k = 0; k < splits.size(); k++)
+		{
+		if (nkept == 0 || splits[k].key != splits[nkept - 1].key || splits[k].check != splits[nkept - 1].check)
+			splits[nkept++] = splits[k];
+		}
+	splits.resize(nkept);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Gives each taxon of the TAXA block its random numbers, and empties the splits read as a stream.
+*/
+void AloeSplitReader::Prepare()
+	{
+	ntax	= taxa.GetNumTaxonLabels();
+	ntrees	= 0;
+	rooted	= true;
+	ResetStream(rootedSplits);
+	ResetStream(unrootedSplits);
+	rootSides.clear();
+
+	AloeRandom random(0x5EED5EED5EED5EEDULL);
+	keys.resize(ntax);
+	checks.resize(ntax);
+	allKeys = 0;
+	allChecks = 0;
+	for (unsigned j = 0; j < ntax; j++)
+		{
+		keys[j] = random.Next();
+		checks[j] = random.Next();
+		allKeys ^= keys[j];
+		allChecks ^= checks[j];
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Reads tree `i', setting `leaves' to its taxa in the order in which they occur in the description and `splits' to
+|	its splits, ordered by IsLess and each given once (by the first group giving it). The description is parsed afresh
+|	each time, and the parsed tree is not kept by the block, so that only the descriptions of the trees are held in
+|	memory. The trees must not have been read as a stream. Throws NxsException if the description is not a tree of
+|	every taxon.
+*/
+void AloeSplitReader::Read(
+  unsigned i,						/* the tree */
+  AloeTreeSplitVector &splits,		/* on return, the splits of the tree */
+  NxsUnsignedVector &leaves)		/* on return, the taxa in the order of the description */
+	{
+	assert(trees != NULL);
+
+	NxsTree tree;
+	unsigned firstTaxon;
+	trees->ParseTree(i, tree);
+	Walk(tree, trees->GetTreeName(i), splits, leaves, firstTaxon);
+	Orient(splits, firstTaxon, rooted);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Empties `stream'.
+*/
+void AloeSplitReader::ResetStream(
+  AloeSplitStream &stream)	/* the splits read as a stream */
+	{
+	stream.table.Clear();
+	stream.taxa.clear();
+	stream.taxaStart.assign(1, 0);
+	stream.taxaOutside.clear();
+	stream.treeSplits.clear();
+	stream.treeStart.assign(1, 0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Counts the splits of tree `i' of `block', just read, when the reader is the tree listener of the block (see
+|	NxsTreeListener). The first tree of a block starts the count afresh, with the taxa then in the TAXA block. Throws
+|	NxsException if the tree is not a tree of every taxon.
+*/
+void AloeSplitReader::TreeRead(
+  NxsTreesBlock &block,		/* the block being read */
+  unsigned i,				/* the index of the tree in the block */
+  const NxsTree &tree)		/* the tree */
+	{
+	assert(trees == NULL);
+	if (i == 0)
+		Prepare();
+
+	AloeTreeSplitVector splits;
+	NxsUnsignedVector leaves;
+	unsigned firstTaxon;
+	Walk(tree, block.GetTreeName(i), splits, leaves, firstTaxon);
+
+	ntrees = i + 1;
+	if (rooted && !tree.IsRooted())
+		Unroot();
+	if (rooted)
+		{
+		AddToStream(rootedSplits, splits, leaves, firstTaxon, i, true);
+		CountRootSide(splits, firstTaxon);
+		}
+	else
+		AddToStream(unrootedSplits, splits, leaves, firstTaxon, i, false);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Turns the splits of the rooted trees read so far as a stream into the splits of the same trees taken to be
+|	unrooted, in `unrootedSplits', and from then on counts the trees as unrooted. Each rooted split gives the unrooted
+|	split of the same bipartition (the side without the first taxon being kept), unless that is trivial. The two groups
+|	at a root of two children give the same unrooted split, which must be counted once for such a tree, so the trees in
+|	which a group is the one holding the first taxon at such a root are taken away from its count. Rooted splits are
+|	numbered in the order in which they first occur, so the unrooted splits are too; the splits of each tree, if kept,
+|	are given in the same order as when an unrooted tree is read.
+*/
+void AloeSplitReader::Unroot()
+	{
+	AloeSplitStream &from = rootedSplits;
+	AloeSplitStream &to = unrootedSplits;
+	ResetStream(to);
+	rootSides.resize(from.table.GetNSplits(), 0);
+
+	NxsUnsignedVector ids(from.table.GetNSplits(), UINT_MAX);
+	for (unsigned k = 0; k < from.table.GetNSplits(); k++)
+		{
+		// The group holds the first taxon if that is among the taxa stored for it, unless those are the taxa outside
+		//
+		bool outside = (from.taxaOutside[k] != 0);
+		bool holdsFirst = outside;
+		for (unsigned p = from.taxaStart[k]; p < from.taxaStart[k + 1]; p++)
+			{
+			if (from.taxa[p] == 0)
+				holdsFirst = !outside;
+			}
+
+		AloeSplitTable::AloeSplit s = from.table.GetSplit(k);
+		if (holdsFirst)
+			{
+			s.key ^= allKeys;
+			s.check ^= allChecks;
+			s.size = ntax - s.size;
+			}
+		if (s.size < 2 || s.size + 2 > ntax)
+			continue;
+		s.count -= rootSides[k];
+
+		ids[k] = to.table.Add(s);
+		if (ids[k] + 1 == to.taxaStart.size())
+			{
+			to.taxa.insert(to.taxa.end(), from.taxa.begin() + from.taxaStart[k], from.taxa.begin() + from.taxaStart[k + 1]);
+			to.taxaStart.push_back((unsigned)to.taxa.size());
+			to.taxaOutside.push_back(outside != holdsFirst);
+			}
+		}
+
+	// Each tree gives each unrooted split once, the first of its groups giving it coming first
+	//
+	if (keepingTreeSplits)
+		{
+		NxsUnsignedVector lastTree(to.table.GetNSplits(), UINT_MAX);
+		for (unsigned i = 0; i + 1 < from.treeStart.size(); i++)
+			{
+			for (unsigned p = from.treeStart[i]; p < from.treeStart[i + 1]; p++)
+				{
+				unsigned id = ids[from.treeSplits[p]];
+				if (id == UINT_MAX || lastTree[id] == i)
+					continue;
+				lastTree[id] = i;
+				to.treeSplits.push_back(id);
+				}
+			to.treeStart.push_back((unsigned)to.treeSplits.size());
+			}
+		}
+
+	rooted = false;
+	ResetStream(from);
+	rootSides.clear();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Walks `tree', setting `leaves' to its taxa in the order in which they occur in the description, `firstTaxon' to
+|	the position of the first taxon in `leaves', and `splits' to its groups of two or more children, in the order in
+|	which they are closed in the description (see Orient). Throws NxsException if the tree does not have every taxon.
+*/
+void AloeSplitReader::Walk(
+  const NxsTree &tree,				/* the tree */
+  const NxsString &name,			/* the name of the tree */
+  AloeTreeSplitVector &splits,		/* on return, the groups of the tree */
+  NxsUnsignedVector &leaves,		/* on return, the taxa in the order of the description */
+  unsigned &firstTaxon) const		/* on return, the position of the first taxon in `leaves' */
+	{
+	splits.clear();
+	leaves.clear();
+	firstTaxon = UINT_MAX;
+
+	if (tree.GetNumLeaves() != ntax)
+		{
+		NxsString msg = "has ";
+		msg += tree.GetNumLeaves();
+		msg += " of the ";
+		msg += ntax;
+		msg += " taxa";
+		Fail(name, msg);
+		}
+
+	const unsigned nnodes = tree.GetNumNodes();
+	vector<AloeSplitFrame> frames(nnodes);
+	unsigned ngroups = 0;
+
+	// Visit the nodes in postorder, so that groups are numbered in the order in which they are closed in the
+	// description and the leaves come in the order in which they occur in it
+	//
+	unsigned k = 0;
+	bool down = true;
+	for (;;)
+		{
+		if (down)
+			{
+			while (!tree.IsLeaf(k))
+				k = tree.GetNode(k).firstChild;
+			}
+
+		const NxsTree::NxsTreeNode &node = tree.GetNode(k);
+		AloeSplitFrame &f = frames[k];
+		if (tree.IsLeaf(k))
+			{
+			unsigned j = node.taxon;
+			if (j == 0)
+				firstTaxon = (unsigned)leaves.size();
+			f.key = keys[j];
+			f.check = checks[j];
+			f.first = (unsigned)leaves.size();
+			leaves.push_back(j);
+			}
+		else
+			{
+			// A group of one child is the same as its child, so only groups of two or more give splits
+			//
+			unsigned group = ngroups++;
+			if (f.nchildren > 1)
+				{
+				AloeTreeSplit t;
+				t.key = f.key;
+				t.check = f.check;
+				t.group = group;
+				t.first = f.first;
+				t.last = (unsigned)leaves.size();
+				t.complemented = false;
+				splits.push_back(t);
+				}
+			}
+
+		if (node.parent == UINT_MAX)
+			break;
+		AloeSplitFrame &p = frames[node.parent];
+		if (tree.GetNode(node.parent).firstChild == k)
+			{
+			p.key = 0;
+			p.check = 0;
+			p.first = f.first;
+			p.nchildren = 0;
+			}
+		p.key ^= f.key;
+		p.check ^= f.check;
+		p.nchildren++;
+
+		down = (node.nextSibling != UINT_MAX);
+		k = (down ? node.nextSibling : node.parent);
+		}
+	}
@@ -0,0 +1,274 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOESPLITS_H
+#define ALOE_ALOESPLITS_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Hash table of the distinct splits found in a set of trees, with the number of trees having each. A split is known
+|	by two 64-bit hashes of its taxa (see AloeSplitReader); the first places it in the table and the second must match
+|	as well, so that two different splits are taken to be the same only if both hashes collide. Nothing else about the
+|	taxa of a split is kept: each entry records instead the first tree having the split and the group of that tree
+|	giving it, from which the taxa can be recovered (AloeSplitReader::GetTaxa). The memory needed is thus proportional
+|	to the number of distinct splits, whatever the number of trees or of taxa. Splits are numbered in the order in
+|	which they are added, or, after Renumber, in the order in which they first occur in the trees.
+*/
+class AloeSplitTable
+	{
+	public:
+
+		struct AloeSplit	/* a distinct split */
+			{
+			AloeWord		key;	/* first hash of the taxa of the split (places it in the table) */
+			AloeWord		check;	/* second hash of the taxa of the split */
+			unsigned		size;	/* number of taxa on the side of the split that is kept */
+			unsigned		count;	/* number of trees having the split */
+			unsigned		tree;	/* first tree having the split */
+			unsigned		group;	/* number of the group of `tree' giving the split, in the order groups are closed */
+			};
+
+							AloeSplitTable();
+
+		unsigned			Add(const AloeSplit &s);
+		void				Clear();
+		unsigned			Find(AloeWord key, AloeWord check) const;
+		unsigned			GetNSplits() const;
+		const AloeSplit		&GetSplit(unsigned k) const;
+		void				Merge(const AloeSplitTable &other);
+		void				Renumber();
+
+	private:
+
+		typedef vector<AloeSplit>	AloeSplitVector;
+
+		AloeSplitVector		splits;	/* the distinct splits */
+		NxsUnsignedVector	slots;	/* the hash table, giving the number of a split or UINT_MAX (open addressing, linear probing; size is a power of 2) */
+
+		unsigned			Probe(AloeWord key, AloeWord check) const;
+		void				Resize(unsigned nslots);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Reads the splits of the trees of a TREES block from their parsed form, either from the block once it has been read
+|	(NxsTreesBlock::GetTree) or as a stream, tree by tree, while the block is being read (NxsTreeListener).
+|~
+|	o Every tree must have every taxon of the TAXA block exactly once.
+|	o Each taxon is given two random 64-bit numbers, and each side of a split is hashed by the exclusive or of the
+|	  numbers of its taxa (Zobrist hashing). The hash of a group is the exclusive or of those of its children, so the
+|	  splits of a tree are hashed in a single walk over its nodes, at a cost independent of the number of taxa in
+|	  each group. The hash of the other side of a split is found by an exclusive or with the hash of all taxa.
+|	o If every tree is rooted, the splits are the groups (clusters) of the trees. Otherwise the trees are taken to be
+|	  unrooted, and the side of each split kept is the one without the first taxon, so that the groups of a rooted
+|	  description of the same tree give the same splits however it is rooted. Groups of one taxon, and the group of
+|	  all taxa (all but one if unrooted), are left out.
+|~
+|	When the trees are kept by the block, Count shares them among threads, each counting into a table of its own; the
+|	tables are then merged and renumbered, so the counts and numbers of the splits do not depend on the number of
+|	threads. The taxa of chosen splits are recovered by GetTaxa, which reads again the trees in which they were first
+|	seen:
+|>
+|	AloeSplitReader reader(trees, taxa);
+|	AloeSplitTable table;
+|	reader.Count(table, nthreads);
+|>
+|	When the trees are too many to be kept, the reader is made the tree listener of the block, and the splits are
+|	counted as each tree is read, after which its description is dropped. The taxa of each split (or of its other
+|	side, if fewer) are kept when it is first seen, for GetTaxa, and the splits of each tree are kept only if asked for
+|	(for GetTreeSplits), so that the memory used grows with the number of distinct splits rather than with the number
+|	of trees. Trees are counted as rooted as long as every tree read is rooted. Should an unrooted tree follow, the
+|	splits counted so far are turned into unrooted splits (see Unroot): a group and the other group at a root of two
+|	children give the same unrooted split, so the trees in which each group is the one holding the first taxon at such
+|	a root are counted as well. Count then hands over the splits counted:
+|>
+|	AloeSplitReader reader(taxa, false);
+|	trees.SetTreeListener(&reader);
+|	...	(read the data file)
+|	AloeSplitTable table;
+|	reader.Count(table);
+|>
+|	The blocks must outlive the reader. Errors in the descriptions are reported by throwing NxsException.
+*/
+class AloeSplitReader : public NxsTreeListener
+	{
+	public:
+
+		struct AloeTreeSplit	/* a split of one tree */
+			{
+			AloeWord		key;			/* first hash of the side of the split kept */
+			AloeWord		check;			/* second hash of the side of the split kept */
+			unsigned		group;			/* number of the group giving the split, in the order groups are closed */
+			unsigned		first;			/* position of the first taxon of the group in the order of the leaves */
+			unsigned		last;			/* one past the position of the last taxon of the group */
+			bool			complemented;	/* true if the side kept is the taxa not in the group */
+			};
+
+		typedef vector<AloeTreeSplit>	AloeTreeSplitVector;
+
+							AloeSplitReader(NxsTreesBlock &t, NxsTaxaBlock &tb);
+							AloeSplitReader(NxsTaxaBlock &tb, bool keepTreeSplits);
+
+		void				Count(AloeSplitTable &table, unsigned nthreads = 0);
+		unsigned			GetNTaxa() const;
+		unsigned			GetNTrees() const;
+		void				GetTaxa(const AloeSplitTable &table, const NxsUnsignedVector &which, AloeBitMatrix &bits);
+		void				GetTreeSplits(unsigned i, const AloeSplitTable &table, NxsUnsignedVector &ids);
+		bool				IsRooted() const;
+		bool				IsStreaming() const;
+		void				Read(unsigned i, AloeTreeSplitVector &splits, NxsUnsignedVector &leaves);
+		virtual void		TreeRead(NxsTreesBlock &block, unsigned i, const NxsTree &tree);
+
+		static bool			IsLess(const AloeTreeSplit &a, const AloeTreeSplit &b);
+
+	private:
+
+		struct AloeSplitStream	/* the splits of the trees read so far as a stream, taken to be rooted or unrooted */
+			{
+			AloeSplitTable		table;			/* the distinct splits, numbered in the order in which they first occur */
+			NxsUnsignedVector	taxa;			/* the taxa stored for each split, split after split */
+			NxsUnsignedVector	taxaStart;		/* start of the taxa of each split in `taxa' (one more entry than splits) */
+			NxsCharVector		taxaOutside;	/* 1 if the taxa stored for a split are those not on the side kept */
+			NxsUnsignedVector	treeSplits;		/* the numbers of the splits of each tree, tree after tree (if kept) */
+			NxsUnsignedVector	treeStart;		/* start of the splits of each tree in `treeSplits' (if kept) */
+			};
+
+		NxsTreesBlock		*trees;				/* the trees, or NULL if they are read as a stream */
+		NxsTaxaBlock		&taxa;				/* the taxa of the trees */
+		unsigned			ntax;				/* number of taxa */
+		unsigned			ntrees;				/* number of trees */
+		bool				rooted;				/* true if every tree is rooted */
+		bool				keepingTreeSplits;	/* true if the splits of each tree read as a stream are kept */
+		AloeSplitStream		rootedSplits;		/* the splits of the trees read as a stream, while they are all rooted */
+		AloeSplitStream		unrootedSplits;		/* the splits of the trees read as a stream, once one is unrooted */
+		NxsUnsignedVector	rootSides;			/* number of trees in which each of `rootedSplits' is the group holding the first taxon at a root of two groups */
+		AloeWordVector		keys;				/* first random number of each taxon */
+		AloeWordVector		checks;				/* second random number of each taxon */
+		AloeWord			allKeys;			/* exclusive or of `keys' */
+		AloeWord			allChecks;			/* exclusive or of `checks' */
+
+		void				AddToStream(AloeSplitStream &stream, AloeTreeSplitVector splits, const NxsUnsignedVector &leaves, unsigned firstTaxon, unsigned i, bool asRooted);
+		void				CountRootSide(const AloeTreeSplitVector &splits, unsigned firstTaxon);
+		void				Fail(const NxsString &name, const NxsString &msg) const;
+		void				Orient(AloeTreeSplitVector &splits, unsigned firstTaxon, bool asRooted) const;
+		void				Prepare();
+		void				ResetStream(AloeSplitStream &stream);
+		void				Unroot();
+		void				Walk(const NxsTree &tree, const NxsString &name, AloeTreeSplitVector &splits, NxsUnsignedVector &leaves, unsigned &firstTaxon) const;
+
+							AloeSplitReader(const AloeSplitReader &);			/* not implemented */
+		AloeSplitReader		&operator=(const AloeSplitReader &);				/* not implemented */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of the split whose hashes are `key' and `check', or UINT_MAX if there is no such split.
+*/
+inline unsigned AloeSplitTable::Find(
+  AloeWord key,			/* the first hash of the split */
+  AloeWord check) const	/* the second hash of the split */
+	{
+	if (splits.empty())
+		return UINT_MAX;
+	return slots[Probe(key, check)];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of distinct splits.
+*/
+inline unsigned AloeSplitTable::GetNSplits() const
+	{
+	return (unsigned)splits.size();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns split `k'.
+*/
+inline const AloeSplitTable::AloeSplit &AloeSplitTable::GetSplit(
+  unsigned k) const	/* the number of the split */
+	{
+	assert(k < splits.size());
+	return splits[k];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the slot holding the split whose hashes are `key' and `check', or the empty slot at which the search for it
+|	ended. Assumes the table is not full.
+*/
+inline unsigned AloeSplitTable::Probe(
+  AloeWord key,			/* the first hash of the split */
+  AloeWord check) const	/* the second hash of the split */
+	{
+	const unsigned mask = (unsigned)slots.size() - 1;
+	unsigned k = (unsigned)(key ^ (key >> 32)) & mask;
+	for (;;)
+		{
+		unsigned s = slots[k];
+		if (s == UINT_MAX || (splits[s].key == key && splits[s].check == check))
+			return k;
+		k = (k + 1) & mask;
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of taxa.
+*/
+inline unsigned AloeSplitReader::GetNTaxa() const
+	{
+	return ntax;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of trees.
+*/
+inline unsigned AloeSplitReader::GetNTrees() const
+	{
+	return ntrees;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if every tree is rooted, so that the splits are the groups of the trees.
+*/
+inline bool AloeSplitReader::IsRooted() const
+	{
+	return (rooted && ntrees > 0);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the trees are read as a stream, rather than from the block once it has been read.
+*/
+inline bool AloeSplitReader::IsStreaming() const
+	{
+	return (trees == NULL);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Orders the splits of a tree by their hashes, and splits with the same hashes by group.
+*/
+inline bool AloeSplitReader::IsLess(
+  const AloeTreeSplit &a,	/* the first split */
+  const AloeTreeSplit &b)	/* the second split */
+	{
+	if (a.key != b.key)
+		return (a.key < b.key);
+	if (a.check != b.check)
+		return (a.check < b.check);
+	return (a.group < b.group);
+	}
+
+#endif
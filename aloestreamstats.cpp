@@ -0,0 +1,447 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloestreamstats.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Creates an accumulator that will count the symbol `presenceSymbol' as a presence.
+*/
+AloeStreamStats::AloeStreamStats(
+  char presenceSymbol)	/* the state symbol that codes presence */
+	{
+	presence		= presenceSymbol;
+	nActiveAreas	= 0;
+	nActiveSpecies	= 0;
+	endemics		= 0;
+	kept			= NULL;
+	leftOut			= UINT_MAX;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Deletes and restores areas, and excludes and includes species, until the active areas and species are those of
+|	`block' (the block whose matrix was read). Only the areas and species whose state changes are visited, so applying
+|	an EXSET or deleting an area costs one pass over the columns or rows concerned. Returns false, changing nothing, if
+|	the block does not match the matrix read, or if the rows were not kept and some area or species has to change (an
+|	area left out by LeaveOut and deleted from the block too needs no change).
+*/
+bool AloeStreamStats::ApplyMasks(
+  NxsCharactersBlock &block)	/* the CHARACTERS or DATA block holding the `activeTaxon' and `activeChar' masks */
+	{
+	unsigned nareas = GetNAreas();
+	unsigned nspecies = GetNSpecies();
+	if (block.GetNTax() != nareas || block.GetNChar() != nspecies || (kept != NULL && kept->GetNRows() != nareas))
+		return false;
+
+	if (kept == NULL)
+		{
+		for (unsigned i = 0; i < nareas; i++)
+			{
+			if (block.IsActiveTaxon(i) != IsActiveArea(i))
+				return false;
+			}
+		for (unsigned j = 0; j < nspecies; j++)
+			{
+			if (block.IsActiveChar(j) != IsActiveSpecies(j))
+				return false;
+			}
+		return true;
+		}
+
+	for (unsigned i = 0; i < nareas; i++)
+		{
+		bool active = block.IsActiveTaxon(i);
+		if (active && !IsActiveArea(i))
+			RestoreArea(i);
+		else if (!active && IsActiveArea(i))
+			DeleteArea(i);
+		}
+
+	for (unsigned j = 0; j < nspecies; j++)
+		{
+		bool active = block.IsActiveChar(j);
+		if (active && !IsActiveSpecies(j))
+			IncludeSpecies(j);
+		else if (!active && IsActiveSpecies(j))
+			ExcludeSpecies(j);
+		}
+	return true;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds (if `restoring' is true) or takes away (if `restoring' is false) area `i' from the frequencies of the species
+|	present in it, adjusting the count of endemics as the frequency of an active species passes through 1. Only the set
+|	bits of the kept row are visited.
+*/
+void AloeStreamStats::ChangeFrequencies(
+  unsigned i,		/* the (0-offset) index of the area */
+  bool restoring)	/* true if the area is being restored, false if it is being deleted */
+	{
+	const AloeWord *row = kept->GetRow(i);
+	unsigned nwords = kept->GetNWords();
+	for (unsigned w = 0; w < nwords; w++)
+		{
+		AloeWord active = activeSpecies[w];
+		for (AloeWord bits = row[w]; bits != 0; bits &= bits - 1)
+			{
+			unsigned b = AloeBitMatrix::LowestBit(bits);
+			unsigned &f = frequency[w * AloeBitMatrix::wordBits + b];
+			unsigned before = f;
+			f = (restoring ? f + 1 : f - 1);
+			if (((active >> b) & 1) != 0)
+				{
+				if (before == 1)
+					endemics--;
+				if (f == 1)
+					endemics++;
+				}
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds (if `including' is true) or takes away (if `including' is false) species `j' from the richness of every area
+|	(active or not) in which it is present, adjusting the count of endemics if the species is present in exactly one
+|	active area. This walks down column `j' of the kept rows.
+*/
+void AloeStreamStats::ChangeRichness(
+  unsigned j,		/* the (0-offset) index of the species */
+  bool including)	/* true if the species is being included, false if it is being excluded */
+	{
+	unsigned nareas = GetNAreas();
+	for (unsigned i = 0; i < nareas; i++)
+		{
+		if (kept->Test(i, j))
+			richness[i] = (including ? richness[i] + 1 : richness[i] - 1);
+		}
+
+	if (frequency[j] == 1)
+		endemics = (including ? endemics + 1 : endemics - 1);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Discards all counts.
+*/
+void AloeStreamStats::Clear()
+	{
+	richness.clear();
+	frequency.clear();
+	activeAreas.clear();
+	activeSpecies.clear();
+	nActiveAreas	= 0;
+	nActiveSpecies	= 0;
+	endemics		= 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Leaves area `i' out of the species frequencies and endemics (its own richness is kept, so that it can be restored).
+|	Does nothing if the area has already been deleted. Assumes the rows have been kept and `i' is in the range
+|	[0..GetNAreas()).
+*/
+void AloeStreamStats::DeleteArea(
+  unsigned i)	/* the (0-offset) index of the area */
+	{
+	assert(kept != NULL);
+	if (!IsActiveArea(i))
+		return;
+
+	FlipBit(activeAreas, i);
+	nActiveAreas--;
+	ChangeFrequencies(i, false);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Leaves species `j' out of the richness of the areas and the endemics (its own frequency is kept, so that it can be
+|	included again). Does nothing if the species has already been excluded. Assumes the rows have been kept and `j' is
+|	in the range [0..GetNSpecies()).
+*/
+void AloeStreamStats::ExcludeSpecies(
+  unsigned j)	/* the (0-offset) index of the species */
+	{
+	assert(kept != NULL);
+	if (!IsActiveSpecies(j))
+		return;
+
+	FlipBit(activeSpecies, j);
+	nActiveSpecies--;
+	ChangeRichness(j, false);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Resizes `mask' to hold `nbits' bits and sets all of them. Bits beyond `nbits' in the last word are left clear, so
+|	that the mask can be ANDed with a row of an AloeBitMatrix of `nbits' columns.
+*/
+void AloeStreamStats::FillMask(
+  AloeWordVector &mask,	/* the bit vector to fill */
+  unsigned nbits)		/* the number of bits to set */
+	{
+	unsigned nwords = AloeBitMatrix::WordsFor(nbits);
+	mask.assign(nwords, ~(AloeWord)0);
+	if (nbits % AloeBitMatrix::wordBits != 0)
+		mask[nwords - 1] = ((AloeWord)1 << (nbits % AloeBitMatrix::wordBits)) - 1;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills `areas' with the indices of the active areas, in increasing order.
+*/
+void AloeStreamStats::GetActiveAreas(
+  NxsUnsignedVector &areas) const	/* on return, the (0-offset) index of each active area */
+	{
+	areas.clear();
+	areas.reserve(nActiveAreas);
+	for (unsigned w = 0; w < activeAreas.size(); w++)
+		{
+		for (AloeWord bits = activeAreas[w]; bits != 0; bits &= bits - 1)
+			areas.push_back(w * AloeBitMatrix::wordBits + AloeBitMatrix::LowestBit(bits));
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Computes the weighted endemism of each active area (the sum of 1 / range size over the active species present,
+|	where the range size of a species is the number of active areas in which it is present) in `we', and the corrected
+|	weighted endemism (weighted endemism / number of active species present, or 0 if there are none) in `cwe'. Deleted
+|	areas are given 0 for both. The range sizes are those kept up to date since reading, so the whole computation is a
+|	single pass over the kept rows, each word masked by the active species: each word is either taken apart bit by bit
+|	(sparse words) or multiplied through the 64 weights it covers without branching (dense words). Returns false,
+|	leaving both vectors empty, if the rows were not kept.
+*/
+bool AloeStreamStats::GetWeightedEndemism(
+  AloeDoubleVector &we,			/* on return, the weighted endemism of each area */
+  AloeDoubleVector &cwe) const	/* on return, the corrected weighted endemism of each area */
+	{
+	we.clear();
+	cwe.clear();
+	if (kept == NULL || kept->GetNRows() < richness.size())
+		return false;
+
+	// The weights are padded with zeros to a whole number of words, so the dense loop needs no bounds check
+	//
+	unsigned nwords = kept->GetNWords();
+	AloeDoubleVector weight((size_t)nwords * AloeBitMatrix::wordBits, 0.0);
+	for (unsigned j = 0; j < frequency.size(); j++)
+		{
+		if (frequency[j] > 0 && IsActiveSpecies(j))
+			weight[j] = 1.0 / frequency[j];
+		}
+
+	unsigned nareas = (unsigned)richness.size();
+	we.assign(nareas, 0.0);
+	cwe.assign(nareas, 0.0);
+	for (unsigned i = 0; i < nareas; i++)
+		{
+		if (!IsActiveArea(i))
+			continue;
+
+		const AloeWord *row = kept->GetRow(i);
+		double sum = 0.0;
+		for (unsigned w = 0; w < nwords; w++)
+			{
+			AloeWord bits = row[w] & activeSpecies[w];
+			const double *wt = &weight[(size_t)w * AloeBitMatrix::wordBits];
+			if (AloeBitMatrix::PopCount(bits) > AloeBitMatrix::wordBits / 4)
+				{
+				for (unsigned b = 0; b < AloeBitMatrix::wordBits; b++)
+					sum += wt[b] * (double)((bits >> b) & 1);
+				}
+			else
+				{
+				for (; bits != 0; bits &= bits - 1)
+					sum += wt[AloeBitMatrix::LowestBit(bits)];
+				}
+			}
+		we[i] = sum;
+		if (richness[i] > 0)
+			cwe[i] = sum / richness[i];
+		}
+	return true;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Brings species `j' back into the richness of the areas and the endemics. Does nothing if the species is active.
+|	Assumes the rows have been kept and `j' is in the range [0..GetNSpecies()).
+*/
+void AloeStreamStats::IncludeSpecies(
+  unsigned j)	/* the (0-offset) index of the species */
+	{
+	assert(kept != NULL);
+	if (IsActiveSpecies(j))
+		return;
+
+	FlipBit(activeSpecies, j);
+	nActiveSpecies++;
+	ChangeRichness(j, true);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Brings area `i' back into the species frequencies and endemics. Does nothing if the area is active. Assumes the
+|	rows have been kept and `i' is in the range [0..GetNAreas()).
+*/
+void AloeStreamStats::RestoreArea(
+  unsigned i)	/* the (0-offset) index of the area */
+	{
+	assert(kept != NULL);
+	if (IsActiveArea(i))
+		return;
+
+	FlipBit(activeAreas, i);
+	nActiveAreas++;
+	ChangeFrequencies(i, true);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Called by `block' as soon as the row for taxon (area) `i' has been read. The counts are started afresh, with every
+|	area and species active (but the area given to LeaveOut), when the first row arrives, so the same object can be
+|	used for every matrix read.
+*/
+void AloeStreamStats::RowRead(
+  NxsCharactersBlock &block,	/* the CHARACTERS or DATA block reading the matrix */
+  unsigned i)					/* the (0-offset) index of the taxon just read */
+	{
+	unsigned ntax = block.GetNTax();
+	unsigned nchar = block.GetNChar();
+
+	if (i == 0)
+		{
+		richness.assign(ntax, 0);
+		frequency.assign(nchar, 0);
+		FillMask(activeAreas, ntax);
+		FillMask(activeSpecies, nchar);
+		nActiveAreas	= ntax;
+		nActiveSpecies	= nchar;
+		endemics		= 0;
+		if (kept != NULL)
+			kept->Reset(ntax, nchar);
+		if (leftOut < ntax)
+			{
+			FlipBit(activeAreas, leftOut);
+			nActiveAreas--;
+			}
+		}
+
+	bool active = (i != leftOut);
+	unsigned n = 0;
+	for (unsigned j = 0; j < nchar; j++)
+		{
+		if (block.IsMissingState(i, j) || block.IsGapState(i, j))
+			continue;
+		if (block.GetState(i, j, 0) == presence)
+			{
+			if (active)
+				{
+				unsigned f = ++frequency[j];
+				if (f == 1)
+					endemics++;
+				else if (f == 2)
+					endemics--;
+				}
+			n++;
+			if (kept != NULL)
+				kept->Set(i, j);
+			}
+		}
+	richness[i] = n;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a matrix holding the kept rows of the areas listed in `areas' (in that order), restricted to the active
+|	species, whose indices are placed in `species'. If `areas' lists every area in order and no species is excluded,
+|	the kept matrix itself is returned and nothing is copied; otherwise `m' is filled and returned. Rows are copied a
+|	word at a time when no species is excluded, and bit by bit (visiting only the set bits of the row masked by the
+|	active species) when columns have to be closed up. Assumes the rows have been kept.
+*/
+const AloeBitMatrix &AloeStreamStats::Select(
+  AloeBitMatrix &m,					/* the matrix to fill if a copy is needed */
+  const NxsUnsignedVector &areas,	/* the (0-offset) indices of the areas wanted */
+  NxsUnsignedVector &species) const	/* on return, the (0-offset) index of the species in each column */
+	{
+	assert(kept != NULL);
+	unsigned nareas = (unsigned)areas.size();
+	unsigned nspecies = GetNSpecies();
+
+	species.clear();
+	species.reserve(nActiveSpecies);
+	NxsUnsignedVector column(nspecies, UINT_MAX);
+	for (unsigned j = 0; j < nspecies; j++)
+		{
+		if (IsActiveSpecies(j))
+			{
+			column[j] = (unsigned)species.size();
+			species.push_back(j);
+			}
+		}
+
+	bool allSpecies = (nActiveSpecies == nspecies);
+	bool allAreas = (nareas == kept->GetNRows());
+	for (unsigned r = 0; allAreas && r < nareas; r++)
+		allAreas = (areas[r] == r);
+	if (allAreas && allSpecies)
+		return *kept;
+
+	m.Reset(nareas, nActiveSpecies);
+	unsigned nwords = kept->GetNWords();
+	for (unsigned r = 0; r < nareas; r++)
+		{
+		const AloeWord *from = kept->GetRow(areas[r]);
+		AloeWord *to = m.GetRow(r);
+		if (allSpecies)
+			{
+			for (unsigned w = 0; w < nwords; w++)
+				to[w] = from[w];
+			continue;
+			}
+		for (unsigned w = 0; w < nwords; w++)
+			{
+			for (AloeWord bits = from[w] & activeSpecies[w]; bits != 0; bits &= bits - 1)
+				{
+				unsigned k = column[w * AloeBitMatrix::wordBits + AloeBitMatrix::LowestBit(bits)];
+				to[k / AloeBitMatrix::wordBits] |= (AloeWord)1 << (k % AloeBitMatrix::wordBits);
+				}
+			}
+		}
+	return m;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a matrix holding the kept rows of every area, in order, restricted to the active species as in Select, but
+|	with the rows of the deleted areas left empty rather than left out. This suits areas that are the cells of a grid,
+|	whose positions must not move when some of them are deleted. Assumes the rows have been kept.
+*/
+const AloeBitMatrix &AloeStreamStats::SelectCells(
+  AloeBitMatrix &m,					/* the matrix to fill if a copy is needed */
+  NxsUnsignedVector &species) const	/* on return, the (0-offset) index of the species in each column */
+	{
+	unsigned nareas = GetNAreas();
+	NxsUnsignedVector cells(nareas);
+	for (unsigned i = 0; i < nareas; i++)
+		cells[i] = i;
+	const AloeBitMatrix &s = Select(m, cells, species);
+	if (nActiveAreas == nareas)
+		return s;
+
+	if (&s != &m)
+		m = s;
+	unsigned nwords = m.GetNWords();
+	for (unsigned i = 0; i < nareas; i++)
+		{
+		if (IsActiveArea(i))
+			continue;
+		AloeWord *row = m.GetRow(i);
+		for (unsigned w = 0; w < nwords; w++)
+			row[w] = 0;
+		}
+	return m;
+	}
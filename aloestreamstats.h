@@ -0,0 +1,229 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOESTREAMSTATS_H
+#define ALOE_ALOESTREAMSTATS_H
+
+#include <ncl.h>
+#include "aloebitmatrix.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Accumulates the area and species statistics reported by Aloe while the MATRIX command of a CHARACTERS or DATA block
+|	is being read, so that the taxon-area matrix itself never has to be stored. Attach an object of this class to the
+|	block with NxsCharactersBlock::SetRowListener before executing the data file; only one count per area and one per
+|	species are kept, so memory use grows with `ntax' + `nchar' rather than `ntax' x `nchar'. A species is counted as
+|	present in an area wherever the first state recorded for it is the symbol `presence'; missing data and gaps are
+|	treated as absences. Analyses that need the presences themselves (e.g., area similarity) can ask for them to be kept
+|	in an AloeBitMatrix by calling KeepRows, which costs one bit per cell rather than the bytes per cell of the NCL
+|	matrix. The weighted endemism of the areas is only available when the rows have been kept.
+|	
+|	Every area and species read starts out active, except an area named beforehand by LeaveOut (e.g., an outgroup),
+|	which is deleted as it is read and so needs no kept rows. Once the rows have been kept, areas can be deleted and
+|	restored, and species excluded and included, one at a time (DeleteArea, ExcludeSpecies, etc.) or by copying the
+|	`activeTaxon' and `activeChar' masks of the block (ApplyMasks, e.g., after EXSET * has been applied). The counts
+|	are then brought up to date from the row or column concerned, never by reading the whole matrix again:
+|~
+|	o the frequency of each species counts only the active areas, and is kept for excluded species too
+|	o the richness of each area counts only the active species, and is kept for deleted areas too
+|	o the number of endemics counts only the active species present in exactly one active area
+|~
+*/
+class AloeStreamStats : public NxsMatrixRowListener
+	{
+	public:
+
+							AloeStreamStats(char presenceSymbol = '1');
+
+		bool				ApplyMasks(NxsCharactersBlock &block);
+		void				Clear();
+		void				DeleteArea(unsigned i);
+		void				ExcludeSpecies(unsigned j);
+		void				GetActiveAreas(NxsUnsignedVector &areas) const;
+		unsigned			GetFrequency(unsigned j) const;
+		const NxsUnsignedVector	&GetFrequencies() const;
+		unsigned			GetNAreas() const;
+		unsigned			GetNSpecies() const;
+		unsigned			GetNumActiveAreas() const;
+		unsigned			GetNumActiveSpecies() const;
+		unsigned			GetNumEndemics() const;
+		unsigned			GetRichness(unsigned i) const;
+		bool				GetWeightedEndemism(AloeDoubleVector &we, AloeDoubleVector &cwe) const;
+		void				IncludeSpecies(unsigned j);
+		bool				IsActiveArea(unsigned i) const;
+		bool				IsActiveSpecies(unsigned j) const;
+		void				KeepRows(AloeBitMatrix *m);
+		void				LeaveOut(unsigned i);
+		void				RestoreArea(unsigned i);
+		virtual void		RowRead(NxsCharactersBlock &block, unsigned i);
+		const AloeBitMatrix	&Select(AloeBitMatrix &m, const NxsUnsignedVector &areas, NxsUnsignedVector &species) const;
+		const AloeBitMatrix	&SelectCells(AloeBitMatrix &m, NxsUnsignedVector &species) const;
+
+	private:
+
+		char				presence;		/* the state symbol that codes presence */
+		NxsUnsignedVector	richness;		/* number of active species present in each area */
+		NxsUnsignedVector	frequency;		/* number of active areas in which each species is present */
+		AloeWordVector		activeAreas;	/* bit i set if area i is active (not deleted) */
+		AloeWordVector		activeSpecies;	/* bit j set if species j is active (not excluded) */
+		unsigned			nActiveAreas;	/* number of bits set in `activeAreas' */
+		unsigned			nActiveSpecies;	/* number of bits set in `activeSpecies' */
+		unsigned			endemics;		/* number of active species present in exactly one active area */
+		AloeBitMatrix		*kept;			/* matrix receiving the presences of every area, or NULL */
+		unsigned			leftOut;		/* area deleted as it is read, or UINT_MAX for none */
+
+		void				ChangeFrequencies(unsigned i, bool restoring);
+		void				ChangeRichness(unsigned j, bool including);
+
+		static void			FillMask(AloeWordVector &mask, unsigned nbits);
+		static void			FlipBit(AloeWordVector &mask, unsigned k);
+		static bool			TestBit(const AloeWordVector &mask, unsigned k);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Changes bit `k' of `mask'.
+*/
+inline void AloeStreamStats::FlipBit(
+  AloeWordVector &mask,	/* the bit vector */
+  unsigned k)			/* the (0-offset) index of the bit */
+	{
+	assert(k / AloeBitMatrix::wordBits < mask.size());
+	mask[k / AloeBitMatrix::wordBits] ^= (AloeWord)1 << (k % AloeBitMatrix::wordBits);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of active areas in which species `j' is present. Assumes `j' is in the range [0..GetNSpecies()).
+*/
+inline unsigned AloeStreamStats::GetFrequency(
+  unsigned j) const	/* the (0-offset) index of the species */
+	{
+	assert(j < frequency.size());
+	return frequency[j];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of active areas in which each species is present.
+*/
+inline const NxsUnsignedVector &AloeStreamStats::GetFrequencies() const
+	{
+	return frequency;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of areas (taxa) in the matrix read, whether active or not.
+*/
+inline unsigned AloeStreamStats::GetNAreas() const
+	{
+	return (unsigned)richness.size();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of areas that have not been deleted.
+*/
+inline unsigned AloeStreamStats::GetNumActiveAreas() const
+	{
+	return nActiveAreas;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of species that have not been excluded.
+*/
+inline unsigned AloeStreamStats::GetNumActiveSpecies() const
+	{
+	return nActiveSpecies;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of active species present in exactly one active area.
+*/
+inline unsigned AloeStreamStats::GetNumEndemics() const
+	{
+	return endemics;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of species (characters) in the matrix read.
+*/
+inline unsigned AloeStreamStats::GetNSpecies() const
+	{
+	return (unsigned)frequency.size();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of active species present in area `i' (whether or not the area itself is active). Assumes `i' is in the range [0..GetNAreas()).
+*/
+inline unsigned AloeStreamStats::GetRichness(
+  unsigned i) const	/* the (0-offset) index of the area */
+	{
+	assert(i < richness.size());
+	return richness[i];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if area `i' has not been deleted. Assumes `i' is in the range [0..GetNAreas()).
+*/
+inline bool AloeStreamStats::IsActiveArea(
+  unsigned i) const	/* the (0-offset) index of the area */
+	{
+	assert(i < richness.size());
+	return TestBit(activeAreas, i);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if species `j' has not been excluded. Assumes `j' is in the range [0..GetNSpecies()).
+*/
+inline bool AloeStreamStats::IsActiveSpecies(
+  unsigned j) const	/* the (0-offset) index of the species */
+	{
+	assert(j < frequency.size());
+	return TestBit(activeSpecies, j);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Asks for the presences in every area to be stored in `m' (one row per area, one column per species) as the matrix
+|	is read. Areas can only be deleted and species excluded once the rows have been kept. Specify NULL to stop storing
+|	them. The matrix must outlive the reading of the data file and any later changes to the active areas and species.
+*/
+inline void AloeStreamStats::KeepRows(
+  AloeBitMatrix *m)	/* the matrix to fill, or NULL */
+	{
+	kept = m;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Asks for area `i' to be deleted as the matrix is read: its richness is counted, and its row kept if rows are being
+|	kept, but it adds nothing to the frequencies of the species or to the endemics. This is how an outgroup is left out
+|	without keeping the rows. An index beyond the last area read is ignored. Specify UINT_MAX to leave out no area.
+*/
+inline void AloeStreamStats::LeaveOut(
+  unsigned i)	/* the (0-offset) index of the area */
+	{
+	leftOut = i;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if bit `k' of `mask' is set.
+*/
+inline bool AloeStreamStats::TestBit(
+  const AloeWordVector &mask,	/* the bit vector */
+  unsigned k)					/* the (0-offset) index of the bit */
+	{
+	assert(k / AloeBitMatrix::wordBits < mask.size());
+	return ((mask[k / AloeBitMatrix::wordBits] >> (k % AloeBitMatrix::wordBits)) & 1) != 0;
+	}
+
+#endif
@@ -0,0 +1,172 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "aloethreadpool.h"
+
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#	include <unistd.h>
+#endif
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Creates a pool of `nthreads' threads, or one thread per processor core if `nthreads' is 0. No thread is started
+|	until Run is called.
+*/
+AloeThreadPool::AloeThreadPool(
+  unsigned n)	/* number of threads to use (0 means one per core) */
+	{
+	nthreads	= (n > 0 ? n : GetNumCores());
+	nextQueue	= 0;
+	queues		= new AloeWorkQueue[nthreads];
+	for (unsigned k = 0; k < nthreads; k++)
+		pthread_mutex_init(&queues[k].lock, NULL);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Releases the queues. Tasks that were added but never run are not deleted.
+*/
+AloeThreadPool::~AloeThreadPool()
+	{
+	for (unsigned k = 0; k < nthreads; k++)
+		pthread_mutex_destroy(&queues[k].lock);
+	delete [] queues;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds `task' to the queue of the next thread in turn. Must not be called while Run is in progress.
+*/
+void AloeThreadPool::Add(
+  AloeTask *task)	/* the task to be run */
+	{
+	assert(task != NULL);
+	queues[nextQueue].tasks.push_back(task);
+	nextQueue = (nextQueue + 1) % nthreads;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of processor cores available, or 1 if this cannot be determined.
+*/
+unsigned AloeThreadPool::GetNumCores()
+	{
+	long n = 1;
+#	if defined(_SC_NPROCESSORS_ONLN)
+		n = sysconf(_SC_NPROCESSORS_ONLN);
+#	endif
+	return (n > 0 ? (unsigned)n : 1);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of bytes of physical memory, or 0 if this cannot be determined.
+*/
+double AloeThreadPool::GetPhysicalMemory()
+	{
+	double bytes = 0.0;
+#	if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+		long pages = sysconf(_SC_PHYS_PAGES);
+		long size = sysconf(_SC_PAGESIZE);
+		if (pages > 0 && size > 0)
+			bytes = (double)pages * size;
+#	endif
+	return bytes;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the next task for thread `id': the most recently added task in its own queue or, if that is empty, the
+|	oldest task in the first non-empty queue of another thread. Returns NULL when every queue is empty.
+*/
+AloeTask *AloeThreadPool::NextTask(
+  unsigned id)	/* index of the thread asking for work */
+	{
+	AloeTask *task = NULL;
+
+	AloeWorkQueue &own = queues[id];
+	pthread_mutex_lock(&own.lock);
+	if (!own.tasks.empty())
+		{
+		task = own.tasks.back();
+		own.tasks.pop_back();
+		}
+	pthread_mutex_unlock(&own.lock);
+
+	for (unsigned k = 1; task == NULL && k < nthreads; k++)
+		{
+		AloeWorkQueue &victim = queues[(id + k) % nthreads];
+		pthread_mutex_lock(&victim.lock);
+		if (!victim.tasks.empty())
+			{
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			}
+		pthread_mutex_unlock(&victim.lock);
+		}
+
+	return task;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs every task added since the last call, using `nthreads' threads (the calling thread and `nthreads' - 1 new 
+|	ones), and returns once all of them have finished. If a thread cannot be created, the remaining threads simply do
+|	its share of the work.
+*/
+void AloeThreadPool::Run()
+	{
+	vector<AloeWorker> workers(nthreads);
+	vector<pthread_t> threads(nthreads);
+	vector<bool> started(nthreads, false);
+
+	for (unsigned k = 0; k < nthreads; k++)
+		{
+		workers[k].pool	= this;
+		workers[k].id	= k;
+		}
+
+	for (unsigned k = 1; k < nthreads; k++)
+		started[k] = (pthread_create(&threads[k], NULL, WorkerMain, &workers[k]) == 0);
+
+	Work(0);
+
+	for (unsigned k = 1; k < nthreads; k++)
+		{
+		if (started[k])
+			pthread_join(threads[k], NULL);
+		}
+
+	nextQueue = 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs tasks on behalf of thread `id' until there are none left. No tasks are added once Run has started, so a 
+|	thread that finds every queue empty has nothing more to do.
+*/
+void AloeThreadPool::Work(
+  unsigned id)	/* index of the thread's own queue */
+	{
+	AloeTask *task;
+	while ((task = NextTask(id)) != NULL)
+		task->Run();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Entry point of the threads started by Run. The argument `arg' points to the thread's AloeWorker.
+*/
+void *AloeThreadPool::WorkerMain(
+  void *arg)	/* pointer to an AloeWorker */
+	{
+	AloeWorker *w = (AloeWorker *)arg;
+	w->pool->Work(w->id);
+	return NULL;
+	}
@@ -0,0 +1,103 @@
+//	Copyright (C) 2006-2024 Mauro J. Cavalcanti
+//
+//	This file is part of ALOE (AnaLysis Of Endemicity).
+//
+//	ALOE is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	ALOE is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with ALOE. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ALOE_ALOETHREADPOOL_H
+#define ALOE_ALOETHREADPOOL_H
+
+#include <deque>
+#include <pthread.h>
+#include <ncl.h>
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Abstract base class for a unit of work to be done by an AloeThreadPool. Derived classes override Run, which is
+|	called exactly once, on one of the pool's threads. Run must not throw: tasks report their own failures.
+*/
+class AloeTask
+	{
+	public:
+
+		virtual			~AloeTask() {}
+
+		virtual void	Run() = 0;
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Runs a set of independent tasks on a fixed number of threads (POSIX threads). Each thread has its own queue of
+|	tasks, to which Add deals the tasks in turn. A thread takes tasks from the back of its own queue and, once that is
+|	empty, steals from the front of the other threads' queues, so that a few long jobs do not leave the other threads
+|	idle. The calling thread does its share of the work, and Run returns when every task has been done:
+|>
+|	AloeThreadPool pool(4);
+|	for (unsigned k = 0; k < jobs.size(); k++)
+|		pool.Add(jobs[k]);
+|	pool.Run();
+|>
+|	The pool does not own the tasks, which must outlive the call to Run.
+*/
+class AloeThreadPool
+	{
+	public:
+
+							AloeThreadPool(unsigned n = 0);
+							~AloeThreadPool();
+
+		void				Add(AloeTask *task);
+		unsigned			GetNThreads() const;
+		void				Run();
+
+		static unsigned		GetNumCores();
+		static double		GetPhysicalMemory();
+
+	private:
+
+		typedef deque<AloeTask *>	AloeTaskDeque;
+
+		struct AloeWorkQueue	/* the tasks waiting to be run by one thread */
+			{
+			pthread_mutex_t	lock;	/* protects `tasks' */
+			AloeTaskDeque	tasks;	/* tasks not yet started */
+			};
+
+		struct AloeWorker	/* what a thread needs to know to start work */
+			{
+			AloeThreadPool	*pool;	/* the pool to which the thread belongs */
+			unsigned		id;		/* index of the thread's own queue in `queues' */
+			};
+
+		unsigned			nthreads;	/* number of threads, including the one calling Run */
+		unsigned			nextQueue;	/* queue to which Add will give the next task */
+		AloeWorkQueue		*queues;	/* one queue for each thread */
+
+		AloeTask			*NextTask(unsigned id);
+		void				Work(unsigned id);
+
+		static void			*WorkerMain(void *arg);
+
+							AloeThreadPool(const AloeThreadPool &);		/* not implemented */
+		AloeThreadPool		&operator=(const AloeThreadPool &);			/* not implemented */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of threads used by Run.
+*/
+inline unsigned AloeThreadPool::GetNThreads() const
+	{
+	return nthreads;
+	}
+
+#endif
@@ -87,6 +87,10 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=..\..\src\nxsarena.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\nxsassumptionsblock.cpp
 # End Source File
 # Begin Source File
@@ -123,6 +127,14 @@ SOURCE=..\..\src\nxsexception.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\nxsinputsource.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\nxslabelindex.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\nxsreader.cpp
 # End Source File
 # Begin Source File
@@ -143,6 +155,10 @@ SOURCE=..\..\src\nxstoken.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\nxstree.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\nxstreesblock.cpp
 # End Source File
 # End Group
@@ -155,6 +171,10 @@ SOURCE=..\..\src\ncl.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\nxsarena.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\nxsassumptionsblock.h
 # End Source File
 # Begin Source File
@@ -195,6 +215,18 @@ SOURCE=..\..\src\nxsexception.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\nxsinputsource.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\nxslabelindex.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\nxsmatrixrowlistener.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\nxsindent.h
 # End Source File
 # Begin Source File
@@ -219,6 +251,14 @@ SOURCE=..\..\src\nxstoken.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\nxstree.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\nxstreelistener.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\nxstreesblock.h
 # End Source File
 # End Group
@@ -36,6 +36,7 @@
 #	include <cstdlib>
 #	include <ctime>
 #	include <cfloat>
+#	include <climits>
 #else
 #	include <assert.h>
 #	include <ctype.h>
@@ -46,6 +47,7 @@
 #	include <stdlib.h>
 #	include <time.h>
 #	include <float.h>
+#	include <limits.h>
 #endif
 
 #include <algorithm>
@@ -54,6 +56,7 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <new>
 #include <set>
 #include <stdexcept>
 #include <string>
@@ -88,18 +91,24 @@ using namespace std;
 #endif
 
 #include "nxsdefs.h"
+#include "nxsarena.h"
 #include "nxsstring.h"
+#include "nxslabelindex.h"
 #include "nxsexception.h"
+#include "nxsinputsource.h"
 #include "nxstoken.h"
 #include "nxsblock.h"
 #include "nxsreader.h"
 #include "nxssetreader.h"
 #include "nxstaxablock.h"
+#include "nxstree.h"
+#include "nxstreelistener.h"
 #include "nxstreesblock.h"
 #include "nxsdistancedatum.h"
 #include "nxsdistancesblock.h"
 #include "nxsdiscretedatum.h"
 #include "nxsdiscretematrix.h"
+#include "nxsmatrixrowlistener.h"
 #include "nxscharactersblock.h"
 #include "nxsassumptionsblock.h"
 #include "nxsdatablock.h"
@@ -0,0 +1,69 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#include "ncl.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes an empty arena. No memory is obtained from the heap until the first call to Allocate.
+*/
+NxsArena::NxsArena(
+  size_t bytesPerChunk)	/* the size of each chunk obtained from the heap */
+	{
+	chunkSize	= RoundUp(bytesPerChunk);
+	reserved	= 0;
+	next		= NULL;
+	end			= NULL;
+	freeLists.assign(maxSmallBlock / alignment + 1, (void *)NULL);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns all memory held by the arena to the heap.
+*/
+NxsArena::~NxsArena()
+	{
+	Release();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Obtains a chunk of `nbytes' from the heap and records it so that it can be freed by Release.
+*/
+char *NxsArena::NewChunk(
+  size_t nbytes)	/* the size of the chunk */
+	{
+	char *c = new char[nbytes];
+	chunks.push_back(c);
+	reserved += nbytes;
+	return c;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns every chunk to the heap, invalidating all pointers obtained from Allocate. The cost depends only on the
+|	number of chunks, not on the number of allocations made. The arena may be used again afterwards.
+*/
+void NxsArena::Release()
+	{
+	for (NxsChunkVector::iterator c = chunks.begin(); c != chunks.end(); c++)
+		delete [] *c;
+	chunks.clear();
+	freeLists.assign(freeLists.size(), (void *)NULL);
+
+	reserved	= 0;
+	next		= NULL;
+	end			= NULL;
+	}
@@ -0,0 +1,143 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#ifndef NCL_NXSARENA_H
+#define NCL_NXSARENA_H
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Region allocator for the many small, short-lived arrays created while a block is being read. Memory is carved
+|	sequentially out of large chunks obtained from operator new, so that allocating a few bytes costs a pointer bump
+|	rather than a call to the general-purpose heap. Blocks returned by Free are kept on per-size free lists and reused
+|	by later requests of the same size. Nothing is returned to the heap until Release is called (or the arena is
+|	destroyed), at which point every chunk is freed at once, without visiting the individual allocations. Objects
+|	placed in an arena therefore must not rely on their destructors being called. Each arena is owned by a single
+|	object (e.g., one NxsDiscreteMatrix), so no locking is done and separate threads reading separate blocks never
+|	contend for the same heap.
+*/
+class NxsArena
+	{
+	public:
+
+		enum
+			{
+			alignment		= (sizeof(double) > sizeof(void *) ? sizeof(double) : sizeof(void *)),	/* every block is a multiple of this many bytes */
+			maxSmallBlock	= 256	/* larger requests are not recycled through the free lists */
+			};
+
+						NxsArena(size_t bytesPerChunk = 65536);
+						~NxsArena();
+
+		void			*Allocate(size_t nbytes);
+		void			Free(void *p, size_t nbytes);
+		size_t			GetBytesReserved();
+		void			Release();
+
+	private:
+
+		typedef vector<char *>	NxsChunkVector;
+		typedef vector<void *>	NxsFreeListVector;
+
+		size_t				chunkSize;	/* number of bytes in each standard chunk */
+		size_t				reserved;	/* total number of bytes obtained from the heap */
+		char				*next;		/* next free byte in the current chunk */
+		char				*end;		/* one past the last byte of the current chunk */
+		NxsChunkVector		chunks;		/* every chunk obtained from the heap (released by Release) */
+		NxsFreeListVector	freeLists;	/* heads of the free lists, one for each multiple of `alignment' up to `maxSmallBlock' */
+
+		char			*NewChunk(size_t nbytes);
+		size_t			RoundUp(size_t nbytes);
+
+						NxsArena(const NxsArena &);				/* not implemented: arenas cannot be copied */
+		NxsArena		&operator=(const NxsArena &);			/* not implemented: arenas cannot be copied */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns `nbytes' rounded up to the next multiple of `alignment' (and never less than `alignment', so that a freed
+|	block is always big enough to hold the free list link).
+*/
+inline size_t NxsArena::RoundUp(
+  size_t nbytes)	/* the number of bytes requested */
+	{
+	if (nbytes == 0)
+		nbytes = 1;
+	return (nbytes + alignment - 1) / alignment * alignment;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a pointer to `nbytes' of uninitialized memory aligned suitably for any built-in type. The memory remains
+|	valid until it is passed to Free or until Release is called.
+*/
+inline void *NxsArena::Allocate(
+  size_t nbytes)	/* the number of bytes needed */
+	{
+	nbytes = RoundUp(nbytes);
+
+	if (nbytes <= maxSmallBlock)
+		{
+		void *&head = freeLists[nbytes / alignment];
+		if (head != NULL)
+			{
+			void *p = head;
+			head = *(void **)p;
+			return p;
+			}
+		}
+
+	if (nbytes > (size_t)(end - next))
+		{
+		if (nbytes > chunkSize / 4)
+			return NewChunk(nbytes);	// big requests get a chunk of their own, leaving the current chunk usable
+		next = NewChunk(chunkSize);
+		end = next + chunkSize;
+		}
+
+	void *p = next;
+	next += nbytes;
+	return p;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a block previously obtained from Allocate, making it available for reuse. The value of `nbytes' must be the
+|	same as that used to allocate the block. Blocks larger than `maxSmallBlock' are simply abandoned until Release.
+*/
+inline void NxsArena::Free(
+  void *p,			/* the block to be returned (may be NULL) */
+  size_t nbytes)	/* the number of bytes requested when the block was allocated */
+	{
+	if (p == NULL)
+		return;
+
+	nbytes = RoundUp(nbytes);
+	if (nbytes > maxSmallBlock)
+		return;
+
+	void *&head = freeLists[nbytes / alignment];
+	*(void **)p = head;
+	head = p;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the total number of bytes currently obtained from the heap by this arena.
+*/
+inline size_t NxsArena::GetBytesReserved()
+	{
+	return reserved;
+	}
+
+#endif
@@ -47,6 +47,9 @@ NxsCharactersBlock::NxsCharactersBlock(
 	activeTaxon			= NULL;
 	activeChar			= NULL;
 	symbols				= NULL;
+	matrixStorage		= NxsDiscreteMatrix::datumStorage;
+	rowListener			= NULL;
+	discardingRows		= false;
 
 	Reset();
 	}
@@ -223,15 +226,8 @@ void NxsCharactersBlock::BuildCharPosArray(
 unsigned NxsCharactersBlock::CharLabelToNumber(
   NxsString s)	/* the character label to convert */
 	{
-	NxsStringVector::const_iterator iter = find(charLabels.begin(), charLabels.end(), s);
-
-	unsigned k = 1;
-	if (iter != charLabels.end())
-		k += (iter - charLabels.begin());
-	else
-		k = 0;
-
-	return k;
+	unsigned k = charLabelIndex.Find(charLabels, s);
+	return (k == UINT_MAX ? 0 : k + 1);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -294,6 +290,8 @@ void NxsCharactersBlock::Consume(
 	delete matrix;
 	matrix				= other.matrix;
 	other.matrix		= NULL;
+	rowsDiscarded		= other.rowsDiscarded;
+	other.rowsDiscarded	= false;
 
 	equates.clear();
 	int size = other.equates.size();
@@ -335,6 +333,10 @@ void NxsCharactersBlock::Consume(
 		other.charStates.clear();
 		}
 
+	charLabelIndex.Rebuild(charLabels);
+	stateIndex.clear();
+	other.stateIndex.clear();
+
 	isEmpty = false;
 	isUserSupplied = other.isUserSupplied;
 	other.Reset();
@@ -353,6 +355,14 @@ void NxsCharactersBlock::DebugShowMatrix(
 	assert(charPos != NULL);
 	assert(taxonPos != NULL);
 
+	if (rowsDiscarded)
+		{
+		if (marginText != NULL)
+			out << marginText;
+		out << "(not stored: rows were discarded after being read)" << endl;
+		return;
+		}
+
 	unsigned i, k;
 	unsigned width = taxa->GetMaxTaxonLabelLength();
 	unsigned first_taxon = UINT_MAX;
@@ -553,6 +563,8 @@ void NxsCharactersBlock::HandleCharlabels(
 	{
 	unsigned num_labels_read = 0;
 	charLabels.clear();
+	charLabelIndex.Clear();
+	charLabels.reserve(ncharTotal);
 
 	if (charPos == NULL)
 		BuildCharPosArray();
@@ -583,7 +595,10 @@ void NxsCharactersBlock::HandleCharlabels(
 				}
 
 			if (!IsEliminated(num_labels_read - 1))
+				{
 				charLabels.push_back(token.GetToken());
+				charLabelIndex.Add(charLabels, (unsigned)charLabels.size() - 1);
+				}
 			}
 		}
 
@@ -606,7 +621,10 @@ void NxsCharactersBlock::HandleCharstatelabels(
 	bool save = true;
 
 	charStates.clear();
+	stateIndex.clear();
 	charLabels.clear();
+	charLabelIndex.Clear();
+	charLabels.reserve(ncharTotal);
 
 	if (charPos == NULL)
 		BuildCharPosArray();
@@ -645,7 +663,10 @@ void NxsCharactersBlock::HandleCharstatelabels(
 			{
 			currChar++;
 			if (!IsEliminated(currChar - 1))
+				{
 				charLabels.push_back(" ");
+				charLabelIndex.Add(charLabels, (unsigned)charLabels.size() - 1);
+				}
 			}
 
 		// If n refers to a character that has been eliminated, go through the motions of
@@ -661,7 +682,10 @@ void NxsCharactersBlock::HandleCharstatelabels(
 		// Token should be the character label
 		//
 		if (save) 
+			{
 			charLabels.push_back(token.GetToken());
+			charLabelIndex.Add(charLabels, (unsigned)charLabels.size() - 1);
+			}
 
 		token.GetNextToken();
 
@@ -897,6 +921,7 @@ void NxsCharactersBlock::HandleEndblock(
 			nm += (k+1);
 			charLabels.push_back(nm.c_str());
 			}
+		charLabelIndex.Rebuild(charLabels);
 		}
 	}
 
@@ -974,6 +999,7 @@ void NxsCharactersBlock::HandleFormat(
 				}
 			standardDataTypeAssumed = true;
 			respectingCase = true;
+			stateIndex.clear();
 			}
 
 		else if (token.Equals("MISSING"))
@@ -1434,8 +1460,9 @@ bool NxsCharactersBlock::HandleNextState(
   unsigned i,		/* the taxon index, in range [0..`ntax') */
   unsigned j)		/* the character index, in range [0..`nchar') */
 	{
-	// This should be the state for taxon i and character j
+	// This should be the state for taxon i and character j, which is stored in row r of the matrix
 	//
+	unsigned r = MatrixRow(i);
 	if (!tokens)
 		{
 		token.SetLabileFlagBit(NxsToken::parentheticalToken);
@@ -1446,7 +1473,48 @@ bool NxsCharactersBlock::HandleNextState(
 	if (interleaving)
 		token.SetLabileFlagBit(NxsToken::newlineIsToken);
 
-	token.GetNextToken();
+	if (tokens)
+		token.GetNextToken();
+	else
+		{
+		// Single-symbol states (by far the most common case) are decoded directly from the input using the table
+		// built by BuildSymbolTable. Anything else (state sets, equates, invalid symbols) leaves a token behind to be 
+		// dealt with by the code below.
+		//
+		char ch = token.GetNextSymbol();
+		if (ch != '\0')
+			{
+			if (j == UINT_MAX)
+				return true;
+
+			int p = symbolCode[(unsigned char)ch];
+			if (p >= 0)
+				{
+				matrix->AddState(r, j, p);
+				matrix->SetPolymorphic(r, j, 0);
+				return true;
+				}
+			else if (p == symbolMissing)
+				{
+				matrix->SetMissing(r, j);
+				return true;
+				}
+			else if (p == symbolGap)
+				{
+				matrix->SetGap(r, j);
+				return true;
+				}
+			else if (p == symbolMatchchar)
+				{
+				matrix->CopyStatesFromFirstTaxon(r, j);
+				return true;
+				}
+
+			NxsString t;
+			t += ch;
+			token.ReplaceToken(t);
+			}
+		}
 
 	if (interleaving && token.AtEOL())
 		return false;
@@ -1464,46 +1532,46 @@ bool NxsCharactersBlock::HandleNextState(
 	assert(token.GetTokenLength() > 0);
 
 	// We've read in the state now, so if this character has been eliminated, we don't want to go any further with it
+	// (eliminated characters have j equal to UINT_MAX; see HandleStdMatrix)
 	//
-	if (j < 0)
+	if (j == UINT_MAX)
 		return true;
 
-	// See if any equate macros apply
+	// See if any equate macros apply (equates should always respect case). The token is examined in place rather
+	// than copied, since this is done for every cell of the matrix.
 	//
-	NxsString skey = NxsString(token.GetToken(true)); // equates should always respect case
-
-	NxsStringMap::iterator p = equates.find(skey);
-	if (p != equates.end())
+	if (!equates.empty())
 		{
-		NxsString sval = (*p).second;
-		token.ReplaceToken(sval.c_str());
+		NxsStringMap::iterator p = equates.find(token.GetTokenReference());
+		if (p != equates.end())
+			token.ReplaceToken((*p).second);
 		}
 
 	// Handle case of single-character state symbol
 	//
 	if (!tokens && token.GetTokenLength() == 1)
 		{
-		char ch = token.GetToken()[0];
+		char ch = token.GetTokenReference()[0];
 
 		// Check for missing data symbol
 		//
 		if (ch == missing)
 			{
-			matrix->SetMissing(i, j);
+			matrix->SetMissing(r, j);
 			}
 
 		// Check for matchchar symbol
 		//
 		else if (matchchar != '\0' && ch == matchchar)
 			{
-			matrix->CopyStatesFromFirstTaxon(i, j);
+			matrix->CopyStatesFromFirstTaxon(r, j);
 			}
 
 		// Check for gap symbol
 		//
 		else if (gap != '\0' && ch == gap)
 			{
-			matrix->SetGap(i, j);
+			matrix->SetGap(r, j);
 			}
 
 		// Look up the position of this state in the symbols array
@@ -1522,8 +1590,8 @@ bool NxsCharactersBlock::HandleNextState(
 				errormsg += ", not found in list of valid symbols";
 				throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 				}
-			matrix->AddState(i, j, p);
-			matrix->SetPolymorphic(i, j, 0);
+			matrix->AddState(r, j, p);
+			matrix->SetPolymorphic(r, j, 0);
 			}
 		}	// if (!tokens && token.GetTokenLength() == 1)
 
@@ -1597,7 +1665,7 @@ bool NxsCharactersBlock::HandleNextState(
 							errormsg += ", not found in list of valid symbols";
 							throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 							}
-						matrix->AddState(i, j, p);
+						matrix->AddState(r, j, p);
 						pFirst++;
 						}
 
@@ -1618,7 +1686,7 @@ bool NxsCharactersBlock::HandleNextState(
 						throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 						}
 					pFirst = (symbols + p);
-					matrix->AddState(i, j, p);
+					matrix->AddState(r, j, p);
 					}
 
 				} // if (t[k] == '~') ... else ... loop
@@ -1626,7 +1694,7 @@ bool NxsCharactersBlock::HandleNextState(
 			k++;
 			} // for (;;) loop
 
-		matrix->SetPolymorphic(i, j, poly);
+		matrix->SetPolymorphic(r, j, poly);
 		}	// if (!tokens && token.GetTokenLength() == 1) ... else if (!tokens && token.GetTokenLength() > 1)
 
 	// Handle case in which TOKENS was specified in the FORMAT command
@@ -1641,7 +1709,7 @@ bool NxsCharactersBlock::HandleNextState(
 		if (!uncertainty && !polymorphism)
 			{
 			int k = HandleTokenState(token, j);
-			matrix->AddState(i, j, k);
+			matrix->AddState(r, j, k);
 			}
 
 		else	// either uncertainty or polymorphism
@@ -1702,7 +1770,7 @@ bool NxsCharactersBlock::HandleNextState(
 						}
 
 					for (int k = first+1; k <= last; k++)
-						matrix->AddState(i, j, k);
+						matrix->AddState(r, j, k);
 
 					tildeFound = false;
 					first = UINT_MAX;
@@ -1715,12 +1783,12 @@ bool NxsCharactersBlock::HandleNextState(
 					// for that character
 					//
 					first = HandleTokenState(token, j);
-					matrix->AddState(i, j, first);
+					matrix->AddState(r, j, first);
 					}
 				}	// if (!uncertainty && !polymorphism) ... else 
 
 			if (polymorphism)
-				matrix->SetPolymorphic(i, j, 1);
+				matrix->SetPolymorphic(r, j, 1);
 			}	// if (!uncertainty && !polymorphism) ... else
 
 		}	// if (!tokens && token.GetTokenLength() == 1) ... else if (!tokens && token.GetTokenLength() > 1) ... else 
@@ -1740,31 +1808,24 @@ unsigned NxsCharactersBlock::HandleTokenState(
 	{
 	// Token should be one of the character states listed for character j in charStates
 	//
-	if (charStates.find(j) == charStates.end())
+	if (stateIndex.size() != nchar)
+		BuildStateIndex();
+
+	const NxsStateIndex &si = stateIndex[j];
+	if (si.labels == NULL)
 		{
 		errormsg = "No states were defined for character ";
 		errormsg += (1 + GetOrigCharIndex(j));
 		throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 		}
 
-	// TO DO: this section is very UGLY - need to find some cleaner way of comparing
-	// the token NxsString to the strings representing valid characters states
-	// in the NxsStringVector associated with character j
+	// The index compares labels ignoring case unless RESPECTCASE was specified
 	//
-	NxsStringVectorMap::const_iterator bagIter	= charStates.find(j);
-	NxsStringVector::const_iterator ci_begin	= (*bagIter).second.begin();
-	NxsStringVector::const_iterator ci_end		= (*bagIter).second.end();
-	NxsString t									= token.GetToken(respectingCase);
-	NxsStringVector::const_iterator cit;
-	if (respectingCase)
-		cit = find(ci_begin, ci_end, t);
-	else
-		cit = find_if (ci_begin, ci_end, bind2nd(NxsStringEqual(), t));
-
-	if (cit == ci_end)
+	unsigned k = si.index.Find(*si.labels, token.GetTokenReference());
+	if (k == UINT_MAX)
 		{
 		errormsg = "Character state ";
-		errormsg += t;
+		errormsg += token.GetToken(respectingCase);
 		errormsg += " not defined for character ";
 		errormsg += (1 + GetOrigCharIndex(j));
 		throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
@@ -1775,7 +1836,6 @@ unsigned NxsCharactersBlock::HandleTokenState(
 	// state saved in matrix would be 0 (it would be 1 if "medium" were specified in the data file, 
 	// and 2 if "large" were specified in the data file).
 	//
-	unsigned k = (cit - ci_begin);
 	return k;
 	}
 
@@ -1955,6 +2015,17 @@ void NxsCharactersBlock::HandleStdMatrix(
 					}
 				} // for (currChar = firstChar; currChar < lastChar; currChar++)
 
+			// The row for taxon i is complete unless the matrix is interleaved. Once the row listener has seen it, 
+			// the row can be cleared ready for the next taxon if rows are being discarded (the first row is kept,
+			// since it is needed for MATCHCHAR).
+			//
+			if (rowListener != NULL && !interleaving)
+				{
+				rowListener->RowRead(*this, i);
+				if (rowsDiscarded && i > 0)
+					matrix->ClearRow(MatrixRow(i));
+				}
+
 			} // for (i = 0; i < ntax; i++)
 
 		firstChar = nextFirst;
@@ -2013,11 +2084,7 @@ void NxsCharactersBlock::HandleTransposedMatrix(
 					{
 					// Check for duplicate character names
 					//
-					NxsString s = token.GetToken();
-					NxsStringVector::const_iterator iter = find(charLabels.begin(), charLabels.end(), s);
-
-					bool charLabelFound = (iter != charLabels.end());
-					if (charLabelFound)
+					if (charLabelIndex.Find(charLabels, token.GetTokenReference()) != UINT_MAX)
 						{
 						errormsg = "Data for this character (";
 						errormsg += token.GetToken();
@@ -2036,14 +2103,13 @@ void NxsCharactersBlock::HandleTransposedMatrix(
 					// so that it is possible to detect characters out of order or duplicated.
 					//
 					charLabels.push_back(token.GetToken());
+					charLabelIndex.Add(charLabels, (unsigned)charLabels.size() - 1);
 					}	// if (page == 0 && newchar)
 
 				else // either not first interleaved page or character labels not previously defined
 					{
-					NxsString s = token.GetToken();
-					NxsStringVector::const_iterator iter = find(charLabels.begin(), charLabels.end(), s);
-
-					if (iter == charLabels.end())
+					unsigned positionInCharLabelsList = charLabelIndex.Find(charLabels, token.GetTokenReference());
+					if (positionInCharLabelsList == UINT_MAX)
 						{
 						errormsg = "Could not find character named ";
 						errormsg += token.GetToken();
@@ -2051,8 +2117,6 @@ void NxsCharactersBlock::HandleTransposedMatrix(
 						throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 						}
 
-					unsigned positionInCharLabelsList = (iter - charLabels.begin());
-
 					// Make sure user has not duplicated data for a single character or changed the order 
 					// in which characters appear in different interleave pages
 					//
@@ -2163,9 +2227,14 @@ void NxsCharactersBlock::HandleMatrix(
 		throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 		}
 
+	// A row listener that allows rows to be discarded needs only the first row (for MATCHCHAR) and the row being read,
+	// but rows of interleaved or transposed matrices are not complete until the whole matrix has been read
+	//
+	rowsDiscarded = (rowListener != NULL && discardingRows && !interleaving && !transposing);
+
 	if (matrix != NULL)
 		delete matrix;
-	matrix = new NxsDiscreteMatrix(ntax, nchar);
+	matrix = new NxsDiscreteMatrix((rowsDiscarded && ntax > 2 ? 2 : ntax), nchar, matrixStorage);
 
 	// Allocate memory for (and initialize) the arrays activeTaxon and activeChar.
 	// All characters and all taxa are initially active.
@@ -2204,11 +2273,23 @@ void NxsCharactersBlock::HandleMatrix(
 	for (i = 0; i < ntaxTotal; i++)
 		taxonPos[i] = UINT_MAX;
 
+	if (!tokens)
+		BuildSymbolTable();
+
 	if (transposing)
 		HandleTransposedMatrix(token);
 	else
 		HandleStdMatrix(token);
 
+	// HandleStdMatrix tells the row listener about each row as it is read, which is not possible if the matrix is 
+	// interleaved or transposed
+	//
+	if (rowListener != NULL && (interleaving || transposing))
+		{
+		for (i = 0; i < ntax; i++)
+			rowListener->RowRead(*this, i);
+		}
+
 	// If we've gotten this far, presumably it is safe to
 	// tell the ASSUMPTIONS block that were ready to take on
 	// the responsibility of being the current character-containing
@@ -2242,6 +2323,7 @@ void NxsCharactersBlock::HandleStatelabels(
 	bool semicolonFoundInInnerLoop = false;
 
 	charStates.clear();
+	stateIndex.clear();
 
 	if (charPos == NULL)
 		BuildCharPosArray();
@@ -2341,6 +2423,59 @@ void NxsCharactersBlock::HandleTaxlabels(
 	newtaxa = false;
 	}
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Builds `stateIndex', which gives HandleTokenState constant-time access to the state labels of each character and a
+|	hash index of those labels (case-insensitive unless `respectingCase' is true). Called automatically the first time
+|	a state is looked up after the state labels have been (re)defined; any command that clears `charStates' also 
+|	clears `stateIndex'.
+*/
+void NxsCharactersBlock::BuildStateIndex()
+	{
+	NxsStateIndex empty;
+	empty.labels	= NULL;
+	empty.index		= NxsLabelIndex(respectingCase);
+	stateIndex.assign(nchar, empty);
+
+	for (NxsStringVectorMap::const_iterator i = charStates.begin(); i != charStates.end(); ++i)
+		{
+		if ((*i).first >= nchar)
+			continue;
+		NxsStateIndex &si = stateIndex[(*i).first];
+		si.labels = &(*i).second;
+		si.index.Rebuild(*si.labels);
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Fills the `symbolCode' table used by HandleNextState to decode single-symbol states without a token. For each 
+|	character the table holds what the single-character token case in HandleNextState would do with it, following the
+|	same order of precedence: characters that are equate keys map to symbolUnknown (so that the equate is applied 
+|	through the token), then the missing, matchchar and gap symbols map to symbolMissing, symbolMatchchar and symbolGap,
+|	and the remaining characters map to their position in `symbols' (or to symbolUnknown if they are not valid 
+|	symbols). Must be called after the FORMAT command has been processed and before the matrix is read.
+*/
+void NxsCharactersBlock::BuildSymbolTable()
+	{
+	for (unsigned c = 0; c < 256; c++)
+		{
+		unsigned p = PositionInSymbols((char)c);
+		symbolCode[c] = (p == UINT_MAX ? symbolUnknown : (int)p);
+		}
+
+	if (gap != '\0')
+		symbolCode[(unsigned char)gap] = symbolGap;
+	if (matchchar != '\0')
+		symbolCode[(unsigned char)matchchar] = symbolMatchchar;
+	symbolCode[(unsigned char)missing] = symbolMissing;
+
+	for (NxsStringMap::const_iterator e = equates.begin(); e != equates.end(); ++e)
+		{
+		if ((*e).first.size() == 1)
+			symbolCode[(unsigned char)(*e).first[0]] = symbolUnknown;
+		}
+	symbolCode[0] = symbolUnknown;
+	}
+
 /*----------------------------------------------------------------------------------------------------------------------
 |	Returns position of `ch' in `symbols' array. The value of `respectingCase' is used to determine whether the search 
 |	should be case sensitive or not. Assumes `symbols' is non-NULL. Returns UINT_MAX if `ch' is not found in `symbols'.
@@ -2660,17 +2795,17 @@ void NxsCharactersBlock::Reset()
 	missing				= '?';
 	gap					= '\0';
 	matchchar			= '\0';
-	matrix				= NULL;
-	charPos				= NULL;
-	taxonPos			= NULL;
-	activeTaxon			= NULL;
-	activeChar			= NULL;
-	symbols				= NULL;
 
+	// Note: `matrix', `charPos', `taxonPos', `activeTaxon', `activeChar' and `symbols' must not be set to NULL
+	// here, otherwise the memory they point to (which for a large matrix is most of the memory used) could
+	// never be freed. The constructor sets them to NULL before calling Reset for the first time.
+	//
 	ResetSymbols();
 
 	charLabels.clear();
+	charLabelIndex.Clear();
 	charStates.clear();
+	stateIndex.clear();
 	equates.clear();
 	eliminated.clear();
 
@@ -2679,6 +2814,7 @@ void NxsCharactersBlock::Reset()
 		delete matrix;
 		matrix = NULL;
 		}
+	rowsDiscarded = false;
 
 	if (charPos != NULL)
 		{
@@ -2780,20 +2916,22 @@ void NxsCharactersBlock::ShowStateLabels(
   unsigned j,				/* the character, in range [0..`nchar') */
   unsigned first_taxon)		/* the index of the first taxon (if UINT_MAX, don't use matchchar) */
 	{
+	unsigned r = MatrixRow(i);
+
 	if (tokens)
 		{
-		unsigned n = matrix->GetNumStates(i, j);
-		if (n == 0 && matrix->IsGap(i, j))
+		unsigned n = matrix->GetNumStates(r, j);
+		if (n == 0 && matrix->IsGap(r, j))
 			out << gap;
-		else if (n == 0 && matrix->IsMissing(i, j))
+		else if (n == 0 && matrix->IsMissing(r, j))
 			out << missing;
 		else if (n == 1) 
 			{
-			unsigned s = matrix->GetState(i, j);
+			unsigned s = matrix->GetState(r, j);
 			bool use_matchchar = false;
 			if (first_taxon >= 0 && i > first_taxon) 
 				{
-				int firsts = matrix->GetState(first_taxon, j);
+				int firsts = matrix->GetState(MatrixRow(first_taxon), j);
 				if (firsts == s)
 				use_matchchar = true;
 				}
@@ -2824,13 +2962,13 @@ void NxsCharactersBlock::ShowStateLabels(
 			{
 			// TODO: handle matchchar possibility here too
 			//
-			if (matrix->IsPolymorphic(i, j))
+			if (matrix->IsPolymorphic(r, j))
 				out << "  (";
 			else
 				out << "  {";
 			for (int k = 0; k < n; k++)
 				{
-				unsigned s = matrix->GetState(i, j, k);
+				unsigned s = matrix->GetState(r, j, k);
 				NxsStringVectorMap::const_iterator ci = charStates.find(j);
 				if (ci == charStates.end())
 					out << "  " << s << "[<-no label found]";
@@ -2841,7 +2979,7 @@ void NxsCharactersBlock::ShowStateLabels(
 					out << "  " << (*ci).second[s];
 					}
 				}
-			if (matrix->IsPolymorphic(i, j))
+			if (matrix->IsPolymorphic(r, j))
 				out << ')';
 			else
 				out << '}';
@@ -2854,10 +2992,10 @@ void NxsCharactersBlock::ShowStateLabels(
 		if (first_taxon >= 0 && i > first_taxon) 
 			{
 			char s[NCL_MAX_STATES + 3];
-			WriteStates(matrix->GetDiscreteDatum(i, j), s, NCL_MAX_STATES + 3);
+			WriteStates(i, j, s, NCL_MAX_STATES + 3);
 
 			char ss[NCL_MAX_STATES + 3];
-			WriteStates(matrix->GetDiscreteDatum(first_taxon, j), ss, NCL_MAX_STATES + 3);
+			WriteStates(first_taxon, j, ss, NCL_MAX_STATES + 3);
 
 			if (strcmp(s, ss) == 0)
 				out << '.';
@@ -2870,25 +3008,28 @@ void NxsCharactersBlock::ShowStateLabels(
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Writes out the state (or states) stored in this NxsDiscreteDatum object to the buffer `s' using the symbols array 
+|	Writes out the state (or states) stored for taxon `i' and character `j' to the buffer `s' using the symbols array 
 |	to do the necessary translation of the numeric state values to state symbols. In the case of polymorphism or 
 |	uncertainty, the list of states will be surrounded by brackets or parentheses (respectively). Assumes `s' is 
 |	non-NULL and long enough to hold everything printed.
 */
 void NxsCharactersBlock::WriteStates(
-  NxsDiscreteDatum &d,	/* the datum to be queried */
+  unsigned i,			/* the (0-offset) index of the taxon in question */
+  unsigned j,			/* the (0-offset) index of the character in question */
   char *s,				/* the buffer to which to print */
   unsigned slen)		/* the length of the buffer `s' */
 	{
 	assert(s != NULL);
 	assert(slen > 1);
 
-	if (matrix->IsMissing(d))
+	unsigned r = MatrixRow(i);
+
+	if (matrix->IsMissing(r, j))
 		{
 		s[0] = missing;
 		s[1] = '\0';
 		}
-	else if (matrix->IsGap(d))
+	else if (matrix->IsGap(r, j))
 		{
 		s[0] = gap;
 		s[1] = '\0';
@@ -2898,7 +3039,7 @@ void NxsCharactersBlock::WriteStates(
 		assert(symbols != NULL);
 		unsigned symbolListLen = strlen(symbols);
 
-		unsigned numStates = matrix->GetNumStates(d);
+		unsigned numStates = matrix->GetNumStates(r, j);
 		unsigned numCharsNeeded = numStates;
 		if (numStates > 1)
 			numCharsNeeded += 2;
@@ -2906,7 +3047,7 @@ void NxsCharactersBlock::WriteStates(
 
 		if (numStates == 1)
 			{
-			unsigned v = matrix->GetState(d);
+			unsigned v = matrix->GetState(r, j);
 			assert(v < symbolListLen);
 			s[0] = symbols[v];
 			s[1] = '\0';
@@ -2916,23 +3057,23 @@ void NxsCharactersBlock::WriteStates(
 			{
 			// numStates must be greater than 1
 			//
-			unsigned i = 0;
-			if (matrix->IsPolymorphic(d))
-				s[i++] = '(';
+			unsigned pos = 0;
+			if (matrix->IsPolymorphic(r, j))
+				s[pos++] = '(';
 			else
-				s[i++] = '{';
+				s[pos++] = '{';
 			for (unsigned k = 0; k < numStates; k++)
 				{
-				unsigned v = matrix->GetState(d, k);
+				unsigned v = matrix->GetState(r, j, k);
 				assert(v < symbolListLen);
-				s[i++] = symbols[v];
-				s[i] = '\0';
+				s[pos++] = symbols[v];
+				s[pos] = '\0';
 				}
-			if (matrix->IsPolymorphic(d))
-				s[i++] = ')';
+			if (matrix->IsPolymorphic(r, j))
+				s[pos++] = ')';
 			else
-				s[i++] = '}';
-			s[i] = '\0';
+				s[pos++] = '}';
+			s[pos] = '\0';
 			}
 		}
 	}
@@ -193,6 +193,7 @@ class NxsCharactersBlock
 		unsigned				ApplyExset(NxsUnsignedSet &exset);
 		unsigned				ApplyIncludeset(NxsUnsignedSet &inset);
 		unsigned				ApplyRestoreset(NxsUnsignedSet &restoreset);
+		bool					AreRowsDiscarded();
 		unsigned				GetCharPos(unsigned origCharIndex);
 		unsigned				GetTaxPos(unsigned origTaxonIndex);
 		unsigned				GetDataType();
@@ -231,6 +232,8 @@ class NxsCharactersBlock
 		bool					IsExcluded(unsigned j);
 		void					DeleteTaxon(unsigned i);
 		void					RestoreTaxon(unsigned i);
+		void					SetMatrixStorage(NxsDiscreteMatrix::StorageEnum mode);
+		void					SetRowListener(NxsMatrixRowListener *listener, bool discardRows = true);
 		bool					IsActiveTaxon(unsigned i);
 		bool					IsDeleted(unsigned i);
 		void					ShowStateLabels(ostream &out, unsigned i, unsigned c, unsigned first_taxon = -1);
@@ -252,7 +255,24 @@ class NxsCharactersBlock
 
 	protected:
 
+		enum SymbolCodesEnum	/* values other than state indices stored in `symbolCode' */
+			{
+			symbolUnknown	= -1,	/* not a state symbol: an equate key, or an invalid symbol (handled through the token) */
+			symbolMissing	= -2,	/* the missing data symbol */
+			symbolGap		= -3,	/* the gap symbol */
+			symbolMatchchar	= -4	/* the matchchar symbol */
+			};
+
+		struct NxsStateIndex	/* the state labels of one character, with their hash index (see BuildStateIndex) */
+			{
+			const NxsStringVector	*labels;	/* the state labels stored in `charStates', or NULL if none were defined */
+			NxsLabelIndex			index;		/* hash index of `labels' */
+			};
+		typedef vector<NxsStateIndex> NxsStateIndexVector;
+
 		void					BuildCharPosArray(bool check_eliminated = false);
+		void					BuildStateIndex();
+		void					BuildSymbolTable();
 		bool					IsInSymbols(char ch);
 		void					HandleCharlabels(NxsToken &token);
 		void					HandleCharstatelabels(NxsToken &token);
@@ -265,13 +285,14 @@ class NxsCharactersBlock
 		virtual void			HandleStdMatrix(NxsToken &token);
 		virtual unsigned		HandleTokenState(NxsToken &token, unsigned c);
 		virtual void			HandleTransposedMatrix(NxsToken &token);
+		unsigned				MatrixRow(unsigned i);
 		virtual void			Read(NxsToken &token);
 		unsigned				PositionInSymbols(char ch);
 		void					HandleStatelabels(NxsToken &token);
 		void					HandleTaxlabels(NxsToken &token);
 		void					ResetSymbols();
 		void					ShowStates(ostream &out, unsigned i, unsigned j);
-		void					WriteStates(NxsDiscreteDatum &d, char *s, unsigned slen);
+		void					WriteStates(unsigned i, unsigned j, char *s, unsigned slen);
 
 		NxsTaxaBlock			*taxa;				/* pointer to the TAXA block in which taxon labels are stored */
 		NxsAssumptionsBlock		*assumptionsBlock;	/* pointer to the ASSUMPTIONS block in which exsets, taxsets and charsets are stored */
@@ -298,8 +319,13 @@ class NxsCharactersBlock
 		char					*symbols;			/* list of valid character state symbols */
 
 		NxsStringMap			equates;			/* list of associations defined by EQUATE attribute of FORMAT command */
+		int						symbolCode[256];	/* state index (or SymbolCodesEnum value) of each single-character state, built by BuildSymbolTable */
 
 		NxsDiscreteMatrix		*matrix;			/* storage for discrete data */
+		NxsDiscreteMatrix::StorageEnum	matrixStorage;	/* storage mode used when `matrix' is created (not changed by Reset) */
+		NxsMatrixRowListener	*rowListener;		/* object told about each row of the matrix as it is read, or NULL (not changed by Reset) */
+		bool					discardingRows;		/* if true, rows are discarded once `rowListener' has seen them, where possible (not changed by Reset) */
+		bool					rowsDiscarded;		/* true if `matrix' holds only the first row and the row last read (see SetRowListener) */
 		unsigned				*charPos;			/* maps character numbers in the data file to column numbers in matrix (necessary if some characters have been eliminated) */
 		unsigned				*taxonPos;			/* maps taxon numbers in the data file to row numbers in matrix (necessary if fewer taxa appear in CHARACTERS block MATRIX command than are specified in the TAXA block) */
 		NxsUnsignedSet			eliminated;			/* array of (0-offset) character numbers that have been eliminated (will remain empty if no ELIMINATE command encountered) */
@@ -308,7 +334,9 @@ class NxsCharactersBlock
 		bool					*activeTaxon;		/* `activeTaxon[i]' true if taxon `i' not deleted; `i' is in range [0..`ntax') */
 
 		NxsStringVector			charLabels;			/* storage for character labels (if provided) */
+		NxsLabelIndex			charLabelIndex;		/* hash index of `charLabels', kept in sync wherever `charLabels' changes */
 		NxsStringVectorMap		charStates;			/* storage for character state labels (if provided) */
+		NxsStateIndexVector		stateIndex;			/* `stateIndex[j]' locates state labels of character `j' (empty until built by BuildStateIndex) */
 
 	private:
 
@@ -317,6 +345,15 @@ class NxsCharactersBlock
 
 typedef NxsCharactersBlock CharactersBlock;
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the rows of the most recently read matrix were discarded after being passed to the row listener 
+|	(see SetRowListener), in which case only the data for the first taxon remain available.
+*/
+inline bool NxsCharactersBlock::AreRowsDiscarded()
+	{
+	return rowsDiscarded;
+	}
+
 /*----------------------------------------------------------------------------------------------------------------------
 |	Deletes taxon whose 0-offset current index is `i'. If taxon has already been deleted, this function has no effect.
 */
@@ -450,7 +487,7 @@ inline int NxsCharactersBlock::GetInternalRepresentation(
 	else if (IsMissingState(i, j))
 		return -2;
 	else
-		return matrix->GetState(i, j, k);
+		return matrix->GetState(MatrixRow(i), j, k);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -534,7 +571,7 @@ inline unsigned NxsCharactersBlock::GetNumStates(
   unsigned i,	/* the taxon in range [0..`ntax') */
   unsigned j)	/* the character in range [0..`nchar') */
 	{
-	return matrix->GetNumStates(i, j);
+	return matrix->GetNumStates(MatrixRow(i), j);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -585,7 +622,7 @@ inline char NxsCharactersBlock::GetState(
 	char state_char = '\0';
 
 	unsigned symbolsLen = strlen(symbols);
-	unsigned p = matrix->GetState(i, j, k);
+	unsigned p = matrix->GetState(MatrixRow(i), j, k);
 	assert(p < symbolsLen);
 	state_char = *(symbols + p);
 
@@ -673,7 +710,7 @@ inline bool NxsCharactersBlock::IsGapState(
   unsigned j)	/* the character, in range [0..`nchar') */
 	{
 	assert(matrix != NULL);
-	return matrix->IsGap(i, j);
+	return matrix->IsGap(MatrixRow(i), j);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -701,7 +738,7 @@ inline bool NxsCharactersBlock::IsMissingState(
   unsigned j)	/* the character, in range [0..`nchar') */
 	{
 	assert(matrix != NULL);
-	return matrix->IsMissing(i, j);
+	return matrix->IsMissing(MatrixRow(i), j);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -714,7 +751,7 @@ inline bool NxsCharactersBlock::IsPolymorphic(
   unsigned j)	/* the character in range [0..`nchar') */
 	{
 	assert(matrix != NULL);
-	return matrix->IsPolymorphic(i, j);
+	return matrix->IsPolymorphic(MatrixRow(i), j);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -750,6 +787,44 @@ inline void NxsCharactersBlock::RestoreTaxon(
 	activeTaxon[i] = true;
 	}
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the row of `matrix' holding the data for taxon `i'. This is `i' itself unless rows are being discarded 
+|	(see SetRowListener), in which case row 0 holds the first taxon and row 1 holds the taxon most recently read.
+*/
+inline unsigned NxsCharactersBlock::MatrixRow(
+  unsigned i)	/* the taxon in range [0..`ntax') */
+	{
+	return (rowsDiscarded && i > 0 ? 1 : i);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Chooses how the data matrix will be stored the next time a MATRIX command is read. The default, datumStorage, keeps
+|	one NxsDiscreteDatum object per cell; packedStorage keeps one byte per cell and is far more economical for large
+|	matrices (see NxsDiscreteMatrix). The public interface of this class is unaffected by the choice. The setting 
+|	survives calls to Reset.
+*/
+inline void NxsCharactersBlock::SetMatrixStorage(
+  NxsDiscreteMatrix::StorageEnum mode)	/* datumStorage or packedStorage */
+	{
+	matrixStorage = mode;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Supplies an object to be told about each row of the matrix as soon as it has been read, so that statistics can be
+|	gathered in a single pass over the data file (see NxsMatrixRowListener). If `discardRows' is true, rows of a 
+|	standard, non-interleaved matrix are not kept once the listener has seen them: the matrix then holds only the first
+|	row (needed for MATCHCHAR) and the row currently being read, and after the MATRIX command has been read every taxon
+|	other than the first appears to have missing data for all characters (use AreRowsDiscarded to find out whether this
+|	happened). Specify NULL for `listener' to stop listening. The setting survives calls to Reset.
+*/
+inline void NxsCharactersBlock::SetRowListener(
+  NxsMatrixRowListener *listener,	/* the object to be told about each row, or NULL */
+  bool discardRows)					/* true if rows may be discarded once the listener has seen them */
+	{
+	rowListener		= listener;
+	discardingRows	= discardRows;
+	}
+
 /*----------------------------------------------------------------------------------------------------------------------
 |	Shows the states for taxon `i', character `j', on the stream `out'. Uses `symbols' array to translate the states 
 |	from the way they are stored (as integers) to the symbol used in the original data matrix. Assumes `i' is in the 
@@ -767,7 +842,7 @@ inline void NxsCharactersBlock::ShowStates(
 	assert(matrix != NULL);
 
 	char s[NCL_MAX_STATES + 3];
-	WriteStates(matrix->GetDiscreteDatum(i, j), s, NCL_MAX_STATES + 3);
+	WriteStates(i, j, s, NCL_MAX_STATES + 3);
 
 	out << s;
 	}
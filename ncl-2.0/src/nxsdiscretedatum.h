@@ -29,7 +29,9 @@
 |	is unambiguous and nonpolymorphic (and not the gap state of course), and 2 or higher if there is either 
 |	polymorphism or uncertainty. If polymorphism or uncertainty apply, it becomes necessary to store information about 
 |	which of these two situations holds. Thus, the last cell in the array is set to either 1 (polymorphism) or 0 
-|	(uncertainty). While a little complicated, this scheme has the following benefits:
+|	(uncertainty). When the datum belongs to a NxsDiscreteMatrix, the `states' array is allocated from (and returned to)
+|	the matrix's NxsArena rather than the heap, and the matrix releases it without calling the destructor. While a 
+|	little complicated, this scheme has the following benefits:
 |~
 |	o if the state is missing, the only memory allocated is for a pointer (`states')
 |	o if the state is unambiguous and not polymorphic, no storage is used for keeping track of whether polymorphism or 
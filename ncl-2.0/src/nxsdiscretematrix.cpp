@@ -21,31 +21,29 @@
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Initializes `nrows' to `rows' and `ncols' to `cols'. In addition, memory is allocated for `data' (each element of 
-|	the matrix `data' is a NxsDiscreteDatum object, which can do its own initialization).
+|	the matrix `data' is a NxsDiscreteDatum object, which can do its own initialization), or for `codes' if `mode' is
+|	packedStorage (every cell of which is initialized to the missing state).
 */
 NxsDiscreteMatrix::NxsDiscreteMatrix(
-  unsigned rows,	/* number of taxa */
-  unsigned cols)	/* number of characters */
+  unsigned rows,		/* number of taxa */
+  unsigned cols,		/* number of characters */
+  StorageEnum mode)		/* datumStorage (one NxsDiscreteDatum per cell) or packedStorage (one byte per cell) */
 	{
-	nrows = rows;
-	ncols = cols;
+	nrows	= rows;
+	ncols	= cols;
+	storage	= mode;
+	data	= NULL;
+	codes	= NULL;
 
-	data = new NxsDiscreteDatum*[nrows];
-	for (unsigned i = 0; i < nrows; i++)
-		data[i] = new NxsDiscreteDatum[ncols];
+	AllocateRows(0);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Deletes memory allocated in the constructor for data member `data'.
+|	Deletes memory allocated in the constructor for data member `data' (or `codes').
 */
 NxsDiscreteMatrix::~NxsDiscreteMatrix()
 	{
-	if (data != NULL)
-		{
-		for (unsigned i = 0; i < nrows; i++)
-			delete [] data[i];
-		delete [] data;
-		}
+	DeleteRows();
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -55,17 +53,45 @@ NxsDiscreteMatrix::~NxsDiscreteMatrix()
 void NxsDiscreteMatrix::AddRows(
   unsigned nAddRows)	/* the number of additional rows to allocate */
 	{
-	unsigned new_nrows = nrows + nAddRows;
+	unsigned first = nrows;
+	nrows += nAddRows;
+	AllocateRows(first);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Reallocates `data' (or `codes' in packedStorage mode) to hold `nrows' rows, keeping rows 0 through `first' - 1 and
+|	creating rows `first' through `nrows' - 1, which are set to the missing state. Assumes `data' and `codes' are NULL
+|	if `first' is 0.
+*/
+void NxsDiscreteMatrix::AllocateRows(
+  unsigned first)	/* the first row needing storage */
+	{
+	if (storage == packedStorage)
+		{
+		// Cell indices in `sideTable' depend only on `ncols', so the side table is unaffected
+		// by adding rows at the bottom of the matrix.
+		//
+		size_t ncells = (size_t)nrows * ncols;
+		size_t start = (size_t)first * ncols;
+		unsigned char *new_codes = (ncells > 0 ? new unsigned char[ncells] : NULL);
+		if (start > 0)
+			memcpy(new_codes, codes, start);
+		if (ncells > start)
+			memset(new_codes + start, packedMissing, ncells - start);
+		delete [] codes;
+		codes = new_codes;
+		return;
+		}
 
 	// Allocate a matrix big enough to hold all of the existing data
 	// as well as the new rows.
 	//
-	NxsDiscreteDatum **new_data = new NxsDiscreteDatum*[new_nrows];
+	NxsDiscreteDatum **new_data = new NxsDiscreteDatum*[nrows];
 
 	// Copy existing data to the new matrix.
 	//
 	unsigned i;
-	for (i = 0; i < nrows; i++)
+	for (i = 0; i < first; i++)
 		new_data[i] = data[i];
 
 	// Let data now point to the new data matrix
@@ -73,12 +99,14 @@ void NxsDiscreteMatrix::AddRows(
 	delete [] data;
 	data = new_data;
 
-	// Create data elements for the newly added rows
+	// Create data elements for the newly added rows (in the arena, so that they need not be deleted one by one)
 	//
-	for (i = nrows; i < new_nrows; i++)
-		data[i] = new NxsDiscreteDatum[ncols];
-
-	nrows = new_nrows;
+	for (i = first; i < nrows; i++)
+		{
+		data[i] = (NxsDiscreteDatum *)arena.Allocate(ncols * sizeof(NxsDiscreteDatum));
+		for (unsigned j = 0; j < ncols; j++)
+			new (data[i] + j) NxsDiscreteDatum();
+		}
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -96,9 +124,38 @@ void NxsDiscreteMatrix::AddState(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
 	assert(value >= 0);
 
+	if (storage == packedStorage)
+		{
+		size_t cell = PackedCell(i, j);
+		unsigned char c = codes[cell];
+		if (c == packedMissing || c == packedGap)
+			SetPackedState(cell, value);
+		else if (c == packedSideTable)
+			{
+			NxsUnsignedVector &v = PackedStates(cell);
+			if (v[0] == 1)
+				v.push_back(value);
+			else
+				v.back() = value;
+			v.push_back(0);	// Assume not polymorphic unless told otherwise.
+			v[0]++;
+			}
+		else
+			{
+			NxsUnsignedVector &v = sideTable[cell];
+			v.resize(4);
+			v[0] = 2;
+			v[1] = c;
+			v[2] = value;
+			v[3] = 0;	// Assume not polymorphic unless told otherwise.
+			codes[cell] = packedSideTable;
+			}
+		return;
+		}
+
 	AddState(data[i][j], value);
 	}
 
@@ -121,21 +178,21 @@ void NxsDiscreteMatrix::AddState(
 
 	if (IsMissing(d))
 		{
-		d.states = new unsigned[2];
+		d.states = NewStates(2);
 		d.states[0] = 1;
 		d.states[1] = value;
 		}
 
 	else if (IsGap(d))
 		{
-		d.states = new unsigned[2];
+		d.states = NewStates(2);
 		d.states[0] = 1;
 		d.states[1] = value;
 		}
 
 	else if (oldns == 1)
 		{
-		d.states = new unsigned[4];
+		d.states = NewStates(4);
 		d.states[0] = 2;
 		d.states[1] = tmp[1];
 		d.states[2] = value;
@@ -145,7 +202,7 @@ void NxsDiscreteMatrix::AddState(
 	else
 		{
 		newlen = oldns + 3;
-		d.states = new unsigned[newlen];
+		d.states = NewStates(newlen);
 		d.states[0] = oldns + 1;
 		for (k = 1; k < oldns + 1; k++)
 		d.states[k] = tmp[k];
@@ -153,13 +210,27 @@ void NxsDiscreteMatrix::AddState(
 		d.states[newlen - 1] = 0;	// Assume not polymorphic unless told otherwise.
 		}
 
-	if (tmp != NULL)
-		delete [] tmp;
+	FreeStates(tmp);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets every cell in row `i' to the missing state, so that the row can be filled again from scratch (AddState adds
+|	to whatever states a cell already holds). Storage freed in datumStorage mode is returned to `arena' for reuse by
+|	the next row. Assumes `i' is in the range [0..`nrows').
+*/
+void NxsDiscreteMatrix::ClearRow(
+  unsigned i)	/* the (0-offset) index of the row to be cleared */
+	{
+	assert(i >= 0);
+	assert(i < nrows);
+
+	for (unsigned j = 0; j < ncols; j++)
+		SetMissing(i, j);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Sets state of taxon `i' and character `j' to state of first taxon for character `j'. Assumes `i' is in the range 
-|	[0..nrows) and `j' is in the range [0..ncols). Also assumes `data' is non-NULL. Calls private function CopyFrom
+|	[0..nrows) and `j' is in the range [0..ncols). Also assumes `data' is non-NULL. Calls private function CopyDatum
 |	to do the actual work.
 */
 void NxsDiscreteMatrix::CopyStatesFromFirstTaxon(
@@ -170,9 +241,69 @@ void NxsDiscreteMatrix::CopyStatesFromFirstTaxon(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		CopyPackedCell(PackedCell(0, j), PackedCell(i, j));
+	else
+		CopyDatum(data[0][j], data[i][j]);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Makes `to' hold a copy of the states stored in `from', allocating the new states array from `arena' and returning
+|	the old one to it. Used only in datumStorage mode.
+*/
+void NxsDiscreteMatrix::CopyDatum(
+  NxsDiscreteDatum &from,	/* the datum to copy */
+  NxsDiscreteDatum &to)		/* the datum to overwrite */
+	{
+	if (&from == &to)
+		return;
+
+	FreeStates(to.states);
+	to.states = NULL;
+
+	if (from.states == NULL)
+		return;
+
+	unsigned len = StatesLength(from.states);
+	to.states = NewStates(len);
+	for (unsigned k = 0; k < len; k++)
+		to.states[k] = from.states[k];
+	}
 
-	data[i][j].CopyFrom(data[0][j]);
+/*----------------------------------------------------------------------------------------------------------------------
+|	Copies the cell at index `from' of `codes' (together with its side table entry, if any) to the cell at index `to'.
+|	Used only in packedStorage mode.
+*/
+void NxsDiscreteMatrix::CopyPackedCell(
+  size_t from,	/* index of the cell to copy */
+  size_t to)	/* index of the cell to overwrite */
+	{
+	if (from == to)
+		return;
+
+	if (codes[to] == packedSideTable)
+		sideTable.erase(to);
+	codes[to] = codes[from];
+	if (codes[from] == packedSideTable)
+		sideTable[to] = PackedStates(from);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Deletes all storage for the matrix (the `data' rows or the `codes' buffer and side table), setting `data' and 
+|	`codes' to NULL. The rows of `data' and their states arrays all live in `arena', so they are released together
+|	without calling the NxsDiscreteDatum destructors.
+*/
+void NxsDiscreteMatrix::DeleteRows()
+	{
+	delete [] data;
+	arena.Release();
+	delete [] codes;
+	sideTable.clear();
+
+	data	= NULL;
+	codes	= NULL;
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -217,7 +348,7 @@ unsigned NxsDiscreteMatrix::DuplicateRow(
   unsigned startCol,	/* the starting column (inclusive) in the range of columns to be duplicated */
   unsigned endCol)		/* the ending column (inclusive) in the range of columns to be duplicated */
 	{
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
 	assert(row >= 0);
 	assert(row < nrows);
 	assert(startCol >= 0);
@@ -239,32 +370,31 @@ unsigned NxsDiscreteMatrix::DuplicateRow(
 	for (unsigned i = 1; i < count; i++)
 		{
 		for (unsigned col = startCol; col <= endCol; col++)
-			data[row+i][col] = data[row][col];
+			{
+			if (storage == packedStorage)
+				CopyPackedCell(PackedCell(row, col), PackedCell(row+i, col));
+			else
+				CopyDatum(data[row][col], data[row+i][col]);
+			}
 		}
 
 	return nNewRows;
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Deletes all cells of `data', setting `data' to NULL, and resets `nrows' and `ncols' to 0.
+|	Deletes all cells of `data' (or `codes'), setting `data' and `codes' to NULL, and resets `nrows' and `ncols' to 0.
 */
 void NxsDiscreteMatrix::Flush()
 	{
-	if (data != NULL)
-		{
-		for (unsigned i = 0; i < nrows; i++)
-			delete [] data[i];
-		delete [] data;
-		}
+	DeleteRows();
 
 	nrows	= 0;
 	ncols	= 0;
-	data	= NULL;
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Assumes that `data' is non-NULL, `i' is in the range [0..`nrows') and `j' is in the range [0..`ncols'). Returns 
-|	reference to the NxsDiscreteDatum object at row `i', column `j' of matrix.
+|	reference to the NxsDiscreteDatum object at row `i', column `j' of matrix. Not available in packedStorage mode.
 */
 NxsDiscreteDatum &NxsDiscreteMatrix::GetDiscreteDatum(
   unsigned i,	/* the row of the matrix */
@@ -274,6 +404,7 @@ NxsDiscreteDatum &NxsDiscreteMatrix::GetDiscreteDatum(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
+	assert(storage == datumStorage);
 	assert(data != NULL);
 
 	return data[i][j];
@@ -292,7 +423,18 @@ unsigned NxsDiscreteMatrix::GetNumStates(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		{
+		size_t cell = PackedCell(i, j);
+		unsigned char c = codes[cell];
+		if (c == packedMissing || c == packedGap)
+			return 0;
+		else if (c == packedSideTable)
+			return PackedStates(cell)[0];
+		return 1;
+		}
 
 	return GetNumStates(data[i][j]);
 	}
@@ -322,12 +464,23 @@ unsigned NxsDiscreteMatrix::GetObsNumStates(
 	{
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
 
 	// Create a set object to hold all states seen for all taxa for character j
 	//
 	set< unsigned, less<unsigned> > stateset;
 
+	if (storage == packedStorage)
+		{
+		for (unsigned i = 0; i < nrows; i++)
+			{
+			unsigned ns = GetNumStates(i, j);
+			for (unsigned k = 0; k < ns; k++)
+				stateset.insert(GetState(i, j, k));
+			}
+		return stateset.size();
+		}
+
 	for (unsigned i = 0; i < nrows; i++)
 		{
 		NxsDiscreteDatum &d = data[i][j];
@@ -357,7 +510,23 @@ unsigned NxsDiscreteMatrix::GetState(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		{
+		size_t cell = PackedCell(i, j);
+		unsigned char c = codes[cell];
+		assert(c != packedMissing);
+		assert(c != packedGap);
+		if (c != packedSideTable)
+			{
+			assert(k == 0);
+			return c;
+			}
+		NxsUnsignedVector &v = PackedStates(cell);
+		assert(k < v[0]);
+		return v[k + 1];
+		}
 
 	return GetState(data[i][j], k);
 	}
@@ -391,7 +560,10 @@ bool NxsDiscreteMatrix::IsGap(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		return (codes[PackedCell(i, j)] == packedGap);
 
 	return IsGap(data[i][j]);
 	}
@@ -421,7 +593,10 @@ bool NxsDiscreteMatrix::IsMissing(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		return (codes[PackedCell(i, j)] == packedMissing);
 
 	return IsMissing(data[i][j]);
 	}
@@ -451,7 +626,16 @@ bool NxsDiscreteMatrix::IsPolymorphic(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		{
+		size_t cell = PackedCell(i, j);
+		if (codes[cell] != packedSideTable)
+			return false;
+		NxsUnsignedVector &v = PackedStates(cell);
+		return (v[0] >= 2 && v.back() > 0);
+		}
 
 	return IsPolymorphic(data[i][j]);
 	}
@@ -472,34 +656,39 @@ bool NxsDiscreteMatrix::IsPolymorphic(
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Deletes all cells of `data' and reallocates memory to create a new matrix object with `nrows' = `rows' and `ncols' 
-|	= `cols'. Assumes `rows' and `cols' are both greater than 0.
+|	Returns reference to the side table entry for the cell at index `cell' of `codes'. The entry has the same layout as
+|	NxsDiscreteDatum::states. Assumes the cell is coded `packedSideTable'. Used only in packedStorage mode.
+*/
+NxsUnsignedVector &NxsDiscreteMatrix::PackedStates(
+  size_t cell)	/* index of the cell in question */
+	{
+	assert(codes[cell] == packedSideTable);
+	NxsPackedStatesMap::iterator it = sideTable.find(cell);
+	assert(it != sideTable.end());
+	return it->second;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Deletes all cells of `data' (or `codes') and reallocates memory to create a new matrix object with `nrows' = `rows'
+|	and `ncols' = `cols'. The storage mode is unchanged. Assumes `rows' and `cols' are both greater than 0.
 */
 void NxsDiscreteMatrix::Reset(
   unsigned rows,	/* the new number of rows (taxa) */
   unsigned cols)	/* the new number of columns (characters) */
 	{
-	unsigned i;
 	assert(rows > 0);
 	assert(cols > 0);
 
 	// Delete what is there now
 	//
-	if (data != NULL)
-		{
-		for (i = 0; i < nrows; i++)
-			delete [] data[i];
-		delete [] data;
-		}
+	DeleteRows();
 
 	nrows = rows;
 	ncols = cols;
 
 	// Create new data matrix
 	//
-	data = new NxsDiscreteDatum*[nrows];
-	for (i = 0; i < nrows; i++)
-		data[i] = new NxsDiscreteDatum[ncols];
+	AllocateRows(0);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -514,7 +703,16 @@ void NxsDiscreteMatrix::SetGap(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		{
+		size_t cell = PackedCell(i, j);
+		if (codes[cell] == packedSideTable)
+			sideTable.erase(cell);
+		codes[cell] = packedGap;
+		return;
+		}
 
 	SetGap(data[i][j]);
 	}
@@ -526,9 +724,8 @@ void NxsDiscreteMatrix::SetGap(
 void NxsDiscreteMatrix::SetGap(
   NxsDiscreteDatum &d)	/* the datum in question */
 	{
-	if (d.states != NULL)
-		delete [] d.states;
-	d.states = new unsigned[1];
+	FreeStates(d.states);
+	d.states = NewStates(1);
 	d.states[0] = 0;
 	}
 
@@ -544,7 +741,16 @@ void NxsDiscreteMatrix::SetMissing(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		{
+		size_t cell = PackedCell(i, j);
+		if (codes[cell] == packedSideTable)
+			sideTable.erase(cell);
+		codes[cell] = packedMissing;
+		return;
+		}
 
 	SetMissing(data[i][j]);
 	}
@@ -556,8 +762,7 @@ void NxsDiscreteMatrix::SetMissing(
 void NxsDiscreteMatrix::SetMissing(
   NxsDiscreteDatum &d)	/* the datum in question */
 	{
-	if (d.states != NULL)
-		delete [] d.states;
+	FreeStates(d.states);
 	d.states = NULL;
 	}
 
@@ -576,9 +781,20 @@ void NxsDiscreteMatrix::SetPolymorphic(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
 	assert(value == 0 || value == 1);
 
+	if (storage == packedStorage)
+		{
+		size_t cell = PackedCell(i, j);
+		if (codes[cell] != packedSideTable)
+			return;
+		NxsUnsignedVector &v = PackedStates(cell);
+		if (v[0] >= 2)
+			v.back() = value;
+		return;
+		}
+
 	SetPolymorphic(data[i][j], value);
 	}
 
@@ -613,7 +829,13 @@ void NxsDiscreteMatrix::SetState(
 	assert(i < nrows);
 	assert(j >= 0);
 	assert(j < ncols);
-	assert(data != NULL);
+	assert(data != NULL || codes != NULL);
+
+	if (storage == packedStorage)
+		{
+		SetPackedState(PackedCell(i, j), value);
+		return;
+		}
 
 	SetState(data[i][j], value);
 	}
@@ -628,10 +850,33 @@ void NxsDiscreteMatrix::SetState(
   NxsDiscreteDatum &d,	/* the datum in question */
   unsigned value)		/* the value to assign for the state */
 	{
-	if (d.states != NULL)
-		delete [] d.states;
-	d.states = new unsigned[2];
+	FreeStates(d.states);
+	d.states = NewStates(2);
 	d.states[0] = 1;
 	d.states[1] = value;
 	}
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Stores `value' as the only state of the cell at index `cell' of `codes', forgetting any states already stored there.
+|	The value is stored inline unless it is too large to fit in a byte, in which case it goes to the side table. Used
+|	only in packedStorage mode.
+*/
+void NxsDiscreteMatrix::SetPackedState(
+  size_t cell,		/* index of the cell in question */
+  unsigned value)	/* the value to assign for the state */
+	{
+	if (value < packedSideTable)
+		{
+		if (codes[cell] == packedSideTable)
+			sideTable.erase(cell);
+		codes[cell] = (unsigned char)value;
+		}
+	else
+		{
+		NxsUnsignedVector &v = sideTable[cell];
+		v.resize(2);
+		v[0] = 1;
+		v[1] = value;
+		codes[cell] = packedSideTable;
+		}
+	}
@@ -34,6 +34,18 @@
 |	distinct allelic forms can be accommodated by this scheme, assuming at minimum a 32-bit architecture. Because it is
 |	not known in advance how many rows are going to be necessary, The NxsDiscreteMatrix class provides the AddRows 
 |	method, which expands the number of rows allocated for the matrix while preserving data already stored. 
+|	
+|	For very large matrices the per-cell NxsDiscreteDatum objects (each with its own heap-allocated states array) can
+|	be replaced by packed storage, selected by passing `packedStorage' to the constructor. In packed mode each cell
+|	occupies a single byte in one contiguous buffer `codes'. Values below `packedSideTable' are the (single) state
+|	itself, while `packedMissing' and `packedGap' denote the missing and gap states. Cells with more than one state (or
+|	with a single state too large to fit in a byte) are marked `packedSideTable' and their states are kept in the map
+|	`sideTable', keyed by cell index, using the same layout as NxsDiscreteDatum::states. The public interface behaves
+|	identically in both modes.
+|	
+|	In the default datumStorage mode, the rows of NxsDiscreteDatum objects and the `states' arrays they point to are
+|	carved out of the arena `arena' owned by the matrix, rather than being obtained one at a time from the heap. The
+|	whole matrix is therefore freed in one step (by Flush, Reset or the destructor) without visiting each cell.
 */
 class NxsDiscreteMatrix
 	{
@@ -42,11 +54,18 @@ class NxsDiscreteMatrix
 
 	public:
 
-							NxsDiscreteMatrix(unsigned rows, unsigned cols);
+		enum StorageEnum		/* how the states for each cell are stored */
+			{
+			datumStorage = 0,	/* one NxsDiscreteDatum object per cell (the default) */
+			packedStorage		/* one byte per cell, with a side table for cells having more than one state */
+			};
+
+							NxsDiscreteMatrix(unsigned rows, unsigned cols, StorageEnum mode = datumStorage);
 		virtual				~NxsDiscreteMatrix();
 
 		void				AddRows(unsigned nAddRows);
 		void				AddState(unsigned i, unsigned j, unsigned value);
+		void				ClearRow(unsigned i);
 		void				CopyStatesFromFirstTaxon(unsigned i, unsigned j);
 		void				DebugSaveMatrix(ostream &out, unsigned colwidth = 12);
 		unsigned			DuplicateRow(unsigned row, unsigned count, unsigned startCol = 0, unsigned endCol = UINT_MAX);
@@ -54,6 +73,7 @@ class NxsDiscreteMatrix
 		unsigned			GetState(unsigned i, unsigned j, unsigned k = 0);
 		unsigned			GetNumStates(unsigned i, unsigned j);
 		unsigned			GetObsNumStates(unsigned j);
+		StorageEnum			GetStorage();
 		bool				IsGap(unsigned i, unsigned j);
 		bool				IsMissing(unsigned i, unsigned j);
 		bool				IsPolymorphic(unsigned i, unsigned j);
@@ -65,9 +85,33 @@ class NxsDiscreteMatrix
 
 	private:
 
-		unsigned			nrows;	/* number of rows (taxa) in the data matrix */
-		unsigned			ncols;	/* number of columns (characters) in the data matrix */
-		NxsDiscreteDatum	**data;	/* storage for the data */
+		typedef map< size_t, NxsUnsignedVector, less<size_t> > NxsPackedStatesMap;
+
+		enum
+			{
+			packedSideTable	= 0xFD,	/* cell states are stored in `sideTable' */
+			packedGap		= 0xFE,	/* cell holds the gap state */
+			packedMissing	= 0xFF	/* cell holds the missing state */
+			};
+
+		unsigned			nrows;		/* number of rows (taxa) in the data matrix */
+		unsigned			ncols;		/* number of columns (characters) in the data matrix */
+		StorageEnum			storage;	/* storage mode chosen when the matrix was created */
+		NxsDiscreteDatum	**data;		/* storage for the data (datumStorage mode only) */
+		unsigned char		*codes;		/* storage for the data, `nrows' x `ncols' bytes (packedStorage mode only) */
+		NxsPackedStatesMap	sideTable;	/* states of cells coded `packedSideTable' (packedStorage mode only) */
+		NxsArena			arena;		/* memory for the rows of `data' and their states arrays (datumStorage mode only) */
+
+		void				AllocateRows(unsigned first);
+		void				DeleteRows();
+		void				CopyDatum(NxsDiscreteDatum &from, NxsDiscreteDatum &to);
+		void				CopyPackedCell(size_t from, size_t to);
+		void				FreeStates(unsigned *states);
+		unsigned			*NewStates(unsigned len);
+		unsigned			StatesLength(const unsigned *states);
+		size_t				PackedCell(unsigned i, unsigned j);
+		NxsUnsignedVector	&PackedStates(size_t cell);
+		void				SetPackedState(size_t cell, unsigned value);
 
 		void				AddState(NxsDiscreteDatum &d, unsigned value);
 		bool				IsGap(NxsDiscreteDatum &d);
@@ -82,6 +126,59 @@ class NxsDiscreteMatrix
 		void				SetState(NxsDiscreteDatum &d, unsigned value);
 	};
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the storage mode (datumStorage or packedStorage) chosen when the matrix was created.
+*/
+inline NxsDiscreteMatrix::StorageEnum NxsDiscreteMatrix::GetStorage()
+	{
+	return storage;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the index into `codes' of the cell at row `i', column `j'. Assumes `i' is in the range [0..`nrows') and `j'
+|	is in the range [0..`ncols').
+*/
+inline size_t NxsDiscreteMatrix::PackedCell(
+  unsigned i,	/* the (0-offset) index of the taxon in question */
+  unsigned j)	/* the (0-offset) index of the character in question */
+	{
+	return (size_t)i * ncols + j;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns a states array of `len' elements allocated from `arena'.
+*/
+inline unsigned *NxsDiscreteMatrix::NewStates(
+  unsigned len)	/* the number of elements needed */
+	{
+	return (unsigned *)arena.Allocate(len * sizeof(unsigned));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the states array `states' (allocated by NewStates) to `arena'. Does nothing if `states' is NULL (the missing
+|	state).
+*/
+inline void NxsDiscreteMatrix::FreeStates(
+  unsigned *states)	/* the array to be freed */
+	{
+	if (states != NULL)
+		arena.Free(states, StatesLength(states) * sizeof(unsigned));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of elements in the non-NULL states array `states', deduced from its contents using the layout
+|	described in NxsDiscreteDatum: [0] for the gap state, [1][s] for a single state, and [n][s1]...[sn][poly] for more
+|	than one state.
+*/
+inline unsigned NxsDiscreteMatrix::StatesLength(
+  const unsigned *states)	/* the array in question */
+	{
+	assert(states != NULL);
+	if (states[0] < 2)
+		return states[0] + 1;
+	return states[0] + 2;
+	}
+
 typedef NxsDiscreteMatrix DiscreteMatrix;
 
 
@@ -20,9 +20,9 @@
 #include "ncl.h"
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Sets `id' to "DISTANCES", `taxa' to `t', `triangle' to `NxsDistancesBlockEnum::lower', `missing' to '?', `matrix' 
-|	and `taxonPos' to NULL, `labels' and `diagonal' to true, `newtaxa' and `interleave' to false, and `ntax' and `nchar'
-|	to 0. Assumes `t' is non-NULL.
+|	Sets `id' to "DISTANCES", `taxa' to `t', `triangle' to `NxsDistancesBlockEnum::lower', `missing' to '?', `matrix',
+|	`packed' and `taxonPos' to NULL, `labels' and `diagonal' to true, `newtaxa' and `interleave' to false, and `ntax' and `nchar'
+|	to 0, and the storage mode to datumStorage. Assumes `t' is non-NULL.
 */
 NxsDistancesBlock::NxsDistancesBlock(
   NxsTaxaBlock *t)	/* the NxsTaxaBlock that will keep track of taxon labels */
@@ -40,20 +40,39 @@ NxsDistancesBlock::NxsDistancesBlock(
 	triangle	= NxsDistancesBlockEnum(lower);
 	missing		= '?';
 	matrix		= NULL;
+	packed		= NULL;
 	taxonPos	= NULL;
+	matrixStorage	= datumStorage;
 }
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Deletes `matrix' and `taxonPos' arrays.
+|	Deletes `matrix' (or `packed') and `taxonPos' arrays.
 */
 NxsDistancesBlock::~NxsDistancesBlock()
 	{
-	if (matrix != NULL)
-		delete matrix;
+	DeleteMatrix();
 	if (taxonPos != NULL)
 		delete [] taxonPos;
 	}
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Deletes the storage for the distances of the `ntax' taxa, whichever of `matrix' and `packed' is in use, and sets
+|	both to NULL.
+*/
+void NxsDistancesBlock::DeleteMatrix()
+	{
+	if (matrix != NULL)
+		{
+		for (unsigned i = 0; i < ntax; i++)
+			delete [] matrix[i];
+		delete [] matrix;
+		matrix = NULL;
+		}
+
+	delete [] packed;
+	packed = NULL;
+	}
+
 /*----------------------------------------------------------------------------------------------------------------------
 |	Called when DIMENSIONS command needs to be parsed from within the DISTANCES block. Deals with everything after the 
 |	token DIMENSIONS up to and including the semicolon that terminates the DIMENSIONS command.
@@ -405,7 +424,10 @@ void NxsDistancesBlock::HandleMatrixCommand(
   NxsToken &token)	/* the token used to read from `in' */
 	{
 	unsigned i;
-	unsigned prev_ntax = ntax;
+
+	// Free the storage of any previous matrix while `ntax' still gives its size
+	//
+	DeleteMatrix();
 
 	if (ntax == 0)
 		ntax = taxa->GetNumTaxonLabels();
@@ -437,19 +459,20 @@ void NxsDistancesBlock::HandleMatrixCommand(
 	for (i = 0; i < ntax; i++)
 		taxonPos[i] = UINT_MAX;
 
-	// Allocate matrix array, deleting it first if previously allocated
+	// Allocate matrix array (or, in packed mode, one float for each pair of taxa, FLT_MAX meaning missing)
 	//
-	if (matrix != NULL)
+	if (matrixStorage == packedStorage)
 		{
-		assert(prev_ntax > 0);
-		for (i = 0; i < prev_ntax; i++)
-			delete [] matrix[i];
-		delete [] matrix;
+		size_t npairs = (size_t)ntax * (ntax - 1) / 2;
+		packed = new float[npairs > 0 ? npairs : 1];
+		std::fill(packed, packed + npairs, FLT_MAX);
+		}
+	else
+		{
+		matrix = new NxsDistanceDatum*[ntax];
+		for (i = 0; i < ntax; i++)
+			matrix[i] = new NxsDistanceDatum[ntax];
 		}
-
-	matrix = new NxsDistanceDatum*[ntax];
-	for (i = 0; i < ntax; i++)
-		matrix[i] = new NxsDistanceDatum[ntax];
 
 	unsigned offset = 0;
 	bool done = false;
@@ -713,13 +736,7 @@ void NxsDistancesBlock::Reset()
 	isEmpty        = true;
 	isUserSupplied = false;
 
-	if (matrix != NULL)
-		{
-		for (unsigned i = 0; i < ntax; i++)
-			delete [] matrix[i];
-		delete [] matrix;
-		matrix = NULL;
-		}
+	DeleteMatrix();
 
 	if (taxonPos != NULL)
 		delete [] taxonPos;
@@ -753,7 +770,7 @@ unsigned NxsDistancesBlock::GetNchar()
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Returns the value of the (`i', `j')th element of `matrix'. Assumes `i' and `j' are both in the range [0..`ntax') 
-|	and the distance stored at `matrix[i][j]' is not missing. Also assumes `matrix' is not NULL.
+|	and the distance stored at `matrix[i][j]' is not missing. Also assumes `matrix' (or `packed') is not NULL.
 */
 double NxsDistancesBlock::GetDistance(
   unsigned i,	/* the row */
@@ -763,8 +780,11 @@ double NxsDistancesBlock::GetDistance(
 	assert(i < ntax);
 	assert(j >= 0);
 	assert(j < ntax);
-	assert(matrix != NULL);
 
+	if (packed != NULL)
+		return (i == j ? 0.0 : packed[PackedIndex(i, j)]);
+
+	assert(matrix != NULL);
 	return matrix[i][j].value;
 	}
 
@@ -834,7 +854,7 @@ bool NxsDistancesBlock::IsLabels()
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Returns true if the (`i',`j')th distance is missing. Assumes `i' and `j' are both in the range [0..`ntax') and 
-|	`matrix' is not NULL.
+|	`matrix' (or `packed') is not NULL.
 */
 bool NxsDistancesBlock::IsMissing(
   unsigned i,	/* the row */
@@ -844,14 +864,18 @@ bool NxsDistancesBlock::IsMissing(
 	assert(i < ntax);
 	assert(j >= 0);
 	assert(j < ntax);
-	assert(matrix != NULL);
 
+	if (packed != NULL)
+		return (i != j && packed[PackedIndex(i, j)] == FLT_MAX);
+
+	assert(matrix != NULL);
 	return (bool)(matrix[i][j].missing);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Sets the value of the (`i',`j')th matrix element to `d' and `missing' to false . Assumes `i' and `j' are both in 
-|	the range [0..`ntax') and `matrix' is not NULL.
+|	the range [0..`ntax') and `matrix' (or `packed') is not NULL. In packed mode, diagonal elements are ignored and an
+|	element of the upper triangle does not replace a distance already stored for the same pair of taxa.
 */
 void NxsDistancesBlock::SetDistance(
   unsigned i,	/* the row */
@@ -862,6 +886,18 @@ void NxsDistancesBlock::SetDistance(
 	assert(i < ntax);
 	assert(j >= 0);
 	assert(j < ntax);
+
+	if (packed != NULL)
+		{
+		if (i != j)
+			{
+			float &p = packed[PackedIndex(i, j)];
+			if (i > j || p == FLT_MAX)
+				p = (float)d;
+			}
+		return;
+		}
+
 	assert(matrix != NULL);
 
 	matrix[i][j].value = d;
@@ -870,7 +906,8 @@ void NxsDistancesBlock::SetDistance(
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Sets the value of the (`i', `j')th `matrix' element to missing. Assumes `i' and `j' are both in the range 
-|	[0..`ntax') and `matrix' is not NULL.
+|	[0..`ntax') and `matrix' (or `packed') is not NULL. In packed mode, a distance already stored for the same pair of
+|	taxa (from the other triangle) is kept.
 */
 void NxsDistancesBlock::SetMissing(
   unsigned i,	/* the row */
@@ -880,6 +917,10 @@ void NxsDistancesBlock::SetMissing(
 	assert(i < ntax);
 	assert(j >= 0);
 	assert(j < ntax);
+
+	if (packed != NULL)
+		return;
+
 	assert(matrix != NULL);
 
 	matrix[i][j].missing = 1;
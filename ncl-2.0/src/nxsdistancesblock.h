@@ -64,6 +64,19 @@ class NxsDistancesBlock
   : public NxsBlock
 	{
 	public:
+		enum NxsDistancesBlockEnum		/* used by data member triangle to determine which triangle(s) of the distance matrix is/are occupied */
+			{
+			upper			= 1,		/* matrix is upper-triangular */
+			lower			= 2,		/* matrix is lower-triangular */
+			both			= 3			/* matrix is rectangular */
+			};
+
+		enum NxsDistancesStorageEnum	/* how the distances are stored (see SetMatrixStorage) */
+			{
+			datumStorage	= 0,		/* one NxsDistanceDatum object for every cell of the square matrix */
+			packedStorage	= 1			/* one float for every pair of taxa */
+			};
+
 							NxsDistancesBlock(NxsTaxaBlock *t);
 		virtual				~NxsDistancesBlock();
 
@@ -82,16 +95,10 @@ class NxsDistancesBlock
 		virtual void		Report(std::ostream &out);
 		virtual void		Reset();
 		void				SetDistance(unsigned i, unsigned j, double d);
+		void				SetMatrixStorage(NxsDistancesStorageEnum mode);
 		void				SetMissing(unsigned i, unsigned j);
 		void				SetNchar(unsigned i);
 
-		enum NxsDistancesBlockEnum		/* used by data member triangle to determine which triangle(s) of the distance matrix is/are occupied */
-			{
-			upper			= 1,		/* matrix is upper-triangular */
-			lower			= 2,		/* matrix is lower-triangular */
-			both			= 3			/* matrix is rectangular */
-			};
-
 	protected:
 
 		void				HandleDimensionsCommand(NxsToken &token);
@@ -117,10 +124,41 @@ class NxsDistancesBlock
 
 		char				missing;	/* the symbol used to represent missing data (e.g. '?') */
 
-		NxsDistanceDatum	**matrix;	/* the structure used for storing the pairwise distance matrix */
+		NxsDistanceDatum	**matrix;	/* the structure used for storing the pairwise distance matrix (datumStorage mode) */
+		float				*packed;	/* lower triangle of the distance matrix, without the diagonal, one row after another (packedStorage mode) */
+		NxsDistancesStorageEnum	matrixStorage;	/* storage mode used when the next MATRIX command is read (not changed by Reset) */
 		unsigned			*taxonPos;	/* array holding 0-offset index into the NxsTaxaBlock list of taxon labels (used to ensure that order of taxa is same for each interleaved block) */
+
+		void				DeleteMatrix();
+		size_t				PackedIndex(unsigned i, unsigned j);
 	};
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the position in `packed' of the distance between taxa `i' and `j', which must differ.
+*/
+inline size_t NxsDistancesBlock::PackedIndex(
+  unsigned i,	/* the row */
+  unsigned j)	/* the column */
+	{
+	if (i < j)
+		std::swap(i, j);
+	return (size_t)i * (i - 1) / 2 + j;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Chooses how the distances will be stored the next time a MATRIX command is read. The default, datumStorage, keeps
+|	one NxsDistanceDatum object (a double and a flag) for each of the ntax x ntax cells, so that the two triangles of
+|	the matrix may differ. The packedStorage mode keeps a single float for each pair of taxa, about an eighth of the
+|	memory, which allows matrices of tens of thousands of taxa to be read. In packed mode the matrix is taken to be
+|	symmetric: the distance between two taxa is the same whichever triangle it was given in (if both triangles are
+|	given, the lower wins unless it is missing), and the diagonal is always zero. The setting survives calls to Reset.
+*/
+inline void NxsDistancesBlock::SetMatrixStorage(
+  NxsDistancesStorageEnum mode)	/* datumStorage or packedStorage */
+	{
+	matrixStorage = mode;
+	}
+
 typedef NxsDistancesBlock	DistancesBlock;
 #define IsBoth				IsRectangular
 
@@ -0,0 +1,174 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#include "ncl.h"
+
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#	define NCL_HAVE_MMAP
+#	include <cerrno>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Opens the file named `fn'. If possible the whole file is memory-mapped; otherwise it will be read in chunks of
+|	`bufferSize' bytes. Use IsOpen to find out whether the file could be opened.
+*/
+NxsInputSource::NxsInputSource(
+  const char *fn)	/* name of the file to read */
+	{
+	Init();
+
+#	if defined(NCL_HAVE_MMAP)
+		fd = open(fn, O_RDONLY);
+		isOpen = (fd >= 0);
+		if (!isOpen)
+			return;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && (off_t)(size_t)st.st_size == st.st_size)
+			{
+			void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED)
+				{
+				mapped = (char *)p;
+				mappedLength = (size_t)st.st_size;
+#				if defined(MADV_SEQUENTIAL)
+					madvise(p, mappedLength, MADV_SEQUENTIAL);
+#				endif
+				}
+			}
+#	else
+		ownStream = new ifstream(fn, ios::binary);
+		stream = ownStream;
+		isOpen = ownStream->is_open();
+#	endif
+
+	if (mapped == NULL)
+		buffer = new char[bufferSize];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Reads from the stream `i', which is assumed to be open already.
+*/
+NxsInputSource::NxsInputSource(
+  istream &i)	/* the stream to read */
+	{
+	Init();
+	stream = &i;
+	buffer = new char[bufferSize];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Unmaps and closes the file, or deletes the buffer, as appropriate. Streams passed to the constructor are not closed.
+*/
+NxsInputSource::~NxsInputSource()
+	{
+#	if defined(NCL_HAVE_MMAP)
+		if (mapped != NULL)
+			munmap(mapped, mappedLength);
+		if (fd >= 0)
+			close(fd);
+#	endif
+
+	delete ownStream;
+	delete [] buffer;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes all data members to the state of an input source with nothing to read.
+*/
+void NxsInputSource::Init()
+	{
+	stream			= NULL;
+	ownStream		= NULL;
+	fd				= -1;
+	mapped			= NULL;
+	mappedLength	= 0;
+	mappedDone		= false;
+	isOpen			= true;
+	buffer			= NULL;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets `first' and `last' to delimit the next range of characters to be read ([`first', `last')). The range remains
+|	valid until the next call to NextChunk. Returns false (leaving `first' and `last' unchanged) when there are no more
+|	characters. Throws NxsException if the input could not be opened or read.
+*/
+bool NxsInputSource::NextChunk(
+  const char *&first,	/* on return, the first character in the range */
+  const char *&last)	/* on return, one past the last character in the range */
+	{
+	if (!isOpen || (stream != NULL && stream->bad()))
+		throw NxsException("Unknown error reading data file (check to make sure file exists)");
+
+	if (mapped != NULL)
+		{
+		if (mappedDone)
+			return false;
+		mappedDone = true;
+		first	= mapped;
+		last	= mapped + mappedLength;
+		return true;
+		}
+
+	size_t n = 0;
+	if (stream != NULL)
+		{
+		streambuf *sb = stream->rdbuf();
+		if (sb == NULL)
+			return false;
+
+		// Take whatever the stream has already buffered; if nothing is buffered, wait for a single character
+		// (this keeps interactive streams responsive)
+		//
+		streamsize avail = sb->in_avail();
+		if (avail > 0)
+			n = (size_t)sb->sgetn(buffer, (avail < (streamsize)bufferSize ? avail : (streamsize)bufferSize));
+		else
+			{
+			int ch = sb->sbumpc();
+			if (ch != EOF)
+				buffer[n++] = (char)ch;
+			}
+		}
+
+#	if defined(NCL_HAVE_MMAP)
+	else
+		{
+		ssize_t nread;
+		do
+			nread = read(fd, buffer, bufferSize);
+		while (nread < 0 && errno == EINTR);
+
+		if (nread < 0)
+			throw NxsException("Unknown error reading data file (check to make sure file exists)");
+		n = (size_t)nread;
+		}
+#	endif
+
+	if (n == 0)
+		return false;
+
+	first	= buffer;
+	last	= buffer + n;
+	return true;
+	}
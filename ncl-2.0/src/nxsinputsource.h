@@ -0,0 +1,90 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#ifndef NCL_NXSINPUTSOURCE_H
+#define NCL_NXSINPUTSOURCE_H
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Supplies the characters of a NEXUS file to a NxsToken object as a sequence of contiguous ranges of memory, so that
+|	the token can scan characters with a pointer rather than making a call on an istream for each one. An input source
+|	can be created in one of two ways:
+|~
+|	o from a file name. On systems providing mmap (POSIX), a regular file is mapped into memory in its entirety and
+|	  handed to the token as a single range. Anything that cannot be mapped (pipes, character devices, or systems
+|	  without mmap) is read in large chunks into a buffer owned by the input source.
+|	o from an istream. Characters already buffered by the stream are handed over in blocks; when none are buffered,
+|	  a single character is read, so that interactive input (e.g., cin) is consumed no faster than it is typed.
+|~
+|	NxsToken objects created from an istream build their own input source, so existing code needs no changes. Use
+|	the file name form to get the full benefit:
+|>
+|	NxsInputSource source("data.nex");
+|	NxsToken token(source);
+|	reader.Execute(token);
+|>
+|	The input source must outlive any NxsToken that reads from it.
+*/
+class NxsInputSource
+	{
+	public:
+
+		enum {bufferSize = 65536};	/* size of the buffer used when the input cannot be memory-mapped */
+
+						NxsInputSource(const char *fn);
+						NxsInputSource(istream &i);
+		virtual			~NxsInputSource();
+
+		bool			IsMapped();
+		bool			IsOpen();
+		bool			NextChunk(const char *&first, const char *&last);
+
+	private:
+
+		istream			*stream;		/* stream from which characters are read (NULL if reading by file descriptor) */
+		ifstream		*ownStream;		/* stream opened by this object (if any) and deleted by the destructor */
+		int				fd;				/* file descriptor of the open file, or -1 (POSIX only) */
+		char			*mapped;		/* start of the memory-mapped file, or NULL if the file is not mapped */
+		size_t			mappedLength;	/* number of bytes in the memory-mapped file */
+		bool			mappedDone;		/* true once the mapped file has been handed out by NextChunk */
+		bool			isOpen;			/* false if the file named in the constructor could not be opened */
+		char			*buffer;		/* buffer of `bufferSize' bytes used when input is not memory-mapped */
+
+		void			Init();
+
+						NxsInputSource(const NxsInputSource &);				/* not implemented */
+		NxsInputSource	&operator=(const NxsInputSource &);					/* not implemented */
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the entire file has been mapped into memory.
+*/
+inline bool NxsInputSource::IsMapped()
+	{
+	return (mapped != NULL);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns false if the file named in the constructor could not be opened, true otherwise.
+*/
+inline bool NxsInputSource::IsOpen()
+	{
+	return isOpen;
+	}
+
+#endif
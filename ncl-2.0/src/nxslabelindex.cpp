@@ -0,0 +1,156 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#include "ncl.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes an empty index. If `respectCase' is false, labels that differ only in case are considered equal.
+*/
+NxsLabelIndex::NxsLabelIndex(
+  bool respectCase)	/* true if label comparisons are to be case sensitive */
+	{
+	nused			= 0;
+	respectingCase	= respectCase;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Adds the label stored at position `i' of `labels' to the index. If an equal label is already indexed at a smaller
+|	position, the index is not changed.
+*/
+void NxsLabelIndex::Add(
+  const NxsStringVector &labels,	/* the vector being indexed */
+  unsigned i)						/* position in `labels' of the label to add */
+	{
+	assert(i < (unsigned)labels.size());
+
+	// Keep the load factor at or below 1/2
+	//
+	if (2 * (nused + 1) > (unsigned)slots.size())
+		Resize(slots.empty() ? 16 : 2 * (unsigned)slots.size());
+
+	const NxsString &s = labels[i];
+	unsigned h = Hash(s);
+	NxsLabelSlot &slot = slots[Probe(labels, s, h)];
+	if (slot.pos == UINT_MAX)
+		{
+		slot.hash	= h;
+		slot.pos	= i;
+		nused++;
+		}
+	else if (i < slot.pos)
+		slot.pos = i;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Empties the index.
+*/
+void NxsLabelIndex::Clear()
+	{
+	slots.clear();
+	nused = 0;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Discards the current contents of the index and indexes every label in `labels'.
+*/
+void NxsLabelIndex::Rebuild(
+  const NxsStringVector &labels)	/* the vector to index */
+	{
+	Clear();
+	unsigned n = (unsigned)labels.size();
+	unsigned nslots = 4;
+	while (nslots < 2 * n)
+		nslots *= 2;
+	Resize(nslots);
+	for (unsigned i = 0; i < n; i++)
+		Add(labels, i);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Removes the label stored at position `i' of `labels' from the index. Must be called before the label at position
+|	`i' is changed. If the same label also occurs elsewhere in `labels', the index is updated to refer to the first of
+|	the remaining occurrences; finding these requires a scan of `labels', so this function is not constant time.
+*/
+void NxsLabelIndex::Remove(
+  const NxsStringVector &labels,	/* the vector being indexed */
+  unsigned i)						/* position in `labels' of the label to remove */
+	{
+	assert(i < (unsigned)labels.size());
+	if (nused == 0)
+		return;
+
+	const NxsString &s = labels[i];
+	unsigned k = Probe(labels, s, Hash(s));
+	if (slots[k].pos != i)
+		return;
+
+	// Delete the slot, then move back any following entries whose probe sequence passed through it
+	//
+	const unsigned mask = (unsigned)slots.size() - 1;
+	slots[k].pos = UINT_MAX;
+	nused--;
+	for (unsigned m = (k + 1) & mask; slots[m].pos != UINT_MAX; m = (m + 1) & mask)
+		{
+		unsigned home = slots[m].hash & mask;
+		if (((m - home) & mask) >= ((m - k) & mask))
+			{
+			slots[k] = slots[m];
+			slots[m].pos = UINT_MAX;
+			k = m;
+			}
+		}
+
+	// Another occurrence of the same label (if any) takes over
+	//
+	unsigned n = (unsigned)labels.size();
+	for (unsigned j = 0; j < n; j++)
+		{
+		if (j != i && Matches(labels[j], s))
+			{
+			Add(labels, j);
+			break;
+			}
+		}
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Reallocates the hash table with `nslots' slots (a power of 2) and reinserts every entry.
+*/
+void NxsLabelIndex::Resize(
+  unsigned nslots)	/* the new number of slots */
+	{
+	NxsLabelSlot empty;
+	empty.hash	= 0;
+	empty.pos	= UINT_MAX;
+
+	NxsLabelSlotVector old;
+	old.swap(slots);
+	slots.assign(nslots, empty);
+
+	const unsigned mask = nslots - 1;
+	for (NxsLabelSlotVector::const_iterator p = old.begin(); p != old.end(); ++p)
+		{
+		if ((*p).pos == UINT_MAX)
+			continue;
+		unsigned k = (*p).hash & mask;
+		while (slots[k].pos != UINT_MAX)
+			k = (k + 1) & mask;
+		slots[k] = *p;
+		}
+	}
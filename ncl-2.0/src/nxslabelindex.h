@@ -0,0 +1,136 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#ifndef NCL_NXSLABELINDEX_H
+#define NCL_NXSLABELINDEX_H
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Hash index giving the position of a label within a NxsStringVector, so that blocks can look up taxon, character or
+|	state labels in constant expected time rather than by scanning the vector. The index does not hold copies of the
+|	labels: it stores only positions (and the hash of the label at each position), and every member function that needs
+|	to compare labels is handed the vector being indexed. It is up to the owner of the vector to keep the index in sync
+|	by calling Add whenever a label is appended, Remove before a label is changed, and Clear when the vector is 
+|	emptied. If the same label occurs more than once in the vector, Find returns the smallest position at which it 
+|	occurs, just as a linear search from the beginning would. Labels are compared exactly unless the index was 
+|	constructed with `respectCase' false, in which case comparisons ignore case.
+*/
+class NxsLabelIndex
+	{
+	public:
+
+						NxsLabelIndex(bool respectCase = true);
+
+		void			Add(const NxsStringVector &labels, unsigned i);
+		void			Clear();
+		unsigned		Find(const NxsStringVector &labels, const NxsString &s) const;
+		unsigned		GetSize() const;
+		void			Rebuild(const NxsStringVector &labels);
+		void			Remove(const NxsStringVector &labels, unsigned i);
+
+	private:
+
+		struct NxsLabelSlot	/* an entry in the hash table */
+			{
+			unsigned	hash;		/* hash of the label */
+			unsigned	pos;		/* position of the label in the indexed vector, or UINT_MAX if the slot is empty */
+			};
+		typedef vector<NxsLabelSlot> NxsLabelSlotVector;
+
+		NxsLabelSlotVector	slots;			/* the hash table (open addressing, linear probing; size is a power of 2) */
+		unsigned			nused;			/* number of slots in use */
+		bool				respectingCase;	/* if false, labels differing only in case are considered equal */
+
+		unsigned		Hash(const NxsString &s) const;
+		bool			Matches(const NxsString &a, const NxsString &b) const;
+		unsigned		Probe(const NxsStringVector &labels, const NxsString &s, unsigned h) const;
+		void			Resize(unsigned nslots);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of distinct labels in the index.
+*/
+inline unsigned NxsLabelIndex::GetSize() const
+	{
+	return nused;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the FNV-1a hash of `s' (of `s' in upper case if case is not being respected).
+*/
+inline unsigned NxsLabelIndex::Hash(
+  const NxsString &s) const	/* the label to hash */
+	{
+	unsigned h = 2166136261U;
+	const unsigned n = (unsigned)s.size();
+	if (respectingCase)
+		{
+		for (unsigned k = 0; k < n; k++)
+			h = (h ^ (unsigned char)s[k]) * 16777619U;
+		}
+	else
+		{
+		for (unsigned k = 0; k < n; k++)
+			h = (h ^ (unsigned char)toupper((unsigned char)s[k])) * 16777619U;
+		}
+	return h;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if labels `a' and `b' are considered the same.
+*/
+inline bool NxsLabelIndex::Matches(
+  const NxsString &a,		/* the first label */
+  const NxsString &b) const	/* the second label */
+	{
+	return (respectingCase ? (a == b) : a.EqualsCaseInsensitive(b));
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the position in `labels' of the first label equal to `s', or UINT_MAX if there is no such label.
+*/
+inline unsigned NxsLabelIndex::Find(
+  const NxsStringVector &labels,	/* the vector that has been indexed */
+  const NxsString &s) const			/* the label to find */
+	{
+	if (nused == 0)
+		return UINT_MAX;
+	return slots[Probe(labels, s, Hash(s))].pos;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the index of the slot holding label `s' (whose hash is `h'), or of the empty slot at which the search for 
+|	`s' ended. Assumes the table is not full.
+*/
+inline unsigned NxsLabelIndex::Probe(
+  const NxsStringVector &labels,	/* the vector that has been indexed */
+  const NxsString &s,				/* the label to find */
+  unsigned h) const					/* the hash of `s' */
+	{
+	const unsigned mask = (unsigned)slots.size() - 1;
+	unsigned k = h & mask;
+	for (;;)
+		{
+		const NxsLabelSlot &slot = slots[k];
+		if (slot.pos == UINT_MAX || (slot.hash == h && Matches(labels[slot.pos], s)))
+			return k;
+		k = (k + 1) & mask;
+		}
+	}
+
+#endif
@@ -0,0 +1,48 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#ifndef NCL_NXSMATRIXROWLISTENER_H
+#define NCL_NXSMATRIXROWLISTENER_H
+
+class NxsCharactersBlock;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Abstract base class for objects that want to see each row of a CHARACTERS (or DATA) block matrix as soon as it has
+|	been read, rather than waiting for the whole block. Derive a class from NxsMatrixRowListener, override RowRead, and
+|	pass an object of the derived class to NxsCharactersBlock::SetRowListener. Inside RowRead, the states of the row
+|	just read are available through the usual NxsCharactersBlock accessors (GetState, IsMissing, IsGap, etc.) using
+|	the taxon index `i'.
+|~
+|	o For a standard, non-interleaved matrix RowRead is called as each row is completed. If the listener was set with
+|	  `discardRows' true, the characters block keeps only the first row (needed for the MATCHCHAR symbol) and the row
+|	  currently being read, so that memory used does not depend on the number of taxa.
+|	o For interleaved or transposed matrices no row is complete until the whole matrix has been read, so the matrix
+|	  is stored as usual and RowRead is called for every taxon, in order, once the MATRIX command has been read.
+|~
+*/
+class NxsMatrixRowListener
+	{
+	public:
+
+		virtual			~NxsMatrixRowListener() {}
+
+		virtual void	RowRead(NxsCharactersBlock &block, unsigned i) = 0;
+	};
+
+#endif
@@ -126,6 +126,7 @@ void NxsTaxaBlock::Read(
 				throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 				}
 
+			taxonLabels.reserve(nominal_ntax);
 			for (unsigned i = 0; i < nominal_ntax; i++)
 				{
 				token.GetNextToken();
@@ -221,6 +222,7 @@ void NxsTaxaBlock::Reset()
 	ntax			= 0;
 	taxonLabels.clear();
 	needsQuotes.clear();
+	taxonIndex.Clear();
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -237,6 +239,7 @@ unsigned NxsTaxaBlock::AddTaxonLabel(
 		needsQuotes.push_back(false);
 	
 	taxonLabels.push_back(s);
+	taxonIndex.Add(taxonLabels, ntax);
 	ntax++;
 	return (ntax-1);
 	}
@@ -255,7 +258,9 @@ void NxsTaxaBlock::ChangeTaxonLabel(
 	else
 		needsQuotes[i] = false;
 
+	taxonIndex.Remove(taxonLabels, i);
 	taxonLabels[i] = s;
+	taxonIndex.Add(taxonLabels, i);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -307,9 +312,7 @@ bool NxsTaxaBlock::NeedsQuotes(
 bool NxsTaxaBlock::IsAlreadyDefined(
   NxsString s)	/* the s to attempt to find in the taxonLabels list */
 	{
-	NxsStringVector::const_iterator iter = find(taxonLabels.begin(), taxonLabels.end(), s);
-	bool taxonLabelFound = (iter != taxonLabels.end());
-	return taxonLabelFound;
+	return (taxonIndex.Find(taxonLabels, s) != UINT_MAX);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -319,16 +322,8 @@ bool NxsTaxaBlock::IsAlreadyDefined(
 unsigned NxsTaxaBlock::FindTaxon(
   NxsString s)	/* the string to attempt to find in the taxonLabels list */
 	{
-	unsigned k = 0;
-	NxsStringVector::const_iterator i;
-	for (i = taxonLabels.begin(); i != taxonLabels.end(); ++i)
-		{
-		if (*i == s)
-			break;
-		k++;
-		}
-
-	if (i == taxonLabels.end())
+	unsigned k = taxonIndex.Find(taxonLabels, s);
+	if (k == UINT_MAX)
 		throw NxsTaxaBlock::NxsX_NoSuchTaxon();
 
 	return k;
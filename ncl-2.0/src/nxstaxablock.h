@@ -23,7 +23,8 @@
 |	This class handles reading and storage for the NxsReader block TAXA. It overrides the member functions Read and 
 |	Reset, which are abstract virtual functions in the base class NxsBlock. The taxon names are stored in an vector of
 |	strings (taxonLabels) that is accessible through the member functions GetTaxonLabel(int), AddTaxonLabel(NxsString), 
-|	ChangeTaxonLabel(int, NxsString), and GetNumTaxonLabels().
+|	ChangeTaxonLabel(int, NxsString), and GetNumTaxonLabels(). A hash index (taxonIndex) kept alongside taxonLabels
+|	allows FindTaxon and IsAlreadyDefined to locate a label without scanning the whole vector.
 */
 class NxsTaxaBlock
   : public NxsBlock
@@ -54,6 +55,7 @@ class NxsTaxaBlock
 		unsigned		ntax;			/* number of taxa */
 		NxsStringVector	taxonLabels;	/* storage for list of taxon labels */
 		NxsBoolVector 	needsQuotes;	/* needsQuotes[i] true if label i needs to be quoted when output */
+		NxsLabelIndex	taxonIndex;		/* hash index of taxonLabels, kept in sync by AddTaxonLabel, ChangeTaxonLabel and Reset */
 
 		virtual void 	Read(NxsToken &token);
 
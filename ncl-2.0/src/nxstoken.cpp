@@ -25,8 +25,33 @@
 */
 NxsToken::NxsToken(
   istream &i)	/* the istream object to which the token is to be associated */
-  : in(i)
 	{
+	source		= new NxsInputSource(i);
+	ownsSource	= true;
+	Init();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Sets up a token that reads from the input source `src', which must remain in existence as long as the token is in
+|	use. The token does not take ownership of `src'.
+*/
+NxsToken::NxsToken(
+  NxsInputSource &src)	/* the input source from which tokens are to be read */
+	{
+	source		= &src;
+	ownsSource	= false;
+	Init();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes the data members common to all constructors. Assumes `source' has already been set.
+*/
+void NxsToken::Init()
+	{
+	next			= NULL;
+	last			= NULL;
+	sourceOffset	= 0;
+
 	atEOF		= false;
 	atEOL		= false;
 	comment.clear();
@@ -63,13 +88,96 @@ NxsToken::NxsToken(
 	punctuation[18]	= '<';
 	punctuation[19]	= '>';
 	punctuation[20]	= '\0';
+
+	// Classify every character once; the labile flags are applied to a copy of this table by UpdateCharClasses.
+	// Note that '\0' counts as both whitespace and punctuation, as it always has (it is found by strchr in both
+	// the `whitespace' and `punctuation' arrays).
+	//
+	const char *p;
+	memset(baseCharClass, 0, sizeof(baseCharClass));
+	for (p = whitespace; *p != '\0'; p++)
+		baseCharClass[(unsigned char)*p] |= whitespaceChar;
+	for (p = punctuation; *p != '\0'; p++)
+		baseCharClass[(unsigned char)*p] |= punctuationChar;
+	baseCharClass[0] |= (whitespaceChar | punctuationChar);
+
+	// These characters are examined individually by GetNextToken
+	//
+	for (p = "_[({\"'"; *p != '\0'; p++)
+		baseCharClass[(unsigned char)*p] |= specialChar;
+
+	memcpy(charClass, baseCharClass, sizeof(charClass));
+	appliedFlags	= 0;
+	appliedSpecial	= '\0';
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Brings the `charClass' table into agreement with the labile flags (newlineIsToken, tildeIsPunctuation, 
+|	useSpecialPunctuation, hyphenNotPunctuation and ignorePunctuation) currently set in `labileFlags', and with the 
+|	current value of `special'. Only the entries affected by these flags are touched, so the cost is a handful of 
+|	assignments (about 20 more if ignorePunctuation is involved) rather than a pass through all 256 characters.
+*/
+void NxsToken::UpdateCharClasses()
+	{
+	const char *p;
+
+	// Undo the changes made to `charClass' last time
+	//
+	if (appliedFlags & ignorePunctuation)
+		{
+		for (p = punctuation; *p != '\0'; p++)
+			charClass[(unsigned char)*p] = baseCharClass[(unsigned char)*p];
+		}
+	charClass[(unsigned char)'\n']				= baseCharClass[(unsigned char)'\n'];
+	charClass[(unsigned char)'~']				= baseCharClass[(unsigned char)'~'];
+	charClass[(unsigned char)'-']				= baseCharClass[(unsigned char)'-'];
+	charClass[(unsigned char)appliedSpecial]	= baseCharClass[(unsigned char)appliedSpecial];
+
+	// Now apply the flags currently in effect, in the same order of precedence as always: tilde and special
+	// characters are added to the punctuation set before the hyphen is (possibly) removed
+	//
+	appliedFlags	= (labileFlags & charClassFlags);
+	appliedSpecial	= special;
+
+	if (appliedFlags & ignorePunctuation)
+		{
+		for (p = punctuation; *p != '\0'; p++)
+			charClass[(unsigned char)*p] &= ~punctuationChar;
+		}
+	if (appliedFlags & newlineIsToken)
+		charClass[(unsigned char)'\n'] = specialChar;
+	if (appliedFlags & tildeIsPunctuation)
+		charClass[(unsigned char)'~'] |= punctuationChar;
+	if (appliedFlags & useSpecialPunctuation)
+		charClass[(unsigned char)special] |= punctuationChar;
+	if (appliedFlags & hyphenNotPunctuation)
+		charClass[(unsigned char)'-'] &= ~punctuationChar;
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Nothing needs to be done; all objects take care of deleting themselves.
+|	Deletes the input source if it was created by the constructor.
 */
 NxsToken::~NxsToken()
 	{
+	if (ownsSource)
+		delete source;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Obtains the next range of characters from `source', updating `next', `last' and `sourceOffset'. Returns false if
+|	there are no more characters to be read.
+*/
+bool NxsToken::NextChunk()
+	{
+	const char *first;
+	const char *end;
+	if (!source->NextChunk(first, end))
+		return false;
+
+	next			= first;
+	last			= end;
+	sourceOffset	+= (streamoff)(end - first);
+	return true;
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -459,6 +567,14 @@ void NxsToken::GetNextToken()
 		if (atEOF)
 			break;
 
+		// Ordinary darkspace characters (by far the most common case) need no further examination
+		//
+		if (charClass[(unsigned char)ch] == 0)
+			{
+			AppendToToken(ch);
+			continue;
+			}
+
 		if (ch == '\n' && labileFlags & newlineIsToken)
 			{
 			if (token.size() > 0)
@@ -594,6 +710,8 @@ void NxsToken::GetNextToken()
 		}
 
 	labileFlags = 0;
+	if (appliedFlags != 0)
+		UpdateCharClasses();
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -30,7 +30,9 @@
 |	time from the input stream, and comments are correctly read and either written to the output stream (if an output
 |	comment) or ignored (if not an output comment). Sequences of characters surrounded by single quotes are read in as
 |	single tokens. A pair of adjacent single quotes are stored as a single quote, and underscore characters are stored
-|	as blanks.
+|	as blanks. Characters are obtained from a NxsInputSource object in large contiguous ranges and scanned with a 
+|	pointer. A token constructed from an istream creates (and owns) an input source reading from that stream; a token
+|	constructed from a NxsInputSource (e.g., one that has memory-mapped the file) reads from that source instead.
 */
 class NxsToken
 	{
@@ -54,6 +56,7 @@ class NxsToken
 		NxsString		errormsg;
 
 						NxsToken(istream &i);
+						NxsToken(NxsInputSource &src);
 		virtual			~NxsToken();
 
 		bool			AtEOF();
@@ -65,6 +68,7 @@ class NxsToken
 		long			GetFileColumn() const;
 		file_pos		GetFilePosition() const;
 		long			GetFileLine() const;
+		char			GetNextSymbol();
 		void			GetNextToken();
 		NxsString		GetToken(bool respect_case = true);
 		const char		*GetTokenAsCStr(bool respect_case = true);
@@ -100,7 +104,23 @@ class NxsToken
 
 	private:
 
-		istream			&in;				/* reference to input stream from which tokens will be read */
+		enum NxsCharClass	/* bits stored in the `charClass' table */
+			{
+			whitespaceChar	= 0x01,	/* character is currently whitespace */
+			punctuationChar	= 0x02,	/* character is currently punctuation */
+			specialChar		= 0x04	/* character needs individual attention in GetNextToken */
+			};
+
+		enum
+			{
+			charClassFlags = newlineIsToken | tildeIsPunctuation | useSpecialPunctuation | hyphenNotPunctuation | ignorePunctuation	/* labile flags affecting `charClass' */
+			};
+
+		NxsInputSource	*source;			/* input source from which tokens will be read */
+		bool			ownsSource;			/* true if `source' was created by this object (and must be deleted by it) */
+		const char		*next;				/* next character to be read from the current range supplied by `source' */
+		const char		*last;				/* one past the last character of the current range supplied by `source' */
+		streamoff		sourceOffset;		/* file offset corresponding to `last' */
 		file_pos		filepos;			/* current file position (for Metrowerks compiler, type is streampos rather than long) */
 		long			fileline;			/* current file line */
 		long			filecol;			/* current column in current line (refers to column immediately following token just read) */
@@ -113,6 +133,17 @@ class NxsToken
 		int				labileFlags;		/* storage for flags in the NxsTokenFlags enum */
 		char			punctuation[21];	/* stores the 20 NEXUS punctuation characters */
 		char			whitespace[4];		/* stores the 3 whitespace characters: blank space, tab and newline */
+		unsigned char	baseCharClass[256];	/* NxsCharClass bits for every character when no labile flags are set */
+		unsigned char	charClass[256];		/* NxsCharClass bits for every character under the labile flags in effect */
+		int				appliedFlags;		/* the bits of `labileFlags' in charClassFlags that `charClass' reflects */
+		char			appliedSpecial;		/* the value of `special' that `charClass' reflects */
+
+		void			Init();
+		void			UpdateCharClasses();
+		bool			NextChunk();
+
+						NxsToken(const NxsToken &);				/* not implemented: tokens cannot be copied */
+		NxsToken		&operator=(const NxsToken &);			/* not implemented: tokens cannot be copied */
 	};
 
 typedef NxsToken NexusToken;
@@ -164,7 +195,7 @@ inline void NxsToken::AppendToToken(
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Reads next character from in and does all of the following before returning it to the calling function:
+|	Reads next character from `source' and does all of the following before returning it to the calling function:
 |~
 |	o if character read is either a carriage return or line feed, the variable line is incremented by one and the
 |	  variable col is reset to zero
@@ -173,51 +204,86 @@ inline void NxsToken::AppendToToken(
 |	o if either a carriage return or line feed is read, the character returned to the calling function is '\n' if 
 |	  character read is neither a carriage return nor a line feed, col is incremented by one and the character is
 |	  returned as is to the calling function
-|	o in all cases, the variable filepos is updated using a call to the tellg function of istream.
+|	o in all cases, the variable filepos is updated to the offset of the next character to be read.
 |~
+|	Characters are taken directly from the range [`next', `last'); `source' is consulted only when that range is
+|	exhausted.
 */
 inline char NxsToken::GetNextChar()
 	{
-	int ch = in.get();
-	int failed = in.bad();
-	if (failed)
+	if (next == last && !NextChunk())
 		{
-		errormsg = "Unknown error reading data file (check to make sure file exists)";
-		throw NxsException(errormsg);
+		atEOF = 1;
+		filepos = (file_pos)sourceOffset;
+		return '\0';
 		}
 
+	int ch = (unsigned char)*next++;
+
 	if (ch == 13 || ch == 10)
 		{
 		fileline++;
 		filecol = 1L;
 
-		if (ch == 13 && (int)in.peek() == 10)
-			ch = in.get();
+		if (ch == 13 && (next != last || NextChunk()) && *next == 10)
+			next++;
 
 		atEOL = 1;
 		}
-	else if (ch == EOF)
-		atEOF = 1;
 	else
 		{
 		filecol++;
 		atEOL = 0;
 		}
 
-#	if defined(__DECCXX)
-		filepos = 0L;
-#	else
-		filepos = in.tellg();
-#	endif
+	filepos = (file_pos)(sourceOffset - (last - next));
 
-	if (atEOF)
-		return '\0';
-	else if (atEOL)
+	if (atEOL)
 		return '\n';
 	else
 		return (char)ch;
 	}
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	A faster alternative to GetNextToken for use when the labile flag singleCharacterToken is in effect (e.g., when 
+|	reading the cells of a data matrix in which every state is a single symbol). Whitespace and comments are skipped 
+|	exactly as GetNextToken would skip them. If the next token then turns out to be a single ordinary darkspace 
+|	character, that character is returned directly: the token buffer is left empty, the labile flags are cleared, and
+|	no NxsString is built. In every other case (punctuation, quotes, underscores, parenthetical or curly-bracketed 
+|	tokens, newlines when newlineIsToken is in effect, or end of file), the token is read by GetNextToken in the usual
+|	way and '\0' is returned, so the caller must then examine the token as usual.
+*/
+inline char NxsToken::GetNextSymbol()
+	{
+	if (labileFlags & singleCharacterToken)
+		{
+		char ch = saved;
+		if (ch == '\0' || IsWhitespace(ch))
+			{
+			do
+				ch = GetNextChar();
+			while (IsWhitespace(ch) && !atEOF);
+			}
+
+		if (!atEOF && charClass[(unsigned char)ch] == 0)
+			{
+			ResetToken();
+			saved = '\0';
+			labileFlags = 0;
+			if (appliedFlags != 0)
+				UpdateCharClasses();
+			return ch;
+			}
+
+		// Let GetNextToken start from the character just read
+		//
+		saved = ch;
+		}
+
+	GetNextToken();
+	return '\0';
+	}
+
 /*----------------------------------------------------------------------------------------------------------------------
 |	Returns true if character supplied is considered a punctuation character. The following twenty characters are 
 |	considered punctuation characters:
@@ -241,17 +307,9 @@ inline bool NxsToken::IsPunctuation(
 	//  o allows ]`<> inside taxon names
 	//  o allows `<> inside taxset names
 	//
-	bool is_punctuation = false;
-	if (strchr(punctuation, ch) != NULL)
-		is_punctuation = true;
-	if (labileFlags & tildeIsPunctuation  && ch == '~')
-		is_punctuation = true;
-	if (labileFlags & useSpecialPunctuation  && ch == special)
-		is_punctuation = true;
-	if (labileFlags & hyphenNotPunctuation  && ch == '-')
-		is_punctuation = false;
-
-	return is_punctuation;
+	// The labile flags are already accounted for in `charClass' (see UpdateCharClasses)
+	//
+	return ((charClass[(unsigned char)ch] & punctuationChar) != 0);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -261,20 +319,9 @@ inline bool NxsToken::IsPunctuation(
 inline bool NxsToken::IsWhitespace(
   char ch)	/* the character in question */
 	{
-	bool ws = false;
-
-	// If ch is found in the whitespace array, it's whitespace
+	// If newlineIsToken is in effect, '\n' has already been removed from the whitespace class in `charClass'
 	//
-	if (strchr(whitespace, ch) != NULL)
-		ws = true;
-
-	// Unless of course ch is the newline character and we're currently
-	// treating newlines as darkspace!
-	//
-	if (labileFlags & newlineIsToken && ch == '\n')
-		ws = false;
-
-	return ws;
+	return ((charClass[(unsigned char)ch] & whitespaceChar) != 0);
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -429,16 +476,21 @@ inline void NxsToken::SetSpecialPunctuationCharacter(
   char c)	/* the character to which `special' is set */
 	{
 	special = c;
+	if (labileFlags & useSpecialPunctuation)
+		UpdateCharClasses();
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
 |	Sets the bit specified in the variable `labileFlags'. The available bits are specified in the NxsTokenFlags enum.
-|	All bits in `labileFlags' are cleared after each token is read.
+|	All bits in `labileFlags' are cleared after each token is read. Bits that change the way characters are classified
+|	cause the `charClass' table to be brought up to date.
 */
 inline void NxsToken::SetLabileFlagBit(
   int bit)	/* the bit (see NxsTokenFlags enum) to set in `labileFlags' */
 	{
 	labileFlags |= bit;
+	if ((labileFlags & charClassFlags) != appliedFlags)
+		UpdateCharClasses();
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#include "ncl.h"
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Initializes an empty tree.
+*/
+NxsTree::NxsTree()
+	{
+	Clear();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Removes every node, leaving an empty unrooted tree.
+*/
+void NxsTree::Clear()
+	{
+	nodes.clear();
+	nleaves		= 0;
+	rooted		= false;
+	hasLengths	= false;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Appends a node with no children to the tree and returns its index. The node becomes the last child of `parent',
+|	whose last child so far was `lastSibling' (UINT_MAX if the node is the first child, or the root).
+*/
+unsigned NxsTree::AddNode(
+  unsigned parent,		/* the parent of the new node, or UINT_MAX for the root */
+  unsigned lastSibling,	/* the previous child of `parent', or UINT_MAX */
+  unsigned taxon)		/* the taxon of the new node if it is a leaf, or UINT_MAX */
+	{
+	unsigned k = (unsigned)nodes.size();
+
+	NxsTreeNode node;
+	node.parent			= parent;
+	node.firstChild		= UINT_MAX;
+	node.nextSibling	= UINT_MAX;
+	node.taxon			= taxon;
+	node.edgeLength		= 0.0;
+	nodes.push_back(node);
+
+	if (lastSibling != UINT_MAX)
+		nodes[lastSibling].nextSibling = k;
+	else if (parent != UINT_MAX)
+		nodes[parent].firstChild = k;
+	if (taxon != UINT_MAX)
+		nleaves++;
+
+	return k;
+	}
@@ -0,0 +1,133 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#ifndef NCL_NXSTREE_H
+#define NCL_NXSTREE_H
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	A tree of a TREES block in parsed form, so that the topology can be walked without going back to the description.
+|	The nodes are held in a single contiguous vector, in the order in which they begin in the description (preorder),
+|	so the root is always node 0 and every node comes before its descendants. Nodes refer to one another by index:
+|~
+|	o `parent' is the node's parent (UINT_MAX for the root);
+|	o `firstChild' is its first child, in the order of the description (UINT_MAX for a leaf);
+|	o `nextSibling' is the next child of its parent (UINT_MAX for the last child).
+|~
+|	Each leaf gives the 0-offset index of its taxon in the NxsTaxaBlock (the TRANSLATE command, if there was one,
+|	having been applied), and each node the length of the branch leading to it (0.0 if none was given). Labels of
+|	internal nodes and comments are not kept. Trees are built by NxsTreesBlock (see NxsTreesBlock::GetTree):
+|>
+|	const NxsTree &tree = trees.GetTree(i);
+|	for (unsigned k = tree.GetNumNodes(); k-- > 0;)
+|		{
+|		const NxsTree::NxsTreeNode &node = tree.GetNode(k);	// children are visited before their parents
+|		...
+|		}
+|>
+*/
+class NxsTree
+	{
+	friend class NxsTreesBlock;
+
+	public:
+
+		struct NxsTreeNode	/* a node of the tree */
+			{
+			unsigned		parent;			/* index of the parent, or UINT_MAX for the root */
+			unsigned		firstChild;		/* index of the first child, or UINT_MAX for a leaf */
+			unsigned		nextSibling;	/* index of the next child of the same parent, or UINT_MAX */
+			unsigned		taxon;			/* 0-offset index of the taxon of a leaf, or UINT_MAX for an internal node */
+			double			edgeLength;		/* length of the branch leading to the node (0.0 if not given) */
+			};
+
+							NxsTree();
+
+		void				Clear();
+		const NxsTreeNode	&GetNode(unsigned k) const;
+		unsigned			GetNumLeaves() const;
+		unsigned			GetNumNodes() const;
+		bool				HasEdgeLengths() const;
+		bool				IsLeaf(unsigned k) const;
+		bool				IsRooted() const;
+
+	private:
+
+		typedef vector<NxsTreeNode>	NxsTreeNodeVector;
+
+		NxsTreeNodeVector	nodes;			/* the nodes, in preorder */
+		unsigned			nleaves;		/* number of leaves */
+		bool				rooted;			/* true if the tree is rooted */
+		bool				hasLengths;		/* true if a length was given for at least one branch */
+
+		unsigned			AddNode(unsigned parent, unsigned lastSibling, unsigned taxon);
+	};
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns node `k', which must be less than GetNumNodes().
+*/
+inline const NxsTree::NxsTreeNode &NxsTree::GetNode(
+  unsigned k) const	/* the index of the node */
+	{
+	assert(k < nodes.size());
+	return nodes[k];
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of leaves (taxa) in the tree.
+*/
+inline unsigned NxsTree::GetNumLeaves() const
+	{
+	return nleaves;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the number of nodes, leaves included.
+*/
+inline unsigned NxsTree::GetNumNodes() const
+	{
+	return (unsigned)nodes.size();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the description gave the length of at least one branch.
+*/
+inline bool NxsTree::HasEdgeLengths() const
+	{
+	return hasLengths;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if node `k' is a leaf.
+*/
+inline bool NxsTree::IsLeaf(
+  unsigned k) const	/* the index of the node */
+	{
+	assert(k < nodes.size());
+	return (nodes[k].firstChild == UINT_MAX);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the tree is rooted (see NxsTreesBlock::IsRootedTree).
+*/
+inline bool NxsTree::IsRooted() const
+	{
+	return rooted;
+	}
+
+#endif
@@ -0,0 +1,49 @@
+//	Copyright (C) 2024 Mauro J. Cavalcanti
+//
+//	This file is part of NCL (Nexus Class Library) version 2.0.
+//
+//	NCL is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	NCL is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with NCL; if not, write to the Free Software Foundation, Inc.,
+//	59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+
+#ifndef NCL_NXSTREELISTENER_H
+#define NCL_NXSTREELISTENER_H
+
+class NxsTree;
+class NxsTreesBlock;
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Abstract base class for objects that want to see each tree of a TREES block as soon as its TREE (or UTREE) command
+|	has been read, rather than waiting for the whole block. Derive a class from NxsTreeListener, override TreeRead, and
+|	pass an object of the derived class to NxsTreesBlock::SetTreeListener. TreeRead is handed the tree in parsed form
+|	(see NxsTree), with the TRANSLATE command already applied to its leaves; the name and rooting of the tree are
+|	available through the usual NxsTreesBlock accessors (GetTreeName, IsRootedTree) using the tree index `i'.
+|~
+|	o If the listener was set with `discardTrees' true, the description of each tree is dropped once the listener has
+|	  seen it, so that memory used by the block does not depend on the size of the trees: only their names and
+|	  rooting are kept.
+|	o An exception of type NxsException thrown by TreeRead stops the reading of the data file, and is reported with
+|	  the position of the TREE command in the file.
+|~
+*/
+class NxsTreeListener
+	{
+	public:
+
+		virtual			~NxsTreeListener() {}
+
+		virtual void	TreeRead(NxsTreesBlock &block, unsigned i, const NxsTree &tree) = 0;
+	};
+
+#endif
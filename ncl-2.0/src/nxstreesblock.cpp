@@ -32,13 +32,18 @@ NxsTreesBlock::NxsTreesBlock(
 	taxa		= tb;
 	ntrees		= 0;
 	defaultTree	= 0;
+
+	treeListener	= NULL;
+	discardingTrees	= true;
+	treesDiscarded	= false;
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Clears `translateList', `rooted', `treeName' and `treeDescription'.
+|	Clears `translateList', `rooted', `treeName' and `treeDescription', and deletes the parsed trees.
 */
 NxsTreesBlock::~NxsTreesBlock()
 	{
+	ClearParsedTrees();
 	translateList.clear();
 	rooted.clear();
 	treeName.clear();
@@ -55,6 +60,20 @@ void NxsTreesBlock::ReplaceTaxaBlockPtr(
 	assert(tb != NULL);
 
 	taxa = tb;
+	ClearParsedTrees();
+	IndexLeafNames();
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Deletes the parsed trees, so that each will be parsed again the next time it is asked for.
+*/
+void NxsTreesBlock::ClearParsedTrees()
+	{
+	for (unsigned i = 0; i < parsedTrees.size(); i++)
+		{
+		delete parsedTrees[i];
+		parsedTrees[i] = NULL;
+		}
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -168,6 +187,7 @@ void NxsTreesBlock::HandleTreeDescription(
 	ntrees++;
 	treeName.push_back(skey);
 	treeDescription.push_back(sval);
+	parsedTrees.push_back(NULL);
 
 	if (tree_is_unrooted)
 		rooted.push_back(false);
@@ -175,6 +195,26 @@ void NxsTreesBlock::HandleTreeDescription(
 		rooted.push_back(true);
 
 	assert(rooted.size() == (unsigned)ntrees);
+
+	// Hand the tree to the listener, if any, reporting anything wrong with it at the position of the command
+	//
+	if (treeListener != NULL)
+		{
+		try
+			{
+			ParseTree(ntrees - 1, listenedTree);
+			treeListener->TreeRead(*this, ntrees - 1, listenedTree);
+			}
+		catch (NxsException &x)
+			{
+			throw NxsException(x.msg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
+			}
+		if (discardingTrees)
+			{
+			NxsString().swap(treeDescription.back());
+			treesDiscarded = true;
+			}
+		}
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -198,6 +238,10 @@ void NxsTreesBlock::Read(
 		throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 		}
 
+	// Trees handed to a listener are parsed as they are read, so leaves must be resolved before the block is finished
+	//
+	IndexLeafNames();
+
 	for (;;)
 		{
 		token.GetNextToken();
@@ -278,6 +322,8 @@ void NxsTreesBlock::Read(
 					throw NxsException(errormsg, token.GetFilePosition(), token.GetFileLine(), token.GetFileColumn());
 					}
 				}	// for (unsigned k = 0; ; k++) 
+
+			IndexLeafNames();
 			}	// if (token.Equals("TRANSLATE")) 
 
 		else if (token.Equals("TREE")) 
@@ -339,10 +385,12 @@ void NxsTreesBlock::Read(
 				}
 			}
 		}	// for (;;)
+
+	IndexLeafNames();
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
-|	Flushes `treeName', `treeDescription', `translateList' and `rooted', and sets `ntrees' and `defaultTree' both to 0
+|	Flushes `treeName', `treeDescription', `translateList', `rooted' and the parsed trees, and sets `ntrees' and `defaultTree' both to 0
 |	in preparation for reading a new TREES block.
 */
 void NxsTreesBlock::Reset()
@@ -361,6 +409,13 @@ void NxsTreesBlock::Reset()
 	treeDescription.clear();
 	translateList.clear();
 	rooted.clear();
+	treesDiscarded = false;
+
+	ClearParsedTrees();
+	parsedTrees.clear();
+	leafNames.clear();
+	leafNameIndex.Clear();
+	leafNameTaxon.clear();
 	}
 
 /*----------------------------------------------------------------------------------------------------------------------
@@ -397,7 +452,8 @@ NxsString NxsTreesBlock::GetTreeName(
 /*----------------------------------------------------------------------------------------------------------------------
 |	Returns the description of the tree stored at position `i' in `treeName'. Assumes that `i' will be in the range 
 |	[0..ntrees). Node numbers will be translated to names in the resulting tree description. Use GetTreeDescription if 
-|	translation is not desired.
+|	translation is not desired. Throws NxsException if the description was dropped after being passed to the tree
+|	listener (see SetTreeListener).
 */
 NxsString NxsTreesBlock::GetTranslatedTreeDescription(
   unsigned i)	/* the index of the tree for which the description is to be returned */
@@ -405,6 +461,9 @@ NxsString NxsTreesBlock::GetTranslatedTreeDescription(
 	assert(i >= 0);
 	assert(i < ntrees);
 
+	if (treesDiscarded && treeDescription[i].empty())
+		TreeError(i, "description was not kept");
+
 	bool adding_labels = (taxa->GetNumTaxonLabels() == 0);
 
 	// s is the original tree definition string 
@@ -454,6 +513,45 @@ NxsString NxsTreesBlock::GetTranslatedTreeDescription(
 	return x;
 	}
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the translation table, which maps each key given in the TRANSLATE command to its taxon label (and is empty
+|	if there was no TRANSLATE command). Unlike GetTranslatedTreeDescription, this does not modify the block, so several
+|	threads may look up keys in the table at the same time.
+*/
+const NxsStringMap &NxsTreesBlock::GetTranslateList()
+	{
+	return translateList;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the parsed form of tree `i' (see ParseTree), parsing its description if this is the first time the tree has
+|	been asked for. Assumes that `i' will be in the range [0..ntrees). The tree remains valid until the block is reset
+|	or given another NxsTaxaBlock. Several threads may call GetTree at once, provided that no two of them ask for the
+|	same tree before it has been built. Throws NxsException if the description is not a valid tree (in which case the
+|	tree is not kept).
+*/
+const NxsTree &NxsTreesBlock::GetTree(
+  unsigned i)	/* the index of the tree */
+	{
+	assert(i < ntrees);
+
+	if (parsedTrees[i] == NULL)
+		{
+		NxsTree *tree = new NxsTree();
+		try
+			{
+			ParseTree(i, *tree);
+			}
+		catch (NxsException &)
+			{
+			delete tree;
+			throw;
+			}
+		parsedTrees[i] = tree;
+		}
+	return *parsedTrees[i];
+	}
+
 /*----------------------------------------------------------------------------------------------------------------------
 |	Returns the description of the tree stored at position `i' in `treeDescription'. Assumes that `i' will be in the 
 |	range [0..`ntrees').
@@ -555,3 +653,231 @@ void NxsTreesBlock::BriefReport(
 		s += " trees\n";
 		}
 	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Rebuilds `leafNames' and its index from the translation table and the taxon labels. TRANSLATE keys come first, so
+|	that they are found in preference to taxon labels.
+*/
+void NxsTreesBlock::IndexLeafNames()
+	{
+	leafNames.clear();
+	leafNameTaxon.clear();
+	for (NxsStringMap::const_iterator k = translateList.begin(); k != translateList.end(); k++)
+		{
+		leafNames.push_back(k->first);
+		leafNameTaxon.push_back(taxa->FindTaxon(k->second));
+		}
+	unsigned ntax = taxa->GetNumTaxonLabels();
+	for (unsigned j = 0; j < ntax; j++)
+		{
+		leafNames.push_back(taxa->GetTaxonLabel(j));
+		leafNameTaxon.push_back(j);
+		}
+	leafNameIndex.Rebuild(leafNames);
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns the taxon named `label' in tree `i', which may be a TRANSLATE key, a taxon label or, if there is no
+|	TRANSLATE command, a taxon number (1 to ntax). Throws NxsException if there is no such taxon.
+*/
+unsigned NxsTreesBlock::FindLeafTaxon(
+  unsigned i,				/* the tree */
+  const NxsString &label)	/* the label found in the description */
+	{
+	unsigned k = leafNameIndex.Find(leafNames, label);
+	if (k != UINT_MAX)
+		return leafNameTaxon[k];
+
+	unsigned ntax = taxa->GetNumTaxonLabels();
+	if (translateList.empty() && !label.empty())
+		{
+		unsigned n = 0;
+		unsigned c = 0;
+		while (c < label.size() && isdigit((unsigned char)label[c]) && n <= ntax)
+			n = 10 * n + (label[c++] - '0');
+		if (c == label.size() && n >= 1 && n <= ntax)
+			return n - 1;
+		}
+
+	NxsString msg = "unknown taxon ";
+	msg += label;
+	TreeError(i, msg);
+	return UINT_MAX;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Parses the description of tree `i' into `tree' (whatever it held before is lost). Assumes that `i' will be in the
+|	range [0..ntrees). Leaves are named by TRANSLATE keys, taxon labels or taxon numbers (see FindLeafTaxon); quoted
+|	labels are unquoted, and underscores in unquoted labels are read as blanks. A tree need not have every taxon, but
+|	none may occur twice. Labels of internal nodes and comments are skipped. Unlike GetTree, this does not keep the
+|	tree, and may be called for the same tree from several threads at once. Throws NxsException, with a message naming
+|	the tree, if the description is not a valid tree.
+*/
+void NxsTreesBlock::ParseTree(
+  unsigned i,		/* the index of the tree */
+  NxsTree &tree)	/* on return, the tree */
+	{
+	assert(i < ntrees);
+
+	if (treesDiscarded && treeDescription[i].empty())
+		TreeError(i, "description was not kept");
+
+	tree.Clear();
+	tree.rooted = rooted[i];
+
+	const NxsString &d = treeDescription[i];
+	const char *s = d.c_str();
+	const unsigned len = (unsigned)d.size();
+
+	// For each group still open, the node of the group and its last child so far
+	//
+	vector< pair<unsigned, unsigned> > open;
+	vector<char> seen(taxa->GetNumTaxonLabels(), 0);
+	unsigned last = UINT_MAX;	// the node just finished, to which a branch length may be given
+	bool expectNode = true;		// after '(' or ',': a taxon or a group must follow
+	bool closed = false;		// just after ')': the group may be labelled
+	NxsString label;
+
+	unsigned k = 0;
+	while (k < len && s[k] != ';')
+		{
+		char ch = s[k];
+		if (isspace((unsigned char)ch))
+			k++;
+
+		else if (ch == '[')
+			{
+			while (k < len && s[k] != ']')
+				k++;
+			if (k == len)
+				TreeError(i, "unterminated comment");
+			k++;
+			}
+
+		else if (ch == '(')
+			{
+			if (!expectNode)
+				TreeError(i, "unexpected '('");
+			unsigned parent = (open.empty() ? UINT_MAX : open.back().first);
+			unsigned sibling = (open.empty() ? UINT_MAX : open.back().second);
+			unsigned node = tree.AddNode(parent, sibling, UINT_MAX);
+			if (!open.empty())
+				open.back().second = node;
+			open.push_back(pair<unsigned, unsigned>(node, UINT_MAX));
+			k++;
+			}
+
+		else if (ch == ',' || ch == ')')
+			{
+			if (open.empty() || expectNode)
+				TreeError(i, (ch == ',' ? "unexpected ','" : "unexpected ')'"));
+			k++;
+			closed = false;
+			if (ch == ',')
+				{
+				expectNode = true;
+				continue;
+				}
+			last = open.back().first;
+			open.pop_back();
+			closed = true;
+			}
+
+		else if (ch == ':')
+			{
+			if (expectNode)
+				TreeError(i, "unexpected ':'");
+			closed = false;
+			unsigned start = ++k;
+			while (k < len && !isspace((unsigned char)s[k]) && strchr("(),:;[", s[k]) == NULL)
+				k++;
+			NxsString number;
+			number.append(s + start, k - start);
+			char *end = NULL;
+			double v = strtod(number.c_str(), &end);
+			if (number.empty() || *end != '\0')
+				{
+				NxsString msg = "invalid branch length ";
+				msg += number;
+				TreeError(i, msg);
+				}
+			tree.nodes[last].edgeLength = v;
+			tree.hasLengths = true;
+			}
+
+		else
+			{
+			// A taxon or the label of a group
+			//
+			label.clear();
+			if (ch == '\'')
+				{
+				for (k++; ; k++)
+					{
+					if (k == len)
+						TreeError(i, "unterminated quoted label");
+					if (s[k] == '\'')
+						{
+						if (k + 1 < len && s[k + 1] == '\'')
+							k++;
+						else
+							break;
+						}
+					label += s[k];
+					}
+				k++;
+				}
+			else
+				{
+				for (; k < len && !isspace((unsigned char)s[k]) && strchr("(),:;[]'", s[k]) == NULL; k++)
+					label += (s[k] == '_' ? ' ' : s[k]);
+				}
+
+			if (closed)
+				{
+				closed = false;
+				continue;
+				}
+			if (!expectNode)
+				{
+				NxsString msg = "unexpected label ";
+				msg += label;
+				TreeError(i, msg);
+				}
+
+			unsigned j = FindLeafTaxon(i, label);
+			if (seen[j])
+				{
+				NxsString msg = "taxon ";
+				msg += label;
+				msg += " occurs more than once";
+				TreeError(i, msg);
+				}
+			seen[j] = 1;
+
+			unsigned parent = (open.empty() ? UINT_MAX : open.back().first);
+			unsigned sibling = (open.empty() ? UINT_MAX : open.back().second);
+			last = tree.AddNode(parent, sibling, j);
+			if (!open.empty())
+				open.back().second = last;
+			expectNode = false;
+			}
+		}
+
+	if (!open.empty() || expectNode)
+		TreeError(i, "unbalanced parentheses");
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Throws NxsException with message `msg' about tree `i'.
+*/
+void NxsTreesBlock::TreeError(
+  unsigned i,				/* the tree */
+  const NxsString &msg)		/* what is wrong with it */
+	{
+	NxsString s = "Tree ";
+	s += treeName[i];
+	s += ": ";
+	s += msg;
+	throw NxsException(s);
+	}
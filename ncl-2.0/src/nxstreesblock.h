@@ -33,10 +33,11 @@
 |>
 |	NEXUS command     Data members    Member functions
 |	-----------------------------------------------------
-|	TRANSLATE         translateList
+|	TRANSLATE         translateList   GetTranslateList
 |	
 |	TREE              treeName        GetTreeName
-|	                                  GetTreeDescription
+|	                  treeDescription GetTreeDescription
+|	                                  GetTree
 |	                                  GetNumTrees
 |	                                  GetNumDefaultTree
 |	                                  IsDefaultTree
@@ -44,6 +45,12 @@
 |	                  rooted          IsRootedTree
 |	-----------------------------------------------------
 |>
+|	GetTree gives the parsed form of a tree (NxsTree), which is built from the description the first time it is asked
+|	for and kept until the block is reset, so that analyses can walk the topology as often as they like at the cost
+|	of parsing each description once. Different trees may be asked for from different threads at the same time, as may
+|	trees that have already been built; ParseTree parses a tree afresh without keeping it. Files holding more trees
+|	than can be kept in memory can be summarised as they are read by supplying an NxsTreeListener (SetTreeListener),
+|	which is handed each tree as soon as it has been read and parsed, after which its description may be dropped.
 */
 class NxsTreesBlock 
   : public NxsBlock
@@ -52,14 +59,19 @@ class NxsTreesBlock
 							NxsTreesBlock(NxsTaxaBlock *tb);
 		virtual				~NxsTreesBlock();
 
+				bool		AreTreesDiscarded();
 				void		ReplaceTaxaBlockPtr(NxsTaxaBlock *tb);
 				unsigned	GetNumDefaultTree();
 				unsigned	GetNumTrees();
 				NxsString	GetTreeName(unsigned i);
 				NxsString	GetTreeDescription(unsigned i);
 				NxsString	GetTranslatedTreeDescription(unsigned i);
+				const NxsStringMap &GetTranslateList();
+				const NxsTree &GetTree(unsigned i);
 				bool		IsDefaultTree(unsigned i);
 				bool		IsRootedTree(unsigned i);
+				void		ParseTree(unsigned i, NxsTree &tree);
+				void		SetTreeListener(NxsTreeListener *listener, bool discardTrees = true);
 		virtual void		Report(std::ostream &out);
 		virtual void		BriefReport(NxsString &s);
 		virtual void		Reset();
@@ -73,11 +85,47 @@ class NxsTreesBlock
 		NxsTaxaBlock		*taxa;				/* pointer to existing NxsTaxaBlock object */
 		unsigned			ntrees;				/* number of trees stored */
 		unsigned			defaultTree;		/* 0-offset index of default tree specified by user, or 0 if user failed to specify a default tree using an asterisk in the NEXUS data file */
+		vector<NxsTree *>	parsedTrees;		/* parsed form of each tree, or NULL if it has not been asked for yet */
+		NxsStringVector		leafNames;			/* names by which leaves may give their taxa: the TRANSLATE keys, then the taxon labels */
+		NxsLabelIndex		leafNameIndex;		/* hash index of `leafNames' */
+		NxsUnsignedVector	leafNameTaxon;		/* the taxon given by each of `leafNames' */
+		NxsTreeListener		*treeListener;		/* object told about each tree as it is read, or NULL (not changed by Reset) */
+		bool				discardingTrees;	/* if true, descriptions are dropped once `treeListener' has seen them (not changed by Reset) */
+		bool				treesDiscarded;		/* true if the descriptions of the trees were dropped (see SetTreeListener) */
+		NxsTree				listenedTree;		/* the tree most recently handed to `treeListener' */
 
 		virtual	void		Read(NxsToken &token);
+		void				ClearParsedTrees();
+		unsigned			FindLeafTaxon(unsigned i, const NxsString &label);
 		void				HandleTreeDescription(NxsToken &token, bool utree);
+		void				IndexLeafNames();
+		void				TreeError(unsigned i, const NxsString &msg);
 	};
 
 typedef NxsTreesBlock TreesBlock;
 
+/*----------------------------------------------------------------------------------------------------------------------
+|	Returns true if the descriptions of the trees were dropped once the tree listener had seen them (see 
+|	SetTreeListener), in which case only the names and rooting of the trees remain available.
+*/
+inline bool NxsTreesBlock::AreTreesDiscarded()
+	{
+	return treesDiscarded;
+	}
+
+/*----------------------------------------------------------------------------------------------------------------------
+|	Supplies an object to be told about each tree as soon as it has been read, so that the trees can be summarised in
+|	a single pass over the data file (see NxsTreeListener). If `discardTrees' is true, the description of each tree is
+|	not kept once the listener has seen it: GetTreeDescription then returns an empty string, and GetTree and
+|	GetTranslatedTreeDescription throw NxsException (use AreTreesDiscarded to find out whether this happened). Specify
+|	NULL for `listener' to stop listening. The setting survives calls to Reset.
+*/
+inline void NxsTreesBlock::SetTreeListener(
+  NxsTreeListener *listener,	/* the object to be told about each tree, or NULL */
+  bool discardTrees)			/* true if descriptions may be dropped once the listener has seen them */
+	{
+	treeListener	= listener;
+	discardingTrees	= discardTrees;
+	}
+
 #endif